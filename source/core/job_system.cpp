@@ -0,0 +1,254 @@
+#include "job_system.h"
+
+#include <algorithm>
+
+namespace Lotus
+{
+  namespace
+  {
+    // Queue of the current thread, only set on the workers of a system
+    thread_local const JobSystem* currentSystem = nullptr;
+    thread_local size_t currentQueueIndex = 0;
+  }
+
+  size_t JobSystem::getDefaultWorkersCount()
+  {
+    size_t hardwareThreads = std::thread::hardware_concurrency();
+
+    return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+  }
+
+  JobSystem& JobSystem::getInstance()
+  {
+    static JobSystem instance;
+    return instance;
+  }
+
+  JobSystem::JobSystem(size_t workersCount)
+  {
+    queues.reserve(workersCount + 1);
+
+    for (size_t i = 0; i < workersCount + 1; i++)
+    {
+      queues.push_back(std::make_unique<JobQueue>());
+    }
+
+    workers.reserve(workersCount);
+
+    for (size_t i = 0; i < workersCount; i++)
+    {
+      workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+  }
+
+  JobSystem::~JobSystem()
+  {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+
+    jobsAvailable.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+      worker.join();
+    }
+  }
+
+  void JobSystem::run(Job job, JobCounter* counter)
+  {
+    if (counter) { counter->pending.fetch_add(1, std::memory_order_relaxed); }
+
+    push({ std::move(job), counter });
+  }
+
+  void JobSystem::runDetached(Job job, JobCounter* counter)
+  {
+    // Queued jobs only run on the workers or in a wait, nothing would run it otherwise
+    if (workers.empty())
+    {
+      if (counter) { counter->pending.fetch_add(1, std::memory_order_relaxed); }
+
+      job();
+      finish(counter);
+      return;
+    }
+
+    run(std::move(job), counter);
+  }
+
+  void JobSystem::runAfter(JobCounter& dependency, Job job, JobCounter* counter)
+  {
+    if (counter) { counter->pending.fetch_add(1, std::memory_order_relaxed); }
+
+    {
+      std::lock_guard<std::mutex> lock(dependency.mutex);
+
+      if (!dependency.isDone())
+      {
+        dependency.continuations.push_back([this, job = std::move(job), counter]() mutable
+        {
+          push({ std::move(job), counter });
+        });
+
+        return;
+      }
+    }
+
+    push({ std::move(job), counter });
+  }
+
+  void JobSystem::wait(JobCounter& counter)
+  {
+    size_t queueIndex = getQueueIndex();
+
+    while (!counter.isDone())
+    {
+      if (!tryRunJob(queueIndex))
+      {
+        std::this_thread::yield();
+      }
+    }
+
+    // The job that finished the counter may still be releasing its continuations
+    std::lock_guard<std::mutex> lock(counter.mutex);
+  }
+
+  void JobSystem::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function)
+  {
+    if (count == 0) { return; }
+
+    // A few chunks per thread balance uneven chunks, the idle threads steal the ones left
+    size_t grain = std::max<size_t>(grainSize, 1);
+    size_t chunks = std::min((count + grain - 1) / grain, getThreadsCount() * 4);
+
+    if (chunks <= 1 || workers.empty())
+    {
+      function(0, count);
+      return;
+    }
+
+    size_t chunkSize = (count + chunks - 1) / chunks;
+    chunks = (count + chunkSize - 1) / chunkSize;
+
+    JobCounter counter;
+
+    for (size_t chunk = 1; chunk < chunks; chunk++)
+    {
+      size_t first = chunk * chunkSize;
+      size_t last = std::min(first + chunkSize, count);
+
+      run([&function, first, last]() { function(first, last); }, &counter);
+    }
+
+    function(0, chunkSize);
+
+    wait(counter);
+  }
+
+  void JobSystem::workerLoop(size_t queueIndex)
+  {
+    currentSystem = this;
+    currentQueueIndex = queueIndex;
+
+    while (true)
+    {
+      if (tryRunJob(queueIndex)) { continue; }
+
+      std::unique_lock<std::mutex> lock(sleepMutex);
+      jobsAvailable.wait(lock, [this]() { return stopping || queuedJobs.load(std::memory_order_acquire) > 0; });
+
+      if (stopping) { return; }
+    }
+  }
+
+  size_t JobSystem::getQueueIndex() const noexcept
+  {
+    return currentSystem == this ? currentQueueIndex : workers.size();
+  }
+
+  void JobSystem::push(QueuedJob job)
+  {
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    JobQueue& queue = *queues[getQueueIndex()];
+
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.jobs.push_back(std::move(job));
+    }
+
+    // Locking orders the push with a worker that checked the queued jobs and is about to sleep
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+
+    jobsAvailable.notify_one();
+  }
+
+  bool JobSystem::tryRunJob(size_t queueIndex)
+  {
+    QueuedJob job;
+    bool found = false;
+
+    // Newest job of the own queue first, it is the one with the warmest data
+    {
+      JobQueue& queue = *queues[queueIndex];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (!queue.jobs.empty())
+      {
+        job = std::move(queue.jobs.back());
+        queue.jobs.pop_back();
+        found = true;
+      }
+    }
+
+    // Then the oldest job of the other queues, starting from the next one so the thieves spread
+    for (size_t i = 1; !found && i < queues.size(); i++)
+    {
+      JobQueue& queue = *queues[(queueIndex + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+
+      if (!queue.jobs.empty())
+      {
+        job = std::move(queue.jobs.front());
+        queue.jobs.pop_front();
+        found = true;
+      }
+    }
+
+    if (!found) { return false; }
+
+    queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+    job.function();
+    finish(job.counter);
+
+    return true;
+  }
+
+  void JobSystem::finish(JobCounter* counter)
+  {
+    if (!counter) { return; }
+
+    std::vector<std::function<void()>> released;
+
+    {
+      std::lock_guard<std::mutex> lock(counter->mutex);
+
+      if (counter->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+        released.swap(counter->continuations);
+      }
+    }
+
+    // The counter may be destroyed from here, the continuations only touch the system
+    for (std::function<void()>& continuation : released)
+    {
+      continuation();
+    }
+  }
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Lotus
+{
+  class JobSystem;
+
+  /*
+    Number of unfinished jobs of a group. Jobs add themselves when they are queued and remove themselves when
+    they finish, so the counter reaches zero once the whole group ran. It must be waited with JobSystem::wait
+    before it is destroyed
+  */
+  class JobCounter
+  {
+  public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool isDone() const noexcept { return pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+
+    std::atomic<uint32_t> pending = 0;
+
+    // Jobs queued with runAfter, released when the counter reaches zero
+    std::mutex mutex;
+    std::vector<std::function<void()>> continuations;
+  };
+
+  /*
+    Worker threads running small jobs. Every worker owns a deque, it takes its newest job from the back and,
+    once it runs out, steals the oldest job of another deque from the front. Threads outside the system share
+    one more deque. Threads waiting for a counter run jobs while they wait, so jobs can wait for other jobs
+  */
+  class JobSystem
+  {
+  public:
+    using Job = std::function<void()>;
+
+    // One worker less than the hardware threads, as the thread that waits runs jobs too
+    static size_t getDefaultWorkersCount();
+
+    // Shared by the engine systems, it is created with the default workers count the first time it is used
+    static JobSystem& getInstance();
+
+    explicit JobSystem(size_t workersCount = getDefaultWorkersCount());
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void run(Job job, JobCounter* counter = nullptr);
+    // For jobs whose counter is polled instead of waited, without workers they run on the calling thread
+    void runDetached(Job job, JobCounter* counter = nullptr);
+    // Queues the job once dependency reaches zero, counter counts it from this call
+    void runAfter(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+
+    // Runs jobs on the calling thread until the counter reaches zero
+    void wait(JobCounter& counter);
+
+    // Calls function(first, last) over [0, count), in chunks of at least grainSize elements, and waits for them
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function);
+
+    // Threads that run the jobs of a wait, the workers and the caller
+    size_t getThreadsCount() const noexcept { return workers.size() + 1; }
+
+  private:
+    struct QueuedJob
+    {
+      Job function;
+      JobCounter* counter = nullptr;
+    };
+
+    struct JobQueue
+    {
+      std::mutex mutex;
+      std::deque<QueuedJob> jobs;
+    };
+
+    void workerLoop(size_t queueIndex);
+    size_t getQueueIndex() const noexcept;
+
+    void push(QueuedJob job);
+    bool tryRunJob(size_t queueIndex);
+    void finish(JobCounter* counter);
+
+    std::vector<std::thread> workers;
+    // One queue per worker, and the last one for the threads outside the system
+    std::vector<std::unique_ptr<JobQueue>> queues;
+
+    // Jobs in the queues, incremented before they are pushed so sleeping workers never miss one
+    std::atomic<size_t> queuedJobs = 0;
+
+    std::mutex sleepMutex;
+    std::condition_variable jobsAvailable;
+    bool stopping = false;
+  };
+}
@@ -0,0 +1,227 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+#include "../core/job_system.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOTUS_BOUNDS_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace Lotus
+{
+  // The SIMD paths load four floats from each position, the fourth one is the next attribute and is ignored
+  static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Bounds: unexpected glm::vec3 layout");
+  static_assert(offsetof(Vertex, position) + 4 * sizeof(float) <= sizeof(Vertex), "Bounds: the vertex position must be followed by another attribute");
+
+  namespace
+  {
+    struct Box
+    {
+      glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+      glm::vec3 maximum = glm::vec3(std::numeric_limits<float>::lowest());
+    };
+
+    Box computeBoxScalar(const Vertex* vertices, size_t first, size_t last)
+    {
+      Box box;
+
+      for (size_t i = first; i < last; i++)
+      {
+        box.minimum = glm::min(box.minimum, vertices[i].position);
+        box.maximum = glm::max(box.maximum, vertices[i].position);
+      }
+
+      return box;
+    }
+
+    float computeRadiusSquaredScalar(const Vertex* vertices, size_t first, size_t last, const glm::vec3& center)
+    {
+      float radiusSquared = 0.0f;
+
+      for (size_t i = first; i < last; i++)
+      {
+        glm::vec3 distance = vertices[i].position - center;
+        radiusSquared = std::max(radiusSquared, distance.x * distance.x + distance.y * distance.y + distance.z * distance.z);
+      }
+
+      return radiusSquared;
+    }
+
+#if LOTUS_BOUNDS_SSE
+
+    Box computeBoxSSE(const Vertex* vertices, size_t first, size_t last)
+    {
+      __m128 minimum = _mm_set1_ps(std::numeric_limits<float>::max());
+      __m128 maximum = _mm_set1_ps(std::numeric_limits<float>::lowest());
+
+      for (size_t i = first; i < last; i++)
+      {
+        const __m128 position = _mm_loadu_ps(&vertices[i].position.x);
+
+        minimum = _mm_min_ps(minimum, position);
+        maximum = _mm_max_ps(maximum, position);
+      }
+
+      alignas(16) float minimumLanes[4];
+      alignas(16) float maximumLanes[4];
+      _mm_store_ps(minimumLanes, minimum);
+      _mm_store_ps(maximumLanes, maximum);
+
+      Box box;
+      box.minimum = glm::vec3(minimumLanes[0], minimumLanes[1], minimumLanes[2]);
+      box.maximum = glm::vec3(maximumLanes[0], maximumLanes[1], maximumLanes[2]);
+
+      return box;
+    }
+
+    float computeRadiusSquaredSSE(const Vertex* vertices, size_t first, size_t last, const glm::vec3& center)
+    {
+      const __m128 centerX = _mm_set1_ps(center.x);
+      const __m128 centerY = _mm_set1_ps(center.y);
+      const __m128 centerZ = _mm_set1_ps(center.z);
+
+      __m128 radiusSquared = _mm_setzero_ps();
+      size_t i = first;
+
+      // Four positions per step, transposed so each register holds one component
+      for (; i + 4 <= last; i += 4)
+      {
+        __m128 x = _mm_loadu_ps(&vertices[i].position.x);
+        __m128 y = _mm_loadu_ps(&vertices[i + 1].position.x);
+        __m128 z = _mm_loadu_ps(&vertices[i + 2].position.x);
+        __m128 w = _mm_loadu_ps(&vertices[i + 3].position.x);
+
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+
+        const __m128 dx = _mm_sub_ps(x, centerX);
+        const __m128 dy = _mm_sub_ps(y, centerY);
+        const __m128 dz = _mm_sub_ps(z, centerZ);
+
+        const __m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+        radiusSquared = _mm_max_ps(radiusSquared, distanceSquared);
+      }
+
+      alignas(16) float lanes[4];
+      _mm_store_ps(lanes, radiusSquared);
+
+      float result = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+
+      return std::max(result, computeRadiusSquaredScalar(vertices, i, last, center));
+    }
+
+#endif
+
+    Box computeBox(const Vertex* vertices, size_t first, size_t last)
+    {
+#if LOTUS_BOUNDS_SSE
+      return computeBoxSSE(vertices, first, last);
+#else
+      return computeBoxScalar(vertices, first, last);
+#endif
+    }
+
+    float computeRadiusSquared(const Vertex* vertices, size_t first, size_t last, const glm::vec3& center)
+    {
+#if LOTUS_BOUNDS_SSE
+      return computeRadiusSquaredSSE(vertices, first, last, center);
+#else
+      return computeRadiusSquaredScalar(vertices, first, last, center);
+#endif
+    }
+
+    // Runs function(chunk, first, last) over contiguous chunks of [0, count), one job per chunk
+    template <typename Function>
+    void forEachChunk(size_t chunksCount, size_t count, Function function)
+    {
+      size_t chunkSize = (count + chunksCount - 1) / chunksCount;
+
+      JobSystem::getInstance().parallelFor(chunksCount, 1, [&](size_t firstChunk, size_t lastChunk)
+      {
+        for (size_t chunk = firstChunk; chunk < lastChunk; chunk++)
+        {
+          size_t first = std::min(chunk * chunkSize, count);
+          size_t last = std::min(first + chunkSize, count);
+
+          function(chunk, first, last);
+        }
+      });
+    }
+
+    MeshBounds createBounds(const Box& box, float radiusSquared)
+    {
+      MeshBounds bounds;
+      bounds.minimum = box.minimum;
+      bounds.maximum = box.maximum;
+
+      glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+      bounds.sphere = glm::vec4(center, std::sqrt(radiusSquared));
+
+      return bounds;
+    }
+  }
+
+  MeshBounds computeMeshBounds(const Vertex* vertices, size_t verticesCount)
+  {
+    if (verticesCount == 0) { return MeshBounds(); }
+
+    size_t chunksCount = 1;
+
+    if (verticesCount >= ParallelBoundsMinVertices)
+    {
+      size_t threadsCount = JobSystem::getInstance().getThreadsCount();
+
+      // Chunks of at least half the threshold, smaller ones don't pay for their job
+      chunksCount = std::min(threadsCount, verticesCount / (ParallelBoundsMinVertices / 2));
+    }
+
+    if (chunksCount <= 1)
+    {
+      Box box = computeBox(vertices, 0, verticesCount);
+      glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+
+      return createBounds(box, computeRadiusSquared(vertices, 0, verticesCount, center));
+    }
+
+    // The radius needs the center of the whole box, so the chunks are visited twice
+    std::vector<Box> boxes(chunksCount);
+
+    forEachChunk(chunksCount, verticesCount, [&](size_t chunk, size_t first, size_t last)
+    {
+      boxes[chunk] = computeBox(vertices, first, last);
+    });
+
+    Box box;
+
+    for (const Box& chunkBox : boxes)
+    {
+      box.minimum = glm::min(box.minimum, chunkBox.minimum);
+      box.maximum = glm::max(box.maximum, chunkBox.maximum);
+    }
+
+    glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+    std::vector<float> radiiSquared(chunksCount, 0.0f);
+
+    forEachChunk(chunksCount, verticesCount, [&](size_t chunk, size_t first, size_t last)
+    {
+      radiiSquared[chunk] = computeRadiusSquared(vertices, first, last, center);
+    });
+
+    return createBounds(box, *std::max_element(radiiSquared.begin(), radiiSquared.end()));
+  }
+
+  MeshBounds computeMeshBoundsScalar(const Vertex* vertices, size_t verticesCount)
+  {
+    if (verticesCount == 0) { return MeshBounds(); }
+
+    Box box = computeBoxScalar(vertices, 0, verticesCount);
+    glm::vec3 center = (box.minimum + box.maximum) * 0.5f;
+
+    return createBounds(box, computeRadiusSquaredScalar(vertices, 0, verticesCount, center));
+  }
+}
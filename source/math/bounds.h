@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "primitives.h"
+
+namespace Lotus
+{
+  /*
+    Bounding volumes of a mesh in mesh space. The sphere is centered in the box, so it isn't the smallest
+    one, but both are computed in the same passes over the positions
+  */
+  struct MeshBounds
+  {
+    glm::vec3 minimum = glm::vec3(0.0f);
+    glm::vec3 maximum = glm::vec3(0.0f);
+    glm::vec4 sphere = glm::vec4(0.0f); // Center and radius
+  };
+
+  // Meshes with at least this many vertices are split between the jobs of the engine job system
+  constexpr size_t ParallelBoundsMinVertices = 1 << 16;
+
+  MeshBounds computeMeshBounds(const Vertex* vertices, size_t verticesCount);
+
+  // Single threaded reference, the parallel version must give the same bounds
+  MeshBounds computeMeshBoundsScalar(const Vertex* vertices, size_t verticesCount);
+}
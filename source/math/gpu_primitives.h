@@ -1,7 +1,13 @@
 #pragma once
 
+#include <cstdint>
 #include "primitives.h"
 
+// Set by the LOTUS_PACKED_VERTICES CMake option, the renderer vertex buffer holds packed vertices instead of Vertex
+#ifndef LOTUS_PACKED_VERTICES
+#define LOTUS_PACKED_VERTICES 0
+#endif
+
 namespace Lotus
 { 
   struct DrawElementsIndirectCommand
@@ -16,13 +22,78 @@ namespace Lotus
     uint32_t padding2 = 0;
   };
 
+  /*
+    Object of the indirect shaders, indexed by its ID. The normal matrix is precomputed with the model matrix, see
+    writeObjectModel, and the vertex shaders pass the material to the fragment ones so they don't read the objects
+  */
   struct GPUObjectData
   {
     glm::mat4 model;              // 64
-    uint64_t materialHandle = 0;  // 72
-    uint64_t padding0 = 0;        // 80
+    glm::vec4 normalMatrix[3];    // 112, std140 mat3 columns, w unused
+    uint64_t materialHandle = 0;  // 120
+    uint32_t meshHandle = 0;      // 124, index of the mesh bounds, packed positions are relative to them
+    uint32_t padding0 = 0;        // 128
+    glm::vec4 boundingSphere;     // 144, mesh space center and radius
+  };
+
+  static_assert(sizeof(GPUObjectData) == 144, "GPUObjectData: must match the std140 layout of Object");
+
+  /*
+    Bounds of a mesh, indexed by its handle
+  */
+  struct GPUMeshBounds
+  {
+    glm::vec4 minimum;        // 16, w unused
+    glm::vec4 maximum;        // 32, w unused
+    glm::vec4 boundingSphere; // 48, center and radius
+    glm::vec4 lodErrors;      // 64, simplification error of each level of detail, FLT_MAX past the last one
+  };
+
+  /*
+    Meshlet of the cluster culling pass, see Meshlet
+  */
+  struct GPUMeshlet
+  {
+    glm::vec4 boundingSphere; // 16
+    glm::vec4 cone;           // 32, axis and cutoff
+    uint32_t firstIndex = 0;  // 36, relative to the first index of the mesh
+    uint32_t count = 0;       // 40
+    uint32_t padding0 = 0;    // 44
+    uint32_t padding1 = 0;    // 48
   };
 
+  /*
+    Cluster culling data of a draw batch, indexed by the draw batch. Batches without meshlets draw through their
+    LOD commands, the others get a range of compacted commands and a counter in the cluster counts
+  */
+  struct GPUClusterBatch
+  {
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletsCount = 0;
+    uint32_t firstCommand = 0;
+    uint32_t countIndex = 0;
+  };
+
+  /*
+    Vertex of the renderer vertex buffer when LOTUS_PACKED_VERTICES is enabled, see packed_vertex.h. The
+    position is quantized in the mesh box, the normal and tangent are octahedral encoded
+  */
+  struct PackedVertex
+  {
+    uint16_t position[4];     // 8, unorm in the mesh box, w is the bitangent sign
+    int16_t normal[2];        // 12, snorm octahedral
+    int16_t tangent[2];       // 16, snorm octahedral
+    uint16_t uv[2];           // 20, half floats
+  };
+
+  static_assert(sizeof(PackedVertex) == 20, "PackedVertex: unexpected padding");
+
+#if LOTUS_PACKED_VERTICES
+  using GPUVertex = PackedVertex;
+#else
+  using GPUVertex = Vertex;
+#endif
+
   struct GPUMaterialData
   {
     glm::vec3 vec3_0;   // 12
@@ -35,6 +106,9 @@ namespace Lotus
     uint64_t uint64_3;  // 64
   };
   
+  /*
+    Batched object, input of the culling pass. The visible ones are appended to their draw batch
+  */
   struct GPUInstance
   {
     uint32_t objectID;
@@ -0,0 +1,418 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+namespace Lotus
+{
+  // Vertices are compared and hashed as bytes
+  static_assert(sizeof(Vertex) == 14 * sizeof(float), "Mesh optimizer: Vertex must not have padding");
+
+  namespace
+  {
+    constexpr uint32_t InvalidVertex = std::numeric_limits<uint32_t>::max();
+
+    struct VertexHash
+    {
+      const Vertex* vertices;
+
+      size_t operator()(unsigned int index) const
+      {
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(vertices + index);
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (size_t i = 0; i < sizeof(Vertex) / sizeof(uint32_t); i++)
+        {
+          hash = (hash ^ words[i]) * 0x100000001b3ull;
+        }
+
+        return static_cast<size_t>(hash ^ (hash >> 32));
+      }
+    };
+
+    struct VertexEqual
+    {
+      const Vertex* vertices;
+
+      bool operator()(unsigned int first, unsigned int second) const
+      {
+        return std::memcmp(vertices + first, vertices + second, sizeof(Vertex)) == 0;
+      }
+    };
+
+    /*
+      FIFO cache simulated with the time each vertex entered it, a vertex is cached while fewer than
+      cacheSize vertices entered after it. Moving the time forward by more than the cache size empties it
+    */
+    struct VertexCache
+    {
+      VertexCache(size_t verticesCount, uint32_t cacheSize) : timestamps(verticesCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+      // Returns true on a miss
+      bool access(unsigned int vertex)
+      {
+        if (time - timestamps[vertex] <= size) { return false; }
+
+        timestamps[vertex] = time++;
+        return true;
+      }
+
+      uint32_t accessTriangle(const unsigned int* triangle)
+      {
+        return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+      }
+
+      void clear()
+      {
+        time += size + 1;
+      }
+
+      std::vector<uint32_t> timestamps;
+      uint32_t time;
+      uint32_t size;
+    };
+  }
+
+  VertexCacheStatistics analyzeVertexCache(std::span<const unsigned int> indices, size_t verticesCount, uint32_t cacheSize)
+  {
+    VertexCacheStatistics statistics;
+    VertexCache cache(verticesCount, cacheSize);
+    std::vector<uint8_t> used(verticesCount, 0);
+
+    for (unsigned int index : indices)
+    {
+      statistics.verticesTransformed += cache.access(index);
+
+      statistics.verticesCount += used[index] == 0;
+      used[index] = 1;
+    }
+
+    statistics.trianglesCount = static_cast<uint32_t>(indices.size() / 3);
+
+    if (statistics.trianglesCount > 0)
+    {
+      statistics.ACMR = float(statistics.verticesTransformed) / float(statistics.trianglesCount);
+      statistics.ATVR = float(statistics.verticesTransformed) / float(statistics.verticesCount);
+    }
+
+    return statistics;
+  }
+
+  void deduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    std::unordered_map<unsigned int, unsigned int, VertexHash, VertexEqual> uniqueVertices(
+        vertices.size(), VertexHash { vertices.data() }, VertexEqual { vertices.data() });
+
+    std::vector<unsigned int> remap(vertices.size());
+    unsigned int uniqueCount = 0;
+
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+      auto [entry, inserted] = uniqueVertices.try_emplace(i, uniqueCount);
+
+      if (inserted) { uniqueCount++; }
+
+      remap[i] = entry->second;
+    }
+
+    if (uniqueCount == vertices.size()) { return; }
+
+    // Unique vertices keep their order, so each one moves to a lower or equal position
+    for (unsigned int i = 0; i < vertices.size(); i++)
+    {
+      vertices[remap[i]] = vertices[i];
+    }
+
+    vertices.resize(uniqueCount);
+
+    for (unsigned int& index : indices)
+    {
+      index = remap[index];
+    }
+  }
+
+  void optimizeVertexCache(std::vector<unsigned int>& indices, size_t verticesCount, std::vector<uint32_t>* clusters, uint32_t cacheSize)
+  {
+    size_t trianglesCount = indices.size() / 3;
+
+    if (clusters) { clusters->clear(); }
+
+    if (trianglesCount == 0) { return; }
+
+    // Triangles of each vertex, the live count is the number of them not emitted yet
+    std::vector<uint32_t> liveTriangles(verticesCount, 0);
+
+    for (unsigned int index : indices)
+    {
+      liveTriangles[index]++;
+    }
+
+    std::vector<uint32_t> adjacencyOffsets(verticesCount + 1, 0);
+
+    for (size_t i = 0; i < verticesCount; i++)
+    {
+      adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyCursors(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+    for (uint32_t triangle = 0; triangle < trianglesCount; triangle++)
+    {
+      for (int i = 0; i < 3; i++)
+      {
+        adjacency[adjacencyCursors[indices[triangle * 3 + i]]++] = triangle;
+      }
+    }
+
+    std::vector<uint32_t> cacheTimestamps(verticesCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    std::vector<uint8_t> emitted(trianglesCount, 0);
+    std::vector<unsigned int> deadEnds;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> result;
+
+    deadEnds.reserve(indices.size());
+    result.reserve(indices.size());
+
+    // Vertices after the cursor are the fallback when the dead end stack has no live vertex
+    uint32_t inputCursor = 0;
+    uint32_t fanningVertex = indices[0];
+
+    if (clusters) { clusters->push_back(0); }
+
+    while (fanningVertex != InvalidVertex)
+    {
+      candidates.clear();
+
+      for (uint32_t i = adjacencyOffsets[fanningVertex]; i < adjacencyOffsets[fanningVertex + 1]; i++)
+      {
+        uint32_t triangle = adjacency[i];
+
+        if (emitted[triangle]) { continue; }
+
+        for (int j = 0; j < 3; j++)
+        {
+          unsigned int vertex = indices[triangle * 3 + j];
+
+          result.push_back(vertex);
+          deadEnds.push_back(vertex);
+          candidates.push_back(vertex);
+          liveTriangles[vertex]--;
+
+          if (time - cacheTimestamps[vertex] > cacheSize) { cacheTimestamps[vertex] = time++; }
+        }
+
+        emitted[triangle] = 1;
+      }
+
+      // The next fan is around the oldest vertex that stays in the cache while its triangles are emitted
+      uint32_t nextVertex = InvalidVertex;
+      int64_t bestPriority = -1;
+
+      for (unsigned int vertex : candidates)
+      {
+        if (liveTriangles[vertex] == 0) { continue; }
+
+        int64_t priority = 0;
+        int64_t age = time - cacheTimestamps[vertex];
+
+        if (age + 2 * int64_t(liveTriangles[vertex]) <= cacheSize) { priority = age; }
+
+        if (priority > bestPriority)
+        {
+          bestPriority = priority;
+          nextVertex = vertex;
+        }
+      }
+
+      if (nextVertex != InvalidVertex)
+      {
+        fanningVertex = nextVertex;
+        continue;
+      }
+
+      // Dead end, the most recent vertices with triangles left are likely still in the cache
+      while (!deadEnds.empty() && nextVertex == InvalidVertex)
+      {
+        unsigned int vertex = deadEnds.back();
+        deadEnds.pop_back();
+
+        if (liveTriangles[vertex] > 0) { nextVertex = vertex; }
+      }
+
+      while (inputCursor < verticesCount && nextVertex == InvalidVertex)
+      {
+        if (liveTriangles[inputCursor] > 0) { nextVertex = inputCursor; }
+        else { inputCursor++; }
+      }
+
+      if (clusters && nextVertex != InvalidVertex) { clusters->push_back(static_cast<uint32_t>(result.size() / 3)); }
+
+      fanningVertex = nextVertex;
+    }
+
+    indices = std::move(result);
+  }
+
+  void optimizeOverdraw(
+      std::vector<unsigned int>& indices,
+      const std::vector<Vertex>& vertices,
+      const std::vector<uint32_t>& clusters,
+      float threshold,
+      uint32_t cacheSize)
+  {
+    size_t trianglesCount = indices.size() / 3;
+
+    if (trianglesCount == 0 || clusters.empty()) { return; }
+
+    // Soft boundaries, cutting a cluster where its running ACMR is already close to the cluster ACMR costs little
+    std::vector<uint32_t> softClusters;
+    VertexCache cache(vertices.size(), cacheSize);
+
+    for (size_t i = 0; i < clusters.size(); i++)
+    {
+      uint32_t first = clusters[i];
+      uint32_t last = i + 1 < clusters.size() ? clusters[i + 1] : static_cast<uint32_t>(trianglesCount);
+
+      cache.clear();
+      uint32_t clusterMisses = 0;
+
+      for (uint32_t triangle = first; triangle < last; triangle++)
+      {
+        clusterMisses += cache.accessTriangle(&indices[triangle * 3]);
+      }
+
+      float clusterThreshold = threshold * float(clusterMisses) / float(last - first);
+
+      cache.clear();
+      softClusters.push_back(first);
+
+      uint32_t runningMisses = 0;
+      uint32_t runningTriangles = 0;
+
+      for (uint32_t triangle = first; triangle < last; triangle++)
+      {
+        runningMisses += cache.accessTriangle(&indices[triangle * 3]);
+        runningTriangles++;
+
+        if (float(runningMisses) <= clusterThreshold * float(runningTriangles))
+        {
+          softClusters.push_back(triangle + 1);
+          cache.clear();
+
+          runningMisses = 0;
+          runningTriangles = 0;
+        }
+      }
+
+      // The triangles after the last cut start from an empty cache with no time to fill it, they are merged with
+      // the previous cluster. A cut at the end of the cluster is removed the same way
+      if (softClusters.back() != first) { softClusters.pop_back(); }
+    }
+
+    glm::vec3 meshCentroid = glm::vec3(0.0f);
+
+    for (const Vertex& vertex : vertices)
+    {
+      meshCentroid += vertex.position;
+    }
+
+    meshCentroid /= float(std::max<size_t>(vertices.size(), 1));
+
+    // Clusters facing away from the mesh center are likely in front of the others
+    std::vector<float> sortKeys(softClusters.size());
+
+    for (size_t i = 0; i < softClusters.size(); i++)
+    {
+      uint32_t first = softClusters[i];
+      uint32_t last = i + 1 < softClusters.size() ? softClusters[i + 1] : static_cast<uint32_t>(trianglesCount);
+
+      glm::vec3 weightedCentroid = glm::vec3(0.0f);
+      glm::vec3 weightedNormal = glm::vec3(0.0f);
+      float area = 0.0f;
+
+      for (uint32_t triangle = first; triangle < last; triangle++)
+      {
+        const glm::vec3& a = vertices[indices[triangle * 3 + 0]].position;
+        const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+        const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+
+        glm::vec3 normal = glm::cross(b - a, c - a);
+        float triangleArea = glm::length(normal);
+
+        weightedCentroid += (a + b + c) * (triangleArea / 3.0f);
+        weightedNormal += normal;
+        area += triangleArea;
+      }
+
+      float normalLength = glm::length(weightedNormal);
+
+      if (area > 0.0f && normalLength > 0.0f)
+      {
+        sortKeys[i] = glm::dot(weightedCentroid / area - meshCentroid, weightedNormal / normalLength);
+      }
+      else
+      {
+        sortKeys[i] = 0.0f;
+      }
+    }
+
+    std::vector<uint32_t> order(softClusters.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    for (uint32_t cluster : order)
+    {
+      uint32_t first = softClusters[cluster];
+      uint32_t last = cluster + 1 < softClusters.size() ? softClusters[cluster + 1] : static_cast<uint32_t>(trianglesCount);
+
+      result.insert(result.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+    }
+
+    indices = std::move(result);
+  }
+
+  void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    std::vector<unsigned int> remap(vertices.size(), InvalidVertex);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+
+    for (unsigned int& index : indices)
+    {
+      if (remap[index] == InvalidVertex)
+      {
+        remap[index] = static_cast<unsigned int>(result.size());
+        result.push_back(vertices[index]);
+      }
+
+      index = remap[index];
+    }
+
+    vertices = std::move(result);
+  }
+
+  void optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, MeshOptimizationReport* report)
+  {
+    if (report) { report->before = analyzeVertexCache(indices, vertices.size()); }
+
+    deduplicateVertices(vertices, indices);
+
+    std::vector<uint32_t> clusters;
+    optimizeVertexCache(indices, vertices.size(), &clusters);
+    optimizeOverdraw(indices, vertices, clusters);
+
+    optimizeVertexFetch(vertices, indices);
+
+    if (report) { report->after = analyzeVertexCache(indices, vertices.size()); }
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "primitives.h"
+
+namespace Lotus
+{
+  // FIFO cache of the statistics, close to the post-transform cache of current GPUs
+  constexpr uint32_t VertexCacheSize = 16;
+  // Cache size that Tipsify optimizes for
+  constexpr uint32_t TipsifyCacheSize = 16;
+  // Clusters may have this much worse ACMR than the whole mesh, so the overdraw ordering has smaller clusters
+  constexpr float OverdrawThreshold = 1.05f;
+
+  /*
+    Post-transform vertex cache statistics of an index list. ACMR is the average of vertices transformed per
+    triangle, 0.5 at best on regular grids and 3 at worst. ATVR is the average of times each vertex is
+    transformed, 1 at best
+  */
+  struct VertexCacheStatistics
+  {
+    uint32_t verticesTransformed = 0;
+    uint32_t verticesCount = 0;
+    uint32_t trianglesCount = 0;
+    float ACMR = 0.0f;
+    float ATVR = 0.0f;
+  };
+
+  struct MeshOptimizationReport
+  {
+    VertexCacheStatistics before;
+    VertexCacheStatistics after;
+  };
+
+  VertexCacheStatistics analyzeVertexCache(std::span<const unsigned int> indices, size_t verticesCount, uint32_t cacheSize = VertexCacheSize);
+
+  // Merges the vertices with the same attributes, the indices are remapped and the vertices compacted
+  void deduplicateVertices(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+  /*
+    Tipsify, Sander et al. 2007: the triangles are emitted in fans around the vertices still in the cache.
+    The clusters get the first triangle of every run that started after a dead end, the overdraw ordering
+    can move them without hurting the cache
+  */
+  void optimizeVertexCache(std::vector<unsigned int>& indices, size_t verticesCount, std::vector<uint32_t>* clusters = nullptr, uint32_t cacheSize = TipsifyCacheSize);
+
+  /*
+    Splits the clusters where their ACMR stays under the threshold, then sorts them so the ones facing out of
+    the mesh are drawn first and occlude the rest, Sander et al. 2007
+  */
+  void optimizeOverdraw(
+      std::vector<unsigned int>& indices,
+      const std::vector<Vertex>& vertices,
+      const std::vector<uint32_t>& clusters,
+      float threshold = OverdrawThreshold,
+      uint32_t cacheSize = TipsifyCacheSize);
+
+  // Vertices are sorted by first use in the indices, unused ones are removed
+  void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+  // Every stage in order, the triangles stay the same with the same winding
+  void optimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, MeshOptimizationReport* report = nullptr);
+}
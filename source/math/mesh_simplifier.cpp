@@ -0,0 +1,385 @@
+#include "mesh_simplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "bounds.h"
+#include "mesh_optimizer.h"
+
+namespace Lotus
+{
+  namespace
+  {
+    // Collapses that turn a triangle by more than about 75 degrees are rejected
+    constexpr float MaxNormalRotationCosine = 0.25f;
+
+    /*
+      Symmetric 4x4 matrix of a sum of squared distances to planes, evaluating it at a point gives the sum
+      of the squared distances of the point to every plane
+    */
+    struct Quadric
+    {
+      double a2 = 0.0, b2 = 0.0, c2 = 0.0, d2 = 0.0;
+      double ab = 0.0, ac = 0.0, ad = 0.0, bc = 0.0, bd = 0.0, cd = 0.0;
+
+      void addPlane(double a, double b, double c, double d)
+      {
+        a2 += a * a; b2 += b * b; c2 += c * c; d2 += d * d;
+        ab += a * b; ac += a * c; ad += a * d;
+        bc += b * c; bd += b * d; cd += c * d;
+      }
+
+      Quadric& operator+=(const Quadric& other)
+      {
+        a2 += other.a2; b2 += other.b2; c2 += other.c2; d2 += other.d2;
+        ab += other.ab; ac += other.ac; ad += other.ad;
+        bc += other.bc; bd += other.bd; cd += other.cd;
+
+        return *this;
+      }
+
+      double evaluate(const glm::vec3& point) const
+      {
+        double x = point.x, y = point.y, z = point.z;
+
+        double result = a2 * x * x + b2 * y * y + c2 * z * z + d2 +
+          2.0 * (ab * x * y + ac * x * z + ad * x + bc * y * z + bd * y + cd * z);
+
+        // Rounding can take points on every plane slightly under zero
+        return std::max(result, 0.0);
+      }
+    };
+
+    struct PositionHash
+    {
+      const Vertex* vertices;
+
+      size_t operator()(unsigned int index) const
+      {
+        uint32_t words[3];
+        std::memcpy(words, &vertices[index].position, sizeof(words));
+
+        uint64_t hash = 0xcbf29ce484222325ull;
+
+        for (uint32_t word : words)
+        {
+          hash = (hash ^ word) * 0x100000001b3ull;
+        }
+
+        return static_cast<size_t>(hash ^ (hash >> 32));
+      }
+    };
+
+    struct PositionEqual
+    {
+      const Vertex* vertices;
+
+      bool operator()(unsigned int first, unsigned int second) const
+      {
+        return std::memcmp(&vertices[first].position, &vertices[second].position, sizeof(glm::vec3)) == 0;
+      }
+    };
+
+    struct Collapse
+    {
+      unsigned int from;
+      unsigned int to;
+      float error;
+    };
+
+    uint64_t makeEdgeKey(unsigned int first, unsigned int second)
+    {
+      return (static_cast<uint64_t>(first) << 32) | second;
+    }
+  }
+
+  void simplifyMesh(
+      std::span<const Vertex> vertices,
+      std::span<const unsigned int> indices,
+      std::vector<unsigned int>& destination,
+      size_t targetIndicesCount,
+      float targetError,
+      float* resultError)
+  {
+    destination.assign(indices.begin(), indices.end());
+
+    if (resultError) { *resultError = 0.0f; }
+
+    size_t verticesCount = vertices.size();
+
+    if (destination.size() <= targetIndicesCount || verticesCount == 0) { return; }
+
+    // Vertices with the same position are one vertex of the surface, the first one represents them
+    std::vector<uint8_t> used(verticesCount, 0);
+
+    for (unsigned int index : indices) { used[index] = 1; }
+
+    std::unordered_map<unsigned int, unsigned int, PositionHash, PositionEqual> positions(
+        verticesCount, PositionHash { vertices.data() }, PositionEqual { vertices.data() });
+
+    std::vector<unsigned int> positionRemap(verticesCount);
+    std::vector<uint32_t> positionUses(verticesCount, 0);
+
+    for (unsigned int i = 0; i < verticesCount; i++)
+    {
+      if (!used[i])
+      {
+        positionRemap[i] = i;
+        continue;
+      }
+
+      positionRemap[i] = positions.try_emplace(i, i).first->second;
+      positionUses[positionRemap[i]]++;
+    }
+
+    // Positions shared by several vertices are attribute seams, the ones on open or non-manifold edges are borders
+    std::vector<uint8_t> locked(verticesCount, 0);
+
+    for (unsigned int i = 0; i < verticesCount; i++)
+    {
+      if (positionUses[i] > 1) { locked[i] = 1; }
+    }
+
+    std::unordered_map<uint64_t, uint32_t> edges(destination.size());
+
+    for (size_t i = 0; i < destination.size(); i += 3)
+    {
+      for (size_t j = 0; j < 3; j++)
+      {
+        unsigned int first = positionRemap[destination[i + j]];
+        unsigned int second = positionRemap[destination[i + (j + 1) % 3]];
+
+        edges[makeEdgeKey(first, second)]++;
+      }
+    }
+
+    for (const auto& [key, count] : edges)
+    {
+      unsigned int first = static_cast<unsigned int>(key >> 32);
+      unsigned int second = static_cast<unsigned int>(key & 0xffffffffu);
+
+      auto opposite = edges.find(makeEdgeKey(second, first));
+
+      if (count > 1 || opposite == edges.end() || opposite->second > 1)
+      {
+        locked[first] = 1;
+        locked[second] = 1;
+      }
+    }
+
+    std::vector<Quadric> quadrics(verticesCount);
+
+    for (size_t i = 0; i < destination.size(); i += 3)
+    {
+      const glm::vec3& p0 = vertices[destination[i]].position;
+      const glm::vec3& p1 = vertices[destination[i + 1]].position;
+      const glm::vec3& p2 = vertices[destination[i + 2]].position;
+
+      glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+      double length = std::sqrt(double(normal.x) * normal.x + double(normal.y) * normal.y + double(normal.z) * normal.z);
+
+      // Degenerate triangles have no plane
+      if (length == 0.0) { continue; }
+
+      double a = normal.x / length;
+      double b = normal.y / length;
+      double c = normal.z / length;
+      double d = -(a * p0.x + b * p0.y + c * p0.z);
+
+      for (size_t j = 0; j < 3; j++)
+      {
+        quadrics[positionRemap[destination[i + j]]].addPlane(a, b, c, d);
+      }
+    }
+
+    float maxError = 0.0f;
+
+    std::vector<unsigned int> collapseRemap(verticesCount);
+    std::vector<uint8_t> touched(verticesCount);
+    std::vector<uint32_t> adjacencyOffsets(verticesCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+
+    // Triangles around a vertex after its collapse, false if one of them would turn too much
+    auto keepsOrientation = [&](unsigned int from, unsigned int to)
+    {
+      const glm::vec3& target = vertices[to].position;
+
+      for (uint32_t i = adjacencyOffsets[from]; i < adjacencyOffsets[from + 1]; i++)
+      {
+        const unsigned int* triangle = destination.data() + adjacency[i] * 3;
+
+        glm::vec3 corners[3];
+        glm::vec3 moved[3];
+        bool removed = false;
+
+        for (int j = 0; j < 3; j++)
+        {
+          removed = removed || positionRemap[triangle[j]] == positionRemap[to];
+          corners[j] = vertices[triangle[j]].position;
+          moved[j] = triangle[j] == from ? target : corners[j];
+        }
+
+        // The triangles along the collapsed edge disappear
+        if (removed) { continue; }
+
+        glm::vec3 normal = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+        glm::vec3 movedNormal = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+
+        if (glm::dot(normal, movedNormal) <= MaxNormalRotationCosine * glm::length(normal) * glm::length(movedNormal))
+        {
+          return false;
+        }
+      }
+
+      return true;
+    };
+
+    while (destination.size() > targetIndicesCount)
+    {
+      uint32_t trianglesCount = static_cast<uint32_t>(destination.size() / 3);
+
+      // Triangles around each vertex, as offsets into a single array
+      std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+
+      for (unsigned int index : destination) { adjacencyOffsets[index + 1]++; }
+
+      std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+      adjacency.resize(destination.size());
+      std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+      for (uint32_t i = 0; i < trianglesCount; i++)
+      {
+        for (int j = 0; j < 3; j++)
+        {
+          adjacency[fill[destination[i * 3 + j]]++] = i;
+        }
+      }
+
+      // Every edge of a closed fan is the next edge of the vertex in one of its triangles
+      collapses.clear();
+
+      for (uint32_t i = 0; i < trianglesCount; i++)
+      {
+        for (int j = 0; j < 3; j++)
+        {
+          unsigned int from = destination[i * 3 + j];
+          unsigned int to = destination[i * 3 + (j + 1) % 3];
+
+          if (locked[positionRemap[from]]) { continue; }
+
+          Quadric quadric = quadrics[positionRemap[from]];
+          quadric += quadrics[positionRemap[to]];
+
+          collapses.push_back({ from, to, static_cast<float>(std::sqrt(quadric.evaluate(vertices[to].position))) });
+        }
+      }
+
+      // Ties are broken by the vertices, so the result doesn't depend on the sort implementation
+      std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r)
+      {
+        if (l.error != r.error) { return l.error < r.error; }
+        if (l.from != r.from) { return l.from < r.from; }
+        return l.to < r.to;
+      });
+
+      std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+      std::fill(touched.begin(), touched.end(), 0);
+
+      size_t removableTriangles = (destination.size() - targetIndicesCount) / 3;
+      size_t removedTriangles = 0;
+      size_t collapsesCount = 0;
+
+      for (const Collapse& collapse : collapses)
+      {
+        if (collapse.error > targetError || removedTriangles >= removableTriangles) { break; }
+
+        // Vertices around a collapse keep their position until the next pass, so the orientation tests stay valid
+        if (touched[collapse.from] || touched[positionRemap[collapse.to]]) { continue; }
+
+        if (!keepsOrientation(collapse.from, collapse.to)) { continue; }
+
+        collapseRemap[collapse.from] = collapse.to;
+        quadrics[positionRemap[collapse.to]] += quadrics[collapse.from];
+        maxError = std::max(maxError, collapse.error);
+        collapsesCount++;
+
+        for (uint32_t i = adjacencyOffsets[collapse.from]; i < adjacencyOffsets[collapse.from + 1]; i++)
+        {
+          const unsigned int* triangle = destination.data() + adjacency[i] * 3;
+          bool removed = false;
+
+          for (int j = 0; j < 3; j++)
+          {
+            touched[positionRemap[triangle[j]]] = 1;
+            removed = removed || positionRemap[triangle[j]] == positionRemap[collapse.to];
+          }
+
+          removedTriangles += removed;
+        }
+      }
+
+      if (collapsesCount == 0) { break; }
+
+      size_t writeIndex = 0;
+
+      for (size_t i = 0; i < destination.size(); i += 3)
+      {
+        unsigned int a = collapseRemap[destination[i]];
+        unsigned int b = collapseRemap[destination[i + 1]];
+        unsigned int c = collapseRemap[destination[i + 2]];
+
+        if (positionRemap[a] == positionRemap[b] || positionRemap[b] == positionRemap[c] || positionRemap[c] == positionRemap[a])
+        {
+          continue;
+        }
+
+        destination[writeIndex++] = a;
+        destination[writeIndex++] = b;
+        destination[writeIndex++] = c;
+      }
+
+      destination.resize(writeIndex);
+    }
+
+    if (resultError) { *resultError = maxError; }
+  }
+
+  void generateMeshLODs(std::span<const Vertex> vertices, std::vector<unsigned int>& indices, std::vector<MeshLOD>& lods)
+  {
+    lods.clear();
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    if (indices.empty()) { return; }
+
+    float radius = computeMeshBounds(vertices.data(), vertices.size()).sphere.w;
+
+    std::vector<unsigned int> current(indices.begin(), indices.end());
+    std::vector<unsigned int> simplified;
+    float error = 0.0f;
+
+    while (lods.size() < MaxMeshLODs)
+    {
+      size_t targetIndicesCount = static_cast<size_t>(current.size() / 3 * LODReductionRatio) * 3;
+      float stepError = 0.0f;
+
+      simplifyMesh(vertices, current, simplified, targetIndicesCount, LODMaxRelativeError * radius, &stepError);
+
+      if (simplified.empty() || simplified.size() > current.size() * LODMinimumReduction) { break; }
+
+      // Each step is measured against the previous level, not the full mesh
+      error += stepError;
+
+      optimizeVertexCache(simplified, vertices.size());
+
+      lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), error });
+      indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+      current.swap(simplified);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "primitives.h"
+#include "render_primitives.h"
+
+namespace Lotus
+{
+  // Each level of detail aims for this fraction of the triangles of the previous one
+  constexpr float LODReductionRatio = 0.5f;
+  // A level that keeps more than this fraction of the triangles of the previous one ends the chain
+  constexpr float LODMinimumReduction = 0.85f;
+  // Largest error of each simplification step, relative to the mesh bounding sphere radius
+  constexpr float LODMaxRelativeError = 0.05f;
+
+  /*
+    Simplifies the triangles with quadric error metrics, Garland and Heckbert 1997. Vertices are collapsed onto
+    a neighbour, so the simplified indices reference the same vertices and no vertex is created. Vertices on
+    borders and on attribute seams (positions shared by several vertices) never move, so the silhouette of
+    open meshes and the texture coordinates are kept.
+
+    It stops when the indices reach the target count or when no collapse is under the target error. The
+    error is the square root of the sum of squared distances to the planes of the merged triangles, so it
+    bounds the distance of the kept vertices to each of those planes. resultError gets the largest error
+  */
+  void simplifyMesh(
+      std::span<const Vertex> vertices,
+      std::span<const unsigned int> indices,
+      std::vector<unsigned int>& destination,
+      size_t targetIndicesCount,
+      float targetError,
+      float* resultError = nullptr);
+
+  /*
+    Appends the coarser levels of detail after the indices, each one simplified from the previous one. The
+    first LOD is the given indices, the errors of the others add up the errors of the steps before them
+  */
+  void generateMeshLODs(std::span<const Vertex> vertices, std::vector<unsigned int>& indices, std::vector<MeshLOD>& lods);
+}
@@ -0,0 +1,135 @@
+#include "meshlet_builder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Lotus
+{
+  void buildMeshlets(std::span<const Vertex> vertices, std::span<const unsigned int> indices, std::vector<Meshlet>& meshlets)
+  {
+    meshlets.clear();
+
+    // Meshlet that last used each vertex, so the vertices are counted once per meshlet without a set
+    constexpr uint32_t NoMeshlet = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> vertexMeshlets(vertices.size(), NoMeshlet);
+
+    uint32_t meshletIndex = 0;
+    uint32_t firstIndex = 0;
+    uint32_t verticesCount = 0;
+    uint32_t trianglesCount = 0;
+
+    for (uint32_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      uint32_t newVertices = 0;
+
+      for (uint32_t j = 0; j < 3; j++)
+      {
+        // A vertex repeated in a degenerate triangle is only new once
+        bool repeated = (j > 0 && indices[i + j] == indices[i]) || (j > 1 && indices[i + j] == indices[i + 1]);
+
+        newVertices += vertexMeshlets[indices[i + j]] != meshletIndex && !repeated ? 1 : 0;
+      }
+
+      if (trianglesCount > 0 && (verticesCount + newVertices > MeshletMaxVertices || trianglesCount == MeshletMaxTriangles))
+      {
+        meshlets.push_back(computeMeshletBounds(vertices, indices, firstIndex, i - firstIndex));
+
+        meshletIndex++;
+        firstIndex = i;
+        verticesCount = 0;
+        trianglesCount = 0;
+      }
+
+      for (uint32_t j = 0; j < 3; j++)
+      {
+        if (vertexMeshlets[indices[i + j]] != meshletIndex)
+        {
+          vertexMeshlets[indices[i + j]] = meshletIndex;
+          verticesCount++;
+        }
+      }
+
+      trianglesCount++;
+    }
+
+    if (trianglesCount > 0)
+    {
+      meshlets.push_back(computeMeshletBounds(vertices, indices, firstIndex, trianglesCount * 3));
+    }
+  }
+
+  Meshlet computeMeshletBounds(std::span<const Vertex> vertices, std::span<const unsigned int> indices, uint32_t firstIndex, uint32_t count)
+  {
+    Meshlet meshlet;
+    meshlet.firstIndex = firstIndex;
+    meshlet.count = count;
+
+    if (count == 0) { return meshlet; }
+
+    glm::vec3 minimum = glm::vec3(std::numeric_limits<float>::max());
+    glm::vec3 maximum = glm::vec3(std::numeric_limits<float>::lowest());
+
+    for (uint32_t i = firstIndex; i < firstIndex + count; i++)
+    {
+      minimum = glm::min(minimum, vertices[indices[i]].position);
+      maximum = glm::max(maximum, vertices[indices[i]].position);
+    }
+
+    glm::vec3 center = (minimum + maximum) * 0.5f;
+    float radiusSquared = 0.0f;
+
+    for (uint32_t i = firstIndex; i < firstIndex + count; i++)
+    {
+      glm::vec3 offset = vertices[indices[i]].position - center;
+      radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+
+    meshlet.boundingSphere = glm::vec4(center, std::sqrt(radiusSquared));
+
+    // The axis is the average of the unit normals, the counter clockwise side of the triangles is the front
+    std::vector<glm::vec3> normals;
+    normals.reserve(count / 3);
+
+    glm::vec3 axis = glm::vec3(0.0f);
+
+    for (uint32_t i = firstIndex; i + 2 < firstIndex + count; i += 3)
+    {
+      const glm::vec3& p0 = vertices[indices[i]].position;
+      glm::vec3 normal = glm::cross(vertices[indices[i + 1]].position - p0, vertices[indices[i + 2]].position - p0);
+      float length = glm::length(normal);
+
+      if (length <= 0.0f) { continue; }
+
+      normals.push_back(normal / length);
+      axis += normals.back();
+    }
+
+    float axisLength = glm::length(axis);
+
+    if (normals.empty() || axisLength <= 0.0f) { return meshlet; }
+
+    axis /= axisLength;
+
+    float minimumCosine = 1.0f;
+
+    for (const glm::vec3& normal : normals)
+    {
+      minimumCosine = std::min(minimumCosine, glm::dot(axis, normal));
+    }
+
+    if (minimumCosine <= MeshletMinConeCosine)
+    {
+      meshlet.cone = glm::vec4(axis, 1.0f);
+      return meshlet;
+    }
+
+    /*
+      The meshlet is backfacing from the points whose direction to it is within 90 degrees minus the cone angle
+      of the axis, so the cutoff is the cosine of that, the sine of the cone angle
+    */
+    meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minimumCosine * minimumCosine));
+
+    return meshlet;
+  }
+}
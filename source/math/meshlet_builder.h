@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "primitives.h"
+#include "render_primitives.h"
+
+namespace Lotus
+{
+  // Normals spread wider than this cosine from the cone axis give a cone that can never be backfacing
+  constexpr float MeshletMinConeCosine = 0.1f;
+
+  /*
+    Splits the triangles in meshlets of at most MeshletMaxVertices vertices and MeshletMaxTriangles triangles.
+    The triangles are scanned in order and never reordered, so each meshlet is a contiguous range of the indices
+    and the meshlets can be drawn straight from the index buffer. The indices should be optimized for the vertex
+    cache first, consecutive triangles are then neighbours and the meshlets stay compact
+  */
+  void buildMeshlets(std::span<const Vertex> vertices, std::span<const unsigned int> indices, std::vector<Meshlet>& meshlets);
+
+  /*
+    Bounding sphere and normal cone of the triangles in indices[firstIndex, firstIndex + count). The sphere is
+    centered in the box of the vertices, degenerate triangles don't widen the cone
+  */
+  Meshlet computeMeshletBounds(std::span<const Vertex> vertices, std::span<const unsigned int> indices, uint32_t firstIndex, uint32_t count);
+}
@@ -0,0 +1,374 @@
+#include "model_matrices.h"
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOTUS_MODEL_MATRICES_SSE 1
+#include <immintrin.h>
+#endif
+
+// MSVC doesn't define __FMA__, but every AVX2 target it builds for has FMA
+#if LOTUS_MODEL_MATRICES_SSE && defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define LOTUS_MODEL_MATRICES_AVX2 1
+#endif
+
+namespace Lotus
+{
+  // The SIMD paths load the glm types directly, so they rely on their memory layout
+  static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Model matrices: unexpected glm::vec3 layout");
+  static_assert(sizeof(glm::fquat) == 4 * sizeof(float), "Model matrices: unexpected glm::fquat layout");
+  static_assert(offsetof(glm::fquat, x) == 0 && offsetof(glm::fquat, w) == 3 * sizeof(float), "Model matrices: glm::fquat must be stored as xyzw");
+  static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "Model matrices: unexpected glm::mat4 layout");
+
+  void composeModelMatricesScalar(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      glm::mat4* matrices,
+      size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      matrices[i] = composeModelMatrix(translations[i], rotations[i], scales[i]);
+    }
+  }
+
+  void composeModelMatricesScalar(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      const uint32_t* indices,
+      glm::mat4* matrices,
+      size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+    {
+      uint32_t index = indices[i];
+      matrices[i] = composeModelMatrix(translations[index], rotations[index], scales[index]);
+    }
+  }
+
+#if LOTUS_MODEL_MATRICES_SSE
+
+  // Four transforms with one component per register
+  struct TransformLanes4
+  {
+    __m128 tx, ty, tz;
+    __m128 qx, qy, qz, qw;
+    __m128 sx, sy, sz;
+  };
+
+  // Upper 3x3 of four model matrices, columns[c][r] holds the row r of the column c
+  struct MatrixLanes4
+  {
+    __m128 columns[3][3];
+  };
+
+  // Splits four packed vec3 into one register per component
+  static inline void loadPackedVec3(const glm::vec3* vectors, __m128& x, __m128& y, __m128& z)
+  {
+    const float* data = &vectors[0].x;
+
+    // x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+    const __m128 m0 = _mm_loadu_ps(data);
+    const __m128 m1 = _mm_loadu_ps(data + 4);
+    const __m128 m2 = _mm_loadu_ps(data + 8);
+
+    const __m128 x2y2x3y3 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+    const __m128 y0y0y1y1 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(0, 0, 1, 1));
+    const __m128 z0z0z1z1 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 1, 2, 2));
+
+    x = _mm_shuffle_ps(m0, x2y2x3y3, _MM_SHUFFLE(2, 0, 3, 0));
+    y = _mm_shuffle_ps(y0y0y1y1, x2y2x3y3, _MM_SHUFFLE(3, 1, 2, 0));
+    z = _mm_shuffle_ps(z0z0z1z1, m2, _MM_SHUFFLE(3, 0, 2, 0));
+  }
+
+  // Reads the vec3 one by one, a 16 bytes load could read past the end of the array
+  static inline void loadScatteredVec3(const glm::vec3* vectors, const uint32_t* indices, __m128& x, __m128& y, __m128& z)
+  {
+    const glm::vec3& v0 = vectors[indices[0]];
+    const glm::vec3& v1 = vectors[indices[1]];
+    const glm::vec3& v2 = vectors[indices[2]];
+    const glm::vec3& v3 = vectors[indices[3]];
+
+    x = _mm_setr_ps(v0.x, v1.x, v2.x, v3.x);
+    y = _mm_setr_ps(v0.y, v1.y, v2.y, v3.y);
+    z = _mm_setr_ps(v0.z, v1.z, v2.z, v3.z);
+  }
+
+  static inline void loadQuaternions(const glm::fquat* q0, const glm::fquat* q1, const glm::fquat* q2, const glm::fquat* q3, TransformLanes4& lanes)
+  {
+    lanes.qx = _mm_loadu_ps(&q0->x);
+    lanes.qy = _mm_loadu_ps(&q1->x);
+    lanes.qz = _mm_loadu_ps(&q2->x);
+    lanes.qw = _mm_loadu_ps(&q3->x);
+
+    _MM_TRANSPOSE4_PS(lanes.qx, lanes.qy, lanes.qz, lanes.qw);
+  }
+
+  static inline TransformLanes4 loadPacked(const glm::vec3* translations, const glm::fquat* rotations, const glm::vec3* scales, size_t first)
+  {
+    TransformLanes4 lanes;
+
+    loadPackedVec3(translations + first, lanes.tx, lanes.ty, lanes.tz);
+    loadPackedVec3(scales + first, lanes.sx, lanes.sy, lanes.sz);
+    loadQuaternions(rotations + first, rotations + first + 1, rotations + first + 2, rotations + first + 3, lanes);
+
+    return lanes;
+  }
+
+  static inline TransformLanes4 loadScattered(const glm::vec3* translations, const glm::fquat* rotations, const glm::vec3* scales, const uint32_t* indices)
+  {
+    TransformLanes4 lanes;
+
+    loadScatteredVec3(translations, indices, lanes.tx, lanes.ty, lanes.tz);
+    loadScatteredVec3(scales, indices, lanes.sx, lanes.sy, lanes.sz);
+    loadQuaternions(rotations + indices[0], rotations + indices[1], rotations + indices[2], rotations + indices[3], lanes);
+
+    return lanes;
+  }
+
+  // Same operations as composeModelMatrix, so every path gives the same results
+  static inline MatrixLanes4 composeLanes(const TransformLanes4& lanes)
+  {
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    const __m128 x2 = _mm_add_ps(lanes.qx, lanes.qx);
+    const __m128 y2 = _mm_add_ps(lanes.qy, lanes.qy);
+    const __m128 z2 = _mm_add_ps(lanes.qz, lanes.qz);
+
+    const __m128 xx = _mm_mul_ps(lanes.qx, x2);
+    const __m128 yy = _mm_mul_ps(lanes.qy, y2);
+    const __m128 zz = _mm_mul_ps(lanes.qz, z2);
+    const __m128 xy = _mm_mul_ps(lanes.qx, y2);
+    const __m128 xz = _mm_mul_ps(lanes.qx, z2);
+    const __m128 yz = _mm_mul_ps(lanes.qy, z2);
+    const __m128 wx = _mm_mul_ps(lanes.qw, x2);
+    const __m128 wy = _mm_mul_ps(lanes.qw, y2);
+    const __m128 wz = _mm_mul_ps(lanes.qw, z2);
+
+    MatrixLanes4 matrix;
+
+    matrix.columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), lanes.sx);
+    matrix.columns[0][1] = _mm_mul_ps(_mm_add_ps(xy, wz), lanes.sx);
+    matrix.columns[0][2] = _mm_mul_ps(_mm_sub_ps(xz, wy), lanes.sx);
+
+    matrix.columns[1][0] = _mm_mul_ps(_mm_sub_ps(xy, wz), lanes.sy);
+    matrix.columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), lanes.sy);
+    matrix.columns[1][2] = _mm_mul_ps(_mm_add_ps(yz, wx), lanes.sy);
+
+    matrix.columns[2][0] = _mm_mul_ps(_mm_add_ps(xz, wy), lanes.sz);
+    matrix.columns[2][1] = _mm_mul_ps(_mm_sub_ps(yz, wx), lanes.sz);
+    matrix.columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), lanes.sz);
+
+    return matrix;
+  }
+
+  // Transposes the component registers back into one column per matrix
+  static inline void storeLanes(const MatrixLanes4& matrix, __m128 tx, __m128 ty, __m128 tz, glm::mat4* matrices)
+  {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    for (int c = 0; c < 3; c++)
+    {
+      __m128 r0 = matrix.columns[c][0];
+      __m128 r1 = matrix.columns[c][1];
+      __m128 r2 = matrix.columns[c][2];
+      __m128 r3 = zero;
+
+      _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+      _mm_storeu_ps(&matrices[0][c].x, r0);
+      _mm_storeu_ps(&matrices[1][c].x, r1);
+      _mm_storeu_ps(&matrices[2][c].x, r2);
+      _mm_storeu_ps(&matrices[3][c].x, r3);
+    }
+
+    __m128 w = one;
+
+    _MM_TRANSPOSE4_PS(tx, ty, tz, w);
+
+    _mm_storeu_ps(&matrices[0][3].x, tx);
+    _mm_storeu_ps(&matrices[1][3].x, ty);
+    _mm_storeu_ps(&matrices[2][3].x, tz);
+    _mm_storeu_ps(&matrices[3][3].x, w);
+  }
+
+#endif
+
+#if LOTUS_MODEL_MATRICES_AVX2
+
+  struct MatrixLanes8
+  {
+    __m256 columns[3][3];
+  };
+
+  static inline __m256 combine(__m128 low, __m128 high)
+  {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+  }
+
+  // Eight transforms at once, the loads and stores reuse the four wide transposes
+  static inline MatrixLanes8 composeLanes(const TransformLanes4& low, const TransformLanes4& high)
+  {
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    const __m256 qx = combine(low.qx, high.qx);
+    const __m256 qy = combine(low.qy, high.qy);
+    const __m256 qz = combine(low.qz, high.qz);
+    const __m256 qw = combine(low.qw, high.qw);
+    const __m256 sx = combine(low.sx, high.sx);
+    const __m256 sy = combine(low.sy, high.sy);
+    const __m256 sz = combine(low.sz, high.sz);
+
+    const __m256 x2 = _mm256_add_ps(qx, qx);
+    const __m256 y2 = _mm256_add_ps(qy, qy);
+    const __m256 z2 = _mm256_add_ps(qz, qz);
+
+    const __m256 xx = _mm256_mul_ps(qx, x2);
+    const __m256 yy = _mm256_mul_ps(qy, y2);
+    const __m256 zz = _mm256_mul_ps(qz, z2);
+    const __m256 xy = _mm256_mul_ps(qx, y2);
+    const __m256 xz = _mm256_mul_ps(qx, z2);
+    const __m256 yz = _mm256_mul_ps(qy, z2);
+
+    // Fused products of the w terms, the results can differ from the scalar path in the last bit
+    MatrixLanes8 matrix;
+
+    matrix.columns[0][0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+    matrix.columns[0][1] = _mm256_mul_ps(_mm256_fmadd_ps(qw, z2, xy), sx);
+    matrix.columns[0][2] = _mm256_mul_ps(_mm256_fnmadd_ps(qw, y2, xz), sx);
+
+    matrix.columns[1][0] = _mm256_mul_ps(_mm256_fnmadd_ps(qw, z2, xy), sy);
+    matrix.columns[1][1] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+    matrix.columns[1][2] = _mm256_mul_ps(_mm256_fmadd_ps(qw, x2, yz), sy);
+
+    matrix.columns[2][0] = _mm256_mul_ps(_mm256_fmadd_ps(qw, y2, xz), sz);
+    matrix.columns[2][1] = _mm256_mul_ps(_mm256_fnmadd_ps(qw, x2, yz), sz);
+    matrix.columns[2][2] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+
+    return matrix;
+  }
+
+  static inline void storeLanes(const MatrixLanes8& matrix, const TransformLanes4& low, const TransformLanes4& high, glm::mat4* matrices)
+  {
+    MatrixLanes4 lowMatrix;
+    MatrixLanes4 highMatrix;
+
+    for (int c = 0; c < 3; c++)
+    {
+      for (int r = 0; r < 3; r++)
+      {
+        lowMatrix.columns[c][r] = _mm256_castps256_ps128(matrix.columns[c][r]);
+        highMatrix.columns[c][r] = _mm256_extractf128_ps(matrix.columns[c][r], 1);
+      }
+    }
+
+    storeLanes(lowMatrix, low.tx, low.ty, low.tz, matrices);
+    storeLanes(highMatrix, high.tx, high.ty, high.tz, matrices + 4);
+  }
+
+#endif
+
+  void composeModelMatrices(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      glm::mat4* matrices,
+      size_t count)
+  {
+    size_t i = 0;
+
+#if LOTUS_MODEL_MATRICES_AVX2
+    for (; i + 8 <= count; i += 8)
+    {
+      const TransformLanes4 low = loadPacked(translations, rotations, scales, i);
+      const TransformLanes4 high = loadPacked(translations, rotations, scales, i + 4);
+
+      storeLanes(composeLanes(low, high), low, high, matrices + i);
+    }
+#endif
+
+#if LOTUS_MODEL_MATRICES_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+      const TransformLanes4 lanes = loadPacked(translations, rotations, scales, i);
+
+      storeLanes(composeLanes(lanes), lanes.tx, lanes.ty, lanes.tz, matrices + i);
+    }
+#endif
+
+    composeModelMatricesScalar(translations + i, rotations + i, scales + i, matrices + i, count - i);
+  }
+
+  void composeModelMatrices(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      const uint32_t* indices,
+      glm::mat4* matrices,
+      size_t count)
+  {
+    size_t i = 0;
+
+#if LOTUS_MODEL_MATRICES_AVX2
+    for (; i + 8 <= count; i += 8)
+    {
+      const TransformLanes4 low = loadScattered(translations, rotations, scales, indices + i);
+      const TransformLanes4 high = loadScattered(translations, rotations, scales, indices + i + 4);
+
+      storeLanes(composeLanes(low, high), low, high, matrices + i);
+    }
+#endif
+
+#if LOTUS_MODEL_MATRICES_SSE
+    for (; i + 4 <= count; i += 4)
+    {
+      const TransformLanes4 lanes = loadScattered(translations, rotations, scales, indices + i);
+
+      storeLanes(composeLanes(lanes), lanes.tx, lanes.ty, lanes.tz, matrices + i);
+    }
+#endif
+
+    composeModelMatricesScalar(translations, rotations, scales, indices + i, matrices + i, count - i);
+  }
+
+  glm::mat3 computeNormalMatrix(const glm::mat4& model)
+  {
+    const glm::vec3 x = glm::vec3(model[0]);
+    const glm::vec3 y = glm::vec3(model[1]);
+    const glm::vec3 z = glm::vec3(model[2]);
+
+    glm::mat3 cofactors = glm::mat3(glm::cross(y, z), glm::cross(z, x), glm::cross(x, y));
+
+    // The determinant is the dot of any column with its cofactors
+    if (glm::dot(x, cofactors[0]) < 0.0f)
+    {
+      cofactors = glm::mat3(-cofactors[0], -cofactors[1], -cofactors[2]);
+    }
+
+    return cofactors;
+  }
+
+  void writeObjectModel(const glm::mat4& model, GPUObjectData& object)
+  {
+    const glm::mat3 normalMatrix = computeNormalMatrix(model);
+
+    object.model = model;
+    object.normalMatrix[0] = glm::vec4(normalMatrix[0], 0.0f);
+    object.normalMatrix[1] = glm::vec4(normalMatrix[1], 0.0f);
+    object.normalMatrix[2] = glm::vec4(normalMatrix[2], 0.0f);
+  }
+
+  const char* getModelMatricesInstructionSet()
+  {
+#if LOTUS_MODEL_MATRICES_AVX2
+    return "AVX2";
+#elif LOTUS_MODEL_MATRICES_SSE
+    return "SSE";
+#else
+    return "Scalar";
+#endif
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "gpu_primitives.h"
+
+namespace Lotus
+{
+  /*
+    Composes translate(translation) * toMat4(rotation) * scale(scale) without building the intermediate
+    matrices. The rotation is expected to be normalized, as in glm::toMat4
+  */
+  inline glm::mat4 composeModelMatrix(const glm::vec3& translation, const glm::fquat& rotation, const glm::vec3& scale)
+  {
+    const float x2 = rotation.x + rotation.x;
+    const float y2 = rotation.y + rotation.y;
+    const float z2 = rotation.z + rotation.z;
+
+    const float xx = rotation.x * x2;
+    const float yy = rotation.y * y2;
+    const float zz = rotation.z * z2;
+    const float xy = rotation.x * y2;
+    const float xz = rotation.x * z2;
+    const float yz = rotation.y * z2;
+    const float wx = rotation.w * x2;
+    const float wy = rotation.w * y2;
+    const float wz = rotation.w * z2;
+
+    return glm::mat4(
+        glm::vec4((1.0f - (yy + zz)) * scale.x, (xy + wz) * scale.x, (xz - wy) * scale.x, 0.0f),
+        glm::vec4((xy - wz) * scale.y, (1.0f - (xx + zz)) * scale.y, (yz + wx) * scale.y, 0.0f),
+        glm::vec4((xz + wy) * scale.z, (yz - wx) * scale.z, (1.0f - (xx + yy)) * scale.z, 0.0f),
+        glm::vec4(translation.x, translation.y, translation.z, 1.0f));
+  }
+
+  // Composes the model matrices of count transforms stored in parallel arrays
+  void composeModelMatrices(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      glm::mat4* matrices,
+      size_t count);
+
+  // Composes the model matrices of the transforms at the given indices, matrices[i] belongs to indices[i]
+  void composeModelMatrices(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      const uint32_t* indices,
+      glm::mat4* matrices,
+      size_t count);
+
+  // Reference implementations, one transform at a time
+  void composeModelMatricesScalar(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      glm::mat4* matrices,
+      size_t count);
+
+  void composeModelMatricesScalar(
+      const glm::vec3* translations,
+      const glm::fquat* rotations,
+      const glm::vec3* scales,
+      const uint32_t* indices,
+      glm::mat4* matrices,
+      size_t count);
+
+  /*
+    Normal matrix of a model matrix, the cofactors of its upper 3x3. It is the transposed inverse scaled by the
+    determinant, so it needs no division and the normals only lose the scale the shaders normalize away. It is
+    flipped with negative determinants so mirroring transforms keep the normals facing out
+  */
+  glm::mat3 computeNormalMatrix(const glm::mat4& model);
+
+  // Writes the model matrix of an object and its normal matrix, stored as the std140 columns of the shader Object
+  void writeObjectModel(const glm::mat4& model, GPUObjectData& object);
+
+  // Instruction set used by composeModelMatrices, "AVX2", "SSE" or "Scalar"
+  const char* getModelMatricesInstructionSet();
+}
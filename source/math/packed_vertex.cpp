@@ -0,0 +1,119 @@
+#include "packed_vertex.h"
+
+#include <cmath>
+#include <cstdint>
+#include <glm/gtc/packing.hpp>
+
+namespace Lotus
+{
+  namespace
+  {
+    // Sign that is never zero, so the folded octahedron faces don't collapse on the axes
+    glm::vec2 signNotZero(const glm::vec2& value)
+    {
+      return glm::vec2(value.x >= 0.0f ? 1.0f : -1.0f, value.y >= 0.0f ? 1.0f : -1.0f);
+    }
+
+    float quantizationScale(float extent)
+    {
+      return extent > 0.0f ? 1.0f / extent : 0.0f;
+    }
+  }
+
+  glm::vec2 encodeOctahedral(const glm::vec3& direction)
+  {
+    float manhattanLength = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+
+    if (manhattanLength == 0.0f) { return glm::vec2(0.0f); }
+
+    glm::vec2 encoded = glm::vec2(direction.x, direction.y) / manhattanLength;
+
+    // The lower hemisphere is folded over the diagonals
+    if (direction.z < 0.0f)
+    {
+      glm::vec2 sign = signNotZero(encoded);
+      encoded = glm::vec2((1.0f - std::abs(encoded.y)) * sign.x, (1.0f - std::abs(encoded.x)) * sign.y);
+    }
+
+    return encoded;
+  }
+
+  glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+  {
+    glm::vec3 direction = glm::vec3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+
+    if (direction.z < 0.0f)
+    {
+      glm::vec2 sign = signNotZero(glm::vec2(direction.x, direction.y));
+      float x = (1.0f - std::abs(direction.y)) * sign.x;
+      float y = (1.0f - std::abs(direction.x)) * sign.y;
+
+      direction.x = x;
+      direction.y = y;
+    }
+
+    return glm::normalize(direction);
+  }
+
+  PackedVertex packVertex(const Vertex& vertex, const MeshBounds& bounds)
+  {
+    PackedVertex packedVertex;
+
+    for (int i = 0; i < 3; i++)
+    {
+      float normalized = (vertex.position[i] - bounds.minimum[i]) * quantizationScale(bounds.maximum[i] - bounds.minimum[i]);
+      packedVertex.position[i] = glm::packUnorm1x16(normalized);
+    }
+
+    // Mirrored UVs flip the bitangent, the shaders rebuild it as cross(normal, tangent) * sign
+    bool positiveBitangent = glm::dot(glm::cross(vertex.normal, vertex.tangent), vertex.bitangent) >= 0.0f;
+    packedVertex.position[3] = positiveBitangent ? UINT16_MAX : 0;
+
+    glm::vec2 normal = encodeOctahedral(vertex.normal);
+    glm::vec2 tangent = encodeOctahedral(vertex.tangent);
+
+    packedVertex.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(normal.x));
+    packedVertex.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(normal.y));
+    packedVertex.tangent[0] = static_cast<int16_t>(glm::packSnorm1x16(tangent.x));
+    packedVertex.tangent[1] = static_cast<int16_t>(glm::packSnorm1x16(tangent.y));
+
+    packedVertex.uv[0] = glm::packHalf1x16(vertex.uv.x);
+    packedVertex.uv[1] = glm::packHalf1x16(vertex.uv.y);
+
+    return packedVertex;
+  }
+
+  Vertex unpackVertex(const PackedVertex& packedVertex, const MeshBounds& bounds)
+  {
+    Vertex vertex;
+
+    for (int i = 0; i < 3; i++)
+    {
+      float normalized = glm::unpackUnorm1x16(packedVertex.position[i]);
+      vertex.position[i] = bounds.minimum[i] + normalized * (bounds.maximum[i] - bounds.minimum[i]);
+    }
+
+    vertex.normal = decodeOctahedral(glm::vec2(
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packedVertex.normal[0])),
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packedVertex.normal[1]))));
+
+    vertex.tangent = decodeOctahedral(glm::vec2(
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packedVertex.tangent[0])),
+        glm::unpackSnorm1x16(static_cast<uint16_t>(packedVertex.tangent[1]))));
+
+    float bitangentSign = packedVertex.position[3] > 0 ? 1.0f : -1.0f;
+    vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * bitangentSign;
+
+    vertex.uv = glm::vec2(glm::unpackHalf1x16(packedVertex.uv[0]), glm::unpackHalf1x16(packedVertex.uv[1]));
+
+    return vertex;
+  }
+
+  void packVertices(const Vertex* vertices, size_t verticesCount, const MeshBounds& bounds, PackedVertex* packedVertices)
+  {
+    for (size_t i = 0; i < verticesCount; i++)
+    {
+      packedVertices[i] = packVertex(vertices[i], bounds);
+    }
+  }
+}
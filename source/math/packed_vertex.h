@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "primitives.h"
+#include "gpu_primitives.h"
+#include "bounds.h"
+
+namespace Lotus
+{
+  /*
+    Octahedral encoding of a unit vector in [-1, 1]^2, the octahedron faces are unfolded on a square so the
+    error is spread evenly over the sphere
+  */
+  glm::vec2 encodeOctahedral(const glm::vec3& direction);
+  glm::vec3 decodeOctahedral(const glm::vec2& encoded);
+
+  // Positions are quantized in the box of the mesh, the vertex shader reads it from the mesh bounds buffer
+  PackedVertex packVertex(const Vertex& vertex, const MeshBounds& bounds);
+
+  // The bitangent is rebuilt from the normal, the tangent and the sign, as the shaders do
+  Vertex unpackVertex(const PackedVertex& vertex, const MeshBounds& bounds);
+
+  void packVertices(const Vertex* vertices, size_t verticesCount, const MeshBounds& bounds, PackedVertex* packedVertices);
+}
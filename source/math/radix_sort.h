@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <vector>
+
+namespace Lotus
+{
+  /*
+    Stable least significant digit radix sort with 8 bit digits. The key function maps each element
+    to an unsigned integer of at most keyBits bits, passes whose digit is the same for every element
+    are skipped, so narrow or mostly equal keys only pay for the histogram pass.
+    Sorting by several keys is done sorting by the least significant key first, since it is stable
+  */
+  template <typename T, typename KeyFunction>
+  void radixSort(std::vector<T>& data, std::vector<T>& scratch, KeyFunction key, uint32_t keyBits = 64)
+  {
+    constexpr uint32_t DigitBits = 8;
+    constexpr uint32_t DigitValues = 1 << DigitBits;
+    constexpr uint32_t MaxDigits = 64 / DigitBits;
+
+    const size_t size = data.size();
+    const uint32_t digitsCount = keyBits == 0 ? 0 : (keyBits + DigitBits - 1) / DigitBits;
+
+    if (size < 2 || digitsCount == 0) { return; }
+
+    // All the digits histograms are computed in a single pass over the data
+    std::array<std::array<size_t, DigitValues>, MaxDigits> histograms{};
+
+    for (size_t i = 0; i < size; i++)
+    {
+      uint64_t value = static_cast<uint64_t>(key(data[i]));
+
+      for (uint32_t d = 0; d < digitsCount; d++)
+      {
+        histograms[d][(value >> (d * DigitBits)) & (DigitValues - 1)]++;
+      }
+    }
+
+    scratch.resize(size);
+
+    T* source = data.data();
+    T* destination = scratch.data();
+    bool sortedInScratch = false;
+
+    for (uint32_t d = 0; d < digitsCount; d++)
+    {
+      std::array<size_t, DigitValues>& histogram = histograms[d];
+
+      // Trivial pass, every element has the same digit
+      if (histogram[(static_cast<uint64_t>(key(source[0])) >> (d * DigitBits)) & (DigitValues - 1)] == size)
+      {
+        continue;
+      }
+
+      size_t offset = 0;
+      for (uint32_t v = 0; v < DigitValues; v++)
+      {
+        size_t count = histogram[v];
+        histogram[v] = offset;
+        offset += count;
+      }
+
+      for (size_t i = 0; i < size; i++)
+      {
+        uint32_t digit = (static_cast<uint64_t>(key(source[i])) >> (d * DigitBits)) & (DigitValues - 1);
+        destination[histogram[digit]++] = source[i];
+      }
+
+      std::swap(source, destination);
+      sortedInScratch = !sortedInScratch;
+    }
+
+    if (sortedInScratch)
+    {
+      data.swap(scratch);
+    }
+  }
+}
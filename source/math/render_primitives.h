@@ -7,37 +7,84 @@
 namespace Lotus
 {  
   /*
-    Abstract representation of an unsigned int ID related to an specific class
+    Abstract representation of an ID related to an specific class. The index is the position of the
+    element in its container, and the generation tells apart the elements that used the same position
   */
   template <typename T>
   class Handle
   {
   public:
-    Handle() : value(0) {}
-    Handle(uint32_t initValue) : value(initValue) {}
+    Handle() : index(0), generation(0) {}
+    Handle(uint32_t initIndex, uint32_t initGeneration = 0) : index(initIndex), generation(initGeneration) {}
 
     Handle<T>& operator=(const Handle<T>& other)
     {
-      value = other.value;
+      index = other.index;
+      generation = other.generation;
       return *this;
     }
 
     friend bool operator==(const Handle<T>& l, const Handle<T>& r)
     {
-      return l.value == r.value;
+      return l.index == r.index && l.generation == r.generation;
+    }
+
+    friend bool operator!=(const Handle<T>& l, const Handle<T>& r)
+    {
+      return !(l == r);
     }
 
     friend bool operator<(const Handle<T>& l, const Handle<T>& r)
     {
-      return l.value < r.value;
+      return l.getValue() < r.getValue();
     }
 
-    uint32_t get() const { return value; }
+    uint32_t get() const { return index; }
+    uint32_t getGeneration() const { return generation; }
 
-    void set(uint32_t newValue) { value = newValue; }
+    // Index and generation packed with the index in the high bits, so it keeps the handles order
+    uint64_t getValue() const { return (static_cast<uint64_t>(index) << 32) | generation; }
+
+    void set(uint32_t newIndex, uint32_t newGeneration = 0)
+    {
+      index = newIndex;
+      generation = newGeneration;
+    }
 
   private:
-    uint32_t value;
+    uint32_t index;
+    uint32_t generation;
+  };
+
+  // Levels of detail of a mesh, including the full one
+  constexpr uint32_t MaxMeshLODs = 4;
+
+  /*
+    Index range of a level of detail, relative to the first index of its mesh. The error is the distance in
+    mesh space the simplified surface may be from the full one
+  */
+  struct MeshLOD
+  {
+    uint32_t firstIndex = 0;
+    uint32_t count = 0;
+    float error = 0.0f;
+  };
+
+  // Limits of a meshlet, 64 vertices and 124 triangles fit the cluster sizes GPUs process best
+  constexpr uint32_t MeshletMaxVertices = 64;
+  constexpr uint32_t MeshletMaxTriangles = 124;
+
+  /*
+    Cluster of neighbour triangles of the full detail mesh, as an index range relative to the first index of its
+    mesh. The cone bounds the normals of its triangles, as the axis and the sine of the angle between the axis
+    and the farthest normal. A cutoff of 1 means the normals are too spread and the meshlet is never backfacing
+  */
+  struct Meshlet
+  {
+    glm::vec4 boundingSphere = glm::vec4(0.0f); // Mesh space center and radius
+    glm::vec4 cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    uint32_t firstIndex = 0;
+    uint32_t count = 0;
   };
 
   /*
@@ -45,9 +92,23 @@ namespace Lotus
   */
   struct RenderMesh
   {
+    // Indices of the full detail mesh, the coarser levels are stored after them
     uint32_t count;
     uint32_t firstIndex;
     uint32_t baseVertex;
+
+    // Mesh space bounds, the sphere is stored as center and radius
+    glm::vec3 boundsMinimum = glm::vec3(0.0f);
+    glm::vec3 boundsMaximum = glm::vec3(0.0f);
+    glm::vec4 boundingSphere = glm::vec4(0.0f);
+
+    // The first one is the full detail mesh
+    uint32_t lodsCount = 1;
+    MeshLOD lods[MaxMeshLODs] = {};
+
+    // Range in the meshlet buffer, meshes without meshlets are drawn whole by the LOD commands
+    uint32_t firstMeshlet = 0;
+    uint32_t meshletsCount = 0;
   };
 
   struct RenderMaterial
@@ -65,6 +126,9 @@ namespace Lotus
 
     uint32_t ID = 0;
 
+    // Key the object was batched with, so it can be unbatched after its handles change
+    uint64_t sortKey = 0;
+
     bool unbatched = true;
   };
 
@@ -94,6 +158,7 @@ namespace Lotus
   */
   struct ObjectBatch
   {
+    uint64_t sortKey;
     Handle<RenderObject> objectHandle;
     Handle<int> shaderHandle;
     Handle<RenderMesh> meshHandle;
@@ -6,40 +6,82 @@
 #include <cstring>
 #include <limits>
 #include <algorithm>
+#include <array>
 #include <vector>
-#include <set>
+#include <map>
+#include <type_traits>
 #include <glad/glad.h>
 #include "../util/log.h"
+#include "../util/dirty_interval_set.h"
+#include "../util/tlsf_allocator.h"
+#include "../util/bitset_allocator.h"
 #include "../math/gpu_primitives.h"
 
 namespace Lotus
 {
 
-  template <typename T, bool CPUMapEnabled = true>
+  /*
+    How the CPU writes reach a GPU buffer:
+    - Mapped: map() maps the GL buffer and the caller writes it directly
+    - CPUShadow: map() returns a CPU copy of the buffer, and unmap() uploads it with glBufferSubData
+    - PersistentRing: the GL buffer stays mapped and is split in RingRegionsCount regions. The CPU writes
+      one region while the GPU reads the others, and a fence per region keeps the CPU from overwriting
+      data that is still in use. The CPU copy is kept to bring each region up to date before reusing it
+  */
+  enum class GPUBufferPolicy
+  {
+    Mapped,
+    CPUShadow,
+    PersistentRing
+  };
+
+  template <typename T, GPUBufferPolicy Policy = GPUBufferPolicy::CPUShadow>
   struct GPUBuffer
   {
+    static constexpr bool HasCPUBuffer = Policy != GPUBufferPolicy::Mapped;
+    static constexpr bool IsRing = Policy == GPUBufferPolicy::PersistentRing;
+
+    static constexpr uint32_t RingRegionsCount = 3;
+    static constexpr uint64_t FenceTimeout = 1000000; // 1 ms
+
+    // Dirty ranges closer than this are uploaded together
+    static constexpr size_t DefaultDirtyMergeGapBytes = 256;
+
     GPUBuffer() :
       ID(0),
       bufferType(GL_SHADER_STORAGE_BUFFER),
       filledSize(0),
       allocatedSize(0),
-      allocated(false)
+      allocated(false),
+      mappedBuffer(nullptr),
+      currentRegion(0),
+      uploadedBytes(0),
+      uploadsCount(0)
     {
       glGenBuffers(1, &ID);
       
       CPUBuffer = nullptr;
+      fences.fill(nullptr);
+
+      setDirtyMergeGap(std::max<size_t>(1, DefaultDirtyMergeGapBytes / sizeof(T)));
     }
 
     GPUBuffer(const GPUBuffer& other) = delete;
 
     ~GPUBuffer()
     {
+      // Deleting the buffer also unmaps it
       glDeleteBuffers(1, &ID);
 
-      if constexpr(CPUMapEnabled)
+      if constexpr(HasCPUBuffer)
       {
         delete[] CPUBuffer;
       }
+
+      if constexpr(IsRing)
+      {
+        deleteFences();
+      }
     }
 
     GPUBuffer& operator=(const GPUBuffer& other) = delete;
@@ -64,11 +106,9 @@ namespace Lotus
         return;
       }
 
-      glBindBuffer(bufferType, ID);
-      glBufferData(bufferType, initialAllocationSize * sizeof(T), nullptr, GL_DYNAMIC_DRAW);
-      glBindBuffer(bufferType, 0);
+      createStorage(initialAllocationSize, nullptr);
 
-      if constexpr(CPUMapEnabled)
+      if constexpr(HasCPUBuffer)
       {
         CPUBuffer = new T[initialAllocationSize];
       }
@@ -87,11 +127,9 @@ namespace Lotus
         return;
       }
 
-      glBindBuffer(bufferType, ID);
-      glBufferData(bufferType, initialAllocationSize * sizeof(T), initialAllocationData, GL_DYNAMIC_DRAW);
-      glBindBuffer(bufferType, 0);
+      createStorage(initialAllocationSize, initialAllocationData);
 
-      if constexpr(CPUMapEnabled)
+      if constexpr(HasCPUBuffer)
       {
         CPUBuffer = new T[initialAllocationSize];
 
@@ -119,34 +157,75 @@ namespace Lotus
         newAllocationSize *= 2;
       }
 
-      uint32_t newID;
+      resize(newAllocationSize);
+    }
 
-      glGenBuffers(1, &newID);
-      glBindBuffer(bufferType, newID);
-      glBufferData(bufferType, newAllocationSize * sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+    // Releases the space after the filled elements
+    void shrinkToFit()
+    {
+      if (!allocated)
+      {
+        LOTUS_LOG_WARN("[Buffer Warning] Tried to shrink non-allocated buffer with ID {0}", ID);
+        return;
+      }
 
-      glBindBuffer(GL_COPY_READ_BUFFER, ID);
+      size_t newAllocationSize = std::max<size_t>(filledSize, 1);
 
-      glCopyBufferSubData(GL_COPY_READ_BUFFER, bufferType, 0, 0, std::min(allocatedSize, newAllocationSize) * sizeof(T));
+      if (newAllocationSize < allocatedSize)
+      {
+        resize(newAllocationSize);
+      }
+    }
 
-      glBindBuffer(bufferType, 0);
-      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    // Moves the data to a new buffer of the given size, keeping the elements that fit
+    void resize(size_t newAllocationSize)
+    {
+      uint32_t oldID = ID;
 
-      glDeleteBuffers(1, &ID);
+      glGenBuffers(1, &ID);
 
-      if constexpr(CPUMapEnabled)
+      if constexpr(IsRing)
+      {
+        // Every region of the new buffer starts from the CPU copy, the old fences guard a deleted buffer
+        createStorage(newAllocationSize, nullptr);
+
+        size_t copiedSize = std::min({ filledSize, allocatedSize, newAllocationSize });
+
+        for (uint32_t region = 0; region < RingRegionsCount; region++)
+        {
+          std::memcpy(getRegionData(region, newAllocationSize), CPUBuffer, copiedSize * sizeof(T));
+          pendingRanges[region].clear();
+        }
+
+        deleteFences();
+      }
+      else
+      {
+        createStorage(newAllocationSize, nullptr);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, oldID);
+        glBindBuffer(bufferType, ID);
+
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, bufferType, 0, 0, std::min(allocatedSize, newAllocationSize) * sizeof(T));
+
+        glBindBuffer(bufferType, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      }
+
+      glDeleteBuffers(1, &oldID);
+
+      if constexpr(HasCPUBuffer)
       {
         T* newCPUBuffer = new T[newAllocationSize];
-        std::memcpy(newCPUBuffer, CPUBuffer, allocatedSize * sizeof(T));
+        std::memcpy(newCPUBuffer, CPUBuffer, std::min(allocatedSize, newAllocationSize) * sizeof(T));
 
         delete[] CPUBuffer;
 
         CPUBuffer = newCPUBuffer;
       }
 
-      LOTUS_LOG_INFO("[Buffer Log] Reallocated buffer with ID {0} (Old ID = {1}, Size = {2}, Old Size = {3})", newID, ID, newAllocationSize, allocatedSize);
+      LOTUS_LOG_INFO("[Buffer Log] Reallocated buffer with ID {0} (Old ID = {1}, Size = {2}, Old Size = {3})", ID, oldID, newAllocationSize, allocatedSize);
 
-      ID = newID;
       allocatedSize = newAllocationSize;
 
       link();
@@ -154,14 +233,33 @@ namespace Lotus
 
     void write(const T* source, uint32_t first, size_t size)
     {
-      glBindBuffer(bufferType, ID);
-      glBufferSubData(bufferType, first * sizeof(T), size * sizeof(T), source);
-      glBindBuffer(bufferType, 0);
+      uploadedBytes += size * sizeof(T);
+      uploadsCount++;
+
+      if constexpr(IsRing)
+      {
+        // The other regions receive the data when they become the current one
+        std::memcpy(getRegionData(currentRegion, allocatedSize) + first, source, size * sizeof(T));
+
+        for (uint32_t region = 0; region < RingRegionsCount; region++)
+        {
+          if (region != currentRegion)
+          {
+            pendingRanges[region].add(first, first + size);
+          }
+        }
+      }
+      else
+      {
+        glBindBuffer(bufferType, ID);
+        glBufferSubData(bufferType, first * sizeof(T), size * sizeof(T), source);
+        glBindBuffer(bufferType, 0);
+      }
     }
 
     T* map()
     {
-      if constexpr(CPUMapEnabled)
+      if constexpr(HasCPUBuffer)
       {
         if (allocatedSize < filledSize)
         {
@@ -176,11 +274,31 @@ namespace Lotus
       }
     }
 
+    // Elements in [first, first + size) of the CPU buffer were modified, and must be uploaded on unmap
+    void markDirty(uint32_t first, size_t size = 1)
+    {
+      if constexpr(HasCPUBuffer)
+      {
+        dirtyIntervals.add(first, first + size);
+      }
+    }
+
+    // Uploads the elements marked as dirty since the last unmap
     void unmap()
     {
-      if constexpr(CPUMapEnabled)
+      if constexpr(HasCPUBuffer)
       {
-        write(CPUBuffer, 0, filledSize);
+        for (const DirtyIntervalSet::Interval& interval : dirtyIntervals.getIntervals())
+        {
+          size_t end = std::min(interval.end, filledSize);
+
+          if (interval.first < end)
+          {
+            write(CPUBuffer + interval.first, static_cast<uint32_t>(interval.first), end - interval.first);
+          }
+        }
+
+        dirtyIntervals.clear();
       }
       else
       {
@@ -188,6 +306,89 @@ namespace Lotus
       }
     }
 
+    void unmap(uint32_t first, size_t size)
+    {
+      markDirty(first, size);
+      unmap();
+    }
+
+    // Gap, in elements, under which two dirty ranges are uploaded as one
+    void setDirtyMergeGap(size_t elements)
+    {
+      dirtyIntervals.setMergeGap(elements);
+
+      for (DirtyIntervalSet& pendingIntervals : pendingRanges)
+      {
+        pendingIntervals.setMergeGap(elements);
+      }
+    }
+
+    size_t getUploadedBytes() const { return uploadedBytes; }
+    size_t getUploadsCount() const { return uploadsCount; }
+
+    void resetUploadCounters()
+    {
+      uploadedBytes = 0;
+      uploadsCount = 0;
+    }
+
+    /*
+      Must be called once the draws that read the current region are submitted. The writes of the next
+      frame go to the next region, after the GPU is done with it
+    */
+    void nextFrame()
+    {
+      if constexpr(IsRing)
+      {
+        fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        currentRegion = (currentRegion + 1) % RingRegionsCount;
+
+        waitFence(currentRegion);
+
+        // Writes done while the region was in use by the GPU
+        DirtyIntervalSet& pendingIntervals = pendingRanges[currentRegion];
+
+        for (const DirtyIntervalSet::Interval& interval : pendingIntervals.getIntervals())
+        {
+          size_t end = std::min(interval.end, allocatedSize);
+
+          if (interval.first < end)
+          {
+            std::memcpy(getRegionData(currentRegion, allocatedSize) + interval.first, CPUBuffer + interval.first, (end - interval.first) * sizeof(T));
+
+            uploadedBytes += (end - interval.first) * sizeof(T);
+            uploadsCount++;
+          }
+        }
+
+        pendingIntervals.clear();
+      }
+    }
+
+    // Byte offset of the region the GPU must read this frame
+    size_t getRegionOffset() const
+    {
+      if constexpr(IsRing)
+      {
+        return currentRegion * allocatedSize * sizeof(T);
+      }
+      else
+      {
+        return 0;
+      }
+    }
+
+    size_t getRegionSize() const
+    {
+      return allocatedSize * sizeof(T);
+    }
+
+    uint32_t getCurrentRegion() const
+    {
+      return currentRegion;
+    }
+
     uint32_t ID;
     uint32_t bufferType;
     size_t filledSize;
@@ -196,19 +397,100 @@ namespace Lotus
 
     // TODO: Declare this variable at compile time (not possible with if constexpr)
     T* CPUBuffer;
+
+  private:
+
+    void createStorage(size_t size, const T* data)
+    {
+      glBindBuffer(bufferType, ID);
+
+      if constexpr(IsRing)
+      {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        const size_t storageSize = RingRegionsCount * size * sizeof(T);
+
+        glBufferStorage(bufferType, storageSize, nullptr, flags);
+        mappedBuffer = (T*) (glMapBufferRange(bufferType, 0, storageSize, flags));
+
+        if (data != nullptr)
+        {
+          for (uint32_t region = 0; region < RingRegionsCount; region++)
+          {
+            std::memcpy(getRegionData(region, size), data, size * sizeof(T));
+          }
+        }
+      }
+      else
+      {
+        glBufferData(bufferType, size * sizeof(T), data, GL_DYNAMIC_DRAW);
+      }
+
+      glBindBuffer(bufferType, 0);
+    }
+
+    T* getRegionData(uint32_t region, size_t regionSize)
+    {
+      return mappedBuffer + region * regionSize;
+    }
+
+    void waitFence(uint32_t region)
+    {
+      GLsync& fence = fences[region];
+
+      if (fence == nullptr) { return; }
+
+      GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FenceTimeout);
+
+      while (result == GL_TIMEOUT_EXPIRED)
+      {
+        result = glClientWaitSync(fence, 0, FenceTimeout);
+      }
+
+      if (result == GL_WAIT_FAILED)
+      {
+        LOTUS_LOG_ERROR("[Buffer Error] Failed to wait for the fence of the region {0}, buffer ID {1}", region, ID);
+      }
+
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+
+    void deleteFences()
+    {
+      for (GLsync& fence : fences)
+      {
+        if (fence != nullptr)
+        {
+          glDeleteSync(fence);
+          fence = nullptr;
+        }
+      }
+    }
+
+    // Persistent ring state
+    T* mappedBuffer;
+    uint32_t currentRegion;
+    std::array<GLsync, RingRegionsCount> fences;
+    std::array<DirtyIntervalSet, RingRegionsCount> pendingRanges;
+
+    DirtyIntervalSet dirtyIntervals;
+
+    // Bytes written to the GPU since the last reset
+    size_t uploadedBytes;
+    size_t uploadsCount;
   };
 
-  template <typename T, bool CPUMapEnabled = true>
-  struct UniformGPUBuffer : GPUBuffer<T, CPUMapEnabled>
+  template <typename T, GPUBufferPolicy Policy = GPUBufferPolicy::CPUShadow>
+  struct UniformGPUBuffer : GPUBuffer<T, Policy>
   {
     uint32_t add(const T* source)
     {
-      uint32_t first = this->filledSize;
+      // Reusing the lowest free slot keeps the buffer dense
+      uint32_t first = freeSlots.acquire();
 
-      if (!allocationPlaces.empty())
+      if (first == BitsetAllocator::InvalidSlot)
       {
-        first = *allocationPlaces.begin();
-        allocationPlaces.erase(allocationPlaces.begin());
+        first = this->filledSize;
       }
       
       if (first == this->filledSize)
@@ -223,7 +505,7 @@ namespace Lotus
 
       this->write(source, first, 1);
 
-      if constexpr(CPUMapEnabled)
+      if constexpr(GPUBuffer<T, Policy>::HasCPUBuffer)
       {
         this->CPUBuffer[first] = *source;
       }
@@ -235,7 +517,7 @@ namespace Lotus
     {
       if (first < this->filledSize)
       {
-        allocationPlaces.insert(first);
+        freeSlots.release(first);
       }
       else
       {
@@ -244,86 +526,229 @@ namespace Lotus
       }
     }
 
-    std::set<uint32_t> allocationPlaces;
+    BitsetAllocator freeSlots;
   };
 
+  /*
+    Buffer of variable sized ranges, such as the geometry of meshes. The ranges are placed by a TLSF
+    allocator, so removed ranges are merged with their free neighbors and reused by later adds. compact()
+    slides the ranges down into the free space a few at a time, so shrinkToFit() can release the end
+  */
   template <typename T>
-  struct NonUniformGPUBuffer : GPUBuffer<T, false>
+  struct NonUniformGPUBuffer : GPUBuffer<T, GPUBufferPolicy::Mapped>
   {
+    // Range moved by a compaction step
+    struct Move
+    {
+      uint32_t from;
+      uint32_t to;
+    };
+
+    NonUniformGPUBuffer() :
+      compactionCursor(0),
+      scratchBufferID(0),
+      scratchBufferSize(0)
+    {}
+
+    ~NonUniformGPUBuffer()
+    {
+      if (scratchBufferID != 0)
+      {
+        glDeleteBuffers(1, &scratchBufferID);
+      }
+    }
+
     uint32_t add(const T* source, size_t size = 1)
     {
-      uint32_t first = this->filledSize;
+      uint32_t first = reserve(size);
+
+      this->write(source, first, size);
+
+      return first;
+    }
+
+    // Places a range without writing it, so its data can be written in several steps
+    uint32_t reserve(size_t size)
+    {
+      uint32_t allocationSize = static_cast<uint32_t>(std::max<size_t>(size, 1));
+
+      allocator.grow(static_cast<uint32_t>(this->allocatedSize));
+
+      TLSFAllocator::Allocation allocation = allocator.allocate(allocationSize);
+
+      // Without a fitting free block, the buffer grows and the new space is appended to the allocator
+      if (!allocation.valid())
+      {
+        this->reallocate(this->allocatedSize + allocationSize);
+        allocator.grow(static_cast<uint32_t>(this->allocatedSize));
+
+        allocation = allocator.allocate(allocationSize);
+      }
+
+      uint32_t first = allocation.offset;
+
+      if (first + allocationSize > this->filledSize)
+      {
+        this->filledSize = first + allocationSize;
+      }
+
+      allocations[first] = allocation.node;
+
+      return first;
+    }
+
+    void remove(uint32_t first)
+    {
+      auto allocation = allocations.find(first);
 
-      for (int i = 0; i < allocationBlocks.size(); i++)
+      if (allocation == allocations.end())
       {
-        int sizeDifference = allocationBlocks[i].size - size;
+        LOTUS_LOG_WARN("[Buffer Warning] Tried to remove non-allocated range at {0}, buffer ID {1}", first, this->ID);
+        return;
+      }
+
+      allocator.free(allocation->second);
+      allocations.erase(allocation);
+
+      updateFilledSize();
+    }
 
-        if (sizeDifference == 0)
+    /*
+      Slides ranges down into the free space before them until maxMovedBytes are copied, continuing
+      from where the previous call stopped. The callers must update the offsets of the moved ranges
+    */
+    size_t compact(size_t maxMovedBytes, std::vector<Move>& moves)
+    {
+      size_t movedBytes = 0;
+
+      auto allocation = allocations.lower_bound(compactionCursor);
+
+      while (allocation != allocations.end() && movedBytes < maxMovedBytes)
+      {
+        uint32_t node = allocation->second;
+        uint32_t from = allocation->first;
+        uint32_t to = allocator.slideDown(node);
+        uint32_t size = allocator.getAllocationSize(node);
+
+        if (to != from)
         {
-          first = allocationBlocks[i].first;
-          allocationBlocks[i] = allocationBlocks.back();
-          allocationBlocks.pop_back();
-          break;
+          moveRange(from, to, size);
+          moves.push_back({ from, to });
+          movedBytes += size * sizeof(T);
+
+          // The moved range stays before the next one, so the iteration order is kept
+          allocation = allocations.erase(allocation);
+          allocations.emplace_hint(allocation, to, node);
         }
-        else if (sizeDifference > 0)
+        else
         {
-          first = allocationBlocks[i].first;
-          allocationBlocks[i].first += size;
-          allocationBlocks[i].size = sizeDifference;
-          break;
+          allocation++;
         }
       }
 
-      if (first + size > this->allocatedSize)
-      {
-        this->reallocate(first + size);
-      }
+      // A finished pass starts again from the beginning, catching the ranges removed meanwhile
+      compactionCursor = allocation != allocations.end() ? allocation->first : 0;
+
+      updateFilledSize();
+
+      return movedBytes;
+    }
 
-      if (first + size > this->filledSize)
+    // Releases the free space after the last range, without moving any range
+    void shrinkToFit()
+    {
+      allocator.grow(static_cast<uint32_t>(this->allocatedSize));
+      allocator.shrink(static_cast<uint32_t>(std::max<size_t>(this->filledSize, 1)));
+
+      if (allocator.getCapacity() < this->allocatedSize)
       {
-        this->filledSize = first + size;
+        this->resize(allocator.getCapacity());
       }
+    }
 
-      this->write(source, first, size);
-
-      return first;
+    // Free elements between the ranges, which compact() can recover
+    size_t getHolesSize() const
+    {
+      return this->filledSize - allocator.getUsedSize();
     }
 
-    void remove(uint32_t first, size_t size = 1)
+    TLSFAllocator::Statistics getAllocationStatistics() const
     {
-      int previousAllocationBlockIndex = -1;
-      int nextAllocationBlockIndex = -1;
+      return allocator.getStatistics();
+    }
 
-      for (int i = 0; i < allocationBlocks.size(); i++)
+    TLSFAllocator allocator;
+    // First element of each range to its allocator node, ordered to compact the ranges by offset
+    std::map<uint32_t, uint32_t> allocations;
+
+  private:
+    void updateFilledSize()
+    {
+      if (allocations.empty())
       {
-        // TODO: Indentify previous and next allocation blocks
+        this->filledSize = 0;
+        return;
       }
 
-      // TODO: If they exist, do the merge, if not, then allocationBlocks.emplace_back(first, size);
+      auto last = allocations.rbegin();
+      this->filledSize = last->first + allocator.getAllocationSize(last->second);
     }
 
-    struct AllocationBlock
+    void moveRange(uint32_t from, uint32_t to, uint32_t size)
     {
-      AllocationBlock(uint32_t initialFirst, size_t initialSize) :
-        first(initialFirst),
-        size(initialSize)
-      {}
+      const GLsizeiptr bytes = size * sizeof(T);
 
-      uint32_t first;
-      size_t size;
-    };
+      glBindBuffer(GL_COPY_READ_BUFFER, this->ID);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+
+      if (from - to >= size)
+      {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * sizeof(T), to * sizeof(T), bytes);
+      }
+      else
+      {
+        // Copies between overlapping ranges of the same buffer are not allowed, they go through a scratch buffer
+        if (scratchBufferSize < static_cast<size_t>(bytes))
+        {
+          if (scratchBufferID == 0)
+          {
+            glGenBuffers(1, &scratchBufferID);
+          }
+
+          scratchBufferSize = bytes;
+
+          glBindBuffer(GL_COPY_WRITE_BUFFER, scratchBufferID);
+          glBufferData(GL_COPY_WRITE_BUFFER, scratchBufferSize, nullptr, GL_DYNAMIC_COPY);
+        }
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratchBufferID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from * sizeof(T), 0, bytes);
+
+        glBindBuffer(GL_COPY_READ_BUFFER, scratchBufferID);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, this->ID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to * sizeof(T), bytes);
+      }
+
+      glBindBuffer(GL_COPY_READ_BUFFER, 0);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    // First range of the next compaction step
+    uint32_t compactionCursor;
 
-    std::vector<AllocationBlock> allocationBlocks;
+    uint32_t scratchBufferID;
+    size_t scratchBufferSize;
   };
 
   /*
-    Buffer for meshes vertices
+    Buffer for meshes vertices, in the full Vertex layout or in the PackedVertex one
   */
-  struct VertexBuffer : public NonUniformGPUBuffer<Vertex>
+  template <typename VertexType = Vertex>
+  struct VertexBuffer : public NonUniformGPUBuffer<VertexType>
   {
     VertexBuffer() : vertexArray(0)
     {
-      bufferType = GL_ARRAY_BUFFER;
+      this->bufferType = GL_ARRAY_BUFFER;
     }
 
     void setVertexArray(uint32_t newVertexArray)
@@ -335,21 +760,36 @@ namespace Lotus
     virtual void link() override
     {
       glBindVertexArray(vertexArray);
-      glBindBuffer(bufferType, ID);
+      glBindBuffer(this->bufferType, this->ID);
 
-      glEnableVertexAttribArray(0);
-      glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, position));
-      glEnableVertexAttribArray(1);
-      glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, normal));
-      glEnableVertexAttribArray(2);
-      glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, uv));
-      glEnableVertexAttribArray(3);
-      glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, tangent));
-      glEnableVertexAttribArray(4);
-      glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, bitangent));
+      if constexpr (std::is_same_v<VertexType, PackedVertex>)
+      {
+        // Decoded in the shaders, see shaders/common/vertex.glsl
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*) offsetof(PackedVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*) offsetof(PackedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*) offsetof(PackedVertex, uv));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*) offsetof(PackedVertex, tangent));
+      }
+      else
+      {
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, uv));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*) offsetof(Vertex, bitangent));
+      }
 
       glBindVertexArray(0);
-      glBindBuffer(bufferType, 0);
+      glBindBuffer(this->bufferType, 0);
     }
 
     uint32_t vertexArray;
@@ -383,21 +823,22 @@ namespace Lotus
   };
 
   /*
-    Buffer for draw commands
+    Buffer for draw commands, the draws must add getRegionOffset() to their command offsets
   */
-  struct DrawIndirectBuffer : public UniformGPUBuffer<DrawElementsIndirectCommand, true>
+  template <GPUBufferPolicy Policy = GPUBufferPolicy::CPUShadow>
+  struct DrawIndirectBuffer : public UniformGPUBuffer<DrawElementsIndirectCommand, Policy>
   {
     DrawIndirectBuffer()
     {
-      bufferType = GL_DRAW_INDIRECT_BUFFER;
+      this->bufferType = GL_DRAW_INDIRECT_BUFFER;
     }
   };
 
   /*
     Buffer for generic uniform storage
   */
-  template <typename T>
-  struct ShaderStorageBuffer : public UniformGPUBuffer<T, true>
+  template <typename T, GPUBufferPolicy Policy = GPUBufferPolicy::CPUShadow>
+  struct ShaderStorageBuffer : public UniformGPUBuffer<T, Policy>
   {
     ShaderStorageBuffer() : bindingPoint(0)
     {
@@ -406,13 +847,21 @@ namespace Lotus
 
     void setBindingPoint(uint32_t newBindingPoint)
     {
-      glBindBufferBase(this->bufferType, newBindingPoint, this->ID);
       bindingPoint = newBindingPoint;
+      bind();
     }
 
+    // Ring buffers only expose the region of the current frame, its offset must respect the SSBO offset alignment
     virtual void bind() override
     {
-      glBindBufferBase(this->bufferType, bindingPoint, this->ID);
+      if constexpr(Policy == GPUBufferPolicy::PersistentRing)
+      {
+        glBindBufferRange(this->bufferType, bindingPoint, this->ID, this->getRegionOffset(), this->getRegionSize());
+      }
+      else
+      {
+        glBindBufferBase(this->bufferType, bindingPoint, this->ID);
+      }
     }
 
     virtual void unbind() override
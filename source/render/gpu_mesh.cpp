@@ -7,7 +7,7 @@ namespace Lotus
 {
   GPUMesh::GPUMesh(const MeshPrimitive& mesh) : GPUMesh(mesh.vertices, mesh.indices) {}
 
-  GPUMesh::GPUMesh(const std::vector<Lotus::Vertex>& vertices, const std::vector<unsigned int>& indices)
+  GPUMesh::GPUMesh(std::span<const Lotus::Vertex> vertices, std::span<const unsigned int> indices)
   {
     glGenVertexArrays(1, &vertexArrayID);
 
@@ -1,7 +1,7 @@
 #pragma once
 
 #include <cstdint>
-#include <vector>
+#include <span>
 #include "../math/primitives.h"
 #include "gpu_buffer.h"
 
@@ -11,7 +11,7 @@ namespace Lotus
   {
   public:
     GPUMesh(const MeshPrimitive& mesh);
-    GPUMesh(const std::vector<Lotus::Vertex>& vertices, const std::vector<unsigned int>& indices);
+    GPUMesh(std::span<const Lotus::Vertex> vertices, std::span<const unsigned int> indices);
     ~GPUMesh();
 
     GPUMesh& operator=(const GPUMesh& other) = delete;
@@ -21,7 +21,7 @@ namespace Lotus
 
   private:
     uint32_t vertexArrayID;
-    VertexBuffer vertexBuffer;
+    VertexBuffer<> vertexBuffer;
     IndexBuffer indexBuffer;
 
     uint32_t indicesCount;
@@ -0,0 +1,613 @@
+#include "batch_builder.h"
+
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include "../../math/radix_sort.h"
+
+namespace Lotus
+{
+
+  void printObjectBatches(const std::vector<ObjectBatch>& batches)
+  {
+    for (int i = 0; i < batches.size(); i++)
+    {
+      std::cout << "RB[" << i << "] = {sk_" << batches[i].sortKey << "oh_" << batches[i].objectHandle.get() << "mh_" << batches[i].meshHandle.get() << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  void printDrawBatches(const std::vector<DrawBatch>& batches)
+  {
+    for (int i = 0; i < batches.size(); i++)
+    {
+      std::cout << "DB[" << i << "] = {ic_" << batches[i].instanceCount << "pic_" << batches[i].prevInstanceCount << "mh_" << batches[i].meshHandle.get() << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  void printShaderBatches(const std::vector<ShaderBatch>& batches)
+  {
+    for (int i = 0; i < batches.size(); i++)
+    {
+      std::cout << "SB[" << i << "] = {c_" << batches[i].count << "f_" << batches[i].first << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  // Object batches are ordered by their sort key, and then by their object handle
+  static bool objectBatchLess(const ObjectBatch& bA, const ObjectBatch& bB)
+  {
+    return bA.sortKey < bB.sortKey || (bA.sortKey == bB.sortKey && bA.objectHandle < bB.objectHandle);
+  }
+
+  BatchBuilder::BatchBuilder(const SortKeyLayout& sortKeyLayout) :
+    layout(sortKeyLayout)
+  {}
+
+  uint64_t BatchBuilder::makeSortKey(const RenderObject& object, uint32_t depthBucket) const
+  {
+    return layout.pack(object.shaderHandle, object.meshHandle.get(), object.materialHandle.get(), depthBucket);
+  }
+
+  ObjectBatch BatchBuilder::makeObjectBatch(Handle<RenderObject> objectHandle, const RenderObject& object)
+  {
+    ObjectBatch batch;
+    batch.sortKey = object.sortKey;
+    batch.objectHandle = objectHandle;
+    batch.meshHandle = object.meshHandle;
+    batch.shaderHandle = object.shaderHandle;
+
+    return batch;
+  }
+
+  // Object batches with the same mesh and shader end in the same draw batch
+  static bool sameDrawBatch(const ObjectBatch& bA, const ObjectBatch& bB)
+  {
+    return bA.meshHandle == bB.meshHandle && bA.shaderHandle == bB.shaderHandle;
+  }
+
+  void BatchBuilder::addObject(Handle<RenderObject> objectHandle, RenderObject& object, uint32_t depthBucket)
+  {
+    object.sortKey = makeSortKey(object, depthBucket);
+
+    if (layout.getShader(object.sortKey) != object.shaderHandle || layout.getMesh(object.sortKey) != object.meshHandle.get())
+    {
+      truncatedSortKeys = true;
+    }
+
+    toBatchObjects.push_back(makeObjectBatch(objectHandle, object));
+  }
+
+  void BatchBuilder::removeObject(Handle<RenderObject> objectHandle, const RenderObject& object)
+  {
+    toUnbatchObjects.push_back(makeObjectBatch(objectHandle, object));
+  }
+
+  void BatchBuilder::sortObjectBatches(std::vector<ObjectBatch>& batches, std::vector<ObjectBatch>& scratch) const
+  {
+    if (batches.size() < RadixSortThreshold)
+    {
+      std::sort(batches.begin(), batches.end(), objectBatchLess);
+      return;
+    }
+
+    // Least significant key first, the radix sort is stable
+    radixSort(batches, scratch, [](const ObjectBatch& batch) { return batch.objectHandle.getValue(); }, 64);
+    radixSort(batches, scratch, [](const ObjectBatch& batch) { return batch.sortKey; }, layout.getTotalBits());
+  }
+
+  void BatchBuilder::build()
+  {
+    // Render merge
+    buildObjectBatches();
+
+    // Draw merge
+    buildDrawBatches();
+
+    // Shader merge
+    buildShaderBatches();
+  }
+
+  void BatchBuilder::buildObjectBatches()
+  {
+    objectBatchesChanged = !toUnbatchObjects.empty() || !toBatchObjects.empty();
+
+    if (!objectBatchesChanged) { return; }
+
+    // Both queues are sorted on their own, the removed objects on a job when there are enough of them
+    if (jobSystem && toUnbatchObjects.size() >= RadixSortThreshold && toBatchObjects.size() >= RadixSortThreshold)
+    {
+      JobCounter counter;
+      jobSystem->run([this]() { sortObjectBatches(toUnbatchObjects, unbatchSortScratch); }, &counter);
+
+      sortObjectBatches(toBatchObjects, sortScratch);
+      jobSystem->wait(counter);
+    }
+    else
+    {
+      sortObjectBatches(toUnbatchObjects, sortScratch);
+      sortObjectBatches(toBatchObjects, sortScratch);
+    }
+
+    // Only the window of object batches between the first and the last queued object is merged again
+    auto first = objectBatches.end();
+    auto last = objectBatches.begin();
+
+    if (!toUnbatchObjects.empty())
+    {
+      first = std::min(first, std::lower_bound(objectBatches.begin(), objectBatches.end(), toUnbatchObjects.front(), objectBatchLess));
+      last = std::max(last, std::upper_bound(objectBatches.begin(), objectBatches.end(), toUnbatchObjects.back(), objectBatchLess));
+    }
+
+    if (!toBatchObjects.empty())
+    {
+      first = std::min(first, std::lower_bound(objectBatches.begin(), objectBatches.end(), toBatchObjects.front(), objectBatchLess));
+      last = std::max(last, std::upper_bound(objectBatches.begin(), objectBatches.end(), toBatchObjects.back(), objectBatchLess));
+    }
+
+    uint32_t windowFirst = static_cast<uint32_t>(first - objectBatches.begin());
+    uint32_t windowSize = static_cast<uint32_t>(last - first);
+
+    // Render merge of the window, deletion and then addition
+    sortScratch.clear();
+    std::set_difference(
+        first, last,
+        toUnbatchObjects.begin(), toUnbatchObjects.end(),
+        std::back_inserter(sortScratch),
+        objectBatchLess);
+
+    mergedWindow.clear();
+    std::merge(
+        sortScratch.begin(), sortScratch.end(),
+        toBatchObjects.begin(), toBatchObjects.end(),
+        std::back_inserter(mergedWindow),
+        objectBatchLess);
+
+    uint32_t mergedSize = static_cast<uint32_t>(mergedWindow.size());
+
+    if (mergedSize > windowSize)
+    {
+      objectBatches.insert(objectBatches.begin() + windowFirst + windowSize, mergedSize - windowSize, ObjectBatch());
+    }
+    else if (mergedSize < windowSize)
+    {
+      objectBatches.erase(objectBatches.begin() + windowFirst + mergedSize, objectBatches.begin() + windowFirst + windowSize);
+    }
+
+    std::copy(mergedWindow.begin(), mergedWindow.end(), objectBatches.begin() + windowFirst);
+
+    toUnbatchObjects.clear();
+    toBatchObjects.clear();
+
+    // std::cout << "Render batches after merge" << std::endl;
+    // printObjectBatches(objectBatches);
+
+    /*
+      Objects before changedFirst didn't move, and objects from changedEnd are the old ones
+      from changedEnd - changedSizeDelta
+    */
+    changedFirst = windowFirst;
+    changedEnd = windowFirst + mergedSize;
+    changedSizeDelta = static_cast<int64_t>(mergedSize) - static_cast<int64_t>(windowSize);
+
+    uint32_t objectBatchesCount = static_cast<uint32_t>(objectBatches.size());
+
+    // Every handle after the window moves if its size changed
+    dirtyObjectRange.merge(changedFirst, changedSizeDelta == 0 ? changedEnd : objectBatchesCount);
+    dirtyObjectRange.clamp(objectBatchesCount);
+  }
+
+  uint32_t BatchBuilder::findRunEnd(uint32_t first) const
+  {
+    uint32_t size = static_cast<uint32_t>(objectBatches.size());
+    const ObjectBatch& firstBatch = objectBatches[first];
+
+    if (truncatedSortKeys)
+    {
+      uint32_t end = first + 1;
+      while (end < size && sameDrawBatch(objectBatches[end], firstBatch)) { end++; }
+
+      return end;
+    }
+
+    // Objects of a draw batch are contiguous, so the end is found with an exponential search
+    uint32_t last = first;
+    uint32_t step = 1;
+
+    while (step < size - last && sameDrawBatch(objectBatches[last + step], firstBatch))
+    {
+      last += step;
+      step *= 2;
+    }
+
+    auto searchEnd = objectBatches.begin() + std::min(size, last + step);
+
+    return static_cast<uint32_t>(std::partition_point(objectBatches.begin() + last + 1, searchEnd,
+        [&firstBatch](const ObjectBatch& batch) { return sameDrawBatch(batch, firstBatch); }) - objectBatches.begin());
+  }
+
+  uint32_t BatchBuilder::scanDrawBatches(uint32_t first, uint32_t minStop, std::vector<DrawBatch>& scannedBatches) const
+  {
+    // Scans the draw batches from first, until a draw batch starting after minStop that was already a draw batch before the build
+    uint32_t size = static_cast<uint32_t>(objectBatches.size());
+    uint32_t oldDrawBatchIndex = static_cast<uint32_t>(drawBatches.size());
+    uint32_t begin = first;
+
+    auto oldBatchLess = [](const DrawBatch& batch, int64_t prevInstanceCount) { return batch.prevInstanceCount < prevInstanceCount; };
+
+    while (begin < size)
+    {
+      if (begin >= minStop)
+      {
+        int64_t oldBegin = static_cast<int64_t>(begin) - changedSizeDelta;
+        auto oldBatch = std::lower_bound(drawBatches.begin(), drawBatches.end(), oldBegin, oldBatchLess);
+
+        if (oldBatch != drawBatches.end() && oldBatch->prevInstanceCount == oldBegin)
+        {
+          oldDrawBatchIndex = static_cast<uint32_t>(oldBatch - drawBatches.begin());
+          break;
+        }
+      }
+
+      uint32_t end = findRunEnd(begin);
+
+      DrawBatch newDrawBatch;
+      newDrawBatch.prevInstanceCount = begin;
+      newDrawBatch.instanceCount = end - begin;
+      newDrawBatch.meshHandle = objectBatches[begin].meshHandle;
+      newDrawBatch.shaderHandle = objectBatches[begin].shaderHandle;
+
+      scannedBatches.push_back(newDrawBatch);
+
+      begin = end;
+    }
+
+    return oldDrawBatchIndex;
+  }
+
+  void BatchBuilder::buildDrawBatches()
+  {
+    if (incrementalBuild && !objectBatchesChanged)
+    {
+      drawBatchesChanged = false;
+      return;
+    }
+
+    drawBatchesChanged = true;
+
+    if (!incrementalBuild || drawBatches.empty() || objectBatches.empty())
+    {
+      drawBatches.clear();
+
+      if (!objectBatches.empty())
+      {
+        uint32_t begin = 0;
+        while (begin < objectBatches.size())
+        {
+          uint32_t end = findRunEnd(begin);
+
+          DrawBatch newDrawBatch;
+          newDrawBatch.prevInstanceCount = begin;
+          newDrawBatch.instanceCount = end - begin;
+          newDrawBatch.meshHandle = objectBatches[begin].meshHandle;
+          newDrawBatch.shaderHandle = objectBatches[begin].shaderHandle;
+
+          drawBatches.push_back(newDrawBatch);
+
+          begin = end;
+        }
+      }
+
+      dirtyDrawRange.merge(0, static_cast<uint32_t>(drawBatches.size()));
+      dirtyDrawRange.clamp(static_cast<uint32_t>(drawBatches.size()));
+      dirtyObjectRange.merge(0, static_cast<uint32_t>(objectBatches.size()));
+      dirtyObjectRange.clamp(static_cast<uint32_t>(objectBatches.size()));
+
+      //std::cout << "Draw batches " << std::endl;
+      //printDrawBatches(drawBatches);
+
+      return;
+    }
+
+    // The draw batch before the first change may be extended by the new objects, so the scan starts there
+    uint32_t previousObject = changedFirst > 0 ? changedFirst - 1 : 0;
+    auto firstDrawBatch = std::upper_bound(drawBatches.begin(), drawBatches.end(), previousObject,
+        [](uint32_t object, const DrawBatch& batch) { return object < batch.prevInstanceCount; });
+
+    uint32_t firstDrawBatchIndex = static_cast<uint32_t>(firstDrawBatch - drawBatches.begin()) - 1;
+
+    scannedDrawBatches.clear();
+    uint32_t oldDrawBatchIndex = scanDrawBatches(drawBatches[firstDrawBatchIndex].prevInstanceCount, changedEnd, scannedDrawBatches);
+
+    uint32_t replacedCount = oldDrawBatchIndex - firstDrawBatchIndex;
+    uint32_t scannedCount = static_cast<uint32_t>(scannedDrawBatches.size());
+
+    // Shift the draw batches after the changes, then replace the changed ones
+    if (changedSizeDelta != 0)
+    {
+      for (uint32_t i = oldDrawBatchIndex; i < drawBatches.size(); i++)
+      {
+        drawBatches[i].prevInstanceCount = static_cast<uint32_t>(drawBatches[i].prevInstanceCount + changedSizeDelta);
+      }
+    }
+
+    if (scannedCount > replacedCount)
+    {
+      drawBatches.insert(drawBatches.begin() + oldDrawBatchIndex, scannedCount - replacedCount, DrawBatch());
+    }
+    else if (scannedCount < replacedCount)
+    {
+      drawBatches.erase(drawBatches.begin() + firstDrawBatchIndex + scannedCount, drawBatches.begin() + oldDrawBatchIndex);
+    }
+
+    std::copy(scannedDrawBatches.begin(), scannedDrawBatches.end(), drawBatches.begin() + firstDrawBatchIndex);
+
+    uint32_t drawBatchesCount = static_cast<uint32_t>(drawBatches.size());
+
+    // Commands after the changed ones move if the batches count changed, and their base instance moves if the objects count changed
+    bool tailMoved = scannedCount != replacedCount || changedSizeDelta != 0;
+
+    dirtyDrawRange.merge(firstDrawBatchIndex, tailMoved ? drawBatchesCount : firstDrawBatchIndex + scannedCount);
+    dirtyDrawRange.clamp(drawBatchesCount);
+
+    //std::cout << "Draw batches " << std::endl;
+    //printDrawBatches(drawBatches);
+  }
+
+  void BatchBuilder::buildShaderBatches()
+  {
+    // There is at most one shader batch per draw batch, so they are just rebuilt when the draw batches changed
+    if (incrementalBuild && !drawBatchesChanged) { return; }
+
+    shaderBatches.clear();
+
+    if (drawBatches.size() == 0) { return; }
+
+    ShaderBatch newShaderBatch;
+    newShaderBatch.first = 0;
+    newShaderBatch.count = 0;
+    newShaderBatch.shaderHandle = drawBatches[0].shaderHandle;
+
+    shaderBatches.push_back(newShaderBatch);
+    ShaderBatch* backShaderBatch = &shaderBatches.back();
+
+    for (int i = 0; i < drawBatches.size(); i++)
+    {
+      const DrawBatch* drawBatch = &drawBatches[i];
+
+      bool bSameShader = drawBatch->shaderHandle == backShaderBatch->shaderHandle;
+
+      if (bSameShader)
+      {
+        backShaderBatch->count++;
+      }
+      else
+      {
+        ShaderBatch newShaderBatch;
+        newShaderBatch.first = i;
+        newShaderBatch.count = 1;
+        newShaderBatch.shaderHandle = drawBatch->shaderHandle;
+
+        shaderBatches.push_back(newShaderBatch);
+        backShaderBatch = &shaderBatches.back();
+      }
+    }
+
+    // std::cout << "Shader batches " << std::endl;
+    // printShaderBatches(shaderBatches);
+  }
+
+  template <typename Function>
+  void BatchBuilder::forEachSubrange(const BatchRange& range, Function function) const
+  {
+    if (!jobSystem || range.count <= WriteGrainSize)
+    {
+      function(range);
+      return;
+    }
+
+    // Every element is written from the batches alone, so the subranges don't share anything
+    jobSystem->parallelFor(range.count, WriteGrainSize, [&](size_t first, size_t last)
+    {
+      function(BatchRange{ range.first + static_cast<uint32_t>(first), static_cast<uint32_t>(last - first) });
+    });
+  }
+
+  void BatchBuilder::writeIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands) const
+  {
+    writeIndirectCommands(renderMeshes, commands, { 0, static_cast<uint32_t>(drawBatches.size()) });
+  }
+
+  void BatchBuilder::writeIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const
+  {
+    forEachSubrange(range, [&](const BatchRange& subrange) { writeIndirectCommandsRange(renderMeshes, commands, subrange); });
+  }
+
+  void BatchBuilder::writeIndirectCommandsRange(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const
+  {
+    for (uint32_t i = range.first; i < range.end(); i++)
+    {
+      const DrawBatch& drawBatch = drawBatches[i];
+
+      const RenderMesh& mesh = renderMeshes[drawBatch.meshHandle];
+
+      commands[i].count = mesh.count;
+      commands[i].instanceCount = drawBatch.instanceCount;
+      commands[i].firstIndex = mesh.firstIndex;
+      commands[i].baseVertex = mesh.baseVertex;
+      commands[i].baseInstance = drawBatch.prevInstanceCount;
+    }
+  }
+
+  void BatchBuilder::writeLODIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands) const
+  {
+    writeLODIndirectCommands(renderMeshes, commands, { 0, static_cast<uint32_t>(drawBatches.size()) });
+  }
+
+  void BatchBuilder::writeLODIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const
+  {
+    forEachSubrange(range, [&](const BatchRange& subrange) { writeLODIndirectCommandsRange(renderMeshes, commands, subrange); });
+  }
+
+  void BatchBuilder::writeLODIndirectCommandsRange(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const
+  {
+    for (uint32_t i = range.first; i < range.end(); i++)
+    {
+      const DrawBatch& drawBatch = drawBatches[i];
+
+      const RenderMesh& mesh = renderMeshes[drawBatch.meshHandle];
+
+      DrawElementsIndirectCommand* lodCommands = commands + static_cast<size_t>(i) * MaxMeshLODs;
+
+      for (uint32_t lod = 0; lod < MaxMeshLODs; lod++)
+      {
+        // Meshes with fewer levels have empty commands, the culling pass never selects them
+        bool hasLOD = lod < mesh.lodsCount;
+
+        lodCommands[lod].count = lod == 0 ? mesh.count : (hasLOD ? mesh.lods[lod].count : 0);
+        lodCommands[lod].instanceCount = lod == 0 ? drawBatch.instanceCount : 0;
+        lodCommands[lod].firstIndex = mesh.firstIndex + (hasLOD ? mesh.lods[lod].firstIndex : 0);
+        lodCommands[lod].baseVertex = mesh.baseVertex;
+        lodCommands[lod].baseInstance = drawBatch.prevInstanceCount * MaxMeshLODs + lod * drawBatch.instanceCount;
+      }
+    }
+  }
+
+  uint32_t BatchBuilder::writeClusterBatches(
+      const SlotMap<RenderMesh>& renderMeshes,
+      GPUClusterBatch* clusterBatches,
+      std::vector<ClusterDraw>& draws,
+      uint32_t maxCommands,
+      uint32_t maxInstances) const
+  {
+    draws.clear();
+
+    uint32_t commandsCount = 0;
+    uint32_t instancesCount = 0;
+
+    for (uint32_t i = 0; i < drawBatches.size(); i++)
+    {
+      const DrawBatch& drawBatch = drawBatches[i];
+      const RenderMesh& mesh = renderMeshes[drawBatch.meshHandle];
+
+      clusterBatches[i] = GPUClusterBatch();
+
+      // The worst case of the pass, every meshlet of every instance visible
+      uint64_t batchCommands = static_cast<uint64_t>(mesh.meshletsCount) * drawBatch.instanceCount;
+
+      if (batchCommands == 0 || commandsCount + batchCommands > maxCommands || instancesCount + drawBatch.instanceCount > maxInstances)
+      {
+        continue;
+      }
+
+      clusterBatches[i].firstMeshlet = mesh.firstMeshlet;
+      clusterBatches[i].meshletsCount = mesh.meshletsCount;
+      clusterBatches[i].firstCommand = commandsCount;
+      clusterBatches[i].countIndex = static_cast<uint32_t>(draws.size());
+
+      draws.push_back({ i, drawBatch.shaderHandle, commandsCount, static_cast<uint32_t>(batchCommands) });
+
+      commandsCount += static_cast<uint32_t>(batchCommands);
+      instancesCount += drawBatch.instanceCount;
+    }
+
+    return commandsCount;
+  }
+
+  void BatchBuilder::writeObjectHandles(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles) const
+  {
+    writeObjectHandles(renderObjects, objectHandles, { 0, static_cast<uint32_t>(objectBatches.size()) });
+  }
+
+  void BatchBuilder::writeObjectHandles(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles, const BatchRange& range) const
+  {
+    forEachSubrange(range, [&](const BatchRange& subrange) { writeObjectHandlesRange(renderObjects, objectHandles, subrange); });
+  }
+
+  void BatchBuilder::writeObjectHandlesRange(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles, const BatchRange& range) const
+  {
+    // Draw batches are contiguous ranges of the object batches, so the handles keep the object batches order
+    for (uint32_t i = range.first; i < range.end(); i++)
+    {
+      objectHandles[i] = renderObjects[objectBatches[i].objectHandle].ID;
+    }
+  }
+
+  void BatchBuilder::writeInstances(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances) const
+  {
+    writeInstances(renderObjects, instances, { 0, static_cast<uint32_t>(objectBatches.size()) });
+  }
+
+  void BatchBuilder::writeInstances(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances, const BatchRange& range) const
+  {
+    forEachSubrange(range, [&](const BatchRange& subrange) { writeInstancesRange(renderObjects, instances, subrange); });
+  }
+
+  void BatchBuilder::writeInstancesRange(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances, const BatchRange& range) const
+  {
+    if (range.empty()) { return; }
+
+    // Draw batch holding the first object of the range
+    auto drawBatch = std::upper_bound(drawBatches.begin(), drawBatches.end(), range.first,
+      [](uint32_t objectIndex, const DrawBatch& batch) { return objectIndex < batch.prevInstanceCount; });
+
+    uint32_t drawBatchIndex = static_cast<uint32_t>(drawBatch - drawBatches.begin()) - 1;
+
+    for (uint32_t i = range.first; i < range.end(); i++)
+    {
+      while (i >= drawBatches[drawBatchIndex].prevInstanceCount + drawBatches[drawBatchIndex].instanceCount)
+      {
+        drawBatchIndex++;
+      }
+
+      instances[i].objectID = renderObjects[objectBatches[i].objectHandle].ID;
+      instances[i].drawBatchID = drawBatchIndex;
+    }
+  }
+
+  BatchRange BatchBuilder::getDirtyInstanceRange() const
+  {
+    BatchRange range = dirtyObjectRange;
+
+    // Objects keep their index when draw batches before them are split or merged, but not their draw batch
+    if (!dirtyDrawRange.empty())
+    {
+      const DrawBatch& first = drawBatches[dirtyDrawRange.first];
+      const DrawBatch& last = drawBatches[dirtyDrawRange.end() - 1];
+
+      range.merge(first.prevInstanceCount, last.prevInstanceCount + last.instanceCount);
+    }
+
+    return range;
+  }
+
+  void BatchBuilder::clearDirtyRanges()
+  {
+    dirtyDrawRange = BatchRange();
+    dirtyObjectRange = BatchRange();
+  }
+
+  void BatchBuilder::markDrawBatchesDirty()
+  {
+    dirtyDrawRange = { 0, static_cast<uint32_t>(drawBatches.size()) };
+  }
+
+  void BatchBuilder::clear()
+  {
+    toBatchObjects.clear();
+    toUnbatchObjects.clear();
+    objectBatches.clear();
+    drawBatches.clear();
+    shaderBatches.clear();
+
+    truncatedSortKeys = false;
+    objectBatchesChanged = false;
+    drawBatchesChanged = false;
+    changedFirst = 0;
+    changedEnd = 0;
+    changedSizeDelta = 0;
+    clearDirtyRanges();
+  }
+
+}
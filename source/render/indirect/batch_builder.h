@@ -0,0 +1,196 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../../math/render_primitives.h"
+#include "../../math/gpu_primitives.h"
+#include "../../util/slot_map.h"
+#include "../../core/job_system.h"
+#include "sort_key.h"
+
+namespace Lotus
+{
+  /*
+    Range of batches, used to know which parts of the GPU buffers have to be uploaded
+  */
+  struct BatchRange
+  {
+    uint32_t first = 0;
+    uint32_t count = 0;
+
+    bool empty() const { return count == 0; }
+    uint32_t end() const { return first + count; }
+
+    void merge(uint32_t rangeFirst, uint32_t rangeEnd)
+    {
+      if (rangeFirst >= rangeEnd) { return; }
+
+      if (empty())
+      {
+        first = rangeFirst;
+        count = rangeEnd - rangeFirst;
+        return;
+      }
+
+      uint32_t newFirst = first < rangeFirst ? first : rangeFirst;
+      uint32_t newEnd = end() > rangeEnd ? end() : rangeEnd;
+
+      first = newFirst;
+      count = newEnd - newFirst;
+    }
+
+    void clamp(uint32_t maxEnd)
+    {
+      if (first >= maxEnd) { count = 0; }
+      else if (end() > maxEnd) { count = maxEnd - first; }
+    }
+  };
+
+  /*
+    Draw batch drawn by clusters, its commands are compacted by the cluster culling pass in
+    [firstCommand, firstCommand + maxCommands) and their count is written at the index of the draw
+  */
+  struct ClusterDraw
+  {
+    uint32_t drawBatch = 0;
+    Handle<int> shaderHandle;
+    uint32_t firstCommand = 0;
+    uint32_t maxCommands = 0;
+  };
+
+  /*
+    CPU side of the indirect renderer batching, it keeps the sorted object batches and merges them
+    into draw and shader batches. It has no OpenGL dependency, so it can run without a context
+  */
+  class BatchBuilder
+  {
+  public:
+    // Objects with less than this amount of batches to sort use a comparison sort instead of a radix sort
+    static constexpr size_t RadixSortThreshold = 256;
+    // Batches written by each job when the buffers are written with a job system
+    static constexpr size_t WriteGrainSize = 8192;
+
+    BatchBuilder(const SortKeyLayout& sortKeyLayout = SortKeyLayout());
+
+    // Queue an object to be inserted in the object batches on the next build, it stores its sort key in the object
+    void addObject(Handle<RenderObject> objectHandle, RenderObject& object, uint32_t depthBucket = 0);
+    // Queue an object to be removed from the object batches on the next build, it uses the sort key stored
+    // when the object was added, so the object handles can be modified before this call
+    void removeObject(Handle<RenderObject> objectHandle, const RenderObject& object);
+
+    uint64_t makeSortKey(const RenderObject& object, uint32_t depthBucket = 0) const;
+
+    /*
+      In incremental mode (default) a build without queued objects does nothing, and otherwise only the
+      draw batches touching the changed objects are rebuilt, the ones after them are just shifted.
+      Without it the draw and shader batches are rebuilt from scratch on every build
+    */
+    void setIncrementalBuild(bool enabled) { incrementalBuild = enabled; }
+    bool isIncrementalBuild() const { return incrementalBuild; }
+
+    // With a job system the queued objects are sorted and the buffers are written on its workers
+    void setJobSystem(JobSystem* newJobSystem) { jobSystem = newJobSystem; }
+
+    void build();
+    void buildObjectBatches();
+    void buildDrawBatches();
+    void buildShaderBatches();
+
+    // Write one indirect command per draw batch, commands must have space for getDrawBatches().size() elements
+    void writeIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands) const;
+    void writeIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const;
+    /*
+      Write MaxMeshLODs commands per draw batch, the command of each level of detail of its mesh at
+      drawBatch * MaxMeshLODs + lod, so commands must have space for getDrawBatches().size() * MaxMeshLODs
+      elements. Every level has room for all the instances of the batch, the handles of the level lod start
+      at prevInstanceCount * MaxMeshLODs + lod * instanceCount. Only the full detail command has instances,
+      the culling pass moves them to the level they need. The range is in draw batches
+    */
+    void writeLODIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands) const;
+    void writeLODIndirectCommands(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const;
+    /*
+      Write the cluster culling data of every draw batch, clusterBatches must have space for getDrawBatches().size()
+      elements. The draw batches of meshes with meshlets get a range of commands with room for every meshlet of
+      every instance, and are appended to draws. Once the ranges would pass maxCommands or their instances
+      maxInstances, the remaining batches get no meshlets and are drawn whole through their LOD commands.
+      Returns the commands of all the ranges
+    */
+    uint32_t writeClusterBatches(
+        const SlotMap<RenderMesh>& renderMeshes,
+        GPUClusterBatch* clusterBatches,
+        std::vector<ClusterDraw>& draws,
+        uint32_t maxCommands,
+        uint32_t maxInstances) const;
+    // Write the buffer ID of every batched object, objectHandles must have space for getObjectBatches().size() elements
+    void writeObjectHandles(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles) const;
+    void writeObjectHandles(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles, const BatchRange& range) const;
+    // Write the buffer ID and draw batch of every batched object, instances must have space for getObjectBatches().size() elements
+    void writeInstances(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances) const;
+    void writeInstances(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances, const BatchRange& range) const;
+
+    // Ranges of indirect commands and object handles that changed since the last call to clearDirtyRanges
+    const BatchRange& getDirtyDrawRange() const { return dirtyDrawRange; }
+    const BatchRange& getDirtyObjectRange() const { return dirtyObjectRange; }
+    // Object batches whose instance changed, either the object or the index of its draw batch
+    BatchRange getDirtyInstanceRange() const;
+    void clearDirtyRanges();
+    // Marks every command as dirty, e.g. when the meshes data changed
+    void markDrawBatchesDirty();
+
+    void clear();
+
+    const std::vector<ObjectBatch>& getObjectBatches() const { return objectBatches; }
+    const std::vector<DrawBatch>& getDrawBatches() const { return drawBatches; }
+    const std::vector<ShaderBatch>& getShaderBatches() const { return shaderBatches; }
+    const SortKeyLayout& getSortKeyLayout() const { return layout; }
+
+  private:
+    static ObjectBatch makeObjectBatch(Handle<RenderObject> objectHandle, const RenderObject& object);
+    void sortObjectBatches(std::vector<ObjectBatch>& batches, std::vector<ObjectBatch>& scratch) const;
+
+    // Calls function(subrange) over the range, split between the jobs if it is large enough
+    template <typename Function>
+    void forEachSubrange(const BatchRange& range, Function function) const;
+
+    void writeIndirectCommandsRange(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const;
+    void writeLODIndirectCommandsRange(const SlotMap<RenderMesh>& renderMeshes, DrawElementsIndirectCommand* commands, const BatchRange& range) const;
+    void writeObjectHandlesRange(const SlotMap<RenderObject>& renderObjects, uint32_t* objectHandles, const BatchRange& range) const;
+    void writeInstancesRange(const SlotMap<RenderObject>& renderObjects, GPUInstance* instances, const BatchRange& range) const;
+
+    uint32_t findRunEnd(uint32_t first) const;
+    uint32_t scanDrawBatches(uint32_t first, uint32_t minStop, std::vector<DrawBatch>& scannedBatches) const;
+
+    SortKeyLayout layout;
+    bool incrementalBuild = true;
+    JobSystem* jobSystem = nullptr;
+    // True if some handle didn't fit in its sort key field, so objects with the same mesh and shader may not be contiguous
+    bool truncatedSortKeys = false;
+
+    // Changes of the last object batches build, in object batches indices
+    bool objectBatchesChanged = false;
+    bool drawBatchesChanged = false;
+    uint32_t changedFirst = 0;
+    uint32_t changedEnd = 0;
+    int64_t changedSizeDelta = 0;
+
+    BatchRange dirtyDrawRange;
+    BatchRange dirtyObjectRange;
+
+    std::vector<ObjectBatch> toBatchObjects;
+    std::vector<ObjectBatch> toUnbatchObjects;
+    std::vector<ObjectBatch> sortScratch;
+    // The removed objects are sorted at the same time as the added ones, so they need their own scratch
+    std::vector<ObjectBatch> unbatchSortScratch;
+    std::vector<ObjectBatch> mergedWindow;
+
+    std::vector<ObjectBatch> objectBatches;
+    std::vector<DrawBatch> drawBatches;
+    std::vector<ShaderBatch> shaderBatches;
+    std::vector<DrawBatch> scannedDrawBatches;
+  };
+
+  void printObjectBatches(const std::vector<ObjectBatch>& batches);
+  void printDrawBatches(const std::vector<DrawBatch>& batches);
+  void printShaderBatches(const std::vector<ShaderBatch>& batches);
+}
@@ -0,0 +1,258 @@
+#include "cooked_mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+
+namespace Lotus
+{
+  namespace
+  {
+    uint64_t alignOffset(uint64_t offset)
+    {
+      return (offset + CookedMeshAlignment - 1) & ~(CookedMeshAlignment - 1);
+    }
+
+    // Checks that count elements of the given size starting at offset are inside the file
+    bool isBlobInside(uint64_t offset, uint64_t count, uint64_t elementSize, size_t fileSize)
+    {
+      if (offset % CookedMeshAlignment != 0 || offset > fileSize) { return false; }
+
+      return count <= (fileSize - offset) / elementSize;
+    }
+
+    bool writePadding(std::ofstream& stream, uint64_t from, uint64_t to)
+    {
+      static constexpr char Zeros[CookedMeshAlignment] = {};
+
+      stream.write(Zeros, static_cast<std::streamsize>(to - from));
+      return stream.good();
+    }
+  }
+
+  std::filesystem::path getCookedMeshPath(const std::filesystem::path& sourcePath)
+  {
+    std::filesystem::path cookedPath = sourcePath;
+    cookedPath += ".lmesh";
+
+    return cookedPath;
+  }
+
+  uint64_t hashBytes(const void* data, size_t size, uint64_t seed)
+  {
+    // FNV-1a over 64 bit words instead of bytes, with a final mix, it only has to detect modified sources
+    constexpr uint64_t OffsetBasis = 0xcbf29ce484222325ull;
+    constexpr uint64_t Prime = 0x100000001b3ull;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = OffsetBasis ^ seed;
+
+    size_t i = 0;
+
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+      uint64_t word;
+      std::memcpy(&word, bytes + i, sizeof(uint64_t));
+
+      hash = (hash ^ word) * Prime;
+      hash ^= hash >> 32;
+    }
+
+    for (; i < size; i++)
+    {
+      hash = (hash ^ bytes[i]) * Prime;
+    }
+
+    hash ^= size;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+  }
+
+  std::optional<uint64_t> hashMeshSource(const std::filesystem::path& sourcePath, bool flipUVs)
+  {
+    MappedFile source;
+
+    if (!source.open(sourcePath)) { return std::nullopt; }
+
+    // The version is part of the seed, so a new cooker rejects the files of older ones even with the same source
+    uint64_t seed = (static_cast<uint64_t>(CookedMeshVersion) << 1) | (flipUVs ? 1 : 0);
+
+    return hashBytes(source.getData(), source.getSize(), seed);
+  }
+
+  bool writeCookedMesh(
+      const std::filesystem::path& path,
+      uint64_t sourceHash,
+      std::span<const Vertex> vertices,
+      std::span<const unsigned int> indices,
+      std::span<const MeshLOD> lods,
+      std::span<const Meshlet> meshlets,
+      const MeshBounds& bounds)
+  {
+    if (lods.empty() || lods.size() > MaxMeshLODs) { return false; }
+
+    CookedMeshHeader header = {};
+    header.magic = CookedMeshMagic;
+    header.version = CookedMeshVersion;
+    header.vertexSize = sizeof(Vertex);
+    header.indexSize = sizeof(unsigned int);
+    header.sourceHash = sourceHash;
+    header.verticesCount = vertices.size();
+    header.verticesOffset = alignOffset(sizeof(CookedMeshHeader));
+    header.indicesCount = indices.size();
+    header.indicesOffset = alignOffset(header.verticesOffset + vertices.size_bytes());
+    header.meshletsCount = meshlets.size();
+    header.meshletsOffset = alignOffset(header.indicesOffset + indices.size_bytes());
+    header.meshletSize = sizeof(Meshlet);
+
+    for (int i = 0; i < 3; i++)
+    {
+      header.boundsMinimum[i] = bounds.minimum[i];
+      header.boundsMaximum[i] = bounds.maximum[i];
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+      header.boundingSphere[i] = bounds.sphere[i];
+    }
+
+    header.lodsCount = static_cast<uint32_t>(lods.size());
+
+    for (size_t i = 0; i < lods.size(); i++)
+    {
+      header.lods[i] = lods[i];
+    }
+
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += ".tmp";
+
+    {
+      std::ofstream stream(temporaryPath, std::ios::binary | std::ios::trunc);
+
+      if (!stream) { return false; }
+
+      stream.write(reinterpret_cast<const char*>(&header), sizeof(CookedMeshHeader));
+
+      bool written = writePadding(stream, sizeof(CookedMeshHeader), header.verticesOffset);
+
+      stream.write(reinterpret_cast<const char*>(vertices.data()), static_cast<std::streamsize>(vertices.size_bytes()));
+      written = written && writePadding(stream, header.verticesOffset + vertices.size_bytes(), header.indicesOffset);
+
+      stream.write(reinterpret_cast<const char*>(indices.data()), static_cast<std::streamsize>(indices.size_bytes()));
+      written = written && writePadding(stream, header.indicesOffset + indices.size_bytes(), header.meshletsOffset);
+
+      stream.write(reinterpret_cast<const char*>(meshlets.data()), static_cast<std::streamsize>(meshlets.size_bytes()));
+      stream.close();
+
+      if (!written || !stream)
+      {
+        std::error_code error;
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+      }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+
+    if (error)
+    {
+      std::filesystem::remove(temporaryPath, error);
+      return false;
+    }
+
+    return true;
+  }
+
+  bool CookedMesh::open(const std::filesystem::path& path, std::optional<uint64_t> expectedSourceHash)
+  {
+    close();
+
+    if (!file.open(path)) { return false; }
+
+    if (file.getSize() < sizeof(CookedMeshHeader))
+    {
+      close();
+      return false;
+    }
+
+    CookedMeshHeader header;
+    std::memcpy(&header, file.getData(), sizeof(CookedMeshHeader));
+
+    bool isValid = header.magic == CookedMeshMagic
+        && header.version == CookedMeshVersion
+        && header.vertexSize == sizeof(Vertex)
+        && header.indexSize == sizeof(unsigned int)
+        && header.meshletSize == sizeof(Meshlet)
+        && (!expectedSourceHash || header.sourceHash == *expectedSourceHash)
+        && isBlobInside(header.verticesOffset, header.verticesCount, sizeof(Vertex), file.getSize())
+        && isBlobInside(header.indicesOffset, header.indicesCount, sizeof(unsigned int), file.getSize())
+        && isBlobInside(header.meshletsOffset, header.meshletsCount, sizeof(Meshlet), file.getSize())
+        && header.lodsCount > 0 && header.lodsCount <= MaxMeshLODs;
+
+    for (uint32_t i = 0; isValid && i < header.lodsCount; i++)
+    {
+      isValid = header.lods[i].firstIndex <= header.indicesCount && header.lods[i].count <= header.indicesCount - header.lods[i].firstIndex;
+    }
+
+    // The meshlets are drawn from the full detail level, so they must stay inside it
+    const Meshlet* fileMeshlets = isValid ? reinterpret_cast<const Meshlet*>(file.getData() + header.meshletsOffset) : nullptr;
+
+    for (uint64_t i = 0; isValid && i < header.meshletsCount; i++)
+    {
+      isValid = fileMeshlets[i].firstIndex <= header.lods[0].count && fileMeshlets[i].count <= header.lods[0].count - fileMeshlets[i].firstIndex;
+    }
+
+    // The indices are drawn straight from the mapping, one past the vertices would fetch out of the mesh range
+    const unsigned int* fileIndices = isValid ? reinterpret_cast<const unsigned int*>(file.getData() + header.indicesOffset) : nullptr;
+    unsigned int maximumIndex = 0;
+
+    for (uint64_t i = 0; isValid && i < header.indicesCount; i++)
+    {
+      maximumIndex = std::max(maximumIndex, fileIndices[i]);
+    }
+
+    isValid = isValid && (header.indicesCount == 0 || maximumIndex < header.verticesCount);
+
+    if (!isValid)
+    {
+      close();
+      return false;
+    }
+
+    vertices = std::span<const Vertex>(reinterpret_cast<const Vertex*>(file.getData() + header.verticesOffset), header.verticesCount);
+    indices = std::span<const unsigned int>(fileIndices, header.indicesCount);
+    meshlets = std::span<const Meshlet>(fileMeshlets, header.meshletsCount);
+
+    bounds.minimum = glm::vec3(header.boundsMinimum[0], header.boundsMinimum[1], header.boundsMinimum[2]);
+    bounds.maximum = glm::vec3(header.boundsMaximum[0], header.boundsMaximum[1], header.boundsMaximum[2]);
+    bounds.sphere = glm::vec4(header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3]);
+
+    lodsCount = header.lodsCount;
+
+    for (uint32_t i = 0; i < lodsCount; i++)
+    {
+      lods[i] = header.lods[i];
+    }
+
+    return true;
+  }
+
+  void CookedMesh::close() noexcept
+  {
+    file.close();
+
+    vertices = {};
+    indices = {};
+    meshlets = {};
+    lodsCount = 0;
+    bounds = MeshBounds();
+  }
+
+}
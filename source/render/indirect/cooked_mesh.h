@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include "../../math/primitives.h"
+#include "../../math/bounds.h"
+#include "../../math/render_primitives.h"
+#include "../../util/mapped_file.h"
+
+namespace Lotus
+{
+  constexpr uint32_t CookedMeshMagic = 0x4853454D; // "MESH" read as little endian
+  // Changed whenever the header, the vertex layout or the import post processing changes
+  constexpr uint32_t CookedMeshVersion = 4;
+  // Vertex and index blobs start at multiples of a cache line, the mapping itself is page aligned
+  constexpr uint64_t CookedMeshAlignment = 64;
+
+  /*
+    Header at the start of a cooked mesh file, followed by the vertex, index and meshlet blobs. The blobs are
+    written in the in-memory layout of Vertex, unsigned int and Meshlet, so loading is a mapping and a copy to
+    the GPU. The index blob holds every level of detail, the LODs give their ranges in it. The meshlets split
+    the full detail level
+  */
+  struct CookedMeshHeader
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexSize;
+    uint32_t indexSize;
+    uint64_t sourceHash;
+    uint64_t verticesCount;
+    uint64_t verticesOffset;
+    uint64_t indicesCount;
+    uint64_t indicesOffset;
+    uint64_t meshletsCount;
+    uint64_t meshletsOffset;
+    float boundsMinimum[3];
+    float boundsMaximum[3];
+    float boundingSphere[4];
+    uint32_t lodsCount;
+    MeshLOD lods[MaxMeshLODs];
+    uint32_t meshletSize;
+  };
+
+  static_assert(sizeof(CookedMeshHeader) % 8 == 0, "Cooked mesh: the header size must keep the 64 bit fields aligned");
+
+  // The cooked file lives next to its source, "model.obj" is cooked to "model.obj.lmesh"
+  std::filesystem::path getCookedMeshPath(const std::filesystem::path& sourcePath);
+
+  uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+  // Hash of the source file bytes and of the import options, nullopt if the source can't be read
+  std::optional<uint64_t> hashMeshSource(const std::filesystem::path& sourcePath, bool flipUVs);
+
+  // Writes to a temporary file that replaces the cooked file at the end, so a failed write leaves no partial file
+  bool writeCookedMesh(
+      const std::filesystem::path& path,
+      uint64_t sourceHash,
+      std::span<const Vertex> vertices,
+      std::span<const unsigned int> indices,
+      std::span<const MeshLOD> lods,
+      std::span<const Meshlet> meshlets,
+      const MeshBounds& bounds);
+
+  /*
+    Cooked mesh mapped in memory, the vertices and indices point into the mapping and stay valid until the
+    cooked mesh is closed or destroyed
+  */
+  class CookedMesh
+  {
+  public:
+    /*
+      Returns false if the file is missing, truncated, from another version or cooked from another source.
+      Without an expected hash the source isn't checked, for builds that only ship the cooked files
+    */
+    bool open(const std::filesystem::path& path, std::optional<uint64_t> expectedSourceHash);
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return file.isOpen(); }
+
+    std::span<const Vertex> getVertices() const noexcept { return vertices; }
+    std::span<const unsigned int> getIndices() const noexcept { return indices; }
+    std::span<const MeshLOD> getLODs() const noexcept { return std::span<const MeshLOD>(lods, lodsCount); }
+    std::span<const Meshlet> getMeshlets() const noexcept { return meshlets; }
+    const MeshBounds& getBounds() const noexcept { return bounds; }
+
+  private:
+    MappedFile file;
+
+    std::span<const Vertex> vertices;
+    std::span<const unsigned int> indices;
+    std::span<const Meshlet> meshlets;
+    MeshLOD lods[MaxMeshLODs];
+    uint32_t lodsCount = 0;
+    MeshBounds bounds;
+  };
+}
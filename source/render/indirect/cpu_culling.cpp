@@ -0,0 +1,121 @@
+#include "cpu_culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOTUS_CPU_CULLING_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace Lotus
+{
+
+  void CPUCuller::gather(const std::vector<ObjectBatch>& objectBatches, const SlotMap<RenderObject>& renderObjects, const SlotMap<RenderMesh>& renderMeshes)
+  {
+    spheres.resize(objectBatches.size());
+    objectIDs.resize(objectBatches.size());
+
+    parallelFor(objectBatches.size(), ObjectsGrainSize, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; i++)
+      {
+        const RenderObject& object = renderObjects[objectBatches[i].objectHandle];
+
+        spheres.set(i, transformBoundingSphere(object.model, renderMeshes[object.meshHandle].boundingSphere));
+        objectIDs[i] = object.ID;
+      }
+    });
+  }
+
+  void CPUCuller::cull(const Frustum& frustum, const std::vector<DrawBatch>& drawBatches, bool testFrustum)
+  {
+    visibleObjectIDs.resize(spheres.size());
+    visibleCounts.resize(drawBatches.size());
+
+    if (testFrustum)
+    {
+      visibilities.resize(spheres.size());
+
+      parallelFor(spheres.size(), ObjectsGrainSize, [&](size_t first, size_t last)
+      {
+        testSpheres(frustum, spheres, first, last, visibilities.data());
+      });
+    }
+    else
+    {
+      visibilities.assign(spheres.size(), 1);
+    }
+
+    // Each draw batch owns the range of its instances, so the batches are compacted independently
+    parallelFor(drawBatches.size(), DrawBatchesGrainSize, [&](size_t first, size_t last)
+    {
+      for (size_t batch = first; batch < last; batch++)
+      {
+        const DrawBatch& drawBatch = drawBatches[batch];
+        uint32_t visibleCount = 0;
+
+        for (uint32_t i = drawBatch.prevInstanceCount; i < drawBatch.prevInstanceCount + drawBatch.instanceCount; i++)
+        {
+          // Written unconditionally, the count only advances for the visible objects
+          visibleObjectIDs[drawBatch.prevInstanceCount + visibleCount] = objectIDs[i];
+          visibleCount += visibilities[i];
+        }
+
+        visibleCounts[batch] = visibleCount;
+      }
+    });
+  }
+
+  void CPUCuller::parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function)
+  {
+    if (jobSystem)
+    {
+      jobSystem->parallelFor(count, grainSize, function);
+    }
+    else if (count > 0)
+    {
+      function(0, count);
+    }
+  }
+
+  void testSpheres(const Frustum& frustum, const BoundingSpheres& spheres, size_t first, size_t last, uint8_t* visibilities)
+  {
+    size_t i = first;
+
+#if LOTUS_CPU_CULLING_SSE
+
+    // Four spheres against each plane, with the same operations order as isSphereInFrustum
+    for (; i + 4 <= last; i += 4)
+    {
+      const __m128 x = _mm_loadu_ps(spheres.x.data() + i);
+      const __m128 y = _mm_loadu_ps(spheres.y.data() + i);
+      const __m128 z = _mm_loadu_ps(spheres.z.data() + i);
+      const __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius.data() + i));
+
+      __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+      for (const glm::vec4& plane : frustum.planes)
+      {
+        __m128 distance = _mm_mul_ps(_mm_set1_ps(plane.x), x);
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), y));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), z));
+        distance = _mm_add_ps(distance, _mm_set1_ps(plane.w));
+
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+      }
+
+      int mask = _mm_movemask_ps(inside);
+
+      visibilities[i] = mask & 1;
+      visibilities[i + 1] = (mask >> 1) & 1;
+      visibilities[i + 2] = (mask >> 2) & 1;
+      visibilities[i + 3] = (mask >> 3) & 1;
+    }
+
+#endif
+
+    for (; i < last; i++)
+    {
+      visibilities[i] = isSphereInFrustum(frustum, glm::vec4(spheres.x[i], spheres.y[i], spheres.z[i], spheres.radius[i])) ? 1 : 0;
+    }
+  }
+
+}
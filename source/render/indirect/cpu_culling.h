@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "../../math/render_primitives.h"
+#include "../../util/slot_map.h"
+#include "../../core/job_system.h"
+#include "culling.h"
+
+namespace Lotus
+{
+  /*
+    Spheres as a structure of arrays, so four of them can be loaded in the lanes of a register
+  */
+  struct BoundingSpheres
+  {
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> radius;
+
+    size_t size() const { return x.size(); }
+
+    void resize(size_t size)
+    {
+      x.resize(size);
+      y.resize(size);
+      z.resize(size);
+      radius.resize(size);
+    }
+
+    void set(size_t index, const glm::vec4& sphere)
+    {
+      x[index] = sphere.x;
+      y[index] = sphere.y;
+      z[index] = sphere.z;
+      radius[index] = sphere.w;
+    }
+  };
+
+  /*
+    Frustum culling on the CPU, for drivers without compute shaders and for tools without a GPU. It gives the
+    same result as the culling pass, the visible object IDs of each draw batch are written from its
+    prevInstanceCount in batch order, so the output only depends on the input and not on the threads
+  */
+  class CPUCuller
+  {
+  public:
+    // Objects tested or batches compacted by each job
+    static constexpr size_t ObjectsGrainSize = 4096;
+    static constexpr size_t DrawBatchesGrainSize = 64;
+
+    // Without a job system everything runs on the calling thread
+    explicit CPUCuller(JobSystem* jobSystem = nullptr) : jobSystem(jobSystem) {}
+
+    void setJobSystem(JobSystem* newJobSystem) { jobSystem = newJobSystem; }
+
+    // Gathers the world space sphere and the object ID of every object batch
+    void gather(const std::vector<ObjectBatch>& objectBatches, const SlotMap<RenderObject>& renderObjects, const SlotMap<RenderMesh>& renderMeshes);
+
+    // Tests the gathered spheres, the draw batches must cover the gathered objects. Without testing the frustum every object is visible
+    void cull(const Frustum& frustum, const std::vector<DrawBatch>& drawBatches, bool testFrustum = true);
+
+    // Gathered data, indexed as the object batches
+    BoundingSpheres& getSpheres() { return spheres; }
+    std::vector<uint32_t>& getObjectIDs() { return objectIDs; }
+
+    // Visible instances of every draw batch, and their object IDs at the draw batch prevInstanceCount
+    const std::vector<uint32_t>& getVisibleCounts() const { return visibleCounts; }
+    const std::vector<uint32_t>& getVisibleObjectIDs() const { return visibleObjectIDs; }
+
+  private:
+    void parallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& function);
+
+    JobSystem* jobSystem;
+
+    BoundingSpheres spheres;
+    std::vector<uint32_t> objectIDs;
+    std::vector<uint8_t> visibilities;
+
+    std::vector<uint32_t> visibleCounts;
+    std::vector<uint32_t> visibleObjectIDs;
+  };
+
+  // Writes a visibility per sphere, 1 if it is inside or crossing the frustum
+  void testSpheres(const Frustum& frustum, const BoundingSpheres& spheres, size_t first, size_t last, uint8_t* visibilities);
+}
@@ -0,0 +1,207 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Lotus
+{
+
+  Frustum extractFrustum(const glm::mat4& viewProjection)
+  {
+    // Rows of the matrix, glm stores the columns
+    glm::vec4 rows[4];
+
+    for (int i = 0; i < 4; i++)
+    {
+      rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    }
+
+    Frustum frustum;
+    frustum.planes[0] = rows[3] + rows[0];
+    frustum.planes[1] = rows[3] - rows[0];
+    frustum.planes[2] = rows[3] + rows[1];
+    frustum.planes[3] = rows[3] - rows[1];
+    frustum.planes[4] = rows[3] + rows[2];
+    frustum.planes[5] = rows[3] - rows[2];
+
+    // Normalized planes give distances, so they can be compared with the radii
+    for (glm::vec4& plane : frustum.planes)
+    {
+      plane /= glm::length(glm::vec3(plane.x, plane.y, plane.z));
+    }
+
+    return frustum;
+  }
+
+  glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere)
+  {
+    glm::vec4 center = model * glm::vec4(sphere.x, sphere.y, sphere.z, 1.0f);
+
+    float scale = std::max({
+      glm::length(glm::vec3(model[0].x, model[0].y, model[0].z)),
+      glm::length(glm::vec3(model[1].x, model[1].y, model[1].z)),
+      glm::length(glm::vec3(model[2].x, model[2].y, model[2].z)) });
+
+    return glm::vec4(center.x, center.y, center.z, sphere.w * scale);
+  }
+
+  bool isSphereInFrustum(const Frustum& frustum, const glm::vec4& sphere)
+  {
+    for (const glm::vec4& plane : frustum.planes)
+    {
+      if (plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w < -sphere.w)
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool projectSphere(const glm::vec3& center, float radius, const glm::mat4& projection, glm::vec4& rectangle)
+  {
+    // The camera looks down -Z, the tangent planes are found with the distance in front of it
+    float depth = -center.z;
+    float zNear = projection[3][2] / (projection[2][2] - 1.0f);
+
+    if (depth < radius + zNear) { return false; }
+
+    // Tangents from the camera to the circles of the sphere in the XZ and YZ planes, by rotating the center
+    auto projectAxis = [&](float coordinate, float& minimum, float& maximum)
+    {
+      float tangent = std::sqrt(coordinate * coordinate + depth * depth - radius * radius);
+
+      minimum = (tangent * coordinate - radius * depth) / (radius * coordinate + tangent * depth);
+      maximum = (tangent * coordinate + radius * depth) / (-radius * coordinate + tangent * depth);
+    };
+
+    float minimumX, maximumX, minimumY, maximumY;
+    projectAxis(center.x, minimumX, maximumX);
+    projectAxis(center.y, minimumY, maximumY);
+
+    rectangle = glm::vec4(
+      minimumX * projection[0][0], minimumY * projection[1][1],
+      maximumX * projection[0][0], maximumY * projection[1][1]) * 0.5f + glm::vec4(0.5f);
+
+    return true;
+  }
+
+  float computeSphereDepth(const glm::vec3& center, float radius, const glm::mat4& projection)
+  {
+    float z = center.z + radius;
+
+    return (projection[2][2] * z + projection[3][2]) / -z * 0.5f + 0.5f;
+  }
+
+  float computeLODTarget(const glm::mat4& projection, float viewportHeight, float thresholdPixels)
+  {
+    // A length l at distance d covers l * projection[1][1] / d * viewportHeight / 2 pixels
+    return thresholdPixels * 2.0f / (projection[1][1] * viewportHeight);
+  }
+
+  uint32_t selectMeshLOD(const glm::vec4& lodErrors, float distance, float scale, float lodTarget)
+  {
+    float allowedError = std::max(distance, 0.0f) * lodTarget;
+    uint32_t lod = 0;
+
+    for (uint32_t i = 1; i < MaxMeshLODs; i++)
+    {
+      if (lodErrors[i] * scale <= allowedError) { lod = i; }
+    }
+
+    return lod;
+  }
+
+  bool isConeBackfacing(const glm::vec3& center, float radius, const glm::vec4& cone, const glm::vec3& cameraPosition)
+  {
+    glm::vec3 direction = center - cameraPosition;
+
+    return glm::dot(direction, glm::vec3(cone)) >= cone.w * glm::length(direction) + radius;
+  }
+
+  void reduceDepth(const float* input, uint32_t inputWidth, uint32_t inputHeight, float* output, uint32_t outputWidth, uint32_t outputHeight)
+  {
+    for (uint32_t y = 0; y < outputHeight; y++)
+    {
+      uint32_t firstY = y * inputHeight / outputHeight;
+      uint32_t lastY = ((y + 1) * inputHeight + outputHeight - 1) / outputHeight;
+
+      for (uint32_t x = 0; x < outputWidth; x++)
+      {
+        uint32_t firstX = x * inputWidth / outputWidth;
+        uint32_t lastX = ((x + 1) * inputWidth + outputWidth - 1) / outputWidth;
+
+        float depth = 0.0f;
+
+        for (uint32_t inputY = firstY; inputY < lastY; inputY++)
+        {
+          for (uint32_t inputX = firstX; inputX < lastX; inputX++)
+          {
+            depth = std::max(depth, input[inputY * inputWidth + inputX]);
+          }
+        }
+
+        output[y * outputWidth + x] = depth;
+      }
+    }
+  }
+
+  bool isRectangleOccluded(const DepthPyramidLevel* levels, uint32_t levelsCount, const glm::vec4& rectangle, float depth)
+  {
+    float width = (rectangle.z - rectangle.x) * levels[0].width;
+    float height = (rectangle.w - rectangle.y) * levels[0].height;
+
+    uint32_t level = static_cast<uint32_t>(std::max(std::ceil(std::log2(std::max({ width, height, 1.0f }))), 0.0f));
+    level = std::min(level, levelsCount - 1);
+
+    const DepthPyramidLevel& pyramidLevel = levels[level];
+
+    auto toTexel = [](float coordinate, uint32_t size)
+    {
+      return static_cast<uint32_t>(std::clamp(std::floor(coordinate * size), 0.0f, static_cast<float>(size - 1)));
+    };
+
+    uint32_t firstX = toTexel(rectangle.x, pyramidLevel.width);
+    uint32_t lastX = toTexel(rectangle.z, pyramidLevel.width);
+    uint32_t firstY = toTexel(rectangle.y, pyramidLevel.height);
+    uint32_t lastY = toTexel(rectangle.w, pyramidLevel.height);
+
+    float occluderDepth = std::max({
+      pyramidLevel.depths[firstY * pyramidLevel.width + firstX],
+      pyramidLevel.depths[firstY * pyramidLevel.width + lastX],
+      pyramidLevel.depths[lastY * pyramidLevel.width + firstX],
+      pyramidLevel.depths[lastY * pyramidLevel.width + lastX] });
+
+    return depth > occluderDepth;
+  }
+
+  void cullInstances(
+    const Frustum& frustum,
+    const GPUInstance* instances,
+    size_t instancesCount,
+    const GPUObjectData* objects,
+    DrawElementsIndirectCommand* commands,
+    size_t commandsCount,
+    uint32_t* objectHandles)
+  {
+    for (size_t i = 0; i < commandsCount; i++)
+    {
+      commands[i].instanceCount = 0;
+    }
+
+    for (size_t i = 0; i < instancesCount; i++)
+    {
+      const GPUInstance& instance = instances[i];
+      const GPUObjectData& object = objects[instance.objectID];
+
+      if (!isSphereInFrustum(frustum, transformBoundingSphere(object.model, object.boundingSphere))) { continue; }
+
+      // The shader does this with an atomic add, so the order inside a batch may differ there
+      DrawElementsIndirectCommand& command = commands[instance.drawBatchID];
+
+      objectHandles[command.baseInstance + command.instanceCount] = instance.objectID;
+      command.instanceCount++;
+    }
+  }
+
+}
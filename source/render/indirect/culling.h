@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "../../math/gpu_primitives.h"
+#include "../../math/render_primitives.h"
+
+namespace Lotus
+{
+  /*
+    Planes of a view frustum, stored as (normal, distance) with the normals pointing inside, so a point p
+    is inside a plane if dot(normal, p) + distance >= 0. The order is left, right, bottom, top, near, far
+  */
+  struct Frustum
+  {
+    glm::vec4 planes[6];
+  };
+
+  // Planes of the clip space volume of a view projection matrix, with OpenGL depth range [-1, 1]
+  Frustum extractFrustum(const glm::mat4& viewProjection);
+
+  // World space sphere of a mesh space sphere, the radius is scaled by the largest axis scale
+  glm::vec4 transformBoundingSphere(const glm::mat4& model, const glm::vec4& sphere);
+
+  bool isSphereInFrustum(const Frustum& frustum, const glm::vec4& sphere);
+
+  /*
+    Screen rectangle covered by a view space sphere, as (min x, min y, max x, max y) texture coordinates. It
+    needs a symmetric perspective projection, and fails for spheres that cross the near plane
+  */
+  bool projectSphere(const glm::vec3& center, float radius, const glm::mat4& projection, glm::vec4& rectangle);
+
+  // Window depth, in [0, 1], of the point of a view space sphere closest to the camera
+  float computeSphereDepth(const glm::vec3& center, float radius, const glm::mat4& projection);
+
+  /*
+    Mesh space error per unit of distance to the camera that projects to the given amount of pixels, for a
+    viewport of the given height. Zero pixels keeps every mesh at full detail
+  */
+  float computeLODTarget(const glm::mat4& projection, float viewportHeight, float thresholdPixels);
+
+  /*
+    CPU reference of the level of detail selection of the culling pass. It picks the coarsest level whose
+    error, scaled by the object scale, is under the target at the distance of the closest point of the
+    bounding sphere. lodErrors holds the error of each level as in GPUMeshBounds
+  */
+  uint32_t selectMeshLOD(const glm::vec4& lodErrors, float distance, float scale, float lodTarget);
+
+  /*
+    CPU reference of the backface test of the cluster culling pass. True if every triangle under the normal cone
+    faces away from the camera at every point of the sphere, so the cluster can be skipped. Everything is in the
+    same space, the cone is the axis and cutoff of Meshlet
+  */
+  bool isConeBackfacing(const glm::vec3& center, float radius, const glm::vec4& cone, const glm::vec3& cameraPosition);
+
+  /*
+    Level of a depth pyramid, each texel keeps the farthest depth of the area it covers
+  */
+  struct DepthPyramidLevel
+  {
+    const float* depths;
+    uint32_t width;
+    uint32_t height;
+  };
+
+  // CPU reference of shaders/culling/depth_pyramid.comp, output texels read every input texel they overlap
+  void reduceDepth(const float* input, uint32_t inputWidth, uint32_t inputHeight, float* output, uint32_t outputWidth, uint32_t outputHeight);
+
+  /*
+    CPU reference of the occlusion test of the culling pass. The level where the rectangle is at most a texel
+    wide is read, so at most 2x2 texels cover it, and it is occluded if depth is behind all of them
+  */
+  bool isRectangleOccluded(const DepthPyramidLevel* levels, uint32_t levelsCount, const glm::vec4& rectangle, float depth);
+
+  /*
+    CPU reference of the culling pass in shaders/culling/frustum_culling.comp, it follows the same steps so
+    the pass can be tested without a GPU. The commands instance counts are reset, then every visible instance
+    is appended to its draw batch, writing its object ID at baseInstance + its position in the batch. It has
+    one command per draw batch, the level of detail selection is tested through selectMeshLOD
+  */
+  void cullInstances(
+    const Frustum& frustum,
+    const GPUInstance* instances,
+    size_t instancesCount,
+    const GPUObjectData* objects,
+    DrawElementsIndirectCommand* commands,
+    size_t commandsCount,
+    uint32_t* objectHandles);
+}
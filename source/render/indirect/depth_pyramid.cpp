@@ -0,0 +1,98 @@
+#include "depth_pyramid.h"
+
+#include <algorithm>
+#include <bit>
+#include <glad/glad.h>
+#include "../../util/path_manager.h"
+
+namespace Lotus
+{
+
+  DepthPyramid::DepthPyramid() :
+    textureID(0),
+    depthWidth(0),
+    depthHeight(0),
+    width(0),
+    height(0),
+    levelsCount(0)
+  {}
+
+  DepthPyramid::~DepthPyramid()
+  {
+    deleteTexture();
+  }
+
+  void DepthPyramid::startUp()
+  {
+    reduceShader = ShaderProgram(shaderPath("culling/depth_pyramid.comp"));
+  }
+
+  void DepthPyramid::resize(uint32_t newDepthWidth, uint32_t newDepthHeight)
+  {
+    if (newDepthWidth == depthWidth && newDepthHeight == depthHeight && textureID != 0) { return; }
+
+    deleteTexture();
+
+    depthWidth = newDepthWidth;
+    depthHeight = newDepthHeight;
+    width = std::max(depthWidth / 2, 1u);
+    height = std::max(depthHeight / 2, 1u);
+
+    // Levels down to a single texel
+    levelsCount = std::bit_width(std::max(width, height));
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &textureID);
+    glTextureStorage2D(textureID, levelsCount, GL_R32F, width, height);
+
+    // The culling pass only fetches texels, filtering would mix the depths
+    glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  void DepthPyramid::build(uint32_t depthTextureID)
+  {
+    reduceShader.bind();
+
+    uint32_t inputWidth = depthWidth;
+    uint32_t inputHeight = depthHeight;
+    uint32_t levelWidth = width;
+    uint32_t levelHeight = height;
+
+    for (uint32_t level = 0; level < levelsCount; level++)
+    {
+      // The first level reads the depth texture, the others the level above them
+      glBindTextureUnit(InputTextureUnit, level == 0 ? depthTextureID : textureID);
+      glBindImageTexture(OutputImageUnit, textureID, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+      glUniform1i(InputLevelLocation, level == 0 ? 0 : level - 1);
+      glUniform2i(InputSizeLocation, inputWidth, inputHeight);
+      glUniform2i(OutputSizeLocation, levelWidth, levelHeight);
+
+      glDispatchCompute((levelWidth + WorkgroupSize - 1) / WorkgroupSize, (levelHeight + WorkgroupSize - 1) / WorkgroupSize, 1);
+
+      glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+      inputWidth = levelWidth;
+      inputHeight = levelHeight;
+      levelWidth = std::max(levelWidth / 2, 1u);
+      levelHeight = std::max(levelHeight / 2, 1u);
+    }
+
+    glBindImageTexture(OutputImageUnit, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glBindTextureUnit(InputTextureUnit, 0);
+
+    reduceShader.unbind();
+  }
+
+  void DepthPyramid::deleteTexture()
+  {
+    if (textureID)
+    {
+      glDeleteTextures(1, &textureID);
+      textureID = 0;
+    }
+  }
+
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include "../shader.h"
+
+namespace Lotus
+{
+  /*
+    Mip chain of a depth texture where each texel keeps the farthest depth of the area it covers, built by
+    shaders/culling/depth_pyramid.comp. The first level is half the size of the depth texture, and the sizes
+    are halved rounding down, the culling pass reads it to find objects hidden behind the drawn ones
+  */
+  class DepthPyramid
+  {
+  public:
+    // Keep in sync with shaders/culling/depth_pyramid.comp
+    static constexpr unsigned int WorkgroupSize = 8;
+    static constexpr unsigned int InputLevelLocation = 0;
+    static constexpr unsigned int InputSizeLocation = 1;
+    static constexpr unsigned int OutputSizeLocation = 2;
+    static constexpr unsigned int InputTextureUnit = 0;
+    static constexpr unsigned int OutputImageUnit = 0;
+
+    DepthPyramid();
+    ~DepthPyramid();
+
+    DepthPyramid(const DepthPyramid&) = delete;
+    DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+    void startUp();
+
+    // Recreates the texture for a depth texture of the given size, only if the size changed
+    void resize(uint32_t depthWidth, uint32_t depthHeight);
+
+    void build(uint32_t depthTextureID);
+
+    uint32_t getTextureID() const noexcept { return textureID; }
+    uint32_t getWidth() const noexcept { return width; }
+    uint32_t getHeight() const noexcept { return height; }
+    uint32_t getLevelsCount() const noexcept { return levelsCount; }
+
+  private:
+    void deleteTexture();
+
+    ShaderProgram reduceShader;
+
+    uint32_t textureID;
+    uint32_t depthWidth;
+    uint32_t depthHeight;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelsCount;
+  };
+}
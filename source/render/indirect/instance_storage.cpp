@@ -0,0 +1,246 @@
+#include "instance_storage.h"
+
+#include <cassert>
+#include <utility>
+
+namespace Lotus
+{
+
+  // Moves the last element into the position index, keeping the array dense
+  template <typename T>
+  static void swapRemove(std::vector<T>& values, uint32_t index)
+  {
+    if (index != values.size() - 1)
+    {
+      values[index] = std::move(values.back());
+    }
+
+    values.pop_back();
+  }
+
+  InstanceID InstanceStorage::create(
+      Handle<RenderMesh> meshHandle,
+      Handle<RenderMaterial> materialHandle,
+      uint32_t shaderHandle,
+      const glm::vec3& translation,
+      const glm::fquat& rotation,
+      const glm::vec3& scale)
+  {
+    uint32_t slotIndex = freeSlotsHead;
+
+    if (slotIndex != InvalidIndex)
+    {
+      freeSlotsHead = slots[slotIndex].index;
+    }
+    else
+    {
+      slotIndex = static_cast<uint32_t>(slots.size());
+      slots.push_back({ InvalidIndex, 0 });
+    }
+
+    uint32_t index = static_cast<uint32_t>(translations.size());
+    slots[slotIndex].index = index;
+
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    meshHandles.push_back(meshHandle);
+    materialHandles.push_back(materialHandle);
+    shaderHandles.push_back(shaderHandle);
+    objectHandles.push_back(Handle<RenderObject>());
+    dirtyFlags.push_back(0);
+    indexToSlot.push_back(slotIndex);
+
+    return InstanceID(slotIndex, slots[slotIndex].generation);
+  }
+
+  bool InstanceStorage::destroy(InstanceID instanceID)
+  {
+    if (!contains(instanceID)) { return false; }
+
+    Slot& slot = slots[instanceID.get()];
+    uint32_t index = slot.index;
+    uint32_t lastIndex = static_cast<uint32_t>(translations.size() - 1);
+
+    // The last instance takes the place of the destroyed one, its entry in the dirty list is its ID so it stays valid
+    swapRemove(translations, index);
+    swapRemove(rotations, index);
+    swapRemove(scales, index);
+    swapRemove(meshHandles, index);
+    swapRemove(materialHandles, index);
+    swapRemove(shaderHandles, index);
+    swapRemove(objectHandles, index);
+    swapRemove(dirtyFlags, index);
+    swapRemove(indexToSlot, index);
+
+    if (index != lastIndex)
+    {
+      slots[indexToSlot[index]].index = index;
+    }
+
+    slot.generation++;
+    slot.index = freeSlotsHead;
+    freeSlotsHead = instanceID.get();
+
+    return true;
+  }
+
+  void InstanceStorage::clear()
+  {
+    // Slots are kept, with a new generation, so IDs from before the clear stay stale
+    for (uint32_t slotIndex : indexToSlot)
+    {
+      slots[slotIndex].generation++;
+      slots[slotIndex].index = freeSlotsHead;
+      freeSlotsHead = slotIndex;
+    }
+
+    translations.clear();
+    rotations.clear();
+    scales.clear();
+    meshHandles.clear();
+    materialHandles.clear();
+    shaderHandles.clear();
+    objectHandles.clear();
+    dirtyFlags.clear();
+    indexToSlot.clear();
+    dirtyInstances.clear();
+  }
+
+  bool InstanceStorage::contains(InstanceID instanceID) const
+  {
+    if (instanceID.get() >= slots.size()) { return false; }
+
+    const Slot& slot = slots[instanceID.get()];
+
+    return slot.generation == instanceID.getGeneration() && slot.index < indexToSlot.size() && indexToSlot[slot.index] == instanceID.get();
+  }
+
+  uint32_t InstanceStorage::getIndex(InstanceID instanceID) const
+  {
+    assert(contains(instanceID) && "InstanceStorage Error: Stale or invalid instance ID");
+    return slots[instanceID.get()].index;
+  }
+
+  InstanceID InstanceStorage::getID(uint32_t index) const
+  {
+    uint32_t slotIndex = indexToSlot[index];
+    return InstanceID(slotIndex, slots[slotIndex].generation);
+  }
+
+  glm::mat4 InstanceStorage::getModelMatrix(uint32_t index) const
+  {
+    return composeModelMatrix(translations[index], rotations[index], scales[index]);
+  }
+
+  void InstanceStorage::getModelMatrices(const uint32_t* indices, size_t count, glm::mat4* matrices) const
+  {
+    composeModelMatrices(translations.data(), rotations.data(), scales.data(), indices, matrices, count);
+  }
+
+  void InstanceStorage::setTranslation(InstanceID instanceID, const glm::vec3& translation)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    translations[index] = translation;
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::translate(InstanceID instanceID, const glm::vec3& translation)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    translations[index] += translation;
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::setRotation(InstanceID instanceID, const glm::fquat& rotation)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    rotations[index] = rotation;
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::rotate(InstanceID instanceID, const glm::vec3& axis, float angle)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    rotations[index] = glm::angleAxis(angle, axis) * rotations[index];
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::setScale(InstanceID instanceID, const glm::vec3& scale)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    scales[index] = scale;
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::scale(InstanceID instanceID, const glm::vec3& scale)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    scales[index] *= scale;
+    markDirty(index, TransformDirty);
+  }
+
+  void InstanceStorage::setMesh(InstanceID instanceID, Handle<RenderMesh> meshHandle)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    if (meshHandles[index] == meshHandle) { return; }
+
+    meshHandles[index] = meshHandle;
+    markDirty(index, MeshDirty);
+  }
+
+  void InstanceStorage::setMaterial(InstanceID instanceID, Handle<RenderMaterial> materialHandle, uint32_t shaderHandle)
+  {
+    uint32_t index = getIndex(instanceID);
+
+    uint8_t flags = 0;
+
+    if (!(materialHandles[index] == materialHandle)) { flags |= MaterialDirty; }
+    if (shaderHandles[index] != shaderHandle) { flags |= ShaderDirty; }
+
+    if (flags == 0) { return; }
+
+    materialHandles[index] = materialHandle;
+    shaderHandles[index] = shaderHandle;
+    markDirty(index, flags);
+  }
+
+  void InstanceStorage::markDirty(uint32_t index, uint8_t flags)
+  {
+    if (dirtyFlags[index] == 0)
+    {
+      dirtyInstances.push_back(getID(index));
+    }
+
+    dirtyFlags[index] |= flags;
+  }
+
+  void InstanceStorage::markTransformsDirty(uint32_t first, uint32_t count)
+  {
+    for (uint32_t index = first; index < first + count; index++)
+    {
+      markDirty(index, TransformDirty);
+    }
+  }
+
+  void InstanceStorage::clearDirty()
+  {
+    for (InstanceID instanceID : dirtyInstances)
+    {
+      if (contains(instanceID))
+      {
+        dirtyFlags[slots[instanceID.get()].index] = 0;
+      }
+    }
+
+    dirtyInstances.clear();
+  }
+
+}
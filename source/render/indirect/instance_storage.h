@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "../../math/render_primitives.h"
+#include "../../math/model_matrices.h"
+
+namespace Lotus
+{
+  class InstanceStorage;
+
+  // Stable ID of an instance, it stays valid until the instance is destroyed
+  using InstanceID = Handle<InstanceStorage>;
+
+  /*
+    Structure of arrays storage of the renderer instances. Every array is dense and indexed by the instance
+    index, which changes when other instances are destroyed, while the instance IDs stay stable. Bulk updates
+    can write the arrays directly and then mark the modified instances as dirty
+  */
+  class InstanceStorage
+  {
+  public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    enum DirtyFlags : uint8_t
+    {
+      TransformDirty = 1 << 0,
+      MeshDirty = 1 << 1,
+      MaterialDirty = 1 << 2,
+      ShaderDirty = 1 << 3
+    };
+
+    InstanceID create(
+        Handle<RenderMesh> meshHandle,
+        Handle<RenderMaterial> materialHandle,
+        uint32_t shaderHandle,
+        const glm::vec3& translation = glm::vec3(0.0f),
+        const glm::fquat& rotation = glm::fquat(1.0f, 0.0f, 0.0f, 0.0f),
+        const glm::vec3& scale = glm::vec3(1.0f));
+    bool destroy(InstanceID instanceID);
+    void clear();
+
+    bool contains(InstanceID instanceID) const;
+    uint32_t getIndex(InstanceID instanceID) const;
+    InstanceID getID(uint32_t index) const;
+    size_t size() const { return translations.size(); }
+
+    // Single instance access
+    const glm::vec3& getTranslation(InstanceID instanceID) const { return translations[getIndex(instanceID)]; }
+    const glm::fquat& getRotation(InstanceID instanceID) const { return rotations[getIndex(instanceID)]; }
+    const glm::vec3& getScale(InstanceID instanceID) const { return scales[getIndex(instanceID)]; }
+    glm::mat4 getModelMatrix(InstanceID instanceID) const { return getModelMatrix(getIndex(instanceID)); }
+    glm::mat4 getModelMatrix(uint32_t index) const;
+    // Model matrices of the instances at the given indices, composed in one batch
+    void getModelMatrices(const uint32_t* indices, size_t count, glm::mat4* matrices) const;
+
+    void setTranslation(InstanceID instanceID, const glm::vec3& translation);
+    void translate(InstanceID instanceID, const glm::vec3& translation);
+    void setRotation(InstanceID instanceID, const glm::fquat& rotation);
+    void rotate(InstanceID instanceID, const glm::vec3& axis, float angle);
+    void setScale(InstanceID instanceID, const glm::vec3& scale);
+    void scale(InstanceID instanceID, const glm::vec3& scale);
+
+    Handle<RenderMesh> getMeshHandle(InstanceID instanceID) const { return meshHandles[getIndex(instanceID)]; }
+    Handle<RenderMaterial> getMaterialHandle(InstanceID instanceID) const { return materialHandles[getIndex(instanceID)]; }
+    uint32_t getShaderHandle(InstanceID instanceID) const { return shaderHandles[getIndex(instanceID)]; }
+
+    void setMesh(InstanceID instanceID, Handle<RenderMesh> meshHandle);
+    void setMaterial(InstanceID instanceID, Handle<RenderMaterial> materialHandle, uint32_t shaderHandle);
+
+    Handle<RenderObject> getObjectHandle(InstanceID instanceID) const { return objectHandles[getIndex(instanceID)]; }
+    void setObjectHandle(InstanceID instanceID, Handle<RenderObject> objectHandle) { objectHandles[getIndex(instanceID)] = objectHandle; }
+
+    // Bulk access, the arrays are indexed by the instance index
+    glm::vec3* getTranslations() { return translations.data(); }
+    glm::fquat* getRotations() { return rotations.data(); }
+    glm::vec3* getScales() { return scales.data(); }
+    const glm::vec3* getTranslations() const { return translations.data(); }
+    const glm::fquat* getRotations() const { return rotations.data(); }
+    const glm::vec3* getScales() const { return scales.data(); }
+    const Handle<RenderMesh>* getMeshHandles() const { return meshHandles.data(); }
+    const Handle<RenderMaterial>* getMaterialHandles() const { return materialHandles.data(); }
+    const uint32_t* getShaderHandles() const { return shaderHandles.data(); }
+    const Handle<RenderObject>* getObjectHandles() const { return objectHandles.data(); }
+    const uint8_t* getDirtyFlags() const { return dirtyFlags.data(); }
+
+    // Dirty tracking, every instance is in the dirty list once until the list is cleared
+    void markDirty(uint32_t index, uint8_t flags);
+    void markTransformsDirty(uint32_t first, uint32_t count);
+    const std::vector<InstanceID>& getDirtyInstances() const { return dirtyInstances; }
+    void clearDirty();
+
+  private:
+    void markDirty(InstanceID instanceID, uint8_t flags) { markDirty(getIndex(instanceID), flags); }
+
+    struct Slot
+    {
+      // Instance index, or next free slot when the slot is free
+      uint32_t index;
+      uint32_t generation;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t freeSlotsHead = InvalidIndex;
+
+    std::vector<glm::vec3> translations;
+    std::vector<glm::fquat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<Handle<RenderMesh>> meshHandles;
+    std::vector<Handle<RenderMaterial>> materialHandles;
+    std::vector<uint32_t> shaderHandles;
+    std::vector<Handle<RenderObject>> objectHandles;
+    std::vector<uint8_t> dirtyFlags;
+    std::vector<uint32_t> indexToSlot;
+
+    std::vector<InstanceID> dirtyInstances;
+  };
+}
@@ -10,11 +10,46 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 #include "../../util/assimp_transformations.h"
+#include "../../util/log.h"
+#include "../../math/packed_vertex.h"
+#include "../../math/mesh_optimizer.h"
+#include "../../math/mesh_simplifier.h"
+#include "../../math/meshlet_builder.h"
 
 namespace Lotus
 {
 
-  Mesh::Mesh(const std::string& filePath, bool flipUVs)
+  Mesh::Mesh(const std::string& filePath, bool flipUVs, bool useCookedMesh)
+  {
+    load(filePath, flipUVs, useCookedMesh);
+  }
+
+  void Mesh::load(const std::string& filePath, bool flipUVs, bool useCookedMesh)
+  {
+    std::optional<uint64_t> sourceHash;
+    std::filesystem::path cookedPath = getCookedMeshPath(filePath);
+
+    if (useCookedMesh) { sourceHash = hashMeshSource(filePath, flipUVs); }
+
+    // Vertices, indices and bounds are read from the mapping, nothing is parsed
+    if (useCookedMesh && cookedMesh.open(cookedPath, sourceHash))
+    {
+      bounds = cookedMesh.getBounds();
+    }
+    else
+    {
+      importSource(filePath, flipUVs);
+
+      if (useCookedMesh && sourceHash && !vertices.empty() && !writeCookedMesh(cookedPath, *sourceHash, vertices, indices, lods, meshlets, bounds))
+      {
+        LOTUS_LOG_WARN("[Mesh Warning] Couldn't write the cooked mesh {0}", cookedPath.string());
+      }
+    }
+
+    packGPUVertices();
+  }
+
+  void Mesh::importSource(const std::string& filePath, bool flipUVs, MeshOptimizationReport* report)
   {
     Assimp::Importer importer;
     unsigned int postProcessFlags = flipUVs ? aiProcess_FlipUVs : 0;
@@ -116,6 +151,17 @@ namespace Lotus
         sceneTransforms.push(currentNode->mChildren[j]->mTransformation * currentTransform);
       }
     }
+
+    // Assimp keeps the file order, the triangles are reordered for the vertex cache and overdraw
+    optimizeMesh(vertices, indices, report);
+
+    // The coarser levels reuse the vertices, their indices are appended after the full mesh
+    generateMeshLODs(vertices, indices, lods);
+
+    // The meshlets follow the vertex cache order of the full level, so they are ranges of its indices
+    buildMeshlets(vertices, std::span<const unsigned int>(indices).first(lods[0].count), meshlets);
+
+    bounds = computeMeshBounds(vertices.data(), vertices.size());
   }
 
   Mesh::Mesh(PrimitiveType type)
@@ -151,6 +197,12 @@ namespace Lotus
         break;
       }
     }
+
+    // Primitives are too small to need levels of detail
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+    bounds = computeMeshBounds(vertices.data(), vertices.size());
+    packGPUVertices();
   }
 
   Mesh::~Mesh()
@@ -158,8 +210,66 @@ namespace Lotus
     clearData();
   }
 
+  std::span<const Vertex> Mesh::getVertices() const
+  {
+    return cookedMesh.isOpen() ? cookedMesh.getVertices() : std::span<const Vertex>(vertices);
+  }
+
+  std::span<const unsigned int> Mesh::getIndices() const
+  {
+    return cookedMesh.isOpen() ? cookedMesh.getIndices() : std::span<const unsigned int>(indices);
+  }
+
+  std::span<const MeshLOD> Mesh::getLODs() const
+  {
+    return cookedMesh.isOpen() ? cookedMesh.getLODs() : std::span<const MeshLOD>(lods);
+  }
+
+  std::span<const Meshlet> Mesh::getMeshlets() const
+  {
+    return cookedMesh.isOpen() ? cookedMesh.getMeshlets() : std::span<const Meshlet>(meshlets);
+  }
+
+  std::span<const GPUVertex> Mesh::getGPUVertices() const
+  {
+#if LOTUS_PACKED_VERTICES
+    return packedVertices;
+#else
+    return getVertices();
+#endif
+  }
+
+  void Mesh::packGPUVertices()
+  {
+#if LOTUS_PACKED_VERTICES
+    std::span<const Vertex> meshVertices = getVertices();
+
+    packedVertices.resize(meshVertices.size());
+    packVertices(meshVertices.data(), meshVertices.size(), bounds, packedVertices.data());
+#endif
+  }
+
+  void Mesh::wait()
+  {
+    JobSystem::getInstance().wait(loadCounter);
+  }
+
   void Mesh::clearData() noexcept
   {
+    vertices.clear();
+    vertices.shrink_to_fit();
+    indices.clear();
+    indices.shrink_to_fit();
+    lods.clear();
+    lods.shrink_to_fit();
+    meshlets.clear();
+    meshlets.shrink_to_fit();
+    cookedMesh.close();
+
+#if LOTUS_PACKED_VERTICES
+    packedVertices.clear();
+    packedVertices.shrink_to_fit();
+#endif
   }
 
 }
\ No newline at end of file
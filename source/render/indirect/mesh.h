@@ -2,10 +2,16 @@
 
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include "../../math/primitives.h"
+#include "../../math/bounds.h"
+#include "../../math/gpu_primitives.h"
+#include "../../math/mesh_optimizer.h"
+#include "../../core/job_system.h"
+#include "cooked_mesh.h"
 
 namespace Lotus
 {
@@ -23,18 +29,58 @@ namespace Lotus
 
     ~Mesh();
     
-    const std::vector<Vertex>& getVertices() const { return vertices; }
-    const std::vector<unsigned int>& getIndices() const { return indices; }
+    // Meshes loaded from a cooked file point into its mapping, the others into their own vectors
+    std::span<const Vertex> getVertices() const;
+    std::span<const unsigned int> getIndices() const;
 
-    uint32_t getIndicesCount() { return indices.size(); }
+    // Vertices in the layout of the renderer vertex buffer, packed when the mesh is loaded if LOTUS_PACKED_VERTICES is set
+    std::span<const GPUVertex> getGPUVertices() const;
+
+    uint32_t getIndicesCount() { return static_cast<uint32_t>(getIndices().size()); }
+
+    // Index ranges of the levels of detail, the first one is the full mesh and the others are in the same indices
+    std::span<const MeshLOD> getLODs() const;
+
+    // Clusters of the full detail level, empty for the primitives
+    std::span<const Meshlet> getMeshlets() const;
+
+    // True if the mesh was loaded from its cooked file instead of being imported
+    bool isCooked() const noexcept { return cookedMesh.isOpen(); }
+
+    // Computed when the mesh is loaded, in mesh space
+    const MeshBounds& getBounds() const { return bounds; }
+
+    // Meshes loaded asynchronously have no data until they are ready
+    bool isReady() const noexcept { return loadCounter.isDone(); }
+    // Runs jobs on the calling thread until the mesh is loaded
+    void wait();
 
   private:
-    Mesh(const std::string& filePath, bool flipUVs = false);
+    Mesh() = default;
+    Mesh(const std::string& filePath, bool flipUVs = false, bool useCookedMesh = true);
     Mesh(PrimitiveType type);
     
+    /*
+      Maps the cooked file of the mesh if it is up to date, otherwise imports the file, flattens its scene
+      graph, generates its levels of detail and meshlets and cooks it for the next loads. It doesn't touch OpenGL so it
+      can run on a worker
+    */
+    void load(const std::string& filePath, bool flipUVs, bool useCookedMesh = true);
+    void importSource(const std::string& filePath, bool flipUVs, MeshOptimizationReport* report = nullptr);
+    void packGPUVertices();
     void clearData() noexcept;
 
+    // Holds the loading job of asynchronous meshes
+    JobCounter loadCounter;
+
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
+    std::vector<MeshLOD> lods;
+    std::vector<Meshlet> meshlets;
+    CookedMesh cookedMesh;
+#if LOTUS_PACKED_VERTICES
+    std::vector<PackedVertex> packedVertices;
+#endif
+    MeshBounds bounds;
   };
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#include "mesh_instance.h"
+
+#include "renderer.h"
+
+namespace Lotus
+{
+
+  void MeshInstance::setMesh(std::shared_ptr<Mesh> mesh) noexcept
+  {
+    if (mesh == nullptr || mesh == meshPtr) { return; }
+
+    meshPtr = mesh;
+
+    if (renderer != nullptr)
+    {
+      renderer->setInstanceMesh(instanceID, mesh);
+    }
+  }
+
+  void MeshInstance::setMaterial(std::shared_ptr<Material> material) noexcept
+  {
+    if (material == nullptr || material == materialPtr) { return; }
+
+    materialPtr = material;
+
+    if (renderer != nullptr)
+    {
+      renderer->setInstanceMaterial(instanceID, material);
+    }
+  }
+
+}
@@ -1,24 +1,34 @@
 #pragma once
 
 #include <iostream>
-#include "../../scene/node_3d.h"
+#include <cstdint>
+#include <limits>
+#include "../../scene/transform.h"
+#include "instance_storage.h"
 #include "mesh.h"
 #include "material.h"
 
 namespace Lotus
 {
-  class MeshInstance : public Node3D
+  class Renderer;
+
+  /*
+    Facade over an instance of the renderer instance storage. While the instance is rendered every transform
+    call reads and writes the storage arrays, once it is deleted it keeps a copy of its last transform
+  */
+  class MeshInstance
   {
   friend class Renderer;
 
   public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
 
     MeshInstance(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) :
       meshPtr(mesh),
       materialPtr(material),
-      meshDirty(false),
-      materialDirty(false),
-      shaderDirty(false)
+      renderer(nullptr),
+      storage(nullptr),
+      instanceIndex(InvalidIndex)
     {
       // ASSERT(mesh != nullptr, "StaticMeshComponent Error: Mesh pointer cannot be null.");
       // ASSERT(material != nullptr, "StaticMeshComponent Error: Material cannot be null.");
@@ -26,34 +36,121 @@ namespace Lotus
 
     const std::shared_ptr<Mesh>& getMesh() const noexcept { return meshPtr; }
     const std::shared_ptr<Material>& getMaterial() const noexcept { return materialPtr; }
+    bool isRendered() const noexcept { return instanceIndex != InvalidIndex; }
+    InstanceID getInstanceID() const noexcept { return instanceID; }
+
+    void setMesh(std::shared_ptr<Mesh> mesh) noexcept;
+    void setMaterial(std::shared_ptr<Material> material) noexcept;
+
+    Transform getTransform() const
+    {
+      if (storage == nullptr) { return transform; }
+
+      return Transform(storage->getTranslation(instanceID), storage->getRotation(instanceID), storage->getScale(instanceID));
+    }
+
+    const glm::vec3& getLocalTranslation() const
+    {
+      return storage ? storage->getTranslation(instanceID) : transform.getLocalTranslation();
+    }
+
+    const glm::fquat& getLocalRotation() const
+    {
+      return storage ? storage->getRotation(instanceID) : transform.getLocalRotation();
+    }
+
+    const glm::vec3& getLocalScale() const
+    {
+      return storage ? storage->getScale(instanceID) : transform.getLocalScale();
+    }
+
+    glm::mat4 getModelMatrix() const
+    {
+      return storage ? storage->getModelMatrix(instanceID) : transform.getModelMatrix();
+    }
+
+    glm::mat4 getViewMatrix() const
+    {
+      return getTransform().getViewMatrix();
+    }
+
+    void setTransform(const Transform& newTransform)
+    {
+      if (storage == nullptr) { transform = newTransform; return; }
+
+      storage->setTranslation(instanceID, newTransform.getLocalTranslation());
+      storage->setRotation(instanceID, newTransform.getLocalRotation());
+      storage->setScale(instanceID, newTransform.getLocalScale());
+    }
+
+    void translate(glm::vec3 translation)
+    {
+      if (storage) { storage->translate(instanceID, translation); }
+      else { transform.translate(translation); }
+    }
+
+    void setTranslation(const glm::vec3 translation)
+    {
+      if (storage) { storage->setTranslation(instanceID, translation); }
+      else { transform.setTranslation(translation); }
+    }
+
+    void scale(float scale)
+    {
+      this->scale(glm::vec3(scale));
+    }
+
+    void scale(glm::vec3 scale)
+    {
+      if (storage) { storage->scale(instanceID, scale); }
+      else { transform.scale(scale); }
+    }
+
+    void setScale(const glm::vec3& scale)
+    {
+      if (storage) { storage->setScale(instanceID, scale); }
+      else { transform.setScale(scale); }
+    }
 
-    void setMesh(std::shared_ptr<Mesh> mesh) noexcept
+    void rotate(glm::vec3 axis, float angle)
     {
-      if (mesh == nullptr || mesh == meshPtr) { return; }
+      if (storage) { storage->rotate(instanceID, axis, angle); }
+      else { transform.rotate(axis, angle); }
+    }
 
-      meshPtr = mesh;
-      meshDirty = true;
+    void setRotation(const glm::fquat& rotation)
+    {
+      if (storage) { storage->setRotation(instanceID, rotation); }
+      else { transform.setRotation(rotation); }
     }
-    
-    void setMaterial(std::shared_ptr<Material> material) noexcept
+
+    glm::vec3 getUpVector() const
     {
-      if (material == nullptr || material == materialPtr) { return; }
+      return getTransform().getUpVector();
+    }
 
-      if (material->getType() != materialPtr->getType())
-      {
-        shaderDirty = true;
-      }
+    glm::vec3 getRightVector() const
+    {
+      return getTransform().getRightVector();
+    }
 
-      materialPtr = material;
-      materialDirty = true;
+    glm::vec3 getFrontVector() const
+    {
+      return getTransform().getFrontVector();
     }
 
   private:
     std::shared_ptr<Mesh> meshPtr;
     std::shared_ptr<Material> materialPtr;
 
-    bool meshDirty;
-    bool materialDirty;
-    bool shaderDirty;
+    Renderer* renderer;
+    // Storage of the instance while it is rendered, null once it is deleted
+    InstanceStorage* storage;
+    InstanceID instanceID;
+    // Transform of the instance while it is not in the storage
+    Transform transform;
+
+    // Position of the instance in the renderer instances array
+    uint32_t instanceIndex;
   };
-}
\ No newline at end of file
+}
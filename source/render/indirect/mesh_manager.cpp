@@ -1,5 +1,8 @@
 #include "mesh_manager.h"
 
+#include <algorithm>
+#include "../../core/job_system.h"
+
 namespace Lotus
 {
   std::string primitiveEnumToString(Mesh::PrimitiveType type)
@@ -48,9 +51,13 @@ namespace Lotus
     // it is returned immediately
     auto it = meshMap.find(stringPath);
     if (it != meshMap.end())
+    {
+      // The mesh may still be loading asynchronously
+      it->second->wait();
       return it->second;
+    }
     
-    Mesh* meshPtr = new Mesh(stringPath, flipUVs);
+    Mesh* meshPtr = new Mesh(stringPath, flipUVs, cookedMeshesEnabled);
     std::shared_ptr<Mesh> sharedPtr = std::shared_ptr<Mesh>(meshPtr);
     
     // Before returning the loaded mesh, we add it to the map so future loads are faster
@@ -58,6 +65,73 @@ namespace Lotus
     return sharedPtr;
   }
 
+  std::shared_ptr<Mesh> MeshManager::loadMeshAsync(const std::filesystem::path& filePath, bool flipUVs) noexcept
+  {
+    const std::string stringPath = filePath.string();
+
+    auto it = meshMap.find(stringPath);
+    if (it != meshMap.end())
+      return it->second;
+
+    std::shared_ptr<Mesh> sharedPtr = std::shared_ptr<Mesh>(new Mesh());
+
+    // The job keeps the mesh alive, so it can be released while it is loading. The renderer only polls isReady
+    JobSystem::getInstance().runDetached([sharedPtr, stringPath, flipUVs, useCookedMesh = cookedMeshesEnabled]()
+    {
+      sharedPtr->load(stringPath, flipUVs, useCookedMesh);
+    }, &sharedPtr->loadCounter);
+
+    meshMap.insert({ stringPath, sharedPtr });
+    return sharedPtr;
+  }
+
+  std::vector<std::shared_ptr<Mesh>> MeshManager::loadMeshes(const std::vector<std::filesystem::path>& filePaths, bool flipUVs) noexcept
+  {
+    // Paths without a loaded mesh, each one imported once even if it is repeated
+    std::vector<std::string> toLoadPaths;
+
+    for (const std::filesystem::path& filePath : filePaths)
+    {
+      std::string stringPath = filePath.string();
+
+      if (!meshMap.contains(stringPath) && std::find(toLoadPaths.begin(), toLoadPaths.end(), stringPath) == toLoadPaths.end())
+      {
+        toLoadPaths.push_back(std::move(stringPath));
+      }
+    }
+
+    // Every import has its own importer, so they only share the job system
+    std::vector<std::shared_ptr<Mesh>> loadedMeshes(toLoadPaths.size());
+
+    JobSystem::getInstance().parallelFor(toLoadPaths.size(), 1, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; i++)
+      {
+        loadedMeshes[i] = std::shared_ptr<Mesh>(new Mesh(toLoadPaths[i], flipUVs, cookedMeshesEnabled));
+      }
+    });
+
+    // The map is only modified on the calling thread
+    for (size_t i = 0; i < toLoadPaths.size(); i++)
+    {
+      meshMap.insert({ toLoadPaths[i], loadedMeshes[i] });
+    }
+
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    meshes.reserve(filePaths.size());
+
+    for (const std::filesystem::path& filePath : filePaths)
+    {
+      std::shared_ptr<Mesh>& mesh = meshMap[filePath.string()];
+
+      // Meshes requested before with loadMeshAsync
+      mesh->wait();
+      meshes.push_back(mesh);
+    }
+
+    return meshes;
+  }
+
   void MeshManager::cleanUnusedMeshes() noexcept
   {
     /*
@@ -75,9 +149,33 @@ namespace Lotus
     }
   }
 
+  bool MeshManager::cookMesh(const std::filesystem::path& filePath, bool flipUVs, bool force, MeshOptimizationReport* report) noexcept
+  {
+    std::optional<uint64_t> sourceHash = hashMeshSource(filePath, flipUVs);
+
+    if (!sourceHash) { return false; }
+
+    std::filesystem::path cookedPath = getCookedMeshPath(filePath);
+
+    if (!force)
+    {
+      CookedMesh cookedMesh;
+
+      if (cookedMesh.open(cookedPath, sourceHash)) { return true; }
+    }
+
+    Mesh mesh;
+    mesh.importSource(filePath.string(), flipUVs, report);
+
+    if (mesh.vertices.empty()) { return false; }
+
+    return writeCookedMesh(cookedPath, *sourceHash, mesh.vertices, mesh.indices, mesh.lods, mesh.meshlets, mesh.bounds);
+  }
+
   void MeshManager::shutDown() noexcept
   {
     for (auto& entry : meshMap) {
+      entry.second->wait();
       entry.second->clearData();
     }
     
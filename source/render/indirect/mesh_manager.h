@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <filesystem>
 #include <unordered_map>
 
@@ -19,8 +20,29 @@ namespace Lotus
     
     std::shared_ptr<Mesh> loadMesh(Mesh::PrimitiveType type) noexcept;
     std::shared_ptr<Mesh> loadMesh(const std::filesystem::path& filePath, bool flipUVs = false) noexcept;
+    /*
+      Returns immediately, the mesh is imported on the engine job system. It can be given to instances before it
+      is ready, they draw nothing until the renderer uploaded it. Mesh::isReady and Mesh::wait work as a future
+    */
+    std::shared_ptr<Mesh> loadMeshAsync(const std::filesystem::path& filePath, bool flipUVs = false) noexcept;
+    // Imports the meshes that aren't loaded yet on the engine job system, they are returned in the paths order
+    std::vector<std::shared_ptr<Mesh>> loadMeshes(const std::vector<std::filesystem::path>& filePaths, bool flipUVs = false) noexcept;
     
     void cleanUnusedMeshes() noexcept;
+
+    /*
+      Imports the file and writes its cooked mesh without loading it, for offline conversion. Returns false if
+      the file can't be imported or the cooked mesh can't be written, an up to date cooked mesh is kept. The
+      report gets the vertex cache statistics of the import, if the mesh was cooked
+    */
+    static bool cookMesh(
+        const std::filesystem::path& filePath,
+        bool flipUVs = false,
+        bool force = false,
+        MeshOptimizationReport* report = nullptr) noexcept;
+
+    // Enabled by default, without cooked meshes every load imports its source file
+    void setCookedMeshesEnabled(bool enabled) noexcept { cookedMeshesEnabled = enabled; }
     
     static MeshManager& getInstance() noexcept
     {
@@ -34,5 +56,6 @@ namespace Lotus
     void shutDown() noexcept;
 
     MeshMap meshMap;
+    bool cookedMeshesEnabled = true;
   };
 }
\ No newline at end of file
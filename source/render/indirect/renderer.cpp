@@ -1,50 +1,41 @@
 #include "renderer.h"
 
 #include <algorithm>
+#include <limits>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "../../util/path_manager.h"
+#include "culling.h"
 
 namespace Lotus {
 
-  void printRenderBatches(const std::vector<ObjectBatch>& batches)
-  {
-    for (int i = 0; i < batches.size(); i++)
-    {
-      std::cout << "RB[" << i << "] = {oh_" << batches[i].objectHandle.get() << "mh_" << batches[i].meshHandle.get() << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl; 
-    }
-    std::cout << std::endl;
-  }
-
-  void printDrawBatches(const std::vector<DrawBatch>& batches)
-  {
-    for (int i = 0; i < batches.size(); i++)
-    {
-      std::cout << "DB[" << i << "] = {ic_" << batches[i].instanceCount << "pic_" << batches[i].prevInstanceCount << "mh_" << batches[i].meshHandle.get() << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl; 
-    }
-    std::cout << std::endl;
-  }
-
-  void printShaderBatches(const std::vector<ShaderBatch>& batches)
-  {
-    for (int i = 0; i < batches.size(); i++)
-    {
-      std::cout << "SB[" << i << "] = {c_" << batches[i].count << "f_" << batches[i].first << "sh_" << batches[i].shaderHandle.get() << "}" << std::endl; 
-    }
-    std::cout << std::endl;
-  }
-
   Renderer::Renderer() :
     vertexArrayID(0),
-    ambientLight({1.0, 1.0, 1.0})
+    ambientLight({1.0, 1.0, 1.0}),
+    clusterInstancesCount(0),
+    sceneFramebufferID(0),
+    sceneColorTextureID(0),
+    sceneDepthTextureID(0),
+    sceneFramebufferWidth(0),
+    sceneFramebufferHeight(0),
+    frustumCulling(true),
+    occlusionCulling(false),
+    CPUCulling(false),
+    clusterCulling(true),
+    lodThreshold(1.0f),
+    lodTarget(0.0f),
+    uploadedBytes(0)
   {}
 
   void Renderer::startUp()
   {
     shaders[static_cast<unsigned int>(MaterialType::UnlitFlat)] = ShaderProgram(shaderPath("indirect/unlit_flat.vert"), shaderPath("indirect/unlit_flat.frag"));
     shaders[static_cast<unsigned int>(MaterialType::DiffuseFlat)] = ShaderProgram(shaderPath("indirect/diffuse_flat.vert"), shaderPath("indirect/diffuse_flat.frag"));
+    cullingShader = ShaderProgram(shaderPath("culling/frustum_culling.comp"));
+    clusterCullingShader = ShaderProgram(shaderPath("culling/cluster_culling.comp"));
+    depthPyramid.startUp();
 
     glEnable(GL_DEPTH_TEST);
     
@@ -59,6 +50,7 @@ namespace Lotus {
     GPUIndexBuffer.setVertexArray(vertexArrayID);
 
     GPUIndirectBuffer.allocate(IndirectBufferInitialAllocationSize);
+    GPUDrawCommandBuffer.allocate(IndirectBufferInitialAllocationSize);
 
     glBindBuffer(GL_UNIFORM_BUFFER, lightBufferID);
     glBufferData(GL_UNIFORM_BUFFER, sizeof(GPULightsData), nullptr, GL_DYNAMIC_DRAW);
@@ -67,21 +59,60 @@ namespace Lotus {
     GPUObjectBuffer.allocate(ObjectBufferInitialAllocationSize);
     GPUObjectBuffer.setBindingPoint(ObjectBufferBindingPoint);
 
+    GPUInstanceBuffer.allocate(ObjectBufferInitialAllocationSize);
+    GPUInstanceBuffer.setBindingPoint(InstanceBufferBindingPoint);
+
     GPUObjectHandleBuffer.allocate(ObjectBufferInitialAllocationSize);
     GPUObjectHandleBuffer.setBindingPoint(ObjectHandleBufferBindingPoint);
 
+    // Every element of the visibility buffer is meaningful, so it is always filled and starts cleared
+    GPUVisibilityBuffer.allocate(ObjectBufferInitialAllocationSize);
+    GPUVisibilityBuffer.setBindingPoint(VisibilityBufferBindingPoint);
+    GPUVisibilityBuffer.filledSize = GPUVisibilityBuffer.allocatedSize;
+    glClearNamedBufferData(GPUVisibilityBuffer.ID, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
     GPUMaterialBuffer.allocate(MaterialBufferInitialAllocationSize);
     GPUMaterialBuffer.setBindingPoint(MaterialBufferBindingPoint);
 
+    GPUMeshBoundsBuffer.allocate(MeshBoundsBufferInitialAllocationSize);
+    GPUMeshBoundsBuffer.setBindingPoint(MeshBoundsBufferBindingPoint);
+
+    GPUMeshletBuffer.allocate(MeshletBufferInitialAllocationSize);
+
+    GPUClusterBatchBuffer.allocate(IndirectBufferInitialAllocationSize);
+    GPUClusterBatchBuffer.setBindingPoint(ClusterBatchBufferBindingPoint);
+
+    GPUClusterInstanceBuffer.allocate(ObjectBufferInitialAllocationSize);
+    GPUClusterInstanceBuffer.setBindingPoint(ClusterInstanceBufferBindingPoint);
+
+    GPUClusterCommandBuffer.allocate(IndirectBufferInitialAllocationSize);
+
+    GPUClusterCountBuffer.allocate(IndirectBufferInitialAllocationSize);
+    GPUClusterCountBuffer.setBindingPoint(ClusterCountBufferBindingPoint);
+
+    // Batch building and CPU culling share the engine workers
+    batchBuilder.setJobSystem(&JobSystem::getInstance());
+    culler.setJobSystem(&JobSystem::getInstance());
+
     glfwSwapInterval(0);
   }
 
   Renderer::~Renderer()
   {
+    // Instances can outlive the renderer, so they keep a copy of their transform
+    for (const std::shared_ptr<MeshInstance>& meshInstance : meshInstances)
+    {
+      meshInstance->transform = meshInstance->getTransform();
+      meshInstance->renderer = nullptr;
+      meshInstance->storage = nullptr;
+      meshInstance->instanceIndex = MeshInstance::InvalidIndex;
+    }
+
     if (vertexArrayID)
     {
       glDeleteBuffers(1, &lightBufferID);
       glDeleteVertexArrays(1, &vertexArrayID);
+      deleteSceneFramebuffer();
 
       vertexArrayID = 0;
     }
@@ -90,14 +121,59 @@ namespace Lotus {
   std::shared_ptr<MeshInstance> Renderer::createMeshInstance(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
   {
     std::shared_ptr<MeshInstance> meshInstance = std::make_shared<MeshInstance>(mesh, material);
+    meshInstance->instanceIndex = static_cast<uint32_t>(meshInstances.size());
     meshInstances.push_back(meshInstance);
 
-    Handle<RenderMesh> meshHandle = getMeshHandle(mesh);
+    meshInstance->renderer = this;
+    meshInstance->storage = &instances;
+    meshInstance->instanceID = createInstance(mesh, material);
+
+    return meshInstance;
+  }
+
+  void Renderer::deleteMeshInstance(std::shared_ptr<MeshInstance> meshInstance)
+  {
+    uint32_t index = meshInstance->instanceIndex;
+
+    if (index >= meshInstances.size() || meshInstances[index] != meshInstance)
+    {
+      LOTUS_LOG_WARN("[Renderer Warning] Tried to delete a mesh instance that doesn't belong to the renderer");
+      return;
+    }
+
+    // The instance keeps its last transform once it leaves the storage
+    meshInstance->transform = meshInstance->getTransform();
+
+    deleteInstance(meshInstance->instanceID);
+
+    meshInstance->renderer = nullptr;
+    meshInstance->storage = nullptr;
+
+    // Swap and pop, the moved instance keeps track of its new position
+    if (index != meshInstances.size() - 1)
+    {
+      meshInstances[index] = std::move(meshInstances.back());
+      meshInstances[index]->instanceIndex = index;
+    }
+
+    meshInstances.pop_back();
+
+    meshInstance->instanceIndex = MeshInstance::InvalidIndex;
+  }
+
+  InstanceID Renderer::createInstance(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material)
+  {
+    Handle<RenderMesh> meshHandle = acquireMesh(mesh);
     Handle<RenderMaterial> materialHandle = getMaterialHandle(material);
+    uint32_t shaderHandle = static_cast<unsigned int>(material->getType());
+
+    InstanceID instanceID = instances.create(meshHandle, materialHandle, shaderHandle);
 
     GPUObjectData GPUObject;
-    GPUObject.model = meshInstance->getModelMatrix();
-    GPUObject.materialHandle = materialHandle.get();
+    writeObjectModel(instances.getModelMatrix(instanceID), GPUObject);
+    GPUObject.materialHandle = renderMaterials[materialHandle].ID;
+    GPUObject.meshHandle = meshHandle.get();
+    GPUObject.boundingSphere = renderMeshes[meshHandle].boundingSphere;
       
     uint32_t objectID = GPUObjectBuffer.add(&GPUObject);
 
@@ -105,24 +181,64 @@ namespace Lotus {
     renderObject.model = GPUObject.model;
     renderObject.meshHandle = meshHandle;
     renderObject.materialHandle = materialHandle;
-    renderObject.shaderHandle = static_cast<unsigned int>(material->getType());
+    renderObject.shaderHandle = shaderHandle;
     renderObject.ID = objectID;
-    
-    Handle<RenderObject> handle(static_cast<uint32_t>(renderObjects.size()));
-    renderObjects.push_back(renderObject);
-    
-    uint32_t placeholderHandle = 1;
-    GPUObjectHandleBuffer.add(&placeholderHandle);
+
+    Handle<RenderObject> handle = renderObjects.insert(renderObject);
+    instances.setObjectHandle(instanceID, handle);
+
+    if (!meshReferences[meshHandle.get()].uploaded)
+    {
+      meshReferences[meshHandle.get()].pendingObjects.push_back(handle);
+    }
 
     unbatchedObjectsHandles.push_back(handle);
 
-    return meshInstance;
+    return instanceID;
   }
 
-  void Renderer::deleteMeshInstance(std::shared_ptr<MeshInstance> meshInstance)
+  void Renderer::deleteInstance(InstanceID instanceID)
   {
-    meshInstances[0] = std::move(meshInstances.back());
-    meshInstances.pop_back();
+    if (!instances.contains(instanceID))
+    {
+      LOTUS_LOG_WARN("[Renderer Warning] Tried to delete an instance that doesn't belong to the renderer");
+      return;
+    }
+
+    Handle<RenderObject> objectHandle = instances.getObjectHandle(instanceID);
+
+    LOTUS_ASSERT(renderObjects.contains(objectHandle), "[Renderer Error] Instance references a deleted render object");
+
+    RenderObject& renderObject = renderObjects[objectHandle];
+
+    // Objects waiting in the unbatched list are not in the batches, the list skips their stale handles
+    if (!renderObject.unbatched)
+    {
+      batchBuilder.removeObject(objectHandle, renderObject);
+    }
+
+    GPUObjectBuffer.remove(renderObject.ID);
+
+    renderObjects.erase(objectHandle);
+
+    releaseMesh(instances.getMeshHandle(instanceID));
+
+    // Entries already in the dirty list become stale and are skipped
+    instances.destroy(instanceID);
+  }
+
+  void Renderer::setInstanceMesh(InstanceID instanceID, std::shared_ptr<Mesh> mesh)
+  {
+    Handle<RenderMesh> previousMeshHandle = instances.getMeshHandle(instanceID);
+
+    instances.setMesh(instanceID, acquireMesh(mesh));
+
+    releaseMesh(previousMeshHandle);
+  }
+
+  void Renderer::setInstanceMaterial(InstanceID instanceID, std::shared_ptr<Material> material)
+  {
+    instances.setMaterial(instanceID, getMaterialHandle(material), static_cast<unsigned int>(material->getType()));
   }
 
   std::shared_ptr<Material> Renderer::createMaterial(MaterialType type)
@@ -172,24 +288,102 @@ namespace Lotus {
 
   void Renderer::render(const Camera& camera)
   {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  
     glm::mat4 viewMatrix = camera.getViewMatrix();
     glm::mat4 projectionMatrix = camera.getProjectionMatrix();
     glm::vec3 cameraPosition = camera.getLocalTranslation();
+
+    bool twoPhaseCulling = occlusionCulling && !CPUCulling;
+
+    int width, height;
+    glfwGetFramebufferSize(glfwGetCurrentContext(), &width, &height);
+
+    lodTarget = computeLODTarget(projectionMatrix, static_cast<float>(std::max(height, 1)), lodThreshold);
+
+    if (twoPhaseCulling)
+    {
+      resizeSceneFramebuffer(std::max(width, 1), std::max(height, 1));
+
+      glBindFramebuffer(GL_FRAMEBUFFER, sceneFramebufferID);
+    }
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
    
     update();
 
+    uploadMeshes();
+
     buildBatches();
 
+    releaseMeshes();
+
+    compactGeometry();
+
+    if (CPUCulling)
+    {
+      cullObjectsOnCPU(projectionMatrix * viewMatrix);
+    }
+
     refreshBuffers();
 
+    if (CPUCulling)
+    {
+      drawBatches(viewMatrix, projectionMatrix);
+    }
+    else if (twoPhaseCulling)
+    {
+      cullObjects(viewMatrix, projectionMatrix, CullingPhase::Early);
+      drawBatches(viewMatrix, projectionMatrix);
+
+      depthPyramid.build(sceneDepthTextureID);
+
+      cullObjects(viewMatrix, projectionMatrix, CullingPhase::Late);
+      drawBatches(viewMatrix, projectionMatrix);
+
+      glBindFramebuffer(GL_FRAMEBUFFER, 0);
+      glBlitNamedFramebuffer(
+          sceneFramebufferID, 0,
+          0, 0, sceneFramebufferWidth, sceneFramebufferHeight,
+          0, 0, sceneFramebufferWidth, sceneFramebufferHeight,
+          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    }
+    else
+    {
+      cullObjects(viewMatrix, projectionMatrix);
+      drawBatches(viewMatrix, projectionMatrix);
+    }
+
+    GPUIndirectBuffer.nextFrame();
+    GPUObjectBuffer.nextFrame();
+    GPUInstanceBuffer.nextFrame();
+
+    collectUploadCounters();
+  }
+
+  void Renderer::drawBatches(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix)
+  {
     glBindVertexArray(vertexArrayID);
-    
-    GPUIndirectBuffer.bind();
+
+    // The CPU culled commands are in the current region of the ring
+    size_t commandsOffset = 0;
+
+    if (CPUCulling)
+    {
+      GPUIndirectBuffer.bind();
+      commandsOffset = GPUIndirectBuffer.getRegionOffset();
+    }
+    else
+    {
+      GPUDrawCommandBuffer.bind();
+    }
+
     GPUObjectBuffer.bind();
     GPUObjectHandleBuffer.bind();
     GPUMaterialBuffer.bind();
+    // Packed positions are relative to the mesh box
+    GPUMeshBoundsBuffer.bind();
+
+    const std::vector<ShaderBatch>& shaderBatches = batchBuilder.getShaderBatches();
+    uint32_t commandsPerDrawBatch = getCommandsPerDrawBatch();
 
     for (int i = 0; i < shaderBatches.size(); i++)
     {
@@ -203,15 +397,75 @@ namespace Lotus {
       glMultiDrawElementsIndirect(
           GL_TRIANGLES,
           GL_UNSIGNED_INT,
-          (void*) (shaderBatch.first * sizeof(DrawElementsIndirectCommand)),
-          shaderBatch.count,
+          (void*) (commandsOffset + shaderBatch.first * commandsPerDrawBatch * sizeof(DrawElementsIndirectCommand)),
+          shaderBatch.count * commandsPerDrawBatch,
           sizeof(DrawElementsIndirectCommand));
     }
 
+    // The cluster pass compacts the commands at the start of the range of each draw batch and counts them
+    if (!CPUCulling && !clusterDraws.empty())
+    {
+      glBindBuffer(GL_DRAW_INDIRECT_BUFFER, GPUClusterCommandBuffer.ID);
+      glBindBuffer(GL_PARAMETER_BUFFER, GPUClusterCountBuffer.ID);
+
+      for (size_t i = 0; i < clusterDraws.size(); i++)
+      {
+        const ClusterDraw& clusterDraw = clusterDraws[i];
+
+        // The draws are in draw batch order, so they are grouped by shader
+        if (i == 0 || clusterDraw.shaderHandle != clusterDraws[i - 1].shaderHandle)
+        {
+          glUseProgram(shaders[clusterDraw.shaderHandle.get()].getProgramID());
+
+          glUniformMatrix4fv(ViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+          glUniformMatrix4fv(ProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+        }
+
+        glMultiDrawElementsIndirectCount(
+            GL_TRIANGLES,
+            GL_UNSIGNED_INT,
+            (void*) (clusterDraw.firstCommand * sizeof(DrawElementsIndirectCommand)),
+            static_cast<GLintptr>(i * sizeof(uint32_t)),
+            clusterDraw.maxCommands,
+            sizeof(DrawElementsIndirectCommand));
+      }
+
+      glBindBuffer(GL_PARAMETER_BUFFER, 0);
+    }
+
+    GPUMeshBoundsBuffer.unbind();
     GPUMaterialBuffer.unbind();
     GPUObjectBuffer.unbind();
     GPUObjectHandleBuffer.unbind();
-    GPUIndirectBuffer.unbind();
+
+    if (CPUCulling)
+    {
+      GPUIndirectBuffer.unbind();
+    }
+    else
+    {
+      GPUDrawCommandBuffer.unbind();
+    }
+  }
+
+  void Renderer::setCPUCulling(bool enabled)
+  {
+    if (enabled == CPUCulling) { return; }
+
+    CPUCulling = enabled;
+
+    // The commands hold the counts and the layout of the previous mode
+    batchBuilder.markDrawBatchesDirty();
+  }
+
+  void Renderer::setClusterCulling(bool enabled)
+  {
+    if (enabled == clusterCulling) { return; }
+
+    clusterCulling = enabled;
+
+    // The cluster batches are written with the commands
+    batchBuilder.markDrawBatchesDirty();
   }
 
   void Renderer::update()
@@ -222,299 +476,485 @@ namespace Lotus {
 
   void Renderer::updateObjects()
   {
-    for (int i = 0; i < meshInstances.size(); i++)
+    const uint8_t* dirtyFlags = instances.getDirtyFlags();
+    const Handle<RenderObject>* objectHandles = instances.getObjectHandles();
+
+    // Model matrices of every moved instance are composed in one batch
+    dirtyTransformsIndices.clear();
+
+    for (const InstanceID& instanceID : instances.getDirtyInstances())
     {
-      const std::shared_ptr<MeshInstance>& meshInstance = meshInstances[i];
-      Transform* transform = &(meshInstance->transform);
+      if (!instances.contains(instanceID)) { continue; }
+
+      uint32_t index = instances.getIndex(instanceID);
 
-      if (transform->dirty || meshInstance->meshDirty || meshInstance->materialDirty)
+      if (dirtyFlags[index] & InstanceStorage::TransformDirty)
       {
-        RenderObject& renderObject = renderObjects[i];
-        Handle<RenderObject> objectHandle(i);
+        dirtyTransformsIndices.push_back(index);
+      }
+    }
 
-        if (transform->dirty)
-        {
-          renderObject.model = meshInstance->getModelMatrix();
-          transform->dirty = false;
-        }
-        if (meshInstance->materialDirty)
-        {
-          renderObject.materialHandle = getMaterialHandle(meshInstance->getMaterial());
-          meshInstance->materialDirty = false;
-        }
-        if (meshInstance->meshDirty || meshInstance->shaderDirty)
+    dirtyModelMatrices.resize(dirtyTransformsIndices.size());
+
+    JobSystem::getInstance().parallelFor(dirtyTransformsIndices.size(), ModelMatricesGrainSize, [this](size_t first, size_t last)
+    {
+      instances.getModelMatrices(dirtyTransformsIndices.data() + first, last - first, dirtyModelMatrices.data() + first);
+    });
+
+    size_t modelMatrixIndex = 0;
+
+    for (const InstanceID& instanceID : instances.getDirtyInstances())
+    {
+      // Instances deleted after being marked
+      if (!instances.contains(instanceID)) { continue; }
+
+      uint32_t index = instances.getIndex(instanceID);
+      uint8_t flags = dirtyFlags[index];
+
+      Handle<RenderObject> objectHandle = objectHandles[index];
+      RenderObject& renderObject = renderObjects[objectHandle];
+
+      /*
+        The renderer MUST rearrange the batch related to this object if any of the handles packed in its
+        sort key change, so the batches ordering logic works accordingly.
+      */
+      bool sortKeyDirty = (flags & (InstanceStorage::MeshDirty | InstanceStorage::ShaderDirty)) ||
+        ((flags & InstanceStorage::MaterialDirty) && batchBuilder.getSortKeyLayout().materialBits > 0);
+
+      if (sortKeyDirty && !renderObject.unbatched)
+      {
+        batchBuilder.removeObject(objectHandle, renderObject);
+        unbatchedObjectsHandles.push_back(objectHandle);
+
+        renderObject.unbatched = true;
+      }
+
+      if (flags & InstanceStorage::TransformDirty)
+      {
+        renderObject.model = dirtyModelMatrices[modelMatrixIndex++];
+      }
+      if (flags & InstanceStorage::MaterialDirty)
+      {
+        renderObject.materialHandle = instances.getMaterialHandles()[index];
+      }
+      if (flags & (InstanceStorage::MeshDirty | InstanceStorage::ShaderDirty))
+      {
+        renderObject.meshHandle = instances.getMeshHandles()[index];
+        renderObject.shaderHandle = instances.getShaderHandles()[index];
+
+        if ((flags & InstanceStorage::MeshDirty) && !meshReferences[renderObject.meshHandle.get()].uploaded)
         {
-          if (!renderObject.unbatched)
-          {
-            /*
-              The renderer MUST rearrange the batch related to this object if the mesh or the shader change
-              so the batches ordering logic works accordingly.
-            */
-            toUnbatchObjects.push_back(renderObject);
-            unbatchedObjectsHandles.push_back(objectHandle);
-
-            renderObject.unbatched = true;
-          }
-
-          renderObject.meshHandle = getMeshHandle(meshInstance->getMesh());
-          renderObject.shaderHandle = static_cast<unsigned int>(meshInstance->getMaterial()->getType());
-          
-          meshInstance->meshDirty = false;
-          meshInstance->shaderDirty = false;
+          meshReferences[renderObject.meshHandle.get()].pendingObjects.push_back(objectHandle);
         }
-
-        // Queue the object to be updated in the GPU buffer
-        dirtyObjectsHandles.push_back(objectHandle);
       }
+
+      // Queue the object to be updated in the GPU buffer
+      dirtyObjectsHandles.push_back(objectHandle);
     }
+
+    instances.clearDirty();
   }
 
   void Renderer::updateMaterials()
   {
-    for (int i = 0; i < materials.size(); i++)
+    for (const auto& [material, materialHandle] : materialMap)
     {
-      const std::shared_ptr<Material>& material = materials[i];
-
       if (material->dirty)
       {
-        RenderMaterial& renderMaterial= renderMaterials[i];
-        Handle<RenderMaterial> materialHandle(i);
-
         material->dirty = false;
 
-        dirtyMaterialsHandles.push_back(materialHandle);
+        dirtyMaterials.push_back(material);
       }
     }
   }
 
   void Renderer::buildBatches()
   {
-    // Render merge
-    buildObjectBatches();
+    for (const Handle<RenderObject>& objectHandle : unbatchedObjectsHandles)
+    {
+      RenderObject* object = renderObjects.find(objectHandle);
+
+      // Objects deleted after being queued
+      if (object == nullptr) { continue; }
 
-    // Draw merge
-    buildDrawBatches();
+      object->unbatched = false;
 
-    // Shader merge
-    buildShaderBatches();
+      batchBuilder.addObject(objectHandle, *object);
+    }
+
+    unbatchedObjectsHandles.clear();
+
+    batchBuilder.build();
+
+    GPUIndirectBuffer.filledSize = batchBuilder.getDrawBatches().size() * getCommandsPerDrawBatch();
   }
 
-  void Renderer::buildObjectBatches()
+  void Renderer::cullObjects(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, CullingPhase phase)
   {
-    if (!toUnbatchObjects.empty())
+    size_t drawBatchesCount = batchBuilder.getDrawBatches().size();
+    size_t instancesCount = batchBuilder.getObjectBatches().size();
+
+    if (drawBatchesCount == 0)
     {
-      std::cout << "Render batches" << std::endl;
-      printRenderBatches(objectBatches);
+      return;
+    }
 
-      std::vector<ObjectBatch> deletionObjectBatches;
-      deletionObjectBatches.reserve(toUnbatchObjects.size());
-      
-      for (const RenderObject& object : toUnbatchObjects)
-      {
-        ObjectBatch batch;
+    // Every level of detail of a draw batch has its command and room for all the instances of the batch, the
+    // instances left to the cluster pass have their handles after them
+    size_t commandsCount = drawBatchesCount * MaxMeshLODs;
+    size_t objectHandlesCount = instancesCount * MaxMeshLODs + clusterInstancesCount;
 
-        batch.objectHandle = Handle<RenderObject>(object.ID);
-        batch.meshHandle = object.meshHandle;
-        batch.shaderHandle = object.shaderHandle;
+    // The GPU written buffers only need space, their content is rebuilt every frame
+    if (GPUDrawCommandBuffer.allocatedSize < commandsCount)
+    {
+      GPUDrawCommandBuffer.reallocate(commandsCount);
+    }
 
-        deletionObjectBatches.push_back(batch);
-      }
+    if (GPUObjectHandleBuffer.allocatedSize < objectHandlesCount)
+    {
+      GPUObjectHandleBuffer.reallocate(objectHandlesCount);
+    }
 
-      toUnbatchObjects.clear();
+    GPUDrawCommandBuffer.filledSize = commandsCount;
+    GPUObjectHandleBuffer.filledSize = objectHandlesCount;
 
-      std::sort(deletionObjectBatches.begin(), deletionObjectBatches.end(),
-      [](const ObjectBatch& bA, const ObjectBatch& bB) {
-        if (bA.shaderHandle < bB.shaderHandle) { return true; }
-        else if (bA.shaderHandle == bB.shaderHandle) {
-                                if (bA.meshHandle < bB.meshHandle) { return true; }
-            else if (bA.meshHandle == bB.meshHandle) { return bA.objectHandle < bB.objectHandle; }
-            else { return false; }
-        }
-        else { return false; }
-      });
-
-      // std::cout << "Ordered deletion render batches" << std::endl;
-      // printRenderBatches(deletionObjectBatches);
-
-      std::vector<ObjectBatch> objectBatchesWithDeletion;
-      objectBatchesWithDeletion.reserve(objectBatches.size());
-
-      std::set_difference(objectBatches.begin(), objectBatches.end(), deletionObjectBatches.begin(), deletionObjectBatches.end(), std::back_inserter(objectBatchesWithDeletion),
-      [](const ObjectBatch& bA, const ObjectBatch& bB) {
-        if (bA.shaderHandle < bB.shaderHandle) { return true; }
-        else if (bA.shaderHandle == bB.shaderHandle) {
-                                if (bA.meshHandle < bB.meshHandle) { return true; }
-            else if (bA.meshHandle == bB.meshHandle) { return bA.objectHandle < bB.objectHandle; }
-            else { return false; }
-        }
-        else { return false; }
-      });
+    size_t objectsCount = GPUObjectBuffer.filledSize;
+
+    if (phase != CullingPhase::All && GPUVisibilityBuffer.allocatedSize < objectsCount)
+    {
+      size_t oldSize = GPUVisibilityBuffer.allocatedSize;
 
-      objectBatches = std::move(objectBatchesWithDeletion);
+      GPUVisibilityBuffer.reallocate(objectsCount);
+      GPUVisibilityBuffer.filledSize = GPUVisibilityBuffer.allocatedSize;
 
-      // std::cout << "Render batches after deletion" << std::endl;
-      // printRenderBatches(objectBatches);
+      // The added objects weren't visible in the last frame, so the late phase tests them
+      glClearNamedBufferSubData(
+          GPUVisibilityBuffer.ID, GL_R32UI,
+          oldSize * sizeof(uint32_t), (GPUVisibilityBuffer.allocatedSize - oldSize) * sizeof(uint32_t),
+          GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
     }
 
-    if (!unbatchedObjectsHandles.empty())
+    // The commands start as the CPU written ones, which have no instances, the late phase resets the early ones
+    glBindBuffer(GL_COPY_READ_BUFFER, GPUIndirectBuffer.ID);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, GPUDrawCommandBuffer.ID);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GPUIndirectBuffer.getRegionOffset(), 0, commandsCount * sizeof(DrawElementsIndirectCommand));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    if (!clusterDraws.empty())
     {
-      std::vector<ObjectBatch> newObjectBatches;
-      newObjectBatches.reserve(unbatchedObjectsHandles.size());
-      
-      // Fill new render batches
-      for (auto objectHandle : unbatchedObjectsHandles)
+      // The cluster pass dispatch starts empty, the culling pass adds a workgroup per instance it leaves to it
+      static constexpr uint32_t EmptyClusterDispatch[4] = { 0, 1, 1, 0 };
+
+      GPUClusterInstanceBuffer.write(EmptyClusterDispatch, 0, 4);
+      glClearNamedBufferSubData(
+          GPUClusterCountBuffer.ID, GL_R32UI,
+          0, clusterDraws.size() * sizeof(uint32_t),
+          GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+
+    Frustum frustum = extractFrustum(projectionMatrix * viewMatrix);
+
+    cullingShader.bind();
+
+    glUniform4fv(FrustumPlanesLocation, 6, glm::value_ptr(frustum.planes[0]));
+    glUniform1ui(InstancesCountLocation, static_cast<GLuint>(instancesCount));
+    glUniform1i(CullingEnabledLocation, frustumCulling);
+    glUniform1ui(CullingPhaseLocation, static_cast<GLuint>(phase));
+    glUniformMatrix4fv(CullingViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+    glUniformMatrix4fv(CullingProjectionMatrixLocation, 1, GL_FALSE, glm::value_ptr(projectionMatrix));
+    glUniform1f(CullingLODTargetLocation, lodTarget);
+
+    GPUObjectBuffer.bind();
+    GPUObjectHandleBuffer.bind();
+    GPUInstanceBuffer.bind();
+    GPUMeshBoundsBuffer.bind();
+    GPUVisibilityBuffer.bind();
+    GPUClusterBatchBuffer.bind();
+    GPUClusterInstanceBuffer.bind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawCommandBufferBindingPoint, GPUDrawCommandBuffer.ID);
+
+    if (phase == CullingPhase::Late)
+    {
+      glBindTextureUnit(DepthPyramidTextureUnit, depthPyramid.getTextureID());
+    }
+
+    glDispatchCompute(static_cast<GLuint>((instancesCount + CullingWorkgroupSize - 1) / CullingWorkgroupSize), 1, 1);
+
+    if (!clusterDraws.empty())
+    {
+      // The cluster pass is dispatched with the workgroups counted by the culling pass
+      glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+      cullClusters(frustum, viewMatrix, instancesCount);
+
+      cullingShader.bind();
+    }
+
+    // The draws read the instance counts and the vertex shaders the visible objects handles
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+    if (phase == CullingPhase::Late)
+    {
+      glBindTextureUnit(DepthPyramidTextureUnit, 0);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawCommandBufferBindingPoint, 0);
+    GPUClusterInstanceBuffer.unbind();
+    GPUClusterBatchBuffer.unbind();
+    GPUVisibilityBuffer.unbind();
+    GPUMeshBoundsBuffer.unbind();
+    GPUInstanceBuffer.unbind();
+    GPUObjectHandleBuffer.unbind();
+    GPUObjectBuffer.unbind();
+
+    cullingShader.unbind();
+  }
+
+  void Renderer::cullClusters(const Frustum& frustum, const glm::mat4& viewMatrix, size_t instancesCount)
+  {
+    clusterCullingShader.bind();
+
+    glUniform4fv(FrustumPlanesLocation, 6, glm::value_ptr(frustum.planes[0]));
+    glUniform1ui(InstancesCountLocation, static_cast<GLuint>(instancesCount));
+    glUniform1i(CullingEnabledLocation, frustumCulling);
+    glUniformMatrix4fv(CullingViewMatrixLocation, 1, GL_FALSE, glm::value_ptr(viewMatrix));
+
+    // The objects, draw commands, cluster batches and cluster instances are still bound by the culling pass
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshletBufferBindingPoint, GPUMeshletBuffer.ID);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ClusterCommandBufferBindingPoint, GPUClusterCommandBuffer.ID);
+    GPUClusterCountBuffer.bind();
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, GPUClusterInstanceBuffer.ID);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+
+    GPUClusterCountBuffer.unbind();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, ClusterCommandBufferBindingPoint, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MeshletBufferBindingPoint, 0);
+
+    clusterCullingShader.unbind();
+  }
+
+  void Renderer::cullObjectsOnCPU(const glm::mat4& viewProjection)
+  {
+    const std::vector<DrawBatch>& drawBatches = batchBuilder.getDrawBatches();
+    size_t instancesCount = batchBuilder.getObjectBatches().size();
+
+    if (drawBatches.empty())
+    {
+      return;
+    }
+
+    culler.gather(batchBuilder.getObjectBatches(), renderObjects, renderMeshes);
+    culler.cull(extractFrustum(viewProjection), drawBatches, frustumCulling);
+
+    if (GPUObjectHandleBuffer.allocatedSize < instancesCount)
+    {
+      GPUObjectHandleBuffer.reallocate(instancesCount);
+    }
+
+    GPUObjectHandleBuffer.filledSize = instancesCount;
+
+    // Slots after the visible objects of a draw batch aren't read, but uploading them keeps a single write
+    GPUObjectHandleBuffer.write(culler.getVisibleObjectIDs().data(), 0, instancesCount);
+  }
+
+  void Renderer::uploadMeshes()
+  {
+    size_t budget = MeshUploadBudgetBytes;
+
+    // Meshes uploaded completely in this call, their pending objects take the new bounding sphere
+    std::vector<Handle<RenderMesh>> uploadedMeshes;
+
+    auto upload = meshUploads.begin();
+
+    while (upload != meshUploads.end() && budget >= sizeof(GPUVertex))
+    {
+      // Meshes released before their upload finished, their ranges were freed with them
+      if (!renderMeshes.contains(upload->meshHandle))
       {
-        RenderObject& object = renderObjects[objectHandle.get()];
-        object.unbatched = false;
+        upload = meshUploads.erase(upload);
+        continue;
+      }
 
-        ObjectBatch batch;
-        batch.objectHandle = object.ID;		
-        batch.meshHandle = object.meshHandle;
-        batch.shaderHandle = object.shaderHandle;
+      MeshReferences& references = meshReferences[upload->meshHandle.get()];
+      const Mesh& mesh = *references.mesh;
 
-        newObjectBatches.push_back(batch);
+      // Still loading on a worker, the following meshes may be ready
+      if (!mesh.isReady())
+      {
+        ++upload;
+        continue;
       }
 
-      unbatchedObjectsHandles.clear();
+      // Cooked meshes are copied straight from their mapping, unless the vertices are packed
+      std::span<const GPUVertex> vertices = mesh.getGPUVertices();
+      std::span<const unsigned int> indices = mesh.getIndices();
+
+      RenderMesh& renderMesh = renderMeshes[upload->meshHandle];
 
-      // New render batches sort
-      std::sort(newObjectBatches.begin(), newObjectBatches.end(),
-      [](const ObjectBatch& bA, const ObjectBatch& bB)
+      // The compaction moves reserved ranges too, so the offsets are always read from the render mesh
+      if (!references.resident)
       {
-        if (bA.shaderHandle < bB.shaderHandle) { return true; }
-        else if (bA.shaderHandle == bB.shaderHandle) {
-                      if (bA.meshHandle < bB.meshHandle) { return true; }
-            else if (bA.meshHandle == bB.meshHandle) { return bA.objectHandle < bB.objectHandle; }
-            else { return false; }
-        }
-        else { return false; }
-      });
+        renderMesh.baseVertex = GPUVertexBuffer.reserve(vertices.size());
+        renderMesh.firstIndex = GPUIndexBuffer.reserve(indices.size());
+        references.resident = true;
+      }
 
-      //std::cout << "Ordered new render batches" << std::endl;
-      //printRenderBatches(newObjectBatches);
+      size_t verticesCount = std::min(vertices.size() - upload->uploadedVertices, budget / sizeof(GPUVertex));
 
-      // Merge the new render batches into the main render batch array
-      if (!objectBatches.empty() && !newObjectBatches.empty())
+      if (verticesCount > 0)
       {
-        int index = objectBatches.size();
-        objectBatches.reserve(objectBatches.size() + newObjectBatches.size());
-        
-        for (const ObjectBatch& objectBatch : newObjectBatches)
-        {
-          objectBatches.push_back(objectBatch);
-        }
+        GPUVertexBuffer.write(vertices.data() + upload->uploadedVertices, renderMesh.baseVertex + upload->uploadedVertices, verticesCount);
+        upload->uploadedVertices += static_cast<uint32_t>(verticesCount);
+        budget -= verticesCount * sizeof(GPUVertex);
+      }
+
+      size_t indicesCount = std::min(indices.size() - upload->uploadedIndices, budget / sizeof(unsigned int));
 
-        ObjectBatch* begin = objectBatches.data();
-        ObjectBatch* mid = begin + index;
-        ObjectBatch* end = begin + objectBatches.size();
-
-        std::inplace_merge(begin, mid, end,
-        [](const ObjectBatch& bA, const ObjectBatch& bB) {
-          if (bA.shaderHandle < bB.shaderHandle) { return true; }
-          else if (bA.shaderHandle == bB.shaderHandle) {
-            if (bA.meshHandle < bB.meshHandle) { return true; }
-            else if (bA.meshHandle == bB.meshHandle) { return bA.objectHandle < bB.objectHandle; }
-            else { return false; }
-          }
-          else { return false; }
-        });
+      if (indicesCount > 0)
+      {
+        GPUIndexBuffer.write(indices.data() + upload->uploadedIndices, renderMesh.firstIndex + upload->uploadedIndices, indicesCount);
+        upload->uploadedIndices += static_cast<uint32_t>(indicesCount);
+        budget -= indicesCount * sizeof(unsigned int);
       }
-      else if (objectBatches.empty())
+
+      // Out of budget in the middle of the mesh, it continues on the next frame
+      if (upload->uploadedVertices < vertices.size() || upload->uploadedIndices < indices.size()) { break; }
+
+      // The bounds and the levels of detail were computed when the mesh was loaded
+      const MeshBounds& bounds = mesh.getBounds();
+      std::span<const MeshLOD> lods = mesh.getLODs();
+
+      renderMesh.lodsCount = static_cast<uint32_t>(std::min<size_t>(lods.size(), MaxMeshLODs));
+      std::copy_n(lods.begin(), renderMesh.lodsCount, renderMesh.lods);
+
+      renderMesh.count = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].count;
+
+      std::span<const Meshlet> meshlets = mesh.getMeshlets();
+
+      // Small meshes are cheaper to draw whole than to cull by clusters
+      if (meshlets.size() >= ClusterCullingMinMeshlets)
       {
-        objectBatches = std::move(newObjectBatches);
+        std::vector<GPUMeshlet> GPUMeshlets(meshlets.size());
+
+        for (size_t i = 0; i < meshlets.size(); i++)
+        {
+          GPUMeshlets[i].boundingSphere = meshlets[i].boundingSphere;
+          GPUMeshlets[i].cone = meshlets[i].cone;
+          GPUMeshlets[i].firstIndex = meshlets[i].firstIndex;
+          GPUMeshlets[i].count = meshlets[i].count;
+        }
+
+        renderMesh.firstMeshlet = GPUMeshletBuffer.add(GPUMeshlets.data(), GPUMeshlets.size());
+        renderMesh.meshletsCount = static_cast<uint32_t>(GPUMeshlets.size());
       }
+      renderMesh.boundsMinimum = bounds.minimum;
+      renderMesh.boundsMaximum = bounds.maximum;
+      renderMesh.boundingSphere = bounds.sphere;
+
+      writeMeshBounds(upload->meshHandle, bounds, lods);
+      references.uploaded = true;
+      uploadedMeshes.push_back(upload->meshHandle);
 
-      //std::cout << "Render batches after addition" << std::endl;
-      //printRenderBatches(objectBatches);
+      upload = meshUploads.erase(upload);
     }
-  }
 
-  void Renderer::buildDrawBatches()
-  {
-    drawBatches.clear();
-    GPUIndirectBuffer.filledSize = 0;
-    
-    if (objectBatches.size() == 0) { return; }
-    
-    DrawBatch newDrawBatch;
-    newDrawBatch.prevInstanceCount = 0;
-    newDrawBatch.instanceCount = 0;
-    newDrawBatch.meshHandle = objectBatches[0].meshHandle;
-    newDrawBatch.shaderHandle = objectBatches[0].shaderHandle;
+    if (uploadedMeshes.empty()) { return; }
 
-    drawBatches.push_back(newDrawBatch);
-    DrawBatch* backDrawBatch = &drawBatches.back();
+    // The objects that got their mesh before it was ready have an empty bounding sphere
+    GPUObjectData* objectBuffer = GPUObjectBuffer.map();
 
-    GPUIndirectBuffer.filledSize++;
+    for (const Handle<RenderMesh>& meshHandle : uploadedMeshes)
+    {
+      std::vector<Handle<RenderObject>> pendingObjects = std::move(meshReferences[meshHandle.get()].pendingObjects);
+
+      for (const Handle<RenderObject>& objectHandle : pendingObjects)
+      {
+        const RenderObject* object = renderObjects.find(objectHandle);
+
+        // Objects deleted or moved to another mesh since they were queued
+        if (object == nullptr || !(object->meshHandle == meshHandle)) { continue; }
+
+        objectBuffer[object->ID].boundingSphere = renderMeshes[meshHandle].boundingSphere;
+        GPUObjectBuffer.markDirty(object->ID);
+      }
+    }
+
+    GPUObjectBuffer.unmap();
 
-    for (int i = 0; i < objectBatches.size(); i++)
+    // The draw commands copy the indices count and the levels of detail of the meshes
+    batchBuilder.markDrawBatchesDirty();
+  }
+
+  void Renderer::releaseMeshes()
+  {
+    for (const Handle<RenderMesh>& meshHandle : releasedMeshes)
     {
-      ObjectBatch* renderBatch = &objectBatches[i];
+      // Meshes acquired again after being released, or already freed by a previous entry
+      if (!renderMeshes.contains(meshHandle) || meshReferences[meshHandle.get()].count > 0) { continue; }
 
-      bool bSameMesh = renderBatch->meshHandle == backDrawBatch->meshHandle;
-      bool bSameShader = renderBatch->shaderHandle == backDrawBatch->shaderHandle;
+      const RenderMesh& renderMesh = renderMeshes[meshHandle];
 
-      if (bSameMesh && bSameShader)
+      // Meshes released before their upload started have no ranges
+      if (meshReferences[meshHandle.get()].resident)
       {
-        backDrawBatch->instanceCount++;
+        GPUVertexBuffer.remove(renderMesh.baseVertex);
+        GPUIndexBuffer.remove(renderMesh.firstIndex);
+        meshReferences[meshHandle.get()].resident = false;
+
+        if (renderMesh.meshletsCount > 0)
+        {
+          GPUMeshletBuffer.remove(renderMesh.firstMeshlet);
+        }
       }
-      else
-      {
-        DrawBatch newDrawBatch;
-        newDrawBatch.prevInstanceCount = i;
-        newDrawBatch.instanceCount = 1;
-        newDrawBatch.meshHandle = renderBatch->meshHandle;
-        newDrawBatch.shaderHandle = renderBatch->shaderHandle;
 
-        drawBatches.push_back(newDrawBatch);
-        backDrawBatch = &drawBatches.back();
+      meshMap.erase(meshReferences[meshHandle.get()].mesh);
+      meshReferences[meshHandle.get()].mesh.reset();
 
-        GPUIndirectBuffer.filledSize++;
-      }
+      renderMeshes.erase(meshHandle);
     }
 
-    //std::cout << "Draw batches " << std::endl;
-    //printDrawBatches(drawBatches);
+    releasedMeshes.clear();
   }
 
-  void Renderer::buildShaderBatches()
+  void Renderer::compactGeometry()
   {
-    shaderBatches.clear();
+    if (GPUVertexBuffer.getHolesSize() == 0 && GPUIndexBuffer.getHolesSize() == 0) { return; }
 
-    if (drawBatches.size() == 0) { return; }
+    vertexMoves.clear();
+    indexMoves.clear();
 
-    ShaderBatch newShaderBatch;
-    newShaderBatch.first = 0;
-    newShaderBatch.count = 0;
-    newShaderBatch.shaderHandle = drawBatches[0].shaderHandle;
+    GPUVertexBuffer.compact(GeometryCompactionBudgetBytes, vertexMoves);
+    GPUIndexBuffer.compact(GeometryCompactionBudgetBytes, indexMoves);
 
-    shaderBatches.push_back(newShaderBatch);
-    ShaderBatch* backShaderBatch = &shaderBatches.back();
+    if (vertexMoves.empty() && indexMoves.empty()) { return; }
 
-    for (int i = 0; i < drawBatches.size(); i++)
-    {
-      DrawBatch* drawBatch = &drawBatches[i];
+    // Every range starts a mesh, so the meshes are found by their old offsets
+    std::unordered_map<uint32_t, uint32_t> vertexOffsets;
+    std::unordered_map<uint32_t, uint32_t> indexOffsets;
 
-      bool bSameShader = drawBatch->shaderHandle == backShaderBatch->shaderHandle;
+    for (const VertexBuffer<GPUVertex>::Move& move : vertexMoves) { vertexOffsets[move.from] = move.to; }
+    for (const IndexBuffer::Move& move : indexMoves) { indexOffsets[move.from] = move.to; }
 
-      if (bSameShader)
-      {
-        backShaderBatch->count++;
-      }
-      else
-      {
-        ShaderBatch newShaderBatch;
-        newShaderBatch.first = i;
-        newShaderBatch.count = 1;
-        newShaderBatch.shaderHandle = drawBatch->shaderHandle;
+    for (RenderMesh& renderMesh : renderMeshes)
+    {
+      auto vertexOffset = vertexOffsets.find(renderMesh.baseVertex);
+      auto indexOffset = indexOffsets.find(renderMesh.firstIndex);
 
-        shaderBatches.push_back(newShaderBatch);
-        backShaderBatch = &shaderBatches.back();
-      }
+      if (vertexOffset != vertexOffsets.end()) { renderMesh.baseVertex = vertexOffset->second; }
+      if (indexOffset != indexOffsets.end()) { renderMesh.firstIndex = indexOffset->second; }
     }
 
-    // std::cout << "Shader batches " << std::endl;
-    // printShaderBatches(shaderBatches);
+    // The draw commands copy the mesh offsets
+    batchBuilder.markDrawBatchesDirty();
+  }
+
+  void Renderer::shrinkGeometryBuffers()
+  {
+    GPUVertexBuffer.shrinkToFit();
+    GPUIndexBuffer.shrinkToFit();
   }
 
   void Renderer::refreshBuffers()
@@ -522,35 +962,108 @@ namespace Lotus {
     refreshIndirectBuffer();
     refreshLightBuffer();
     refreshObjectBuffer();
-    refreshObjectHandleBuffer();
+    refreshInstanceBuffer();
     refreshMaterialBuffer();
+
+    batchBuilder.clearDirtyRanges();
   }
 
   void Renderer::refreshIndirectBuffer()
   {
-    if (!drawBatches.empty())
+    // The CPU culled counts change every frame, so then every command is written
+    BatchRange dirtyRange = batchBuilder.getDirtyDrawRange();
+
+    if (CPUCulling)
+    {
+      dirtyRange = { 0, static_cast<uint32_t>(batchBuilder.getDrawBatches().size()) };
+    }
+
+    if (dirtyRange.empty())
+    {
+      return;
+    }
+
+    DrawElementsIndirectCommand* indirectBuffer = GPUIndirectBuffer.map();
+
+    if (CPUCulling)
     {
-      DrawElementsIndirectCommand* indirectBuffer = GPUIndirectBuffer.map();
+      batchBuilder.writeIndirectCommands(renderMeshes, indirectBuffer, dirtyRange);
 
-      for (int i = 0; i < drawBatches.size(); i++)
+      for (uint32_t i = dirtyRange.first; i < dirtyRange.end(); i++)
       {
-        auto drawBatch = drawBatches[i];
+        indirectBuffer[i].instanceCount = culler.getVisibleCounts()[i];
+      }
+
+      GPUIndirectBuffer.unmap(dirtyRange.first, dirtyRange.count);
+    }
+    else
+    {
+      batchBuilder.writeLODIndirectCommands(renderMeshes, indirectBuffer, dirtyRange);
 
-        const RenderMesh& mesh = renderMeshes[drawBatch.meshHandle.get()];
+      // The culling pass counts the visible instances of each level
+      uint32_t firstCommand = dirtyRange.first * MaxMeshLODs;
+      uint32_t commandsCount = dirtyRange.count * MaxMeshLODs;
 
-        indirectBuffer[i].count = mesh.count;
-        indirectBuffer[i].instanceCount = drawBatch.instanceCount;
-        indirectBuffer[i].firstIndex = mesh.firstIndex;
-        indirectBuffer[i].baseVertex = mesh.baseVertex;
-        indirectBuffer[i].baseInstance = drawBatch.prevInstanceCount;
+      for (uint32_t i = firstCommand; i < firstCommand + commandsCount; i++)
+      {
+        indirectBuffer[i].instanceCount = 0;
       }
 
-      GPUIndirectBuffer.unmap();
+      GPUIndirectBuffer.unmap(firstCommand, commandsCount);
+
+      refreshClusterBuffers();
     }
 
     // std::cout << GPUIndirectBuffer << std::endl;
   }
 
+  void Renderer::refreshClusterBuffers()
+  {
+    size_t drawBatchesCount = batchBuilder.getDrawBatches().size();
+
+    // The culling pass reads the batch of every instance, so the batches without clusters are written too
+    GPUClusterBatchBuffer.filledSize = drawBatchesCount;
+
+    // Rewritten whole, the command range of a draw batch moves with the instances of the ones before it
+    uint32_t clusterCommandsCount = batchBuilder.writeClusterBatches(
+        renderMeshes,
+        GPUClusterBatchBuffer.map(),
+        clusterDraws,
+        clusterCulling ? MaxClusterCommands : 0,
+        MaxClusterInstances);
+
+    GPUClusterBatchBuffer.unmap(0, drawBatchesCount);
+
+    clusterInstancesCount = 0;
+
+    for (const ClusterDraw& clusterDraw : clusterDraws)
+    {
+      clusterInstancesCount += batchBuilder.getDrawBatches()[clusterDraw.drawBatch].instanceCount;
+    }
+
+    // The GPU written buffers only need space, the dispatch size takes the first four elements of the instances
+    size_t clusterInstanceElements = 4 + clusterInstancesCount * sizeof(GPUInstance) / sizeof(uint32_t);
+
+    if (GPUClusterInstanceBuffer.allocatedSize < clusterInstanceElements)
+    {
+      GPUClusterInstanceBuffer.reallocate(clusterInstanceElements);
+    }
+
+    if (GPUClusterCommandBuffer.allocatedSize < clusterCommandsCount)
+    {
+      GPUClusterCommandBuffer.reallocate(clusterCommandsCount);
+    }
+
+    if (GPUClusterCountBuffer.allocatedSize < clusterDraws.size())
+    {
+      GPUClusterCountBuffer.reallocate(clusterDraws.size());
+    }
+
+    GPUClusterInstanceBuffer.filledSize = clusterInstanceElements;
+    GPUClusterCommandBuffer.filledSize = clusterCommandsCount;
+    GPUClusterCountBuffer.filledSize = clusterDraws.size();
+  }
+
   void Renderer::refreshLightBuffer()
   {
     GPULightsData lightsData;
@@ -594,10 +1107,16 @@ namespace Lotus {
     
     for (const Handle<RenderObject>& objectHandle : dirtyObjectsHandles)
     {
-      const RenderObject& object = renderObjects[objectHandle.get()];
+      const RenderObject* object = renderObjects.find(objectHandle);
+
+      if (object == nullptr) { continue; }
+
+      writeObjectModel(object->model, objectBuffer[object->ID]);
+      objectBuffer[object->ID].materialHandle = renderMaterials[object->materialHandle].ID;
+      objectBuffer[object->ID].meshHandle = object->meshHandle.get();
+      objectBuffer[object->ID].boundingSphere = renderMeshes[object->meshHandle].boundingSphere;
 
-      objectBuffer[object.ID].model = object.model;
-      objectBuffer[object.ID].materialHandle = object.materialHandle.get();
+      GPUObjectBuffer.markDirty(object->ID);
     }
 
     GPUObjectBuffer.unmap();
@@ -605,76 +1124,107 @@ namespace Lotus {
     dirtyObjectsHandles.clear();
   }
 
-  void Renderer::refreshObjectHandleBuffer()
+  void Renderer::refreshInstanceBuffer()
   {
-    if (drawBatches.empty())
+    GPUInstanceBuffer.filledSize = batchBuilder.getObjectBatches().size();
+
+    BatchRange dirtyRange = batchBuilder.getDirtyInstanceRange();
+
+    if (dirtyRange.empty())
     {
       return;
     }
 
-    uint32_t* objectHandleBuffer = GPUObjectHandleBuffer.map();
+    GPUInstance* instanceBuffer = GPUInstanceBuffer.map();
 
-    int index = 0;
-    for (int dI = 0; dI < drawBatches.size(); dI++)
-    {
-      auto drawBatch = drawBatches[dI];
+    batchBuilder.writeInstances(renderObjects, instanceBuffer, dirtyRange);
 
-      for (int iI = 0; iI < drawBatch.instanceCount; iI++)
-      {
-        objectHandleBuffer[index] = renderObjects[objectBatches[drawBatch.prevInstanceCount + iI].objectHandle.get()].ID;
-        index++;
-      }
-    }
-
-    GPUObjectHandleBuffer.unmap();
+    GPUInstanceBuffer.unmap(dirtyRange.first, dirtyRange.count);
   }
   
   void Renderer::refreshMaterialBuffer()
   {
-    if (dirtyMaterialsHandles.empty())
+    if (dirtyMaterials.empty())
     {
       return;
     }
 
     GPUMaterialData* materialBuffer = GPUMaterialBuffer.map();
 
-    for (const Handle<RenderMaterial>& materialHandle : dirtyMaterialsHandles)
+    for (const std::shared_ptr<Material>& material : dirtyMaterials)
     {
-      const RenderMaterial& renderMaterial = renderMaterials[materialHandle.get()];
+      const RenderMaterial& renderMaterial = renderMaterials[materialMap.at(material)];
 
-      const std::shared_ptr<Material>& material = materials[materialHandle.get()];
+      materialBuffer[renderMaterial.ID] = material->getMaterialData();
 
-      materialBuffer[renderMaterial.ID] = materials[materialHandle.get()]->getMaterialData();
+      GPUMaterialBuffer.markDirty(renderMaterial.ID);
     }
 
     GPUMaterialBuffer.unmap();
 
-    dirtyMaterialsHandles.clear();
+    dirtyMaterials.clear();
   }
 
-  void Renderer::refreshInstancesBuffer()
+  void Renderer::collectUploadCounters()
   {
-		if (0 < objectBatches.size())
-		{
-			// reallocateBuffer(CPU_GPUInstanceBuffer, renderBatches.size() * sizeof(GPUInstance));
-		}
+    uploadedBytes = GPUVertexBuffer.getUploadedBytes() + GPUIndexBuffer.getUploadedBytes() +
+      GPUIndirectBuffer.getUploadedBytes() + GPUObjectBuffer.getUploadedBytes() +
+      GPUInstanceBuffer.getUploadedBytes() + GPUMaterialBuffer.getUploadedBytes() +
+      GPUMeshBoundsBuffer.getUploadedBytes() + GPUMeshletBuffer.getUploadedBytes() +
+      GPUClusterBatchBuffer.getUploadedBytes();
+
+    GPUVertexBuffer.resetUploadCounters();
+    GPUIndexBuffer.resetUploadCounters();
+    GPUIndirectBuffer.resetUploadCounters();
+    GPUObjectBuffer.resetUploadCounters();
+    GPUInstanceBuffer.resetUploadCounters();
+    GPUMaterialBuffer.resetUploadCounters();
+    GPUMeshBoundsBuffer.resetUploadCounters();
+    GPUMeshletBuffer.resetUploadCounters();
+    GPUClusterBatchBuffer.resetUploadCounters();
+  }
+
+  void Renderer::resizeSceneFramebuffer(uint32_t width, uint32_t height)
+  {
+    if (sceneFramebufferID != 0 && width == sceneFramebufferWidth && height == sceneFramebufferHeight) { return; }
+
+    deleteSceneFramebuffer();
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &sceneColorTextureID);
+    glTextureStorage2D(sceneColorTextureID, 1, GL_RGBA8, width, height);
 
-    if (objectBatches.size() > 0)
+    // The depth is read by the depth pyramid, so it is a texture instead of a renderbuffer
+    glCreateTextures(GL_TEXTURE_2D, 1, &sceneDepthTextureID);
+    glTextureStorage2D(sceneDepthTextureID, 1, GL_DEPTH_COMPONENT32F, width, height);
+    glTextureParameteri(sceneDepthTextureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(sceneDepthTextureID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    glCreateFramebuffers(1, &sceneFramebufferID);
+    glNamedFramebufferTexture(sceneFramebufferID, GL_COLOR_ATTACHMENT0, sceneColorTextureID, 0);
+    glNamedFramebufferTexture(sceneFramebufferID, GL_DEPTH_ATTACHMENT, sceneDepthTextureID, 0);
+
+    if (glCheckNamedFramebufferStatus(sceneFramebufferID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
     {
-      GPUInstance* data = nullptr; // TODO
+      LOTUS_LOG_ERROR("[Renderer Error] Scene framebuffer with ID {0} is incomplete", sceneFramebufferID);
+    }
 
-      int dataIndex = 0;
-      for (int dI = 0; dI < drawBatches.size(); dI++)
-      {
-        auto drawBatch = drawBatches[dI];
+    sceneFramebufferWidth = width;
+    sceneFramebufferHeight = height;
 
-        for (int iI = 0; iI < drawBatch.instanceCount; iI++)
-        {
-          data[dataIndex].objectID = 0; //(&objects[renderBatches[drawBatch.prevInstancesCount + iI].objectHandle.get()])->objectHandle.get();
-          data[dataIndex].drawBatchID = dI;
-          dataIndex++;
-        }
-      }
+    depthPyramid.resize(width, height);
+  }
+
+  void Renderer::deleteSceneFramebuffer()
+  {
+    if (sceneFramebufferID)
+    {
+      glDeleteFramebuffers(1, &sceneFramebufferID);
+      glDeleteTextures(1, &sceneColorTextureID);
+      glDeleteTextures(1, &sceneDepthTextureID);
+
+      sceneFramebufferID = 0;
+      sceneColorTextureID = 0;
+      sceneDepthTextureID = 0;
     }
   }
 
@@ -686,21 +1236,25 @@ namespace Lotus {
 
     if (it == meshMap.end())
     {
-      const std::vector<Vertex>& vertices = mesh->getVertices();
-      const std::vector<unsigned int>& indices = mesh->getIndices();
-
-      uint32_t verticesBufferLocation = GPUVertexBuffer.add(vertices.data(), vertices.size()); 
-      uint32_t indicesBufferLocation = GPUIndexBuffer.add(indices.data(), indices.size());
-
+      // Empty until uploadMeshes writes its geometry, so its draws have no indices
       RenderMesh renderMesh;
-      renderMesh.firstIndex = indicesBufferLocation;
-      renderMesh.baseVertex = verticesBufferLocation;
-      renderMesh.count = indices.size();
+      renderMesh.firstIndex = 0;
+      renderMesh.baseVertex = 0;
+      renderMesh.count = 0;
+
+      handle = renderMeshes.insert(renderMesh);
 
-      handle.set(static_cast<uint32_t>(renderMeshes.size()));
-      renderMeshes.push_back(renderMesh);
+      writeMeshBounds(handle, MeshBounds());
 
       meshMap[mesh] = handle;
+
+      if (handle.get() >= meshReferences.size())
+      {
+        meshReferences.resize(handle.get() + 1);
+      }
+
+      meshReferences[handle.get()] = { mesh, 0, false };
+      meshUploads.push_back({ handle });
     }
     else
     {
@@ -710,6 +1264,52 @@ namespace Lotus {
     return handle;
   }
 
+  void Renderer::writeMeshBounds(Handle<RenderMesh> meshHandle, const MeshBounds& bounds, std::span<const MeshLOD> lods)
+  {
+    GPUMeshBounds GPUBounds;
+    GPUBounds.minimum = glm::vec4(bounds.minimum, 0.0f);
+    GPUBounds.maximum = glm::vec4(bounds.maximum, 0.0f);
+    GPUBounds.boundingSphere = bounds.sphere;
+
+    // The missing levels can't be selected, the full detail one always can
+    GPUBounds.lodErrors = glm::vec4(std::numeric_limits<float>::max());
+    GPUBounds.lodErrors[0] = 0.0f;
+
+    for (size_t i = 1; i < std::min<size_t>(lods.size(), MaxMeshLODs); i++)
+    {
+      GPUBounds.lodErrors[static_cast<int>(i)] = lods[i].error;
+    }
+
+    // Handles of freed meshes are reused, so the buffer only grows past the highest handle index
+    if (meshHandle.get() >= GPUMeshBoundsBuffer.filledSize)
+    {
+      GPUMeshBoundsBuffer.filledSize = meshHandle.get() + 1;
+    }
+
+    GPUMeshBoundsBuffer.map()[meshHandle.get()] = GPUBounds;
+    GPUMeshBoundsBuffer.markDirty(meshHandle.get());
+    GPUMeshBoundsBuffer.unmap();
+  }
+
+  Handle<RenderMesh> Renderer::acquireMesh(std::shared_ptr<Mesh> mesh)
+  {
+    Handle<RenderMesh> handle = getMeshHandle(mesh);
+
+    meshReferences[handle.get()].count++;
+
+    return handle;
+  }
+
+  void Renderer::releaseMesh(Handle<RenderMesh> meshHandle)
+  {
+    LOTUS_ASSERT(meshReferences[meshHandle.get()].count > 0, "[Renderer Error] Released a mesh without references");
+
+    if (--meshReferences[meshHandle.get()].count == 0)
+    {
+      releasedMeshes.push_back(meshHandle);
+    }
+  }
+
   Handle<RenderMaterial> Renderer::getMaterialHandle(std::shared_ptr<Material> material)
   {
     Handle<RenderMaterial> handle;
@@ -718,8 +1318,6 @@ namespace Lotus {
 
     if (it == materialMap.end())
     {
-      materials.push_back(material);
-
       GPUMaterialData GPUMaterial = material->getMaterialData();
       
       uint32_t materialID = GPUMaterialBuffer.add(&GPUMaterial);
@@ -727,8 +1325,7 @@ namespace Lotus {
       RenderMaterial renderMaterial;
       renderMaterial.ID = materialID;
       
-      handle.set(static_cast<uint32_t>(renderMaterials.size()));
-      renderMaterials.push_back(renderMaterial);
+      handle = renderMaterials.insert(renderMaterial);
       
       materialMap[material] = handle;
     }
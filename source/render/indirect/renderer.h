@@ -5,6 +5,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <span>
 #include <array>
 #include <vector>
 #include <unordered_map>
@@ -15,13 +16,19 @@
 #include "../../scene/camera.h"
 #include "../../lighting/directional_light.h"
 #include "../../lighting/point_light.h"
+#include "../../util/slot_map.h"
 #include "../gpu_buffer.h"
 #include "mesh.h"
 #include "../shader.h"
 #include "material.h"
 #include "unlit_flat_material.h"
 #include "diffuse_flat_material.h"
+#include "instance_storage.h"
 #include "mesh_instance.h"
+#include "batch_builder.h"
+#include "depth_pyramid.h"
+#include "cpu_culling.h"
+#include "../../core/job_system.h"
 
 
 namespace Lotus
@@ -40,12 +47,62 @@ namespace Lotus
     static constexpr unsigned int ObjectBufferBindingPoint = 0;
     static constexpr unsigned int ObjectHandleBufferBindingPoint = 1;
     static constexpr unsigned int MaterialBufferBindingPoint = 2;
+    static constexpr unsigned int InstanceBufferBindingPoint = 3;
+    static constexpr unsigned int DrawCommandBufferBindingPoint = 4;
+    static constexpr unsigned int MeshBoundsBufferBindingPoint = 5;
+    static constexpr unsigned int VisibilityBufferBindingPoint = 6;
+    static constexpr unsigned int MeshletBufferBindingPoint = 7;
+    static constexpr unsigned int ClusterBatchBufferBindingPoint = 8;
+    static constexpr unsigned int ClusterInstanceBufferBindingPoint = 9;
+    static constexpr unsigned int ClusterCommandBufferBindingPoint = 10;
+    static constexpr unsigned int ClusterCountBufferBindingPoint = 11;
+
+    // Culling shader uniforms, the planes take one location each
+    static constexpr unsigned int FrustumPlanesLocation = 0;
+    static constexpr unsigned int InstancesCountLocation = 6;
+    static constexpr unsigned int CullingEnabledLocation = 7;
+    static constexpr unsigned int CullingPhaseLocation = 8;
+    static constexpr unsigned int CullingViewMatrixLocation = 9;
+    static constexpr unsigned int CullingProjectionMatrixLocation = 13;
+    static constexpr unsigned int CullingLODTargetLocation = 17;
+    static constexpr unsigned int CullingWorkgroupSize = 256;
+    static constexpr unsigned int ClusterCullingWorkgroupSize = 64;
+    static constexpr unsigned int DepthPyramidTextureUnit = 0;
+
+    /*
+      Passes of the culling shader. With occlusion culling, the early phase draws the objects visible in the
+      last frame, and the late phase tests every object against their depth pyramid and draws the ones that
+      became visible
+    */
+    enum class CullingPhase : uint32_t
+    {
+      All,
+      Early,
+      Late
+    };
 
     static constexpr unsigned int VertexBufferInitialAllocationSize = 1 << 16; 
     static constexpr unsigned int IndexBufferInitialAllocationSize = 1 << 16;
     static constexpr unsigned int IndirectBufferInitialAllocationSize = 1 << 10;
     static constexpr unsigned int ObjectBufferInitialAllocationSize = 1 << 10;
     static constexpr unsigned int MaterialBufferInitialAllocationSize = 1 << 8;
+    static constexpr unsigned int MeshBoundsBufferInitialAllocationSize = 1 << 8;
+    static constexpr unsigned int MeshletBufferInitialAllocationSize = 1 << 12;
+
+    // Meshes with fewer meshlets are drawn whole, culling their clusters would cost more than it saves
+    static constexpr size_t ClusterCullingMinMeshlets = 16;
+    // The cluster commands have room for every meshlet of every instance, the draw batches past it are drawn whole
+    static constexpr uint32_t MaxClusterCommands = 1 << 20;
+    // Workgroups of the cluster pass, the smallest dispatch size limit OpenGL allows
+    static constexpr uint32_t MaxClusterInstances = 65535;
+
+    // Dirty model matrices composed by each job
+    static constexpr size_t ModelMatricesGrainSize = 4096;
+
+    // Geometry bytes moved per frame, per buffer, to close the holes left by released meshes
+    static constexpr size_t GeometryCompactionBudgetBytes = 1 << 20;
+    // Geometry bytes of new meshes uploaded per frame, larger meshes take several frames
+    static constexpr size_t MeshUploadBudgetBytes = 8 << 20;
 
     Renderer();
     ~Renderer();
@@ -55,6 +112,13 @@ namespace Lotus
     std::shared_ptr<MeshInstance> createMeshInstance(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
     void deleteMeshInstance(std::shared_ptr<MeshInstance> meshInstance);
 
+    // Data oriented instances, bulk updates can write the storage arrays directly
+    InstanceID createInstance(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
+    void deleteInstance(InstanceID instanceID);
+    void setInstanceMesh(InstanceID instanceID, std::shared_ptr<Mesh> mesh);
+    void setInstanceMaterial(InstanceID instanceID, std::shared_ptr<Material> material);
+    InstanceStorage& getInstanceStorage() noexcept { return instances; }
+
     std::shared_ptr<Material> createMaterial(MaterialType type);
 
     void setAmbientLight(glm::vec3 color);
@@ -63,6 +127,32 @@ namespace Lotus
 
     void render(const Camera& camera);
 
+    // Without frustum culling every instance is drawn, the culling pass still builds the draw commands
+    void setFrustumCulling(bool enabled) { frustumCulling = enabled; }
+    bool isFrustumCulling() const { return frustumCulling; }
+
+    // Draws the scene in two phases to skip the objects hidden behind the ones visible in the last frame
+    void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+    bool isOcclusionCulling() const { return occlusionCulling; }
+
+    /*
+      Screen size in pixels of the simplification error allowed by the level of detail selection, objects use
+      the coarsest level of their mesh that stays under it. Zero draws every mesh at full detail
+    */
+    void setLODThreshold(float pixels) { lodThreshold = pixels; }
+    float getLODThreshold() const { return lodThreshold; }
+
+    /*
+      Splits the meshes with enough meshlets in clusters, culled in a second pass against the frustum and with
+      their normal cones, so clusters facing away from the camera aren't drawn. Their triangles are single sided
+    */
+    void setClusterCulling(bool enabled);
+    bool isClusterCulling() const { return clusterCulling; }
+
+    // Culls on worker threads instead of the culling pass, for drivers without compute shaders. It has no occlusion culling, LOD selection nor cluster culling
+    void setCPUCulling(bool enabled);
+    bool isCPUCulling() const { return CPUCulling; }
+
     // Update Functions
     void update();
     void updateObjects();
@@ -70,25 +160,51 @@ namespace Lotus
 
     // Batches Functions
     void buildBatches();
-    void buildObjectBatches();
-    void buildDrawBatches();
-    void buildShaderBatches();
+
+    // Culling Functions
+    void cullObjects(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix, CullingPhase phase = CullingPhase::All);
+    // Must run before refreshBuffers, the indirect commands take the visible counts
+    void cullObjectsOnCPU(const glm::mat4& viewProjection);
+
+    // Draw Functions
+    void drawBatches(const glm::mat4& viewMatrix, const glm::mat4& projectionMatrix);
+
+    // Geometry Functions
+    // Uploads the ready meshes within the frame budget, the instances of a mesh draw nothing until it is uploaded
+    void uploadMeshes();
+    void releaseMeshes();
+    void compactGeometry();
+    // Returns the free space at the end of the geometry buffers to the driver
+    void shrinkGeometryBuffers();
 
     // Buffers Functions
     void refreshBuffers();
     void refreshIndirectBuffer();
+    void refreshClusterBuffers();
     void refreshLightBuffer();
     void refreshObjectBuffer();
-    void refreshObjectHandleBuffer();
+    void refreshInstanceBuffer();
     void refreshMaterialBuffer();
 
-    void refreshInstancesBuffer(); // TODO
+    // Bytes written to the GPU buffers during the last frame
+    size_t getUploadedBytes() const noexcept { return uploadedBytes; }
 
   private:
 
 
+    // Runs after the culling pass, over the instances it left to the clusters
+    void cullClusters(const Frustum& frustum, const glm::mat4& viewMatrix, size_t instancesCount);
+
     // Util Functions
+    void collectUploadCounters();
+    void resizeSceneFramebuffer(uint32_t width, uint32_t height);
+    void deleteSceneFramebuffer();
     Handle<RenderMesh> getMeshHandle(std::shared_ptr<Mesh> mesh);
+    void writeMeshBounds(Handle<RenderMesh> meshHandle, const MeshBounds& bounds, std::span<const MeshLOD> lods = {});
+    // The culling pass has a command per level of detail of each draw batch, the CPU culling one per draw batch
+    uint32_t getCommandsPerDrawBatch() const { return CPUCulling ? 1 : MaxMeshLODs; }
+    Handle<RenderMesh> acquireMesh(std::shared_ptr<Mesh> mesh);
+    void releaseMesh(Handle<RenderMesh> meshHandle);
     Handle<RenderMaterial> getMaterialHandle(std::shared_ptr<Material> material);
 
     struct GPULightsData
@@ -102,6 +218,8 @@ namespace Lotus
 
     // Shaders
     std::array<ShaderProgram, static_cast<unsigned int>(MaterialType::MaterialTypeCount)> shaders;
+    ShaderProgram cullingShader;
+    ShaderProgram clusterCullingShader;
 
     // Maps
 	  std::unordered_map<std::shared_ptr<Mesh>, Handle<RenderMesh>> meshMap;
@@ -114,39 +232,107 @@ namespace Lotus
     std::vector<std::shared_ptr<PointLight>> pointLights;
 
     // Objects
+    InstanceStorage instances;
     std::vector<std::shared_ptr<MeshInstance>> meshInstances;
-    std::vector<RenderObject> renderObjects;
+    SlotMap<RenderObject> renderObjects;
     std::vector<Handle<RenderObject>> dirtyObjectsHandles;
-    std::vector<RenderObject> toUnbatchObjects;
+    // Instances with dirty transforms and their new model matrices, kept to reuse their memory
+    std::vector<uint32_t> dirtyTransformsIndices;
+    std::vector<glm::mat4> dirtyModelMatrices;
     std::vector<Handle<RenderObject>> unbatchedObjectsHandles;
     
     // Materials
-    std::vector<std::shared_ptr<Material>> materials;
-    std::vector<RenderMaterial> renderMaterials;
-    std::vector<Handle<RenderMaterial>> dirtyMaterialsHandles;
+    SlotMap<RenderMaterial> renderMaterials;
+    std::vector<std::shared_ptr<Material>> dirtyMaterials;
 
     // Meshes
-    std::vector<RenderMesh> renderMeshes;
+    struct MeshReferences
+    {
+      std::shared_ptr<Mesh> mesh;
+      uint32_t count = 0;
+      // True once its geometry ranges are reserved in the buffers
+      bool resident = false;
+      // True once its geometry and bounds are written, the objects created before take its bounding sphere then
+      bool uploaded = false;
+      // Objects that got the mesh before its upload finished, may hold stale handles
+      std::vector<Handle<RenderObject>> pendingObjects;
+    };
+
+    // Geometry of a mesh written so far, the ranges are reserved when the upload starts
+    struct MeshUpload
+    {
+      Handle<RenderMesh> meshHandle;
+      uint32_t uploadedVertices = 0;
+      uint32_t uploadedIndices = 0;
+    };
+
+    SlotMap<RenderMesh> renderMeshes;
+    // Instances using each mesh, indexed by the handle index
+    std::vector<MeshReferences> meshReferences;
+    // Meshes without instances, their geometry is freed once the batches stop drawing them
+    std::vector<Handle<RenderMesh>> releasedMeshes;
+    // Meshes waiting to be loaded or uploaded, in request order
+    std::vector<MeshUpload> meshUploads;
+    // Ranges moved by the last compaction step
+    std::vector<VertexBuffer<GPUVertex>::Move> vertexMoves;
+    std::vector<IndexBuffer::Move> indexMoves;
 
     // Batches
-    std::vector<ObjectBatch> objectBatches;
-    std::vector<DrawBatch> drawBatches;
-    std::vector<ShaderBatch> shaderBatches;
+    BatchBuilder batchBuilder;
 
     // Buffers
     uint32_t vertexArrayID;
 
-    VertexBuffer GPUVertexBuffer;
+    VertexBuffer<GPUVertex> GPUVertexBuffer;
     IndexBuffer GPUIndexBuffer;
 
-    DrawIndirectBuffer GPUIndirectBuffer;
-    ShaderStorageBuffer<GPUObjectData> GPUObjectBuffer;
-    ShaderStorageBuffer<uint32_t> GPUObjectHandleBuffer;
+    // Buffers rewritten every frame avoid implicit synchronization with persistent rings
+    DrawIndirectBuffer<GPUBufferPolicy::PersistentRing> GPUIndirectBuffer;
+    ShaderStorageBuffer<GPUObjectData, GPUBufferPolicy::PersistentRing> GPUObjectBuffer;
+    ShaderStorageBuffer<GPUInstance, GPUBufferPolicy::PersistentRing> GPUInstanceBuffer;
     ShaderStorageBuffer<GPUMaterialData> GPUMaterialBuffer;
+    // Indexed by the mesh handles, the GPU passes find the size of a mesh without going through its objects
+    ShaderStorageBuffer<GPUMeshBounds> GPUMeshBoundsBuffer;
+
+    // Written by the culling pass, the draws read them instead of the CPU written commands
+    DrawIndirectBuffer<GPUBufferPolicy::Mapped> GPUDrawCommandBuffer;
+    ShaderStorageBuffer<uint32_t, GPUBufferPolicy::Mapped> GPUObjectHandleBuffer;
+    // Indexed by the object IDs, only the late culling phase writes it
+    ShaderStorageBuffer<uint32_t, GPUBufferPolicy::Mapped> GPUVisibilityBuffer;
+
+    // Meshlets of the meshes drawn by clusters, a range per mesh
+    NonUniformGPUBuffer<GPUMeshlet> GPUMeshletBuffer;
+    // Indexed by the draw batches, the ones drawn by clusters have a range of the cluster commands
+    ShaderStorageBuffer<GPUClusterBatch> GPUClusterBatchBuffer;
+    // Written by the passes, the instances left to the cluster pass after its dispatch size, its commands and their counts
+    ShaderStorageBuffer<uint32_t, GPUBufferPolicy::Mapped> GPUClusterInstanceBuffer;
+    DrawIndirectBuffer<GPUBufferPolicy::Mapped> GPUClusterCommandBuffer;
+    ShaderStorageBuffer<uint32_t, GPUBufferPolicy::Mapped> GPUClusterCountBuffer;
+
+    // Draw batches drawn by clusters, in draw batch order
+    std::vector<ClusterDraw> clusterDraws;
+    uint32_t clusterInstancesCount;
+
+    // Occlusion culling draws to its own framebuffer, so the depth can be read to build the pyramid
+    uint32_t sceneFramebufferID;
+    uint32_t sceneColorTextureID;
+    uint32_t sceneDepthTextureID;
+    uint32_t sceneFramebufferWidth;
+    uint32_t sceneFramebufferHeight;
+    DepthPyramid depthPyramid;
+
+    CPUCuller culler;
+
+    bool frustumCulling;
+    bool occlusionCulling;
+    bool CPUCulling;
+    bool clusterCulling;
+
+    float lodThreshold;
+    // Computed from the threshold and the viewport at the start of the frame
+    float lodTarget;
 
-    // TODO
-    GPUInstance* CPU_GPUInstanceBuffer;
-    size_t CPU_GPUInstanceBufferSize;
+    size_t uploadedBytes;
 
     // Terrains
     ShaderProgram terrainShader;
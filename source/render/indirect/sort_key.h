@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Lotus
+{
+  /*
+    Bit layout of the 64 bit keys used to order the object batches, from the most to the least
+    significant bits the fields are: shader | mesh | material | depth bucket. A field with zero
+    bits is ignored, and values wider than their field are truncated, which only makes the
+    batches less compact because draw batches are split by the real mesh and shader handles
+  */
+  struct SortKeyLayout
+  {
+    uint32_t shaderBits = 8;
+    uint32_t meshBits = 24;
+    uint32_t materialBits = 0;
+    uint32_t depthBits = 0;
+
+    uint32_t getTotalBits() const { return shaderBits + meshBits + materialBits + depthBits; }
+
+    bool isValid() const { return getTotalBits() <= 64; }
+
+    uint64_t pack(uint32_t shader, uint32_t mesh, uint32_t material, uint32_t depthBucket) const
+    {
+      uint64_t key = 0;
+
+      key = append(key, shader, shaderBits);
+      key = append(key, mesh, meshBits);
+      key = append(key, material, materialBits);
+      key = append(key, depthBucket, depthBits);
+
+      return key;
+    }
+
+    uint32_t getShader(uint64_t key) const { return extract(key, materialBits + depthBits + meshBits, shaderBits); }
+    uint32_t getMesh(uint64_t key) const { return extract(key, materialBits + depthBits, meshBits); }
+    uint32_t getMaterial(uint64_t key) const { return extract(key, depthBits, materialBits); }
+    uint32_t getDepthBucket(uint64_t key) const { return extract(key, 0, depthBits); }
+
+  private:
+    static uint64_t mask(uint32_t bits)
+    {
+      return bits >= 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    }
+
+    static uint64_t append(uint64_t key, uint32_t value, uint32_t bits)
+    {
+      if (bits == 0) { return key; }
+
+      return (bits >= 64 ? 0 : key << bits) | (uint64_t(value) & mask(bits));
+    }
+
+    static uint32_t extract(uint64_t key, uint32_t shift, uint32_t bits)
+    {
+      if (bits == 0 || shift >= 64) { return 0; }
+
+      return static_cast<uint32_t>((key >> shift) & mask(bits));
+    }
+  };
+}
@@ -6,6 +6,8 @@
 #include <array>
 #include <glad/glad.h>
 #include "../util/log.h"
+#include "../math/gpu_primitives.h"
+#include "../math/render_primitives.h"
 // #include "renderer.h"
 
 namespace Lotus
@@ -135,12 +137,14 @@ namespace Lotus
       std::string value;
     };
 
-    std::array<ShaderConstant, 3> shaderConstants = 
+    std::array<ShaderConstant, 5> shaderConstants = 
     {
       {
       {"${MAX_DIRECTIONAL_LIGHTS}", std::to_string(2)}, //Renderer::HalfMaxDirectionalLights * 2)},
       {"${MAX_POINT_LIGHTS}", std::to_string(2)}, //Renderer::HalfMaxPointLights * 2)},
       {"${MAX_SPOT_LIGHTS}", std::to_string(2)}, //Renderer::HalfMaxSpotLights * 2)}
+      {"${PACKED_VERTICES}", std::to_string(LOTUS_PACKED_VERTICES)},
+      {"${MAX_MESH_LODS}", std::to_string(MaxMeshLODs)}
       }
     };
     
@@ -201,6 +205,15 @@ namespace Lotus
     linkProgram(vertexShader, fragmentShader);
   }
 
+  ShaderProgram::ShaderProgram(const std::filesystem::path& computeShaderPath) noexcept
+  {
+    programID = 0;
+
+    Shader computeShader(computeShaderPath, ShaderType::Compute);
+
+    linkProgram(computeShader);
+  }
+
   ShaderProgram::ShaderProgram(ShaderProgram&& program) noexcept
   {
     programID = program.programID;
@@ -269,6 +282,39 @@ namespace Lotus
     programID = program;
   }
 
+  void ShaderProgram::linkProgram(const Shader& computeShader)
+  {
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, computeShader.getID());
+    glLinkProgram(program);
+
+    // Error handling
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+    if (linked == GL_FALSE)
+    {
+      GLint length = 0;
+      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+
+      char* message = new char[length];
+      glGetProgramInfoLog(program, length, &length, message);
+
+      glDeleteProgram(program);
+      glDeleteShader(computeShader.getID());
+
+      std::string messageString = message;
+      delete[] message;
+
+      LOTUS_LOG_ERROR("[Shader Error] Failed to link compute shader");
+      LOTUS_LOG_ERROR("[Shader Error] Compute shader file at {0}", computeShader.getPath().string());
+      LOTUS_LOG_ERROR("[Shader Error] GLSL error message\n\n{0}", messageString);
+      LOTUS_ASSERT(false, "Exiting");
+    }
+    
+    programID = program;
+  }
+
   void ShaderProgram::bind()
   {
     glUseProgram(programID);
@@ -49,6 +49,7 @@ namespace Lotus
     
     ShaderProgram(const Shader& vertexShader, const Shader& fragmentShader);
     ShaderProgram(const std::filesystem::path& vertexShaderPath, const std::filesystem::path& fragmentShaderPath) noexcept;
+    explicit ShaderProgram(const std::filesystem::path& computeShaderPath) noexcept;
     ShaderProgram() : programID(0) {}
     ShaderProgram(const ShaderProgram& program) = delete;
     ShaderProgram(ShaderProgram&& program) noexcept;
@@ -63,6 +64,7 @@ namespace Lotus
 
   private:
     void linkProgram(const Shader& vertexShader, const Shader& fragmentShader);
+    void linkProgram(const Shader& computeShader);
     
     uint32_t programID;
   };
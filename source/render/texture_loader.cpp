@@ -1,13 +1,36 @@
 #include "texture_loader.h"
 
 #include <cstring>
+#include <algorithm>
 #include <stb_image.h>
 #include "../util/log.h"
+#include "../core/job_system.h"
 
 namespace Lotus
 {
 
-  GPUTexture* loadImageTexture(
+  /*
+    Pixels of an image file, decoding doesn't touch OpenGL so it can run on any thread
+  */
+  struct DecodedImage
+  {
+    stbi_uc* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+  };
+
+  DecodedImage decodeImage(const std::string& filePath)
+  {
+    DecodedImage image;
+    image.data = stbi_load(filePath.c_str(), &image.width, &image.height, &image.channels, 0);
+
+    return image;
+  }
+
+  // Uploads the decoded image to a new texture and frees its pixels, it must run on the context thread
+  GPUTexture* createImageTexture(
+      DecodedImage& image,
       const std::string& filePath,
       TextureMagnificationFilter magFilter,
       TextureMinificationFilter minFilter,
@@ -15,30 +38,27 @@ namespace Lotus
       TextureWrapMode tWrapMode,
       bool genMipmaps)
   {
-    int stbWidth, stbHeight, stbChannels;
-    stbi_uc* data = stbi_load(filePath.c_str(), &stbWidth, &stbHeight, &stbChannels, 0);
-
-    if (!data)
+    if (!image.data)
     {
       LOTUS_LOG_ERROR("[Texture Error] Image without data at path {0}", filePath);
       LOTUS_ASSERT(false, "Exiting");
-      stbi_image_free(data);
+      stbi_image_free(image.data);
     }
 
     TextureConfig textureConfig;
-    textureConfig.data = data;
-    textureConfig.width = stbWidth;
-    textureConfig.height = stbHeight;
+    textureConfig.data = image.data;
+    textureConfig.width = image.width;
+    textureConfig.height = image.height;
 
-    if (stbChannels == 1)
+    if (image.channels == 1)
     {
       textureConfig.format = TextureFormat::RUnsigned;
     }
-    else if (stbChannels == 4)
+    else if (image.channels == 4)
     {
       textureConfig.format = TextureFormat::RGBAUnsigned;
     }
-    else if (stbChannels == 3)
+    else if (image.channels == 3)
     {
       textureConfig.format = TextureFormat::RGBUnsigned;
     }
@@ -55,11 +75,25 @@ namespace Lotus
     
     GPUTexture* gpuTexture = new GPUTexture(textureConfig);
 
-    stbi_image_free(data);
+    stbi_image_free(image.data);
+    image.data = nullptr;
     
     return gpuTexture;
   }
 
+  GPUTexture* loadImageTexture(
+      const std::string& filePath,
+      TextureMagnificationFilter magFilter,
+      TextureMinificationFilter minFilter,
+      TextureWrapMode sWrapMode,
+      TextureWrapMode tWrapMode,
+      bool genMipmaps)
+  {
+    DecodedImage image = decodeImage(filePath);
+
+    return createImageTexture(image, filePath, magFilter, minFilter, sWrapMode, tWrapMode, genMipmaps);
+  }
+
   std::shared_ptr<GPUTexture> TextureLoader::loadTexture(
       const std::filesystem::path& filePath,
       TextureMagnificationFilter magFilter,
@@ -87,4 +121,53 @@ namespace Lotus
     return textureSharedPtr;
   }
 
+  std::vector<std::shared_ptr<GPUTexture>> TextureLoader::loadTextures(
+      const std::vector<std::filesystem::path>& filePaths,
+      TextureMagnificationFilter magFilter,
+      TextureMinificationFilter minFilter,
+      TextureWrapMode sWrapMode,
+      TextureWrapMode tWrapMode,
+      bool genMipmaps) noexcept
+  {
+    // Paths without a loaded texture, each one decoded once even if it is repeated
+    std::vector<std::string> toLoadPaths;
+
+    for (const std::filesystem::path& filePath : filePaths)
+    {
+      std::string stringPath = filePath.string();
+
+      if (!textureMap.contains(stringPath) && std::find(toLoadPaths.begin(), toLoadPaths.end(), stringPath) == toLoadPaths.end())
+      {
+        toLoadPaths.push_back(std::move(stringPath));
+      }
+    }
+
+    std::vector<DecodedImage> images(toLoadPaths.size());
+
+    JobSystem::getInstance().parallelFor(toLoadPaths.size(), 1, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; i++)
+      {
+        images[i] = decodeImage(toLoadPaths[i]);
+      }
+    });
+
+    // The textures are created on the calling thread, the one with the context
+    for (size_t i = 0; i < toLoadPaths.size(); i++)
+    {
+      GPUTexture* texture = createImageTexture(images[i], toLoadPaths[i], magFilter, minFilter, sWrapMode, tWrapMode, genMipmaps);
+      textureMap.insert({ toLoadPaths[i], std::shared_ptr<GPUTexture>(texture) });
+    }
+
+    std::vector<std::shared_ptr<GPUTexture>> textures;
+    textures.reserve(filePaths.size());
+
+    for (const std::filesystem::path& filePath : filePaths)
+    {
+      textures.push_back(textureMap[filePath.string()]);
+    }
+
+    return textures;
+  }
+
 }
\ No newline at end of file
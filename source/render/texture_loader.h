@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <unordered_map>
 #include <filesystem>
 #include "../math/noise.h"
@@ -31,6 +32,15 @@ namespace Lotus
         TextureWrapMode tWrapMode = TextureWrapMode::Repeat,
         bool genMipmaps = false) noexcept;
 
+    // Decodes the images on the engine job system and creates their textures on the calling thread
+    std::vector<std::shared_ptr<GPUTexture>> loadTextures(
+        const std::vector<std::filesystem::path>& filePaths,
+        TextureMagnificationFilter magFilter = TextureMagnificationFilter::Linear,
+        TextureMinificationFilter minFilter = TextureMinificationFilter::LinearMipmapLinear,
+        TextureWrapMode sWrapMode = TextureWrapMode::Repeat,
+        TextureWrapMode tWrapMode = TextureWrapMode::Repeat,
+        bool genMipmaps = false) noexcept;
+
     std::shared_ptr<GPUTexture> generatePerlinTexture(int width, int height);
 
   private:
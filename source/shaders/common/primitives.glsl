@@ -1,5 +1,53 @@
 struct Object
 {
   mat4 model;
+  mat3 normalMatrix;
   uint materialHandle;
+  uint materialHandleHigh;
+  uint meshHandle;
+  vec4 boundingSphere;
+};
+
+struct MeshBounds
+{
+  vec4 minimum;
+  vec4 maximum;
+  vec4 boundingSphere;
+  vec4 lodErrors;
+};
+
+struct DrawCommand
+{
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  uint baseVertex;
+  uint baseInstance;
+  uint padding0;
+  uint padding1;
+  uint padding2;
+};
+
+struct Instance
+{
+  uint objectID;
+  uint drawBatchID;
+};
+
+struct Meshlet
+{
+  vec4 boundingSphere;
+  vec4 cone;
+  uint firstIndex;
+  uint count;
+  uint padding0;
+  uint padding1;
+};
+
+struct ClusterBatch
+{
+  uint firstMeshlet;
+  uint meshletsCount;
+  uint firstCommand;
+  uint countIndex;
 };
\ No newline at end of file
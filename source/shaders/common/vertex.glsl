@@ -0,0 +1,71 @@
+// Inputs of the renderer vertex buffer, in the Vertex layout or in the PackedVertex one
+#define PACKED_VERTICES ${PACKED_VERTICES}
+
+// Shader storage buffer with the meshes bounds, packed positions are relative to their box
+layout(std430, binding = 5) readonly buffer MeshesBounds
+{
+	MeshBounds[] meshBounds;
+};
+
+#if PACKED_VERTICES
+
+layout(location = 0) in vec4 packedPosition; // Unorm in the mesh box, w is the bitangent sign
+layout(location = 1) in vec2 packedNormal;   // Snorm octahedral
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in vec2 packedTangent;  // Snorm octahedral
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 direction = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+	if (direction.z < 0.0)
+	{
+		vec2 signNotZero = vec2(direction.x >= 0.0 ? 1.0 : -1.0, direction.y >= 0.0 ? 1.0 : -1.0);
+		direction.xy = (1.0 - abs(direction.yx)) * signNotZero;
+	}
+
+	return normalize(direction);
+}
+
+vec3 vertexPosition(uint meshHandle)
+{
+	MeshBounds bounds = meshBounds[meshHandle];
+
+	return mix(bounds.minimum.xyz, bounds.maximum.xyz, packedPosition.xyz);
+}
+
+vec3 vertexNormal()
+{
+	return decodeOctahedral(packedNormal);
+}
+
+// Tangent and bitangent sign, the bitangent is cross(normal, tangent.xyz) * tangent.w
+vec4 vertexTangent()
+{
+	return vec4(decodeOctahedral(packedTangent), packedPosition.w * 2.0 - 1.0);
+}
+
+#else
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec2 texCoord;
+layout(location = 3) in vec3 tangent;
+layout(location = 4) in vec3 bitangent;
+
+vec3 vertexPosition(uint meshHandle)
+{
+	return position;
+}
+
+vec3 vertexNormal()
+{
+	return normal;
+}
+
+vec4 vertexTangent()
+{
+	return vec4(tangent, dot(cross(normal, tangent), bitangent) >= 0.0 ? 1.0 : -1.0);
+}
+
+#endif
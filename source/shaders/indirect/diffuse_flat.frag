@@ -17,12 +17,6 @@ struct Material
 	int int_3;
 };
 
-// Shader storage buffer with the objects
-layout(std140, binding = 0) readonly buffer Objects
-{
-	Object[] objects;
-};
-
 // Shader storage buffer with the materials
 layout(std140, binding = 2) readonly buffer Materials
 {
@@ -40,7 +34,7 @@ layout(std140, binding = 0) uniform Lights
 };
 
 // Inputs
-flat in uint fragObjectID;
+flat in uint fragMaterialID;
 in vec3 fragPosition;
 in vec3 fragNormal;
 
@@ -49,8 +43,7 @@ out vec4 outColor;
 
 void main()
 {
-	Object object = objects[fragObjectID];
-	Material material = materials[object.materialHandle];
+	Material material = materials[fragMaterialID];
 
 	vec3 ambient = ambientLight;
 
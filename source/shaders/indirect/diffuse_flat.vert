@@ -18,11 +18,10 @@ layout(location = 0) uniform mat4 view;
 layout(location = 1) uniform mat4 projection;
 
 // Inputs
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 normal;
+#include ../common/vertex.glsl
 
 // Outputs
-flat out uint fragObjectID;
+flat out uint fragMaterialID;
 out vec3 fragPosition;
 out vec3 fragNormal;
 
@@ -31,10 +30,12 @@ void main()
 	uint objectID = objectHandles[gl_BaseInstance + gl_InstanceID];
 
   Object object = objects[objectID];
+  vec3 meshPosition = vertexPosition(object.meshHandle);
 
-	fragObjectID = objectID;
-	fragPosition = vec3(object.model * vec4(position, 1.0));
-	fragNormal = mat3(transpose(inverse(object.model))) * normal;
+	// The fragment stage reads the material straight from the index, without the object
+	fragMaterialID = object.materialHandle;
+	fragPosition = vec3(object.model * vec4(meshPosition, 1.0));
+	fragNormal = object.normalMatrix * vertexNormal();
 	
-	gl_Position = projection * view * object.model * vec4(position, 1.0);
+	gl_Position = projection * view * object.model * vec4(meshPosition, 1.0);
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 // Enable bindless textures
 #extension GL_ARB_bindless_texture : require
 
+#include ../common/lighting.glsl
+
 struct Material
 {
 	vec3 diffuseTextureTint;
@@ -40,7 +42,7 @@ layout(std140, binding = 0) uniform Lights
 };
 
 // Inputs
-flat in uint fragObjectID;
+flat in uint fragMaterialID;
 in vec3 fragPosition;
 in vec3 fragNormal;
 in vec2 fragTexCoord;
@@ -50,8 +52,7 @@ out vec4 outColor;
 
 void main()
 {
-	Object object = objects[fragObjectID];
-	Material material = materials[object.materialHandle];
+	Material material = materials[fragMaterialID];
 
 	vec3 ambient = ambientLight;
 
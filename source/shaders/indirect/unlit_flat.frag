@@ -14,12 +14,6 @@ struct Material
 	int int_3;
 };
 
-// Shader storage buffer with the objects
-layout(std140, binding = 0) readonly buffer Objects
-{
-	Object[] objects;
-};
-
 // Shader storage buffer with the materials
 layout(std140, binding = 2) readonly buffer Materials
 {
@@ -27,15 +21,14 @@ layout(std140, binding = 2) readonly buffer Materials
 };
 
 // Inputs
-flat in uint fragObjectID;
+flat in uint fragMaterialID;
 
 // Outputs
 out vec4 outColor;
 
 void main()
 {
-	Object object = objects[fragObjectID];
-	Material material = materials[object.materialHandle];
+	Material material = materials[fragMaterialID];
 
 	outColor = vec4(material.unlitColor, 1.0);
 }
\ No newline at end of file
@@ -9,12 +9,14 @@ namespace Lotus
       uint16_t generatorDataPerChunkSide,
       uint16_t generatorChunksPerSide,
       const PerlinNoiseConfig& generatorNoiseConfig,
-      const Vec2i& generatorDataOrigin) : 
+      const Vec2i& generatorDataOrigin,
+      JobSystem& generatorJobSystem) : 
     dataPerChunkSide(generatorDataPerChunkSide),
     chunksPerSide(generatorChunksPerSide),
     dataOrigin(generatorDataOrigin),
     chunksOrigin({ 0 , 0 }),
-    noiseConfig(generatorNoiseConfig)
+    noiseConfig(generatorNoiseConfig),
+    jobSystem(&generatorJobSystem)
   {
     chunksData.reserve(chunksPerSide * chunksPerSide);
 
@@ -24,13 +26,13 @@ namespace Lotus
       chunksData.push_back(chunkData);
     }
 
-    for (int x = 0; x < chunksPerSide; x++)
+    jobSystem->parallelFor(chunksPerSide * chunksPerSide, 1, [this](size_t first, size_t last)
     {
-      for (int y = 0; y < chunksPerSide; y++)
+      for (size_t chunk = first; chunk < last; chunk++)
       {
-        generateChunkData(x, y);
+        generateChunkData(static_cast<int>(chunk % chunksPerSide), static_cast<int>(chunk / chunksPerSide));
       }
-    }
+    });
   }
 
   ProceduralDataGenerator::~ProceduralDataGenerator()
@@ -56,10 +58,13 @@ namespace Lotus
     dataOrigin.y -= dataPerChunkSide;
     chunksOrigin.y = (chunksOrigin.y + chunksPerSide - 1) % chunksPerSide;
     
-    for (int x = 0; x < chunksPerSide; x++)
+    jobSystem->parallelFor(chunksPerSide, 1, [this](size_t first, size_t last)
     {
-      generateChunkData(x, getChunksTop());
-    }
+      for (size_t x = first; x < last; x++)
+      {
+        generateChunkData(static_cast<int>(x), getChunksTop());
+      }
+    });
 
     LOTUS_LOG_INFO("[Procedural Data Generator Log] Updated top chunks");
   }
@@ -69,10 +74,13 @@ namespace Lotus
     dataOrigin.x += dataPerChunkSide;
     chunksOrigin.x = (chunksOrigin.x + 1) % chunksPerSide;
 
-    for (int y = 0; y < chunksPerSide; y++)
+    jobSystem->parallelFor(chunksPerSide, 1, [this](size_t first, size_t last)
     {
-      generateChunkData(getChunksRight(), y);
-    }
+      for (size_t y = first; y < last; y++)
+      {
+        generateChunkData(getChunksRight(), static_cast<int>(y));
+      }
+    });
 
     LOTUS_LOG_INFO("[Procedural Data Generator Log] Updated right chunks");
   }
@@ -82,10 +90,13 @@ namespace Lotus
     dataOrigin.y += dataPerChunkSide;
     chunksOrigin.y = (chunksOrigin.y + 1) % chunksPerSide;
 
-    for (int x = 0; x < chunksPerSide; x++)
+    jobSystem->parallelFor(chunksPerSide, 1, [this](size_t first, size_t last)
     {
-      generateChunkData(x, getChunksBottom());
-    }
+      for (size_t x = first; x < last; x++)
+      {
+        generateChunkData(static_cast<int>(x), getChunksBottom());
+      }
+    });
 
     LOTUS_LOG_INFO("[Procedural Data Generator Log] Updated bottom chunks");
   }
@@ -95,10 +106,13 @@ namespace Lotus
     dataOrigin.x -= dataPerChunkSide;
     chunksOrigin.x = (chunksOrigin.x + chunksPerSide - 1) % chunksPerSide;
     
-    for (int y = 0; y < chunksPerSide; y++)
+    jobSystem->parallelFor(chunksPerSide, 1, [this](size_t first, size_t last)
     {
-      generateChunkData(getChunksLeft(), y);
-    }
+      for (size_t y = first; y < last; y++)
+      {
+        generateChunkData(getChunksLeft(), static_cast<int>(y));
+      }
+    });
 
     LOTUS_LOG_INFO("[Procedural Data Generator Log] Updated left chunks");
   }
@@ -116,9 +130,11 @@ namespace Lotus
     
     float* chunkData = chunksData[y * chunksPerSide + x];
 
-    noiseConfig.offset = offset;
+    // Each chunk has its own copy of the config, the shared one is read by the other chunks
+    PerlinNoiseConfig chunkNoiseConfig = noiseConfig;
+    chunkNoiseConfig.offset = offset;
 
-    Perlin2DArray::fill(chunkData, dataPerChunkSide, dataPerChunkSide, noiseConfig);
+    Perlin2DArray::fill(chunkData, dataPerChunkSide, dataPerChunkSide, chunkNoiseConfig);
   }
 
 }
\ No newline at end of file
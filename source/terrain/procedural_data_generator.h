@@ -4,6 +4,7 @@
 #include <vector>
 #include "../math/linear_algebra.h"
 #include "../math/noise.h"
+#include "../core/job_system.h"
 
 namespace Lotus
 {
@@ -16,7 +17,8 @@ namespace Lotus
         uint16_t dataPerChunkSide,
         uint16_t chunksPerSide,
         const PerlinNoiseConfig& noiseConfig,
-        const Vec2i& dataOrigin = { 0, 0 });
+        const Vec2i& dataOrigin = { 0, 0 },
+        JobSystem& jobSystem = JobSystem::getInstance());
     ~ProceduralDataGenerator();
 
     uint16_t getDataPerChunkSide() const { return dataPerChunkSide; }
@@ -42,6 +44,7 @@ namespace Lotus
   private:
 
     void generateChunkData(const Vec2i& chunk);
+    // Chunks write their own data, so several of them can be generated at the same time
     void generateChunkData(int x, int y);
 
     uint16_t dataPerChunkSide;
@@ -52,6 +55,8 @@ namespace Lotus
 
     PerlinNoiseConfig noiseConfig;
 
+    JobSystem* jobSystem;
+
     std::vector<float*> chunksData;
   };
 
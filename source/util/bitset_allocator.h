@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cassert>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace Lotus
+{
+  /*
+    Set of free slots that always hands out the lowest one. The slots are bits of 64 bit words, and each
+    summary level keeps a bit per word of the level below that has any free slot, up to a single word. Finding
+    the lowest free slot descends the levels with countr_zero, and no memory is allocated per slot
+  */
+  class BitsetAllocator
+  {
+  public:
+    static constexpr uint32_t InvalidSlot = std::numeric_limits<uint32_t>::max();
+
+    BitsetAllocator() : freeCount(0)
+    {
+      resize(WordBits);
+    }
+
+    // Returns the lowest free slot and marks it as used, or InvalidSlot if no slot is free
+    uint32_t acquire()
+    {
+      if (freeCount == 0) { return InvalidSlot; }
+
+      uint32_t word = 0;
+
+      for (size_t level = levels.size() - 1; level > 0; level--)
+      {
+        word = word * WordBits + std::countr_zero(levels[level][word]);
+      }
+
+      uint32_t slot = word * WordBits + std::countr_zero(levels[0][word]);
+
+      clearBit(slot);
+
+      return slot;
+    }
+
+    // Marks the slot as free, the set grows to contain it
+    void release(uint32_t slot)
+    {
+      if (slot >= capacity)
+      {
+        size_t newCapacity = capacity;
+
+        while (slot >= newCapacity) { newCapacity *= 2; }
+
+        resize(newCapacity);
+      }
+
+      if (isFree(slot)) { return; }
+
+      setBit(slot);
+    }
+
+    bool isFree(uint32_t slot) const
+    {
+      return slot < capacity && (levels[0][slot / WordBits] >> (slot % WordBits)) & 1;
+    }
+
+    size_t getFreeCount() const { return freeCount; }
+    bool empty() const { return freeCount == 0; }
+
+    void clear()
+    {
+      for (std::vector<uint64_t>& level : levels)
+      {
+        std::fill(level.begin(), level.end(), 0);
+      }
+
+      freeCount = 0;
+    }
+
+  private:
+    static constexpr uint32_t WordBits = 64;
+
+    void setBit(uint32_t slot)
+    {
+      freeCount++;
+
+      // A word becoming non empty sets its bit in the level above
+      for (std::vector<uint64_t>& level : levels)
+      {
+        uint64_t& word = level[slot / WordBits];
+        bool wasEmpty = word == 0;
+
+        word |= uint64_t(1) << (slot % WordBits);
+
+        if (!wasEmpty) { break; }
+
+        slot /= WordBits;
+      }
+    }
+
+    void clearBit(uint32_t slot)
+    {
+      assert(isFree(slot) && "BitsetAllocator Error: Acquired a slot that isn't free");
+
+      freeCount--;
+
+      // A word becoming empty clears its bit in the level above
+      for (std::vector<uint64_t>& level : levels)
+      {
+        uint64_t& word = level[slot / WordBits];
+
+        word &= ~(uint64_t(1) << (slot % WordBits));
+
+        if (word != 0) { break; }
+
+        slot /= WordBits;
+      }
+    }
+
+    void resize(size_t newCapacity)
+    {
+      std::vector<uint64_t> leaves = levels.empty() ? std::vector<uint64_t>() : std::move(levels[0]);
+      leaves.resize((newCapacity + WordBits - 1) / WordBits, 0);
+
+      levels.clear();
+      levels.push_back(std::move(leaves));
+
+      // The summaries are rebuilt from the leaves, growth doubles the capacity so this is amortized
+      while (levels.back().size() > 1)
+      {
+        const std::vector<uint64_t>& below = levels.back();
+        std::vector<uint64_t> summary((below.size() + WordBits - 1) / WordBits, 0);
+
+        for (size_t word = 0; word < below.size(); word++)
+        {
+          if (below[word] != 0)
+          {
+            summary[word / WordBits] |= uint64_t(1) << (word % WordBits);
+          }
+        }
+
+        levels.push_back(std::move(summary));
+      }
+
+      capacity = newCapacity;
+    }
+
+    // levels[0] has a bit per slot, the last level has a single word
+    std::vector<std::vector<uint64_t>> levels;
+    size_t capacity;
+    size_t freeCount;
+  };
+}
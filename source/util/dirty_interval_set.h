@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+
+namespace Lotus
+{
+  /*
+    Ranges of elements [first, end) written since the last clear. Ranges separated by at most mergeGap
+    clean elements are coalesced, trading a few redundant elements for fewer uploads
+  */
+  class DirtyIntervalSet
+  {
+  public:
+    struct Interval
+    {
+      size_t first;
+      size_t end;
+
+      size_t size() const { return end - first; }
+    };
+
+    explicit DirtyIntervalSet(size_t initialMergeGap = 0) :
+      mergeGap(initialMergeGap),
+      normalized(true)
+    {}
+
+    void setMergeGap(size_t newMergeGap)
+    {
+      mergeGap = newMergeGap;
+      normalized = intervals.size() <= 1;
+    }
+
+    size_t getMergeGap() const { return mergeGap; }
+
+    void add(size_t first, size_t end)
+    {
+      if (first >= end) { return; }
+
+      // Sequential writes grow the last interval, so the common case never sorts
+      if (!intervals.empty())
+      {
+        Interval& last = intervals.back();
+
+        if (first <= last.end + mergeGap && end + mergeGap >= last.first)
+        {
+          if (first < last.first) { normalized = false; }
+
+          last.first = std::min(last.first, first);
+          last.end = std::max(last.end, end);
+          return;
+        }
+
+        if (first < last.first) { normalized = false; }
+      }
+
+      intervals.push_back({ first, end });
+    }
+
+    // Sorted and coalesced intervals
+    const std::vector<Interval>& getIntervals()
+    {
+      normalize();
+      return intervals;
+    }
+
+    // Elements covered by the intervals, including the merged gaps
+    size_t getDirtySize()
+    {
+      normalize();
+
+      size_t dirtySize = 0;
+
+      for (const Interval& interval : intervals)
+      {
+        dirtySize += interval.size();
+      }
+
+      return dirtySize;
+    }
+
+    bool empty() const { return intervals.empty(); }
+
+    void clear()
+    {
+      intervals.clear();
+      normalized = true;
+    }
+
+  private:
+    void normalize()
+    {
+      if (normalized) { return; }
+
+      std::sort(intervals.begin(), intervals.end(), [](const Interval& a, const Interval& b) { return a.first < b.first; });
+
+      size_t merged = 0;
+
+      for (size_t i = 1; i < intervals.size(); i++)
+      {
+        if (intervals[i].first <= intervals[merged].end + mergeGap)
+        {
+          intervals[merged].end = std::max(intervals[merged].end, intervals[i].end);
+        }
+        else
+        {
+          intervals[++merged] = intervals[i];
+        }
+      }
+
+      intervals.resize(merged + 1);
+      normalized = true;
+    }
+
+    std::vector<Interval> intervals;
+    size_t mergeGap;
+    // Sorted with every gap larger than mergeGap
+    bool normalized;
+  };
+}
@@ -0,0 +1,143 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Lotus
+{
+
+  MappedFile::~MappedFile()
+  {
+    close();
+  }
+
+  MappedFile::MappedFile(MappedFile&& other) noexcept
+  {
+    *this = std::move(other);
+  }
+
+  MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+  {
+    if (this != &other)
+    {
+      close();
+
+      data = std::exchange(other.data, nullptr);
+      size = std::exchange(other.size, 0);
+
+#ifdef _WIN32
+      fileHandle = std::exchange(other.fileHandle, nullptr);
+      mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+
+    return *this;
+  }
+
+#ifdef _WIN32
+
+  bool MappedFile::open(const std::filesystem::path& path)
+  {
+    close();
+
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+      CloseHandle(file);
+      return false;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (mapping == nullptr)
+    {
+      CloseHandle(file);
+      return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (view == nullptr)
+    {
+      CloseHandle(mapping);
+      CloseHandle(file);
+      return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+
+    return true;
+  }
+
+  void MappedFile::close() noexcept
+  {
+    if (data) { UnmapViewOfFile(data); }
+    if (mappingHandle) { CloseHandle(mappingHandle); }
+    if (fileHandle) { CloseHandle(fileHandle); }
+
+    data = nullptr;
+    size = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+  }
+
+#else
+
+  bool MappedFile::open(const std::filesystem::path& path)
+  {
+    close();
+
+    int file = ::open(path.c_str(), O_RDONLY);
+
+    if (file < 0) { return false; }
+
+    struct stat fileStatus;
+
+    if (fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+    {
+      ::close(file);
+      return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+    // The mapping keeps its own reference to the file
+    ::close(file);
+
+    if (view == MAP_FAILED) { return false; }
+
+    data = static_cast<const uint8_t*>(view);
+    size = static_cast<size_t>(fileStatus.st_size);
+
+    return true;
+  }
+
+  void MappedFile::close() noexcept
+  {
+    if (data) { munmap(const_cast<uint8_t*>(data), size); }
+
+    data = nullptr;
+    size = 0;
+  }
+
+#endif
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Lotus
+{
+  /*
+    Read only view of a whole file mapped in memory. The pages are loaded by the system when they are first
+    read, so opening a large file costs about the same as opening a small one
+  */
+  class MappedFile
+  {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file can't be opened or is empty
+    bool open(const std::filesystem::path& path);
+    void close() noexcept;
+
+    bool isOpen() const noexcept { return data != nullptr; }
+
+    const uint8_t* getData() const noexcept { return data; }
+    size_t getSize() const noexcept { return size; }
+
+  private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+  };
+}
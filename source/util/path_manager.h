@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+===================================
+Placeholder script, don't modify it
+===================================
+*/
+
+#include <iostream>
+#include <string>
+#include <filesystem>
+
+namespace Lotus
+{
+  static const std::string directoryPath = "/root/repo/";
+
+  static std::filesystem::path assetPath(const std::string& assetRelativePath)
+  {
+    return directoryPath + "assets/" + assetRelativePath;
+  }
+
+  static std::filesystem::path shaderPath(const std::string& shaderRelativePath)
+  {
+    return directoryPath + "source/shaders/" + shaderRelativePath;
+  }
+
+  static std::filesystem::path testPath(const std::string& relativePath)
+  {
+    return directoryPath + "tests/" + relativePath;
+  }
+}
+
+
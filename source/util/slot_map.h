@@ -0,0 +1,173 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include "../math/render_primitives.h"
+
+namespace Lotus
+{
+  /*
+    Container of elements referenced by generational handles. The elements are kept packed in a dense
+    array, and a sparse array of slots maps the handle indices to them. Erasing an element moves the last
+    one into its place and increases the generation of its slot, so stale handles are detected
+  */
+  template <typename T>
+  class SlotMap
+  {
+  public:
+    static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+    Handle<T> insert(const T& value)
+    {
+      return emplace(value);
+    }
+
+    Handle<T> insert(T&& value)
+    {
+      return emplace(std::move(value));
+    }
+
+    template <typename... Args>
+    Handle<T> emplace(Args&&... args)
+    {
+      uint32_t slotIndex = freeSlotsHead;
+
+      if (slotIndex != InvalidIndex)
+      {
+        freeSlotsHead = slots[slotIndex].denseIndex;
+      }
+      else
+      {
+        slotIndex = static_cast<uint32_t>(slots.size());
+        slots.push_back({ InvalidIndex, 0 });
+      }
+
+      Slot& slot = slots[slotIndex];
+      slot.denseIndex = static_cast<uint32_t>(values.size());
+
+      values.emplace_back(std::forward<Args>(args)...);
+      denseToSlot.push_back(slotIndex);
+
+      return Handle<T>(slotIndex, slot.generation);
+    }
+
+    bool erase(Handle<T> handle)
+    {
+      if (!contains(handle)) { return false; }
+
+      Slot& slot = slots[handle.get()];
+      uint32_t denseIndex = slot.denseIndex;
+      uint32_t lastIndex = static_cast<uint32_t>(values.size() - 1);
+
+      // The last element takes the place of the erased one
+      if (denseIndex != lastIndex)
+      {
+        values[denseIndex] = std::move(values[lastIndex]);
+        denseToSlot[denseIndex] = denseToSlot[lastIndex];
+        slots[denseToSlot[denseIndex]].denseIndex = denseIndex;
+      }
+
+      values.pop_back();
+      denseToSlot.pop_back();
+
+      // Free slots are linked through their dense index
+      slot.generation++;
+      slot.denseIndex = freeSlotsHead;
+      freeSlotsHead = handle.get();
+
+      return true;
+    }
+
+    bool contains(Handle<T> handle) const
+    {
+      if (handle.get() >= slots.size()) { return false; }
+
+      const Slot& slot = slots[handle.get()];
+
+      return slot.generation == handle.getGeneration() && slot.denseIndex < values.size() && denseToSlot[slot.denseIndex] == handle.get();
+    }
+
+    // Returns nullptr if the handle is stale
+    T* find(Handle<T> handle)
+    {
+      return contains(handle) ? &values[slots[handle.get()].denseIndex] : nullptr;
+    }
+
+    const T* find(Handle<T> handle) const
+    {
+      return contains(handle) ? &values[slots[handle.get()].denseIndex] : nullptr;
+    }
+
+    T& operator[](Handle<T> handle)
+    {
+      assert(contains(handle) && "SlotMap Error: Stale or invalid handle");
+      return values[slots[handle.get()].denseIndex];
+    }
+
+    const T& operator[](Handle<T> handle) const
+    {
+      assert(contains(handle) && "SlotMap Error: Stale or invalid handle");
+      return values[slots[handle.get()].denseIndex];
+    }
+
+    // Handle of the element in the position denseIndex of the dense array
+    Handle<T> getHandle(size_t denseIndex) const
+    {
+      uint32_t slotIndex = denseToSlot[denseIndex];
+      return Handle<T>(slotIndex, slots[slotIndex].generation);
+    }
+
+    void reserve(size_t capacity)
+    {
+      values.reserve(capacity);
+      denseToSlot.reserve(capacity);
+      slots.reserve(capacity);
+    }
+
+    void clear()
+    {
+      // Slots are kept, with a new generation, so handles from before the clear stay stale
+      for (uint32_t denseIndex = 0; denseIndex < values.size(); denseIndex++)
+      {
+        uint32_t slotIndex = denseToSlot[denseIndex];
+
+        slots[slotIndex].generation++;
+        slots[slotIndex].denseIndex = freeSlotsHead;
+        freeSlotsHead = slotIndex;
+      }
+
+      values.clear();
+      denseToSlot.clear();
+    }
+
+    size_t size() const { return values.size(); }
+    bool empty() const { return values.empty(); }
+    size_t getSlotsCount() const { return slots.size(); }
+
+    // Dense iteration, in no particular order
+    typename std::vector<T>::iterator begin() { return values.begin(); }
+    typename std::vector<T>::iterator end() { return values.end(); }
+    typename std::vector<T>::const_iterator begin() const { return values.begin(); }
+    typename std::vector<T>::const_iterator end() const { return values.end(); }
+
+    T* data() { return values.data(); }
+    const T* data() const { return values.data(); }
+
+  private:
+    struct Slot
+    {
+      // Position in the dense array, or next free slot when the slot is free
+      uint32_t denseIndex;
+      uint32_t generation;
+    };
+
+    std::vector<Slot> slots;
+    std::vector<T> values;
+    std::vector<uint32_t> denseToSlot;
+    uint32_t freeSlotsHead = InvalidIndex;
+  };
+}
@@ -0,0 +1,435 @@
+#include "tlsf_allocator.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+
+namespace Lotus
+{
+
+  TLSFAllocator::TLSFAllocator(uint32_t initialCapacity)
+  {
+    reset(initialCapacity);
+  }
+
+  uint32_t TLSFAllocator::sizeToBinRoundUp(uint32_t size)
+  {
+    if (size < LeafBinsCount) { return size; }
+
+    uint32_t highestBit = 31 - std::countl_zero(size);
+    uint32_t mantissaStart = highestBit - MantissaBits;
+    uint32_t exponent = mantissaStart + 1;
+    uint32_t mantissa = (size >> mantissaStart) & (LeafBinsCount - 1);
+
+    // A carry from the mantissa moves to the next exponent, which is still the right bin
+    if ((size & ((1u << mantissaStart) - 1)) != 0) { mantissa++; }
+
+    return (exponent << MantissaBits) + mantissa;
+  }
+
+  uint32_t TLSFAllocator::sizeToBinRoundDown(uint32_t size)
+  {
+    if (size < LeafBinsCount) { return size; }
+
+    uint32_t highestBit = 31 - std::countl_zero(size);
+    uint32_t mantissaStart = highestBit - MantissaBits;
+    uint32_t exponent = mantissaStart + 1;
+    uint32_t mantissa = (size >> mantissaStart) & (LeafBinsCount - 1);
+
+    return (exponent << MantissaBits) | mantissa;
+  }
+
+  uint32_t TLSFAllocator::binToSize(uint32_t bin)
+  {
+    uint32_t exponent = bin >> MantissaBits;
+    uint32_t mantissa = bin & (LeafBinsCount - 1);
+
+    if (exponent == 0) { return mantissa; }
+
+    return (mantissa | LeafBinsCount) << (exponent - 1);
+  }
+
+  TLSFAllocator::Allocation TLSFAllocator::allocate(uint32_t size)
+  {
+    assert(size > 0 && "TLSFAllocator Error: Allocations must have a size");
+
+    // Every block in the bins from the rounded up size fits the request
+    uint32_t node = InvalidNode;
+    uint32_t bin = findFreeBin(sizeToBinRoundUp(size));
+
+    if (bin != InvalidNode)
+    {
+      node = binHeads[bin];
+    }
+    else
+    {
+      // Only some blocks of the size's own bin fit it, they are checked before failing so the space isn't grown in vain
+      for (uint32_t candidate = binHeads[sizeToBinRoundDown(size)]; candidate != InvalidNode; candidate = nodes[candidate].binNext)
+      {
+        if (nodes[candidate].size >= size)
+        {
+          node = candidate;
+          break;
+        }
+      }
+
+      if (node == InvalidNode) { return Allocation(); }
+    }
+
+    removeFreeNode(node);
+
+    Node& allocated = nodes[node];
+    uint32_t remainder = allocated.size - size;
+
+    allocated.used = true;
+    allocated.size = size;
+
+    // The rest of the block stays free, right after the allocation
+    if (remainder > 0)
+    {
+      uint32_t remainderNode = createNode(nodes[node].offset + size, remainder, node, nodes[node].neighborNext);
+
+      if (nodes[remainderNode].neighborNext != InvalidNode)
+      {
+        nodes[nodes[remainderNode].neighborNext].neighborPrevious = remainderNode;
+      }
+      else
+      {
+        lastNode = remainderNode;
+      }
+
+      nodes[node].neighborNext = remainderNode;
+      insertFreeNode(remainderNode);
+    }
+
+    usedSize += size;
+    allocationsCount++;
+
+    return { nodes[node].offset, node };
+  }
+
+  void TLSFAllocator::free(Allocation allocation)
+  {
+    free(allocation.node);
+  }
+
+  void TLSFAllocator::free(uint32_t node)
+  {
+    assert(node < nodes.size() && nodes[node].used && "TLSFAllocator Error: Freed a node that isn't allocated");
+
+    Node& freed = nodes[node];
+    freed.used = false;
+
+    usedSize -= freed.size;
+    allocationsCount--;
+
+    // Merge with the free neighbors, the merged node keeps the lowest offset
+    uint32_t previous = freed.neighborPrevious;
+
+    if (previous != InvalidNode && !nodes[previous].used)
+    {
+      removeFreeNode(previous);
+
+      nodes[previous].size += nodes[node].size;
+      nodes[previous].neighborNext = nodes[node].neighborNext;
+
+      if (nodes[node].neighborNext != InvalidNode)
+      {
+        nodes[nodes[node].neighborNext].neighborPrevious = previous;
+      }
+
+      if (lastNode == node) { lastNode = previous; }
+
+      releaseNode(node);
+      node = previous;
+    }
+
+    uint32_t next = nodes[node].neighborNext;
+
+    if (next != InvalidNode && !nodes[next].used)
+    {
+      removeFreeNode(next);
+
+      nodes[node].size += nodes[next].size;
+      nodes[node].neighborNext = nodes[next].neighborNext;
+
+      if (nodes[next].neighborNext != InvalidNode)
+      {
+        nodes[nodes[next].neighborNext].neighborPrevious = node;
+      }
+
+      if (lastNode == next) { lastNode = node; }
+
+      releaseNode(next);
+    }
+
+    insertFreeNode(node);
+  }
+
+  uint32_t TLSFAllocator::slideDown(uint32_t node)
+  {
+    assert(node < nodes.size() && nodes[node].used && "TLSFAllocator Error: Moved a node that isn't allocated");
+
+    uint32_t previous = nodes[node].neighborPrevious;
+
+    if (previous == InvalidNode || nodes[previous].used) { return nodes[node].offset; }
+
+    // The free block and the allocation swap places, the block before the free one is always used
+    removeFreeNode(previous);
+
+    uint32_t before = nodes[previous].neighborPrevious;
+    uint32_t after = nodes[node].neighborNext;
+
+    nodes[node].offset = nodes[previous].offset;
+    nodes[previous].offset = nodes[node].offset + nodes[node].size;
+
+    nodes[node].neighborPrevious = before;
+    nodes[node].neighborNext = previous;
+    nodes[previous].neighborPrevious = node;
+    nodes[previous].neighborNext = after;
+
+    if (before != InvalidNode)
+    {
+      nodes[before].neighborNext = node;
+    }
+
+    if (after != InvalidNode)
+    {
+      nodes[after].neighborPrevious = previous;
+    }
+    else
+    {
+      lastNode = previous;
+    }
+
+    // The free block may now touch the next free one
+    if (after != InvalidNode && !nodes[after].used)
+    {
+      removeFreeNode(after);
+
+      nodes[previous].size += nodes[after].size;
+      nodes[previous].neighborNext = nodes[after].neighborNext;
+
+      if (nodes[after].neighborNext != InvalidNode)
+      {
+        nodes[nodes[after].neighborNext].neighborPrevious = previous;
+      }
+
+      if (lastNode == after) { lastNode = previous; }
+
+      releaseNode(after);
+    }
+
+    insertFreeNode(previous);
+
+    return nodes[node].offset;
+  }
+
+  void TLSFAllocator::grow(uint32_t newCapacity)
+  {
+    if (newCapacity <= capacity) { return; }
+
+    uint32_t addedSize = newCapacity - capacity;
+
+    if (lastNode != InvalidNode && !nodes[lastNode].used)
+    {
+      removeFreeNode(lastNode);
+      nodes[lastNode].size += addedSize;
+      insertFreeNode(lastNode);
+    }
+    else
+    {
+      uint32_t node = createNode(capacity, addedSize, lastNode, InvalidNode);
+
+      if (lastNode != InvalidNode)
+      {
+        nodes[lastNode].neighborNext = node;
+      }
+
+      lastNode = node;
+      insertFreeNode(node);
+    }
+
+    capacity = newCapacity;
+  }
+
+  uint32_t TLSFAllocator::shrink(uint32_t newCapacity)
+  {
+    if (newCapacity >= capacity || lastNode == InvalidNode || nodes[lastNode].used) { return capacity; }
+
+    uint32_t removedSize = std::min(capacity - newCapacity, nodes[lastNode].size);
+
+    removeFreeNode(lastNode);
+
+    nodes[lastNode].size -= removedSize;
+    capacity -= removedSize;
+
+    if (nodes[lastNode].size > 0)
+    {
+      insertFreeNode(lastNode);
+    }
+    else
+    {
+      uint32_t previous = nodes[lastNode].neighborPrevious;
+
+      if (previous != InvalidNode)
+      {
+        nodes[previous].neighborNext = InvalidNode;
+      }
+
+      releaseNode(lastNode);
+      lastNode = previous;
+    }
+
+    return capacity;
+  }
+
+  void TLSFAllocator::reset(uint32_t newCapacity)
+  {
+    nodes.clear();
+    unusedNodes.clear();
+
+    topBinsMask = 0;
+    std::fill(std::begin(leafBinsMasks), std::end(leafBinsMasks), 0);
+    std::fill(std::begin(binHeads), std::end(binHeads), InvalidNode);
+
+    capacity = 0;
+    usedSize = 0;
+    allocationsCount = 0;
+    lastNode = InvalidNode;
+
+    grow(newCapacity);
+  }
+
+  TLSFAllocator::Statistics TLSFAllocator::getStatistics() const
+  {
+    Statistics statistics;
+    statistics.capacity = capacity;
+    statistics.usedSize = usedSize;
+    statistics.freeSize = capacity - usedSize;
+    statistics.allocationsCount = allocationsCount;
+
+    for (uint32_t bin = 0; bin < BinsCount; bin++)
+    {
+      for (uint32_t node = binHeads[bin]; node != InvalidNode; node = nodes[node].binNext)
+      {
+        statistics.freeBlocksCount++;
+        statistics.largestFreeBlock = std::max(statistics.largestFreeBlock, nodes[node].size);
+      }
+    }
+
+    return statistics;
+  }
+
+  uint32_t TLSFAllocator::createNode(uint32_t offset, uint32_t size, uint32_t neighborPrevious, uint32_t neighborNext)
+  {
+    uint32_t node;
+
+    if (!unusedNodes.empty())
+    {
+      node = unusedNodes.back();
+      unusedNodes.pop_back();
+    }
+    else
+    {
+      node = static_cast<uint32_t>(nodes.size());
+      nodes.emplace_back();
+    }
+
+    nodes[node] = Node();
+    nodes[node].offset = offset;
+    nodes[node].size = size;
+    nodes[node].neighborPrevious = neighborPrevious;
+    nodes[node].neighborNext = neighborNext;
+
+    return node;
+  }
+
+  void TLSFAllocator::releaseNode(uint32_t node)
+  {
+    nodes[node] = Node();
+    unusedNodes.push_back(node);
+  }
+
+  void TLSFAllocator::insertFreeNode(uint32_t node)
+  {
+    // Blocks are stored in the bin of their rounded down size, so every block of a bin fits its size
+    uint32_t bin = sizeToBinRoundDown(nodes[node].size);
+    uint32_t topBin = bin >> MantissaBits;
+    uint32_t leafBin = bin & (LeafBinsCount - 1);
+
+    nodes[node].binPrevious = InvalidNode;
+    nodes[node].binNext = binHeads[bin];
+
+    if (binHeads[bin] != InvalidNode)
+    {
+      nodes[binHeads[bin]].binPrevious = node;
+    }
+
+    binHeads[bin] = node;
+
+    topBinsMask |= 1u << topBin;
+    leafBinsMasks[topBin] |= static_cast<uint8_t>(1u << leafBin);
+  }
+
+  void TLSFAllocator::removeFreeNode(uint32_t node)
+  {
+    uint32_t bin = sizeToBinRoundDown(nodes[node].size);
+    uint32_t previous = nodes[node].binPrevious;
+    uint32_t next = nodes[node].binNext;
+
+    if (previous != InvalidNode)
+    {
+      nodes[previous].binNext = next;
+    }
+    else
+    {
+      binHeads[bin] = next;
+    }
+
+    if (next != InvalidNode)
+    {
+      nodes[next].binPrevious = previous;
+    }
+
+    nodes[node].binPrevious = InvalidNode;
+    nodes[node].binNext = InvalidNode;
+
+    if (binHeads[bin] == InvalidNode)
+    {
+      uint32_t topBin = bin >> MantissaBits;
+      uint32_t leafBin = bin & (LeafBinsCount - 1);
+
+      leafBinsMasks[topBin] &= static_cast<uint8_t>(~(1u << leafBin));
+
+      if (leafBinsMasks[topBin] == 0)
+      {
+        topBinsMask &= ~(1u << topBin);
+      }
+    }
+  }
+
+  uint32_t TLSFAllocator::findFreeBin(uint32_t minimumBin) const
+  {
+    if (minimumBin >= BinsCount) { return InvalidNode; }
+
+    uint32_t topBin = minimumBin >> MantissaBits;
+    uint32_t leafBin = minimumBin & (LeafBinsCount - 1);
+
+    // First the bins of the same exponent, then the first larger exponent
+    uint32_t leafMask = leafBinsMasks[topBin] & (~0u << leafBin);
+
+    if (leafMask == 0)
+    {
+      uint32_t topMask = topBin + 1 < TopBinsCount ? topBinsMask & (~0u << (topBin + 1)) : 0;
+
+      if (topMask == 0) { return InvalidNode; }
+
+      topBin = std::countr_zero(topMask);
+      leafMask = leafBinsMasks[topBin];
+    }
+
+    return (topBin << MantissaBits) | std::countr_zero(leafMask);
+  }
+
+}
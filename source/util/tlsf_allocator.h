@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace Lotus
+{
+  /*
+    Two level segregated fit allocator of ranges inside a linear space, such as the elements of a GPU
+    buffer. Free blocks are kept in 256 bins, indexed by a floating point encoding of their size (5 bits of
+    exponent and 3 of mantissa), and two levels of bitmasks find the first bin that fits a request. Allocation
+    and release are O(1), and released blocks are merged with their free neighbors. The offsets and sizes
+    are in elements, not bytes
+  */
+  class TLSFAllocator
+  {
+  public:
+    static constexpr uint32_t InvalidOffset = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t InvalidNode = std::numeric_limits<uint32_t>::max();
+
+    static constexpr uint32_t MantissaBits = 3;
+    static constexpr uint32_t LeafBinsCount = 1 << MantissaBits;
+    static constexpr uint32_t TopBinsCount = 32;
+    static constexpr uint32_t BinsCount = TopBinsCount * LeafBinsCount;
+
+    struct Allocation
+    {
+      uint32_t offset = InvalidOffset;
+      // Node to pass to free
+      uint32_t node = InvalidNode;
+
+      bool valid() const { return offset != InvalidOffset; }
+    };
+
+    struct Statistics
+    {
+      uint32_t capacity = 0;
+      uint32_t usedSize = 0;
+      uint32_t freeSize = 0;
+      uint32_t largestFreeBlock = 0;
+      uint32_t freeBlocksCount = 0;
+      uint32_t allocationsCount = 0;
+
+      // 0 when all the free space is in one block, close to 1 when it is split in many small ones
+      float getFragmentation() const
+      {
+        return freeSize == 0 ? 0.0f : 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeSize);
+      }
+    };
+
+    explicit TLSFAllocator(uint32_t initialCapacity = 0);
+
+    // Returns an invalid allocation if no free block fits the size, the caller then grows the space
+    Allocation allocate(uint32_t size);
+    void free(Allocation allocation);
+    void free(uint32_t node);
+
+    // Moves an allocation to the start of the free block before it, if there is one, and returns its offset
+    uint32_t slideDown(uint32_t node);
+
+    // Adds the space [capacity, newCapacity) at the end
+    void grow(uint32_t newCapacity);
+    // Removes the free space at the end down to newCapacity at most, returns the new capacity
+    uint32_t shrink(uint32_t newCapacity);
+    void reset(uint32_t newCapacity);
+
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getUsedSize() const { return usedSize; }
+    uint32_t getAllocationOffset(uint32_t node) const { return nodes[node].offset; }
+    uint32_t getAllocationSize(uint32_t node) const { return nodes[node].size; }
+    Statistics getStatistics() const;
+
+    // Size encodings of the bins, public for testing
+    static uint32_t sizeToBinRoundUp(uint32_t size);
+    static uint32_t sizeToBinRoundDown(uint32_t size);
+    static uint32_t binToSize(uint32_t bin);
+
+  private:
+    struct Node
+    {
+      uint32_t offset = 0;
+      uint32_t size = 0;
+      // Nodes in the same bin
+      uint32_t binPrevious = InvalidNode;
+      uint32_t binNext = InvalidNode;
+      // Nodes of the adjacent ranges
+      uint32_t neighborPrevious = InvalidNode;
+      uint32_t neighborNext = InvalidNode;
+      bool used = false;
+    };
+
+    uint32_t createNode(uint32_t offset, uint32_t size, uint32_t neighborPrevious, uint32_t neighborNext);
+    void releaseNode(uint32_t node);
+
+    void insertFreeNode(uint32_t node);
+    void removeFreeNode(uint32_t node);
+    uint32_t findFreeBin(uint32_t minimumBin) const;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> unusedNodes;
+
+    uint32_t topBinsMask;
+    uint8_t leafBinsMasks[TopBinsCount];
+    uint32_t binHeads[BinsCount];
+
+    uint32_t capacity;
+    uint32_t usedSize;
+    uint32_t allocationsCount;
+    // Node of the range that ends at the capacity
+    uint32_t lastNode;
+  };
+}
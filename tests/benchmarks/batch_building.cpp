@@ -0,0 +1,305 @@
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "math/radix_sort.h"
+#include "render/indirect/batch_builder.h"
+
+/*
+  Arguments: objects count, meshes count, shaders count
+*/
+
+Lotus::SlotMap<Lotus::RenderObject> createRenderObjects(int64_t objectsCount, int64_t meshesCount, int64_t shadersCount)
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, static_cast<uint32_t>(meshesCount - 1));
+  std::uniform_int_distribution<uint32_t> shaderDistribution(0, static_cast<uint32_t>(shadersCount - 1));
+
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects;
+  renderObjects.reserve(objectsCount);
+
+  for (uint32_t i = 0; i < objectsCount; i++)
+  {
+    Lotus::RenderObject object;
+    object.meshHandle = meshDistribution(generator);
+    object.shaderHandle = shaderDistribution(generator);
+    object.ID = i;
+
+    renderObjects.insert(object);
+  }
+
+  return renderObjects;
+}
+
+Lotus::SlotMap<Lotus::RenderMesh> createRenderMeshes(int64_t meshesCount)
+{
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+  for (uint32_t i = 0; i < meshesCount; i++)
+  {
+    renderMeshes.insert({ 36, i * 36, i * 24 });
+  }
+
+  return renderMeshes;
+}
+
+void addAllObjects(Lotus::BatchBuilder& batchBuilder, Lotus::SlotMap<Lotus::RenderObject>& renderObjects)
+{
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+}
+
+void batchingArguments(benchmark::internal::Benchmark* benchmark)
+{
+  benchmark->ArgNames({ "objects", "meshes", "shaders" });
+  benchmark->Args({ 10000, 16, 2 });
+  benchmark->Args({ 100000, 64, 4 });
+  benchmark->Args({ 1000000, 16, 1 });
+  benchmark->Args({ 1000000, 256, 4 });
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+// Batching of a whole scene from scratch, as in the first frame
+static void BM_FullBuild(benchmark::State& state)
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(state.range(0), state.range(1), state.range(2));
+  Lotus::BatchBuilder batchBuilder;
+
+  for (auto _ : state)
+  {
+    batchBuilder.clear();
+    addAllObjects(batchBuilder, renderObjects);
+    batchBuilder.build();
+
+    benchmark::DoNotOptimize(batchBuilder.getShaderBatches().data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Batching after one percent of the objects changed their mesh
+static void BM_RebatchOnePercent(benchmark::State& state)
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(state.range(0), state.range(1), state.range(2));
+  Lotus::BatchBuilder batchBuilder;
+
+  addAllObjects(batchBuilder, renderObjects);
+  batchBuilder.build();
+
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<uint32_t> objectDistribution(0, static_cast<uint32_t>(renderObjects.size() - 1));
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, static_cast<uint32_t>(state.range(1) - 1));
+
+  size_t changesCount = std::max<size_t>(renderObjects.size() / 100, 1);
+  std::vector<uint32_t> changedObjects;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    changedObjects.resize(changesCount);
+    for (uint32_t& objectIndex : changedObjects)
+    {
+      objectIndex = objectDistribution(generator);
+    }
+    std::sort(changedObjects.begin(), changedObjects.end());
+    changedObjects.erase(std::unique(changedObjects.begin(), changedObjects.end()), changedObjects.end());
+    state.ResumeTiming();
+
+    for (uint32_t objectIndex : changedObjects)
+    {
+      renderObjects[objectIndex].meshHandle = meshDistribution(generator);
+      batchBuilder.removeObject(objectIndex, renderObjects[objectIndex]);
+      batchBuilder.addObject(objectIndex, renderObjects[objectIndex]);
+    }
+
+    batchBuilder.build();
+  }
+
+  state.SetItemsProcessed(state.iterations() * changesCount);
+}
+
+// Indirect commands and object handles generation from already built batches
+static void BM_WriteBuffers(benchmark::State& state)
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(state.range(0), state.range(1), state.range(2));
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes = createRenderMeshes(state.range(1));
+  Lotus::BatchBuilder batchBuilder;
+
+  addAllObjects(batchBuilder, renderObjects);
+  batchBuilder.build();
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(batchBuilder.getDrawBatches().size());
+  std::vector<uint32_t> objectHandles(batchBuilder.getObjectBatches().size());
+
+  for (auto _ : state)
+  {
+    batchBuilder.writeIndirectCommands(renderMeshes, commands.data());
+    batchBuilder.writeObjectHandles(renderObjects, objectHandles.data());
+
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void frameArguments(benchmark::internal::Benchmark* benchmark)
+{
+  benchmark->ArgNames({ "objects", "meshes", "shaders", "incremental" });
+  benchmark->Args({ 200000, 64, 4, 0 });
+  benchmark->Args({ 200000, 64, 4, 1 });
+  benchmark->Unit(benchmark::kMicrosecond);
+}
+
+// Batching and buffers generation of a frame where changesCount objects changed their mesh, as done by the renderer
+static void runFrames(benchmark::State& state, size_t changesCount)
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(state.range(0), state.range(1), state.range(2));
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes = createRenderMeshes(state.range(1));
+  Lotus::BatchBuilder batchBuilder;
+  batchBuilder.setIncrementalBuild(state.range(3) != 0);
+
+  addAllObjects(batchBuilder, renderObjects);
+  batchBuilder.build();
+  batchBuilder.clearDirtyRanges();
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands;
+  std::vector<uint32_t> objectHandles(renderObjects.size());
+
+  std::mt19937 generator(11);
+  std::uniform_int_distribution<uint32_t> objectDistribution(0, static_cast<uint32_t>(renderObjects.size() - 1));
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, static_cast<uint32_t>(state.range(1) - 1));
+
+  size_t writtenCommands = 0;
+  size_t writtenHandles = 0;
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < changesCount; i++)
+    {
+      uint32_t objectIndex = objectDistribution(generator);
+
+      renderObjects[objectIndex].meshHandle = meshDistribution(generator);
+      batchBuilder.removeObject(objectIndex, renderObjects[objectIndex]);
+      batchBuilder.addObject(objectIndex, renderObjects[objectIndex]);
+    }
+
+    batchBuilder.build();
+
+    // The full mode uploads the whole buffers every frame, as the renderer did before the dirty ranges
+    Lotus::BatchRange drawRange = batchBuilder.getDirtyDrawRange();
+    Lotus::BatchRange objectRange = batchBuilder.getDirtyObjectRange();
+
+    if (!batchBuilder.isIncrementalBuild())
+    {
+      drawRange = { 0, static_cast<uint32_t>(batchBuilder.getDrawBatches().size()) };
+      objectRange = { 0, static_cast<uint32_t>(batchBuilder.getObjectBatches().size()) };
+    }
+
+    commands.resize(batchBuilder.getDrawBatches().size());
+    batchBuilder.writeIndirectCommands(renderMeshes, commands.data(), drawRange);
+    batchBuilder.writeObjectHandles(renderObjects, objectHandles.data(), objectRange);
+    batchBuilder.clearDirtyRanges();
+
+    writtenCommands += drawRange.count;
+    writtenHandles += objectRange.count;
+
+    benchmark::ClobberMemory();
+  }
+
+  state.counters["commands"] = benchmark::Counter(static_cast<double>(writtenCommands), benchmark::Counter::kAvgIterations);
+  state.counters["handles"] = benchmark::Counter(static_cast<double>(writtenHandles), benchmark::Counter::kAvgIterations);
+}
+
+// Static scene, nothing to rebatch
+static void BM_StaticFrame(benchmark::State& state)
+{
+  runFrames(state, 0);
+}
+
+// One object changed its mesh
+static void BM_OneChangeFrame(benchmark::State& state)
+{
+  runFrames(state, 1);
+}
+
+std::vector<Lotus::ObjectBatch> createObjectBatches(int64_t objectsCount, int64_t meshesCount, int64_t shadersCount)
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(objectsCount, meshesCount, shadersCount);
+  Lotus::SortKeyLayout layout;
+
+  std::vector<Lotus::ObjectBatch> objectBatches(renderObjects.size());
+
+  for (uint32_t i = 0; i < objectBatches.size(); i++)
+  {
+    objectBatches[i].sortKey = layout.pack(renderObjects[i].shaderHandle, renderObjects[i].meshHandle.get(), 0, 0);
+    objectBatches[i].objectHandle = i;
+    objectBatches[i].meshHandle = renderObjects[i].meshHandle;
+    objectBatches[i].shaderHandle = renderObjects[i].shaderHandle;
+  }
+
+  std::shuffle(objectBatches.begin(), objectBatches.end(), std::mt19937(3));
+
+  return objectBatches;
+}
+
+// Sort of the object batches with the previous three level comparator, as reference for the radix sort
+static void BM_ComparatorSort(benchmark::State& state)
+{
+  std::vector<Lotus::ObjectBatch> unsortedBatches = createObjectBatches(state.range(0), state.range(1), state.range(2));
+  std::vector<Lotus::ObjectBatch> objectBatches;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    objectBatches = unsortedBatches;
+    state.ResumeTiming();
+
+    std::sort(objectBatches.begin(), objectBatches.end(),
+    [](const Lotus::ObjectBatch& bA, const Lotus::ObjectBatch& bB) {
+      if (bA.shaderHandle < bB.shaderHandle) { return true; }
+      else if (bA.shaderHandle == bB.shaderHandle) {
+        if (bA.meshHandle < bB.meshHandle) { return true; }
+        else if (bA.meshHandle == bB.meshHandle) { return bA.objectHandle < bB.objectHandle; }
+        else { return false; }
+      }
+      else { return false; }
+    });
+
+    benchmark::DoNotOptimize(objectBatches.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_RadixSort(benchmark::State& state)
+{
+  std::vector<Lotus::ObjectBatch> unsortedBatches = createObjectBatches(state.range(0), state.range(1), state.range(2));
+  std::vector<Lotus::ObjectBatch> objectBatches;
+  std::vector<Lotus::ObjectBatch> scratch;
+  Lotus::SortKeyLayout layout;
+
+  for (auto _ : state)
+  {
+    state.PauseTiming();
+    objectBatches = unsortedBatches;
+    state.ResumeTiming();
+
+    Lotus::radixSort(objectBatches, scratch, [](const Lotus::ObjectBatch& batch) { return batch.objectHandle.getValue(); }, 64);
+    Lotus::radixSort(objectBatches, scratch, [](const Lotus::ObjectBatch& batch) { return batch.sortKey; }, layout.getTotalBits());
+
+    benchmark::DoNotOptimize(objectBatches.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ComparatorSort)->Apply(batchingArguments);
+BENCHMARK(BM_RadixSort)->Apply(batchingArguments);
+BENCHMARK(BM_FullBuild)->Apply(batchingArguments);
+BENCHMARK(BM_RebatchOnePercent)->Apply(batchingArguments);
+BENCHMARK(BM_WriteBuffers)->Apply(batchingArguments);
+BENCHMARK(BM_StaticFrame)->Apply(frameArguments);
+BENCHMARK(BM_OneChangeFrame)->Apply(frameArguments);
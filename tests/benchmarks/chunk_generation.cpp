@@ -0,0 +1,61 @@
+#include <cstdint>
+#include <algorithm>
+#include <thread>
+#include <benchmark/benchmark.h>
+#include "core/job_system.h"
+#include "terrain/procedural_data_generator.h"
+
+/*
+  Argument: threads count, the calling thread and the workers
+*/
+
+void threadsArguments(benchmark::internal::Benchmark* benchmark)
+{
+  int64_t hardwareThreads = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+
+  benchmark->ArgName("threads");
+
+  for (int64_t threads = 1; threads < hardwareThreads; threads *= 2)
+  {
+    benchmark->Arg(threads);
+  }
+
+  benchmark->Arg(hardwareThreads);
+  benchmark->UseRealTime();
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+// Every chunk of a generator, as when the terrain is created
+static void BM_GenerateAllChunks(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+  Lotus::PerlinNoiseConfig noiseConfig;
+
+  for (auto _ : state)
+  {
+    Lotus::ProceduralDataGenerator generator(128, 8, noiseConfig, { 0, 0 }, jobSystem);
+
+    benchmark::DoNotOptimize(generator.getChunkData(0, 0));
+  }
+
+  state.SetItemsProcessed(state.iterations() * 8 * 8);
+}
+
+// One row of chunks, as when the camera crosses a chunk border
+static void BM_GenerateChunksRow(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+  Lotus::PerlinNoiseConfig noiseConfig;
+
+  Lotus::ProceduralDataGenerator generator(256, 16, noiseConfig, { 0, 0 }, jobSystem);
+
+  for (auto _ : state)
+  {
+    generator.updateRightChunks();
+  }
+
+  state.SetItemsProcessed(state.iterations() * 16);
+}
+
+BENCHMARK(BM_GenerateAllChunks)->Apply(threadsArguments);
+BENCHMARK(BM_GenerateChunksRow)->Apply(threadsArguments);
@@ -0,0 +1,90 @@
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "util/bitset_allocator.h"
+
+/*
+  Arguments: slots count
+
+  Churn of a buffer with every slot in use: each iteration frees random slots and takes the lowest free
+  ones again, like objects being deleted and created in a full object buffer
+*/
+
+static constexpr size_t ChurnSlotsCount = 1024;
+
+std::vector<uint32_t> createChurnSlots(int64_t slotsCount)
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<uint32_t> distribution(0, static_cast<uint32_t>(slotsCount - 1));
+
+  std::vector<uint32_t> slots(ChurnSlotsCount * 64);
+
+  for (uint32_t& slot : slots)
+  {
+    slot = distribution(generator);
+  }
+
+  return slots;
+}
+
+static void BM_FreeSlotsSet(benchmark::State& state)
+{
+  std::vector<uint32_t> churnSlots = createChurnSlots(state.range(0));
+  std::set<uint32_t> freeSlots;
+  size_t churnOffset = 0;
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < ChurnSlotsCount; i++)
+    {
+      freeSlots.insert(churnSlots[churnOffset + i]);
+    }
+
+    while (!freeSlots.empty())
+    {
+      uint32_t slot = *freeSlots.begin();
+      freeSlots.erase(freeSlots.begin());
+
+      benchmark::DoNotOptimize(slot);
+    }
+
+    churnOffset = (churnOffset + ChurnSlotsCount) % churnSlots.size();
+  }
+
+  state.SetItemsProcessed(state.iterations() * ChurnSlotsCount);
+}
+
+static void BM_FreeSlotsBitset(benchmark::State& state)
+{
+  std::vector<uint32_t> churnSlots = createChurnSlots(state.range(0));
+  Lotus::BitsetAllocator freeSlots;
+  size_t churnOffset = 0;
+
+  // The capacity is reached once, like a buffer after its first frames
+  freeSlots.release(static_cast<uint32_t>(state.range(0) - 1));
+  freeSlots.acquire();
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < ChurnSlotsCount; i++)
+    {
+      freeSlots.release(churnSlots[churnOffset + i]);
+    }
+
+    uint32_t slot;
+
+    while ((slot = freeSlots.acquire()) != Lotus::BitsetAllocator::InvalidSlot)
+    {
+      benchmark::DoNotOptimize(slot);
+    }
+
+    churnOffset = (churnOffset + ChurnSlotsCount) % churnSlots.size();
+  }
+
+  state.SetItemsProcessed(state.iterations() * ChurnSlotsCount);
+}
+
+BENCHMARK(BM_FreeSlotsSet)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FreeSlotsBitset)->Arg(1 << 10)->Arg(1 << 16)->Arg(1 << 20)->Unit(benchmark::kMicrosecond);
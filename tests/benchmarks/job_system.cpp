@@ -0,0 +1,185 @@
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "core/job_system.h"
+#include "render/indirect/batch_builder.h"
+#include "render/indirect/cpu_culling.h"
+
+/*
+  Argument: threads count, the calling thread and the workers. Every benchmark runs the same work from
+  one thread to the hardware threads, so the scaling of each engine system can be compared
+*/
+
+void threadsArguments(benchmark::internal::Benchmark* benchmark)
+{
+  int64_t hardwareThreads = std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+
+  benchmark->ArgName("threads");
+
+  for (int64_t threads = 1; threads < hardwareThreads; threads *= 2)
+  {
+    benchmark->Arg(threads);
+  }
+
+  benchmark->Arg(hardwareThreads);
+  benchmark->UseRealTime();
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+struct Scene
+{
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects;
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+  Lotus::BatchBuilder batchBuilder;
+};
+
+// Objects scattered around the origin, in 64 meshes and 4 shaders
+void createScene(Scene& scene, uint32_t objectsCount)
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, 63);
+  std::uniform_int_distribution<uint32_t> shaderDistribution(0, 3);
+
+  for (uint32_t i = 0; i < 64; i++)
+  {
+    Lotus::RenderMesh mesh;
+    mesh.count = 36;
+    mesh.firstIndex = i * 36;
+    mesh.baseVertex = i * 24;
+    mesh.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, 0.5f + 0.05f * i);
+
+    scene.renderMeshes.insert(mesh);
+  }
+
+  scene.renderObjects.reserve(objectsCount);
+
+  for (uint32_t i = 0; i < objectsCount; i++)
+  {
+    Lotus::RenderObject object;
+    object.meshHandle = meshDistribution(generator);
+    object.shaderHandle = shaderDistribution(generator);
+    object.model = glm::translate(glm::mat4(1.0f), glm::vec3(position(generator), position(generator), position(generator)));
+    object.ID = i;
+
+    Lotus::Handle<Lotus::RenderObject> objectHandle = scene.renderObjects.insert(object);
+    scene.batchBuilder.addObject(objectHandle, scene.renderObjects[objectHandle]);
+  }
+
+  scene.batchBuilder.build();
+}
+
+// Scheduling cost alone, small jobs that do nothing
+static void BM_EmptyJobs(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+
+  constexpr int JobsCount = 10000;
+
+  for (auto _ : state)
+  {
+    Lotus::JobCounter counter;
+
+    for (int i = 0; i < JobsCount; i++)
+    {
+      jobSystem.run([]() {}, &counter);
+    }
+
+    jobSystem.wait(counter);
+  }
+
+  state.SetItemsProcessed(state.iterations() * JobsCount);
+}
+
+// Batching after ten percent of the objects changed their mesh, the removed and added objects are sorted at the same time
+static void BM_RebatchTenPercent(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+
+  Scene scene;
+  createScene(scene, 1000000);
+  scene.batchBuilder.setJobSystem(&jobSystem);
+
+  std::mt19937 generator(7);
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, 63);
+
+  uint32_t objectsCount = static_cast<uint32_t>(scene.renderObjects.size());
+  uint32_t first = 0;
+
+  for (auto _ : state)
+  {
+    for (uint32_t i = first; i < objectsCount; i += 10)
+    {
+      Lotus::RenderObject& object = scene.renderObjects[i];
+
+      scene.batchBuilder.removeObject(i, object);
+      object.meshHandle = meshDistribution(generator);
+      scene.batchBuilder.addObject(i, object);
+    }
+
+    scene.batchBuilder.build();
+
+    first = (first + 1) % 10;
+  }
+
+  state.SetItemsProcessed(state.iterations() * objectsCount / 10);
+}
+
+// Indirect commands, object handles and instances of a whole scene
+static void BM_WriteBuffers(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+
+  Scene scene;
+  createScene(scene, 1000000);
+  scene.batchBuilder.setJobSystem(&jobSystem);
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(scene.batchBuilder.getDrawBatches().size());
+  std::vector<uint32_t> objectHandles(scene.batchBuilder.getObjectBatches().size());
+  std::vector<Lotus::GPUInstance> instances(scene.batchBuilder.getObjectBatches().size());
+
+  for (auto _ : state)
+  {
+    scene.batchBuilder.writeIndirectCommands(scene.renderMeshes, commands.data());
+    scene.batchBuilder.writeObjectHandles(scene.renderObjects, objectHandles.data());
+    scene.batchBuilder.writeInstances(scene.renderObjects, instances.data());
+
+    benchmark::DoNotOptimize(instances.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * scene.renderObjects.size());
+}
+
+// Gather and frustum test of a whole scene on the CPU
+static void BM_CPUCulling(benchmark::State& state)
+{
+  Lotus::JobSystem jobSystem(state.range(0) - 1);
+
+  Scene scene;
+  createScene(scene, 1000000);
+
+  Lotus::CPUCuller culler(&jobSystem);
+
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 10.0f, 120.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  Lotus::Frustum frustum = Lotus::extractFrustum(glm::perspective(glm::radians(60.0f), 1.6f, 0.1f, 200.0f) * view);
+
+  for (auto _ : state)
+  {
+    culler.gather(scene.batchBuilder.getObjectBatches(), scene.renderObjects, scene.renderMeshes);
+    culler.cull(frustum, scene.batchBuilder.getDrawBatches());
+
+    benchmark::DoNotOptimize(culler.getVisibleCounts().data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * scene.renderObjects.size());
+}
+
+BENCHMARK(BM_EmptyJobs)->Apply(threadsArguments);
+BENCHMARK(BM_RebatchTenPercent)->Apply(threadsArguments);
+BENCHMARK(BM_WriteBuffers)->Apply(threadsArguments);
+BENCHMARK(BM_CPUCulling)->Apply(threadsArguments);
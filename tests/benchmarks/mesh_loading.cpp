@@ -0,0 +1,66 @@
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include "render/indirect/mesh_manager.h"
+#include "util/path_manager.h"
+
+/*
+  Startup cost of a mesh, from its file to a copy of its vertices and indices as the renderer does when it
+  uploads them. The imported mesh runs Assimp, the cooked one maps its cooked file next to the source
+*/
+
+std::filesystem::path meshPath = Lotus::assetPath("models/air_conditioner/AirConditioner.obj");
+
+void loadAndCopyMesh(benchmark::State& state)
+{
+  Lotus::MeshManager& meshManager = Lotus::MeshManager::getInstance();
+
+  std::vector<uint8_t> staging;
+
+  for (auto _ : state)
+  {
+    std::shared_ptr<Lotus::Mesh> mesh = meshManager.loadMesh(meshPath);
+
+    std::span<const Lotus::Vertex> vertices = mesh->getVertices();
+    std::span<const unsigned int> indices = mesh->getIndices();
+
+    staging.resize(vertices.size_bytes() + indices.size_bytes());
+    std::memcpy(staging.data(), vertices.data(), vertices.size_bytes());
+    std::memcpy(staging.data() + vertices.size_bytes(), indices.data(), indices.size_bytes());
+
+    benchmark::DoNotOptimize(staging.data());
+
+    // Released so the next iteration loads it again
+    mesh.reset();
+    meshManager.cleanUnusedMeshes();
+  }
+
+  state.SetBytesProcessed(state.iterations() * staging.size());
+}
+
+static void BM_ImportMesh(benchmark::State& state)
+{
+  Lotus::MeshManager::getInstance().setCookedMeshesEnabled(false);
+
+  loadAndCopyMesh(state);
+}
+
+static void BM_LoadCookedMesh(benchmark::State& state)
+{
+  Lotus::MeshManager::getInstance().setCookedMeshesEnabled(true);
+
+  if (!Lotus::MeshManager::cookMesh(meshPath))
+  {
+    state.SkipWithError("The mesh couldn't be cooked");
+    return;
+  }
+
+  loadAndCopyMesh(state);
+}
+
+BENCHMARK(BM_ImportMesh)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_LoadCookedMesh)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,143 @@
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "math/model_matrices.h"
+
+/*
+  Arguments: transforms count
+*/
+
+struct Transforms
+{
+  std::vector<glm::vec3> translations;
+  std::vector<glm::fquat> rotations;
+  std::vector<glm::vec3> scales;
+  std::vector<glm::mat4> matrices;
+};
+
+Transforms createTransforms(int64_t transformsCount)
+{
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+  Transforms transforms;
+
+  for (int64_t i = 0; i < transformsCount; i++)
+  {
+    transforms.translations.push_back(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 100.0f);
+    transforms.rotations.push_back(glm::normalize(glm::fquat(distribution(generator), distribution(generator), distribution(generator), distribution(generator))));
+    transforms.scales.push_back(glm::vec3(distribution(generator) + 2.0f));
+  }
+
+  transforms.matrices.resize(transformsCount);
+
+  return transforms;
+}
+
+void transformsArguments(benchmark::internal::Benchmark* benchmark)
+{
+  benchmark->ArgNames({ "transforms" });
+  benchmark->Arg(1000);
+  benchmark->Arg(100000);
+  benchmark->Arg(1000000);
+  benchmark->Unit(benchmark::kMicrosecond);
+}
+
+// Previous path, three matrices multiplied per transform as in Transform::getModelMatrix
+static void BM_GLMModelMatrices(benchmark::State& state)
+{
+  Transforms transforms = createTransforms(state.range(0));
+
+  for (auto _ : state)
+  {
+    for (size_t i = 0; i < transforms.matrices.size(); i++)
+    {
+      const glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), transforms.translations[i]);
+      const glm::mat4 rotationMatrix = glm::toMat4(transforms.rotations[i]);
+      const glm::mat4 scaleMatrix = glm::scale(glm::mat4(1.0f), transforms.scales[i]);
+
+      transforms.matrices[i] = translationMatrix * rotationMatrix * scaleMatrix;
+    }
+
+    benchmark::DoNotOptimize(transforms.matrices.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_ScalarModelMatrices(benchmark::State& state)
+{
+  Transforms transforms = createTransforms(state.range(0));
+
+  for (auto _ : state)
+  {
+    Lotus::composeModelMatricesScalar(
+        transforms.translations.data(), transforms.rotations.data(), transforms.scales.data(),
+        transforms.matrices.data(), transforms.matrices.size());
+
+    benchmark::DoNotOptimize(transforms.matrices.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+static void BM_BatchedModelMatrices(benchmark::State& state)
+{
+  Transforms transforms = createTransforms(state.range(0));
+
+  state.SetLabel(Lotus::getModelMatricesInstructionSet());
+
+  for (auto _ : state)
+  {
+    Lotus::composeModelMatrices(
+        transforms.translations.data(), transforms.rotations.data(), transforms.scales.data(),
+        transforms.matrices.data(), transforms.matrices.size());
+
+    benchmark::DoNotOptimize(transforms.matrices.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Dirty transforms spread over the arrays, as the renderer updates them
+static void BM_BatchedScatteredModelMatrices(benchmark::State& state)
+{
+  Transforms transforms = createTransforms(state.range(0));
+
+  std::vector<uint32_t> indices(transforms.matrices.size());
+
+  for (uint32_t i = 0; i < indices.size(); i++)
+  {
+    indices[i] = i;
+  }
+
+  std::shuffle(indices.begin(), indices.end(), std::mt19937(7));
+  indices.resize(indices.size() / 2);
+  std::sort(indices.begin(), indices.end());
+
+  state.SetLabel(Lotus::getModelMatricesInstructionSet());
+
+  for (auto _ : state)
+  {
+    Lotus::composeModelMatrices(
+        transforms.translations.data(), transforms.rotations.data(), transforms.scales.data(),
+        indices.data(), transforms.matrices.data(), indices.size());
+
+    benchmark::DoNotOptimize(transforms.matrices.data());
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * indices.size());
+}
+
+BENCHMARK(BM_GLMModelMatrices)->Apply(transformsArguments);
+BENCHMARK(BM_ScalarModelMatrices)->Apply(transformsArguments);
+BENCHMARK(BM_BatchedModelMatrices)->Apply(transformsArguments);
+BENCHMARK(BM_BatchedScatteredModelMatrices)->Apply(transformsArguments);
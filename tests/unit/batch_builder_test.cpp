@@ -0,0 +1,660 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "render/indirect/batch_builder.h"
+
+namespace
+{
+  Lotus::SlotMap<Lotus::RenderObject> createRenderObjects(size_t objectsCount, std::mt19937& generator)
+  {
+    std::uniform_int_distribution<uint32_t> meshDistribution(0, 7);
+    std::uniform_int_distribution<uint32_t> shaderDistribution(0, 2);
+
+    // Inserted in an empty slot map, so the handles of the objects are their indices
+    Lotus::SlotMap<Lotus::RenderObject> renderObjects;
+
+    for (uint32_t i = 0; i < objectsCount; i++)
+    {
+      Lotus::RenderObject object;
+      object.meshHandle = meshDistribution(generator);
+      object.shaderHandle = shaderDistribution(generator);
+      object.ID = i;
+
+      renderObjects.insert(object);
+    }
+
+    return renderObjects;
+  }
+
+  // Checks the built batches against the expected grouping of the current objects
+  void expectValidBatches(const Lotus::BatchBuilder& batchBuilder, const Lotus::SlotMap<Lotus::RenderObject>& renderObjects)
+  {
+    const std::vector<Lotus::ObjectBatch>& objectBatches = batchBuilder.getObjectBatches();
+    const std::vector<Lotus::DrawBatch>& drawBatches = batchBuilder.getDrawBatches();
+    const std::vector<Lotus::ShaderBatch>& shaderBatches = batchBuilder.getShaderBatches();
+
+    ASSERT_EQ(objectBatches.size(), renderObjects.size());
+
+    for (size_t i = 0; i < objectBatches.size(); i++)
+    {
+      const Lotus::RenderObject& object = renderObjects[objectBatches[i].objectHandle.get()];
+      EXPECT_EQ(objectBatches[i].meshHandle.get(), object.meshHandle.get());
+      EXPECT_EQ(objectBatches[i].shaderHandle.get(), object.shaderHandle);
+
+      EXPECT_EQ(objectBatches[i].sortKey, batchBuilder.makeSortKey(object));
+
+      if (i > 0)
+      {
+        const Lotus::ObjectBatch& previous = objectBatches[i - 1];
+        const Lotus::ObjectBatch& current = objectBatches[i];
+
+        bool ordered = previous.sortKey < current.sortKey ||
+          (previous.sortKey == current.sortKey && previous.objectHandle < current.objectHandle);
+
+        EXPECT_TRUE(ordered) << "Object batch " << i << " is out of order";
+      }
+    }
+
+    uint32_t instancesCount = 0;
+
+    for (const Lotus::DrawBatch& drawBatch : drawBatches)
+    {
+      EXPECT_EQ(drawBatch.prevInstanceCount, instancesCount);
+      EXPECT_GT(drawBatch.instanceCount, 0u);
+
+      for (uint32_t i = 0; i < drawBatch.instanceCount; i++)
+      {
+        EXPECT_TRUE(objectBatches[drawBatch.prevInstanceCount + i].meshHandle == drawBatch.meshHandle);
+        EXPECT_TRUE(objectBatches[drawBatch.prevInstanceCount + i].shaderHandle == drawBatch.shaderHandle);
+      }
+
+      instancesCount += drawBatch.instanceCount;
+    }
+
+    EXPECT_EQ(instancesCount, objectBatches.size());
+
+    uint32_t drawsCount = 0;
+
+    for (const Lotus::ShaderBatch& shaderBatch : shaderBatches)
+    {
+      EXPECT_EQ(shaderBatch.first, drawsCount);
+
+      for (uint32_t i = 0; i < shaderBatch.count; i++)
+      {
+        EXPECT_TRUE(drawBatches[shaderBatch.first + i].shaderHandle == shaderBatch.shaderHandle);
+      }
+
+      drawsCount += shaderBatch.count;
+    }
+
+    EXPECT_EQ(drawsCount, drawBatches.size());
+  }
+}
+
+TEST(BatchBuilderTest, BuildsSortedBatches)
+{
+  std::mt19937 generator(1234);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(2000, generator);
+
+  Lotus::BatchBuilder batchBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  expectValidBatches(batchBuilder, renderObjects);
+}
+
+TEST(BatchBuilderTest, RebatchesChangedObjects)
+{
+  std::mt19937 generator(4321);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(2000, generator);
+
+  Lotus::BatchBuilder batchBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  std::uniform_int_distribution<uint32_t> objectDistribution(0, static_cast<uint32_t>(renderObjects.size() - 1));
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, 7);
+  std::uniform_int_distribution<uint32_t> shaderDistribution(0, 2);
+
+  for (int frame = 0; frame < 20; frame++)
+  {
+    std::vector<bool> changed(renderObjects.size(), false);
+
+    for (int i = 0; i < 50; i++)
+    {
+      uint32_t objectIndex = objectDistribution(generator);
+
+      if (changed[objectIndex]) { continue; }
+      changed[objectIndex] = true;
+
+      // Handles are modified before the removal, as the renderer does
+      renderObjects[objectIndex].meshHandle = meshDistribution(generator);
+      renderObjects[objectIndex].shaderHandle = shaderDistribution(generator);
+      batchBuilder.removeObject(objectIndex, renderObjects[objectIndex]);
+      batchBuilder.addObject(objectIndex, renderObjects[objectIndex]);
+    }
+
+    batchBuilder.build();
+
+    expectValidBatches(batchBuilder, renderObjects);
+  }
+}
+
+TEST(BatchBuilderTest, WritesCommandsAndHandles)
+{
+  std::mt19937 generator(99);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(500, generator);
+
+  // Buffer IDs different from the handles, as happens after slots are recycled
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    renderObjects[i].ID = 1000 + i;
+  }
+
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    renderMeshes.insert({ 6 * (i + 1), 100 * i, 10 * i });
+  }
+
+  Lotus::BatchBuilder batchBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  const std::vector<Lotus::DrawBatch>& drawBatches = batchBuilder.getDrawBatches();
+  const std::vector<Lotus::ObjectBatch>& objectBatches = batchBuilder.getObjectBatches();
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(drawBatches.size());
+  batchBuilder.writeIndirectCommands(renderMeshes, commands.data());
+
+  for (size_t i = 0; i < commands.size(); i++)
+  {
+    const Lotus::RenderMesh& mesh = renderMeshes[drawBatches[i].meshHandle.get()];
+
+    EXPECT_EQ(commands[i].count, mesh.count);
+    EXPECT_EQ(commands[i].firstIndex, mesh.firstIndex);
+    EXPECT_EQ(commands[i].baseVertex, mesh.baseVertex);
+    EXPECT_EQ(commands[i].instanceCount, drawBatches[i].instanceCount);
+    EXPECT_EQ(commands[i].baseInstance, drawBatches[i].prevInstanceCount);
+  }
+
+  std::vector<uint32_t> objectHandles(objectBatches.size());
+  batchBuilder.writeObjectHandles(renderObjects, objectHandles.data());
+
+  for (size_t i = 0; i < objectHandles.size(); i++)
+  {
+    EXPECT_EQ(objectHandles[i], renderObjects[objectBatches[i].objectHandle.get()].ID);
+  }
+
+  std::vector<Lotus::GPUInstance> instances(objectBatches.size());
+  batchBuilder.writeInstances(renderObjects, instances.data());
+
+  for (uint32_t drawBatchIndex = 0; drawBatchIndex < drawBatches.size(); drawBatchIndex++)
+  {
+    for (uint32_t i = 0; i < drawBatches[drawBatchIndex].instanceCount; i++)
+    {
+      const Lotus::GPUInstance& instance = instances[drawBatches[drawBatchIndex].prevInstanceCount + i];
+
+      EXPECT_EQ(instance.objectID, objectHandles[drawBatches[drawBatchIndex].prevInstanceCount + i]);
+      EXPECT_EQ(instance.drawBatchID, drawBatchIndex);
+    }
+  }
+
+  // A range starting inside a draw batch finds its draw batch
+  std::vector<Lotus::GPUInstance> rangeInstances(objectBatches.size());
+  batchBuilder.writeInstances(renderObjects, rangeInstances.data(), { 123, 200 });
+
+  for (uint32_t i = 123; i < 323; i++)
+  {
+    EXPECT_EQ(rangeInstances[i].objectID, instances[i].objectID);
+    EXPECT_EQ(rangeInstances[i].drawBatchID, instances[i].drawBatchID);
+  }
+}
+
+TEST(BatchBuilderTest, WritesACommandPerLOD)
+{
+  std::mt19937 generator(17);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(500, generator);
+
+  // Mesh i has i % MaxMeshLODs + 1 levels, each one with half the indices of the previous one
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    Lotus::RenderMesh mesh = { 96, 1000 * i, 10 * i };
+    mesh.lodsCount = i % Lotus::MaxMeshLODs + 1;
+    mesh.lods[0] = { 0, 96, 0.0f };
+
+    for (uint32_t lod = 1; lod < mesh.lodsCount; lod++)
+    {
+      mesh.lods[lod] = { mesh.lods[lod - 1].firstIndex + mesh.lods[lod - 1].count, mesh.lods[lod - 1].count / 2, float(lod) };
+    }
+
+    renderMeshes.insert(mesh);
+  }
+
+  Lotus::BatchBuilder batchBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  const std::vector<Lotus::DrawBatch>& drawBatches = batchBuilder.getDrawBatches();
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(drawBatches.size());
+  batchBuilder.writeIndirectCommands(renderMeshes, commands.data());
+
+  std::vector<Lotus::DrawElementsIndirectCommand> lodCommands(drawBatches.size() * Lotus::MaxMeshLODs);
+  batchBuilder.writeLODIndirectCommands(renderMeshes, lodCommands.data());
+
+  // Every level of every batch has its own slots for all the instances of the batch
+  std::vector<uint8_t> usedSlots(batchBuilder.getObjectBatches().size() * Lotus::MaxMeshLODs, 0);
+
+  for (size_t i = 0; i < drawBatches.size(); i++)
+  {
+    const Lotus::RenderMesh& mesh = renderMeshes[drawBatches[i].meshHandle.get()];
+
+    for (uint32_t lod = 0; lod < Lotus::MaxMeshLODs; lod++)
+    {
+      const Lotus::DrawElementsIndirectCommand& command = lodCommands[i * Lotus::MaxMeshLODs + lod];
+
+      EXPECT_EQ(command.baseVertex, mesh.baseVertex);
+
+      if (lod == 0)
+      {
+        EXPECT_EQ(command.count, commands[i].count);
+        EXPECT_EQ(command.firstIndex, commands[i].firstIndex);
+        EXPECT_EQ(command.instanceCount, commands[i].instanceCount);
+      }
+      else
+      {
+        EXPECT_EQ(command.count, lod < mesh.lodsCount ? mesh.lods[lod].count : 0u);
+        EXPECT_EQ(command.instanceCount, 0u);
+      }
+
+      if (lod < mesh.lodsCount)
+      {
+        EXPECT_EQ(command.firstIndex, mesh.firstIndex + mesh.lods[lod].firstIndex);
+      }
+
+      for (uint32_t slot = command.baseInstance; slot < command.baseInstance + drawBatches[i].instanceCount; slot++)
+      {
+        ASSERT_LT(slot, usedSlots.size());
+        ASSERT_EQ(usedSlots[slot], 0) << "Draw batch " << i << ", LOD " << lod;
+        usedSlots[slot] = 1;
+      }
+    }
+  }
+
+  EXPECT_EQ(std::count(usedSlots.begin(), usedSlots.end(), 1), static_cast<std::ptrdiff_t>(usedSlots.size()));
+}
+
+TEST(BatchBuilderTest, WritesClusterRangesWithinTheLimits)
+{
+  std::mt19937 generator(23);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(500, generator);
+
+  // The even meshes have meshlets, the odd ones are drawn whole
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    Lotus::RenderMesh mesh = { 96, 1000 * i, 10 * i };
+    mesh.firstMeshlet = 100 * i;
+    mesh.meshletsCount = i % 2 == 0 ? 20 + i : 0;
+
+    renderMeshes.insert(mesh);
+  }
+
+  Lotus::BatchBuilder batchBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  const std::vector<Lotus::DrawBatch>& drawBatches = batchBuilder.getDrawBatches();
+
+  std::vector<Lotus::GPUClusterBatch> clusterBatches(drawBatches.size());
+  std::vector<Lotus::ClusterDraw> draws;
+
+  uint32_t commandsCount = batchBuilder.writeClusterBatches(renderMeshes, clusterBatches.data(), draws, UINT32_MAX, UINT32_MAX);
+
+  // Without limits every batch with meshlets is drawn by clusters, in draw batch order and with back to back ranges
+  uint32_t nextCommand = 0;
+  size_t drawIndex = 0;
+
+  for (uint32_t i = 0; i < drawBatches.size(); i++)
+  {
+    const Lotus::RenderMesh& mesh = renderMeshes[drawBatches[i].meshHandle.get()];
+    const Lotus::GPUClusterBatch& clusterBatch = clusterBatches[i];
+
+    EXPECT_EQ(clusterBatch.meshletsCount, mesh.meshletsCount);
+
+    if (mesh.meshletsCount == 0) { continue; }
+
+    ASSERT_LT(drawIndex, draws.size());
+
+    const Lotus::ClusterDraw& draw = draws[drawIndex];
+
+    EXPECT_EQ(draw.drawBatch, i);
+    EXPECT_TRUE(draw.shaderHandle == drawBatches[i].shaderHandle);
+    EXPECT_EQ(draw.firstCommand, nextCommand);
+    EXPECT_EQ(draw.maxCommands, mesh.meshletsCount * drawBatches[i].instanceCount);
+
+    EXPECT_EQ(clusterBatch.firstMeshlet, mesh.firstMeshlet);
+    EXPECT_EQ(clusterBatch.firstCommand, draw.firstCommand);
+    EXPECT_EQ(clusterBatch.countIndex, drawIndex);
+
+    nextCommand += draw.maxCommands;
+    drawIndex++;
+  }
+
+  EXPECT_EQ(drawIndex, draws.size());
+  EXPECT_EQ(commandsCount, nextCommand);
+
+  // With limits the batches that don't fit are drawn whole, the ones that fit keep their ranges
+  const uint32_t maxCommands = commandsCount / 2;
+  const uint32_t maxInstances = 100;
+
+  commandsCount = batchBuilder.writeClusterBatches(renderMeshes, clusterBatches.data(), draws, maxCommands, maxInstances);
+
+  EXPECT_LE(commandsCount, maxCommands);
+  EXPECT_FALSE(draws.empty());
+
+  uint32_t instancesCount = 0;
+  uint32_t clusteredCount = 0;
+
+  for (uint32_t i = 0; i < drawBatches.size(); i++)
+  {
+    if (clusterBatches[i].meshletsCount == 0) { continue; }
+
+    instancesCount += drawBatches[i].instanceCount;
+    clusteredCount++;
+  }
+
+  EXPECT_EQ(clusteredCount, draws.size());
+  EXPECT_LE(instancesCount, maxInstances);
+}
+
+TEST(BatchBuilderTest, OrdersByMaterialWithinDrawBatches)
+{
+  Lotus::SortKeyLayout layout;
+  layout.materialBits = 16;
+
+  std::mt19937 generator(77);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(3000, generator);
+  std::uniform_int_distribution<uint32_t> materialDistribution(0, 99);
+
+  for (Lotus::RenderObject& object : renderObjects)
+  {
+    object.materialHandle = materialDistribution(generator);
+  }
+
+  Lotus::BatchBuilder batchBuilder(layout);
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    batchBuilder.addObject(i, renderObjects[i]);
+  }
+
+  batchBuilder.build();
+
+  expectValidBatches(batchBuilder, renderObjects);
+
+  const std::vector<Lotus::ObjectBatch>& objectBatches = batchBuilder.getObjectBatches();
+
+  for (const Lotus::DrawBatch& drawBatch : batchBuilder.getDrawBatches())
+  {
+    for (uint32_t i = 1; i < drawBatch.instanceCount; i++)
+    {
+      uint32_t previousMaterial = renderObjects[objectBatches[drawBatch.prevInstanceCount + i - 1].objectHandle.get()].materialHandle.get();
+      uint32_t currentMaterial = renderObjects[objectBatches[drawBatch.prevInstanceCount + i].objectHandle.get()].materialHandle.get();
+
+      EXPECT_LE(previousMaterial, currentMaterial);
+    }
+  }
+}
+
+namespace
+{
+  // Applies random changes to an incremental and a full builder, and checks that uploading only the dirty ranges gives the same buffers
+  void expectIncrementalMatchesFull(const Lotus::SortKeyLayout& layout, uint32_t seed)
+  {
+    std::mt19937 generator(seed);
+    Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(3000, generator);
+    std::vector<bool> batched(renderObjects.size(), false);
+
+    Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+    for (uint32_t i = 0; i < 8; i++)
+    {
+      renderMeshes.insert({ 3 * (i + 1), 50 * i, 20 * i });
+    }
+
+    Lotus::BatchBuilder incrementalBuilder(layout);
+    Lotus::BatchBuilder fullBuilder(layout);
+    fullBuilder.setIncrementalBuild(false);
+
+    // Buffers only updated inside the dirty ranges, as the renderer uploads them
+    std::vector<Lotus::DrawElementsIndirectCommand> commands;
+    std::vector<uint32_t> objectHandles;
+
+    std::uniform_int_distribution<uint32_t> objectDistribution(0, static_cast<uint32_t>(renderObjects.size() - 1));
+    std::uniform_int_distribution<uint32_t> meshDistribution(0, 7);
+    std::uniform_int_distribution<uint32_t> shaderDistribution(0, 2);
+    std::uniform_int_distribution<int> actionDistribution(0, 2);
+
+    for (int frame = 0; frame < 60; frame++)
+    {
+      // Some frames don't change anything, and the first ones only add objects
+      int changesCount = frame % 5 == 4 ? 0 : (frame < 3 ? 1000 : 1 + frame % 40);
+      std::vector<bool> changed(renderObjects.size(), false);
+
+      for (int i = 0; i < changesCount; i++)
+      {
+        uint32_t objectIndex = objectDistribution(generator);
+
+        if (changed[objectIndex]) { continue; }
+        changed[objectIndex] = true;
+
+        Lotus::RenderObject& object = renderObjects[objectIndex];
+        int action = frame < 3 ? 0 : actionDistribution(generator);
+
+        if (!batched[objectIndex])
+        {
+          incrementalBuilder.addObject(objectIndex, object);
+          fullBuilder.addObject(objectIndex, object);
+          batched[objectIndex] = true;
+        }
+        else if (action == 1)
+        {
+          incrementalBuilder.removeObject(objectIndex, object);
+          fullBuilder.removeObject(objectIndex, object);
+          batched[objectIndex] = false;
+        }
+        else
+        {
+          object.meshHandle = meshDistribution(generator);
+          object.shaderHandle = shaderDistribution(generator);
+
+          incrementalBuilder.removeObject(objectIndex, object);
+          fullBuilder.removeObject(objectIndex, object);
+          incrementalBuilder.addObject(objectIndex, object);
+          fullBuilder.addObject(objectIndex, object);
+        }
+      }
+
+      incrementalBuilder.build();
+      fullBuilder.build();
+
+      const std::vector<Lotus::DrawBatch>& drawBatches = incrementalBuilder.getDrawBatches();
+      const std::vector<Lotus::DrawBatch>& expectedDrawBatches = fullBuilder.getDrawBatches();
+
+      ASSERT_EQ(drawBatches.size(), expectedDrawBatches.size()) << "At frame " << frame;
+
+      for (size_t i = 0; i < drawBatches.size(); i++)
+      {
+        EXPECT_EQ(drawBatches[i].prevInstanceCount, expectedDrawBatches[i].prevInstanceCount);
+        EXPECT_EQ(drawBatches[i].instanceCount, expectedDrawBatches[i].instanceCount);
+        EXPECT_TRUE(drawBatches[i].meshHandle == expectedDrawBatches[i].meshHandle);
+        EXPECT_TRUE(drawBatches[i].shaderHandle == expectedDrawBatches[i].shaderHandle);
+      }
+
+      const std::vector<Lotus::ShaderBatch>& shaderBatches = incrementalBuilder.getShaderBatches();
+      const std::vector<Lotus::ShaderBatch>& expectedShaderBatches = fullBuilder.getShaderBatches();
+
+      ASSERT_EQ(shaderBatches.size(), expectedShaderBatches.size()) << "At frame " << frame;
+
+      for (size_t i = 0; i < shaderBatches.size(); i++)
+      {
+        EXPECT_EQ(shaderBatches[i].first, expectedShaderBatches[i].first);
+        EXPECT_EQ(shaderBatches[i].count, expectedShaderBatches[i].count);
+      }
+
+      if (changesCount == 0)
+      {
+        EXPECT_TRUE(incrementalBuilder.getDirtyDrawRange().empty());
+        EXPECT_TRUE(incrementalBuilder.getDirtyObjectRange().empty());
+      }
+
+      commands.resize(drawBatches.size());
+      objectHandles.resize(incrementalBuilder.getObjectBatches().size());
+
+      incrementalBuilder.writeIndirectCommands(renderMeshes, commands.data(), incrementalBuilder.getDirtyDrawRange());
+      incrementalBuilder.writeObjectHandles(renderObjects, objectHandles.data(), incrementalBuilder.getDirtyObjectRange());
+      incrementalBuilder.clearDirtyRanges();
+
+      std::vector<Lotus::DrawElementsIndirectCommand> expectedCommands(expectedDrawBatches.size());
+      std::vector<uint32_t> expectedObjectHandles(fullBuilder.getObjectBatches().size());
+
+      fullBuilder.writeIndirectCommands(renderMeshes, expectedCommands.data());
+      fullBuilder.writeObjectHandles(renderObjects, expectedObjectHandles.data());
+
+      for (size_t i = 0; i < commands.size(); i++)
+      {
+        EXPECT_EQ(commands[i].count, expectedCommands[i].count) << "Command " << i << " at frame " << frame;
+        EXPECT_EQ(commands[i].instanceCount, expectedCommands[i].instanceCount) << "Command " << i << " at frame " << frame;
+        EXPECT_EQ(commands[i].baseInstance, expectedCommands[i].baseInstance) << "Command " << i << " at frame " << frame;
+      }
+
+      EXPECT_EQ(objectHandles, expectedObjectHandles) << "At frame " << frame;
+    }
+  }
+}
+
+TEST(BatchBuilderTest, IncrementalBuildMatchesFullBuild)
+{
+  expectIncrementalMatchesFull(Lotus::SortKeyLayout(), 2024);
+}
+
+TEST(BatchBuilderTest, IncrementalBuildMatchesFullBuildWithTruncatedKeys)
+{
+  // Two mesh bits for eight meshes, so objects of a draw batch can be split by other meshes
+  Lotus::SortKeyLayout layout;
+  layout.meshBits = 2;
+  layout.materialBits = 8;
+
+  expectIncrementalMatchesFull(layout, 7);
+}
+
+TEST(BatchBuilderTest, JobSystemMatchesSerialBuild)
+{
+  std::mt19937 generator(31);
+  Lotus::SlotMap<Lotus::RenderObject> renderObjects = createRenderObjects(50000, generator);
+
+  Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    renderMeshes.insert({ 6 * (i + 1), 100 * i, 10 * i });
+  }
+
+  Lotus::JobSystem jobSystem(3);
+
+  Lotus::BatchBuilder parallelBuilder;
+  parallelBuilder.setJobSystem(&jobSystem);
+  Lotus::BatchBuilder serialBuilder;
+
+  for (uint32_t i = 0; i < renderObjects.size(); i++)
+  {
+    parallelBuilder.addObject(i, renderObjects[i]);
+    serialBuilder.addObject(i, renderObjects[i]);
+  }
+
+  parallelBuilder.build();
+  serialBuilder.build();
+
+  // Enough changes for the removed and added objects to be sorted at the same time
+  std::uniform_int_distribution<uint32_t> meshDistribution(0, 7);
+
+  for (uint32_t i = 0; i < renderObjects.size(); i += 7)
+  {
+    parallelBuilder.removeObject(i, renderObjects[i]);
+    serialBuilder.removeObject(i, renderObjects[i]);
+
+    renderObjects[i].meshHandle = meshDistribution(generator);
+
+    parallelBuilder.addObject(i, renderObjects[i]);
+    serialBuilder.addObject(i, renderObjects[i]);
+  }
+
+  parallelBuilder.build();
+  serialBuilder.build();
+
+  expectValidBatches(parallelBuilder, renderObjects);
+
+  const std::vector<Lotus::ObjectBatch>& objectBatches = parallelBuilder.getObjectBatches();
+  const std::vector<Lotus::ObjectBatch>& expectedObjectBatches = serialBuilder.getObjectBatches();
+
+  ASSERT_EQ(objectBatches.size(), expectedObjectBatches.size());
+
+  for (size_t i = 0; i < objectBatches.size(); i++)
+  {
+    ASSERT_TRUE(objectBatches[i].objectHandle == expectedObjectBatches[i].objectHandle) << "Object batch " << i;
+  }
+
+  // The object batches are more than a write job, so the writes are split
+  std::vector<Lotus::GPUInstance> instances(objectBatches.size());
+  std::vector<Lotus::GPUInstance> expectedInstances(objectBatches.size());
+
+  parallelBuilder.writeInstances(renderObjects, instances.data());
+  serialBuilder.writeInstances(renderObjects, expectedInstances.data());
+
+  for (size_t i = 0; i < instances.size(); i++)
+  {
+    ASSERT_EQ(instances[i].objectID, expectedInstances[i].objectID) << "Instance " << i;
+    ASSERT_EQ(instances[i].drawBatchID, expectedInstances[i].drawBatchID) << "Instance " << i;
+  }
+
+  std::vector<uint32_t> objectHandles(objectBatches.size());
+  std::vector<uint32_t> expectedObjectHandles(objectBatches.size());
+
+  parallelBuilder.writeObjectHandles(renderObjects, objectHandles.data());
+  serialBuilder.writeObjectHandles(renderObjects, expectedObjectHandles.data());
+
+  EXPECT_EQ(objectHandles, expectedObjectHandles);
+}
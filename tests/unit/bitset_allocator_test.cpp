@@ -0,0 +1,78 @@
+#include <cstdint>
+#include <random>
+#include <set>
+#include <gtest/gtest.h>
+#include "util/bitset_allocator.h"
+
+using Lotus::BitsetAllocator;
+
+TEST(BitsetAllocatorTest, AcquiresLowestFreeSlot)
+{
+  BitsetAllocator slots;
+
+  EXPECT_EQ(slots.acquire(), BitsetAllocator::InvalidSlot);
+
+  slots.release(700);
+  slots.release(5);
+  slots.release(64);
+  slots.release(5);
+
+  EXPECT_EQ(slots.getFreeCount(), 3u);
+  EXPECT_TRUE(slots.isFree(64));
+  EXPECT_FALSE(slots.isFree(63));
+
+  EXPECT_EQ(slots.acquire(), 5u);
+  EXPECT_EQ(slots.acquire(), 64u);
+  EXPECT_EQ(slots.acquire(), 700u);
+  EXPECT_EQ(slots.acquire(), BitsetAllocator::InvalidSlot);
+  EXPECT_TRUE(slots.empty());
+}
+
+TEST(BitsetAllocatorTest, KeepsFreeSlotsWhenGrowing)
+{
+  BitsetAllocator slots;
+
+  slots.release(3);
+  // Needs three summary levels
+  slots.release(300000);
+  slots.release(1 << 20);
+
+  EXPECT_EQ(slots.acquire(), 3u);
+  EXPECT_EQ(slots.acquire(), 300000u);
+
+  slots.clear();
+
+  EXPECT_TRUE(slots.empty());
+  EXPECT_FALSE(slots.isFree(1 << 20));
+}
+
+TEST(BitsetAllocatorTest, MatchesOrderedSet)
+{
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<uint32_t> slotDistribution(0, 200000);
+  std::uniform_int_distribution<int> actionDistribution(0, 2);
+
+  BitsetAllocator slots;
+  std::set<uint32_t> reference;
+
+  for (int step = 0; step < 50000; step++)
+  {
+    if (actionDistribution(generator) == 0)
+    {
+      uint32_t expected = reference.empty() ? BitsetAllocator::InvalidSlot : *reference.begin();
+
+      if (!reference.empty()) { reference.erase(reference.begin()); }
+
+      ASSERT_EQ(slots.acquire(), expected);
+    }
+    else
+    {
+      uint32_t slot = slotDistribution(generator);
+
+      slots.release(slot);
+      reference.insert(slot);
+    }
+
+    ASSERT_EQ(slots.getFreeCount(), reference.size());
+  }
+}
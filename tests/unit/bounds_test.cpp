@@ -0,0 +1,60 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include "math/bounds.h"
+
+namespace
+{
+  void expectSameBounds(const Lotus::MeshBounds& bounds, const Lotus::MeshBounds& expected)
+  {
+    EXPECT_EQ(bounds.minimum, expected.minimum);
+    EXPECT_EQ(bounds.maximum, expected.maximum);
+    EXPECT_FLOAT_EQ(bounds.sphere.x, expected.sphere.x);
+    EXPECT_FLOAT_EQ(bounds.sphere.y, expected.sphere.y);
+    EXPECT_FLOAT_EQ(bounds.sphere.z, expected.sphere.z);
+    EXPECT_FLOAT_EQ(bounds.sphere.w, expected.sphere.w);
+  }
+}
+
+TEST(BoundsTest, BoundsPrimitives)
+{
+  Lotus::Cube cube;
+
+  Lotus::MeshBounds bounds = Lotus::computeMeshBounds(cube.vertices.data(), cube.vertices.size());
+
+  EXPECT_EQ(bounds.minimum, glm::vec3(-1.0f));
+  EXPECT_EQ(bounds.maximum, glm::vec3(1.0f));
+  EXPECT_FLOAT_EQ(bounds.sphere.x, 0.0f);
+  EXPECT_FLOAT_EQ(bounds.sphere.y, 0.0f);
+  EXPECT_FLOAT_EQ(bounds.sphere.z, 0.0f);
+  EXPECT_FLOAT_EQ(bounds.sphere.w, std::sqrt(3.0f));
+
+  EXPECT_EQ(Lotus::computeMeshBounds(nullptr, 0).sphere, glm::vec4(0.0f));
+}
+
+TEST(BoundsTest, MatchesScalarReference)
+{
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<float> distribution(-100.0f, 100.0f);
+
+  // Counts above the threshold are split between threads, and the odd counts exercise the scalar tails
+  for (size_t count : { size_t(1), size_t(7), size_t(1001), Lotus::ParallelBoundsMinVertices * 3 + 5 })
+  {
+    std::vector<Lotus::Vertex> vertices(count);
+
+    for (Lotus::Vertex& vertex : vertices)
+    {
+      vertex.position = glm::vec3(distribution(generator), distribution(generator) + 300.0f, distribution(generator) * 0.5f);
+      vertex.normal = glm::vec3(distribution(generator));
+    }
+
+    SCOPED_TRACE(count);
+
+    expectSameBounds(
+      Lotus::computeMeshBounds(vertices.data(), vertices.size()),
+      Lotus::computeMeshBoundsScalar(vertices.data(), vertices.size()));
+  }
+}
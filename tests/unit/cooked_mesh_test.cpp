@@ -0,0 +1,227 @@
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <filesystem>
+#include <optional>
+#include <vector>
+#include <gtest/gtest.h>
+#include "math/meshlet_builder.h"
+#include "render/indirect/cooked_mesh.h"
+
+class CookedMeshTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    directory = std::filesystem::temp_directory_path() / "lotus_cooked_mesh_test";
+    std::filesystem::create_directories(directory);
+
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+      Lotus::Vertex vertex;
+      vertex.position = glm::vec3(float(i), float(i % 7) - 3.0f, -float(i % 13));
+      vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+      vertex.uv = glm::vec2(float(i % 2), float(i % 3));
+      vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+      vertex.bitangent = glm::vec3(0.0f, 0.0f, 1.0f);
+
+      vertices.push_back(vertex);
+    }
+
+    for (uint32_t i = 0; i + 2 < 1000; i++)
+    {
+      indices.insert(indices.end(), { i, i + 1, i + 2 });
+    }
+
+    // Coarser level made of every other triangle, stored after the full one
+    lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+    lods.push_back({ static_cast<uint32_t>(indices.size()), 0, 0.5f });
+
+    for (uint32_t i = 0; i + 2 < 1000; i += 2)
+    {
+      indices.insert(indices.end(), { i, i + 1, i + 2 });
+      lods.back().count += 3;
+    }
+
+    Lotus::buildMeshlets(vertices, std::span<const unsigned int>(indices).first(lods[0].count), meshlets);
+
+    bounds = Lotus::computeMeshBounds(vertices.data(), vertices.size());
+  }
+
+  void TearDown() override
+  {
+    std::filesystem::remove_all(directory);
+  }
+
+  std::filesystem::path directory;
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  std::vector<Lotus::MeshLOD> lods;
+  std::vector<Lotus::Meshlet> meshlets;
+  Lotus::MeshBounds bounds;
+};
+
+TEST_F(CookedMeshTest, ReadsWhatWasWritten)
+{
+  std::filesystem::path path = directory / "mesh.lmesh";
+
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+  EXPECT_FALSE(std::filesystem::exists(directory / "mesh.lmesh.tmp"));
+
+  Lotus::CookedMesh cookedMesh;
+  ASSERT_TRUE(cookedMesh.open(path, 42));
+
+  ASSERT_EQ(cookedMesh.getVertices().size(), vertices.size());
+  ASSERT_EQ(cookedMesh.getIndices().size(), indices.size());
+
+  // The blobs are used in place, so they have to be aligned
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(cookedMesh.getVertices().data()) % Lotus::CookedMeshAlignment, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(cookedMesh.getIndices().data()) % Lotus::CookedMeshAlignment, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(cookedMesh.getMeshlets().data()) % Lotus::CookedMeshAlignment, 0u);
+
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    ASSERT_EQ(cookedMesh.getVertices()[i].position, vertices[i].position) << "Vertex " << i;
+    ASSERT_EQ(cookedMesh.getVertices()[i].uv, vertices[i].uv) << "Vertex " << i;
+    ASSERT_EQ(cookedMesh.getVertices()[i].bitangent, vertices[i].bitangent) << "Vertex " << i;
+  }
+
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    ASSERT_EQ(cookedMesh.getIndices()[i], indices[i]) << "Index " << i;
+  }
+
+  EXPECT_EQ(cookedMesh.getBounds().minimum, bounds.minimum);
+  EXPECT_EQ(cookedMesh.getBounds().maximum, bounds.maximum);
+  EXPECT_EQ(cookedMesh.getBounds().sphere, bounds.sphere);
+
+  ASSERT_EQ(cookedMesh.getLODs().size(), lods.size());
+
+  for (size_t i = 0; i < lods.size(); i++)
+  {
+    EXPECT_EQ(cookedMesh.getLODs()[i].firstIndex, lods[i].firstIndex);
+    EXPECT_EQ(cookedMesh.getLODs()[i].count, lods[i].count);
+    EXPECT_EQ(cookedMesh.getLODs()[i].error, lods[i].error);
+  }
+
+  ASSERT_GT(meshlets.size(), 1u);
+  ASSERT_EQ(cookedMesh.getMeshlets().size(), meshlets.size());
+
+  for (size_t i = 0; i < meshlets.size(); i++)
+  {
+    EXPECT_EQ(cookedMesh.getMeshlets()[i].firstIndex, meshlets[i].firstIndex);
+    EXPECT_EQ(cookedMesh.getMeshlets()[i].count, meshlets[i].count);
+    EXPECT_EQ(cookedMesh.getMeshlets()[i].boundingSphere, meshlets[i].boundingSphere);
+    EXPECT_EQ(cookedMesh.getMeshlets()[i].cone, meshlets[i].cone);
+  }
+
+  cookedMesh.close();
+  EXPECT_FALSE(cookedMesh.isOpen());
+  EXPECT_TRUE(cookedMesh.getVertices().empty());
+}
+
+TEST_F(CookedMeshTest, RejectsStaleAndDamagedFiles)
+{
+  std::filesystem::path path = directory / "mesh.lmesh";
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+
+  Lotus::CookedMesh cookedMesh;
+
+  // Cooked from another version of the source
+  EXPECT_FALSE(cookedMesh.open(path, 43));
+  EXPECT_FALSE(cookedMesh.isOpen());
+
+  // Without the source any valid file is used
+  EXPECT_TRUE(cookedMesh.open(path, std::nullopt));
+
+  EXPECT_FALSE(cookedMesh.open(directory / "missing.lmesh", std::nullopt));
+
+  // Another version of the format
+  {
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t version = Lotus::CookedMeshVersion + 1;
+    stream.seekp(offsetof(Lotus::CookedMeshHeader, version));
+    stream.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+
+  // A level of detail past the end of the indices
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+
+  {
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    uint32_t count = static_cast<uint32_t>(indices.size());
+    stream.seekp(offsetof(Lotus::CookedMeshHeader, lods) + sizeof(Lotus::MeshLOD) + offsetof(Lotus::MeshLOD, count));
+    stream.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+
+  // A meshlet past the end of the full detail level
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+
+  {
+    Lotus::CookedMeshHeader header;
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    uint32_t firstIndex = lods[0].count;
+    stream.seekp(header.meshletsOffset + (meshlets.size() - 1) * sizeof(Lotus::Meshlet) + offsetof(Lotus::Meshlet, firstIndex));
+    stream.write(reinterpret_cast<const char*>(&firstIndex), sizeof(firstIndex));
+  }
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+
+  // An index past the vertices, the ranges are still valid
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+
+  {
+    Lotus::CookedMeshHeader header;
+    std::fstream stream(path, std::ios::binary | std::ios::in | std::ios::out);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    unsigned int index = static_cast<unsigned int>(vertices.size());
+    stream.seekp(header.indicesOffset + (indices.size() / 2) * sizeof(unsigned int));
+    stream.write(reinterpret_cast<const char*>(&index), sizeof(index));
+  }
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+
+  // Truncated while it was copied, the blobs aren't read past the end of the file
+  ASSERT_TRUE(Lotus::writeCookedMesh(path, 42, vertices, indices, lods, meshlets, bounds));
+  std::filesystem::resize_file(path, std::filesystem::file_size(path) - sizeof(unsigned int));
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+
+  std::filesystem::resize_file(path, sizeof(Lotus::CookedMeshHeader) / 2);
+
+  EXPECT_FALSE(cookedMesh.open(path, 42));
+}
+
+TEST_F(CookedMeshTest, SourceHashDetectsChanges)
+{
+  std::filesystem::path sourcePath = directory / "mesh.obj";
+
+  {
+    std::ofstream stream(sourcePath);
+    stream << "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n";
+  }
+
+  std::optional<uint64_t> hash = Lotus::hashMeshSource(sourcePath, false);
+  ASSERT_TRUE(hash.has_value());
+
+  EXPECT_EQ(Lotus::hashMeshSource(sourcePath, false), hash);
+  // The import options change the cooked data
+  EXPECT_NE(Lotus::hashMeshSource(sourcePath, true), hash);
+
+  {
+    std::ofstream stream(sourcePath);
+    stream << "v 0 0 0\nv 2 0 0\nv 0 1 0\nf 1 2 3\n";
+  }
+
+  EXPECT_NE(Lotus::hashMeshSource(sourcePath, false), hash);
+  EXPECT_FALSE(Lotus::hashMeshSource(directory / "missing.obj", false).has_value());
+
+  EXPECT_EQ(Lotus::getCookedMeshPath(sourcePath), directory / "mesh.obj.lmesh");
+}
@@ -0,0 +1,151 @@
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "render/indirect/cpu_culling.h"
+
+namespace
+{
+  struct Scene
+  {
+    Lotus::SlotMap<Lotus::RenderObject> renderObjects;
+    Lotus::SlotMap<Lotus::RenderMesh> renderMeshes;
+    std::vector<Lotus::ObjectBatch> objectBatches;
+    std::vector<Lotus::DrawBatch> drawBatches;
+
+    // Brute force input of cullInstances
+    std::vector<Lotus::GPUObjectData> objects;
+    std::vector<Lotus::GPUInstance> instances;
+  };
+
+  // Objects scattered around the camera, in draw batches of random sizes
+  Scene createScene(uint32_t objectsCount)
+  {
+    std::mt19937 generator(17);
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> scale(0.2f, 3.0f);
+    std::uniform_int_distribution<uint32_t> batchSize(1, 300);
+
+    Scene scene;
+
+    std::vector<Lotus::Handle<Lotus::RenderMesh>> meshHandles;
+
+    for (float radius : { 0.5f, 1.0f, 4.0f })
+    {
+      Lotus::RenderMesh mesh;
+      mesh.boundingSphere = glm::vec4(0.0f, 0.5f, 0.0f, radius);
+      meshHandles.push_back(scene.renderMeshes.insert(mesh));
+    }
+
+    uint32_t drawBatchEnd = 0;
+
+    for (uint32_t i = 0; i < objectsCount; i++)
+    {
+      if (i == drawBatchEnd)
+      {
+        uint32_t size = std::min(batchSize(generator), objectsCount - i);
+
+        scene.drawBatches.push_back({ 0, meshHandles[scene.drawBatches.size() % meshHandles.size()], i, size });
+        drawBatchEnd = i + size;
+      }
+
+      Lotus::RenderObject object;
+      object.meshHandle = scene.drawBatches.back().meshHandle;
+      object.model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(position(generator), position(generator), position(generator))), glm::vec3(scale(generator)));
+      object.ID = objectsCount - 1 - i;
+
+      Lotus::Handle<Lotus::RenderObject> objectHandle = scene.renderObjects.insert(object);
+      scene.objectBatches.push_back({ 0, objectHandle, 0, object.meshHandle });
+
+      if (scene.objects.size() <= object.ID)
+      {
+        scene.objects.resize(object.ID + 1);
+      }
+
+      scene.objects[object.ID].model = object.model;
+      scene.objects[object.ID].boundingSphere = scene.renderMeshes[object.meshHandle].boundingSphere;
+      scene.instances.push_back({ object.ID, static_cast<uint32_t>(scene.drawBatches.size() - 1) });
+    }
+
+    return scene;
+  }
+
+  Lotus::Frustum createFrustum()
+  {
+    glm::mat4 view = glm::lookAt(glm::vec3(5.0f, 2.0f, 30.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    return Lotus::extractFrustum(glm::perspective(glm::radians(60.0f), 1.6f, 0.1f, 70.0f) * view);
+  }
+}
+
+TEST(CPUCullingTest, MatchesBruteForceReference)
+{
+  Scene scene = createScene(20011);
+  Lotus::Frustum frustum = createFrustum();
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(scene.drawBatches.size());
+  std::vector<uint32_t> objectHandles(scene.instances.size());
+
+  for (size_t i = 0; i < commands.size(); i++)
+  {
+    commands[i].baseInstance = scene.drawBatches[i].prevInstanceCount;
+  }
+
+  Lotus::cullInstances(frustum, scene.instances.data(), scene.instances.size(), scene.objects.data(), commands.data(), commands.size(), objectHandles.data());
+
+  Lotus::CPUCuller culler;
+  culler.gather(scene.objectBatches, scene.renderObjects, scene.renderMeshes);
+  culler.cull(frustum, scene.drawBatches);
+
+  uint32_t visibleCount = 0;
+
+  for (size_t i = 0; i < commands.size(); i++)
+  {
+    ASSERT_EQ(culler.getVisibleCounts()[i], commands[i].instanceCount) << "Draw batch " << i;
+
+    for (uint32_t j = 0; j < commands[i].instanceCount; j++)
+    {
+      ASSERT_EQ(culler.getVisibleObjectIDs()[commands[i].baseInstance + j], objectHandles[commands[i].baseInstance + j]);
+    }
+
+    visibleCount += commands[i].instanceCount;
+  }
+
+  // The scene has both visible and culled objects
+  EXPECT_GT(visibleCount, 0u);
+  EXPECT_LT(visibleCount, scene.instances.size());
+}
+
+TEST(CPUCullingTest, ThreadsGiveTheSameResult)
+{
+  Scene scene = createScene(50000);
+  Lotus::Frustum frustum = createFrustum();
+
+  Lotus::CPUCuller serialCuller;
+  serialCuller.gather(scene.objectBatches, scene.renderObjects, scene.renderMeshes);
+  serialCuller.cull(frustum, scene.drawBatches);
+
+  Lotus::JobSystem jobSystem(4);
+  Lotus::CPUCuller parallelCuller(&jobSystem);
+
+  // Repeated runs reuse the workers and the culler buffers
+  for (int run = 0; run < 3; run++)
+  {
+    parallelCuller.gather(scene.objectBatches, scene.renderObjects, scene.renderMeshes);
+    parallelCuller.cull(frustum, scene.drawBatches);
+
+    ASSERT_EQ(parallelCuller.getVisibleCounts(), serialCuller.getVisibleCounts());
+
+    for (const Lotus::DrawBatch& drawBatch : scene.drawBatches)
+    {
+      uint32_t batchIndex = static_cast<uint32_t>(&drawBatch - scene.drawBatches.data());
+
+      for (uint32_t j = 0; j < serialCuller.getVisibleCounts()[batchIndex]; j++)
+      {
+        ASSERT_EQ(parallelCuller.getVisibleObjectIDs()[drawBatch.prevInstanceCount + j], serialCuller.getVisibleObjectIDs()[drawBatch.prevInstanceCount + j]);
+      }
+    }
+  }
+}
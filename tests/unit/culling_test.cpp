@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "render/indirect/culling.h"
+
+namespace
+{
+  // Camera at the origin looking down -Z, at 10 units the frustum spans [-10, 10] in X and Y
+  Lotus::Frustum createFrustum()
+  {
+    return Lotus::extractFrustum(glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f));
+  }
+
+  Lotus::GPUObjectData createObject(glm::vec3 position, float radius)
+  {
+    Lotus::GPUObjectData object;
+    object.model = glm::translate(glm::mat4(1.0f), position);
+    object.boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, radius);
+
+    return object;
+  }
+}
+
+TEST(CullingTest, TestsSpheresAgainstFrustum)
+{
+  Lotus::Frustum frustum = createFrustum();
+
+  EXPECT_TRUE(Lotus::isSphereInFrustum(frustum, glm::vec4(0.0f, 0.0f, -10.0f, 1.0f)));
+  EXPECT_FALSE(Lotus::isSphereInFrustum(frustum, glm::vec4(0.0f, 0.0f, 10.0f, 1.0f)));
+  EXPECT_FALSE(Lotus::isSphereInFrustum(frustum, glm::vec4(0.0f, 0.0f, -200.0f, 1.0f)));
+
+  // Spheres crossing a plane are visible, the ones fully outside are not
+  EXPECT_TRUE(Lotus::isSphereInFrustum(frustum, glm::vec4(10.5f, 0.0f, -10.0f, 1.0f)));
+  EXPECT_FALSE(Lotus::isSphereInFrustum(frustum, glm::vec4(12.0f, 0.0f, -10.0f, 1.0f)));
+  EXPECT_TRUE(Lotus::isSphereInFrustum(frustum, glm::vec4(0.0f, -10.5f, -10.0f, 1.0f)));
+  EXPECT_FALSE(Lotus::isSphereInFrustum(frustum, glm::vec4(0.0f, -12.0f, -10.0f, 1.0f)));
+}
+
+TEST(CullingTest, TransformsSpheres)
+{
+  glm::mat4 model = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 0.0f, 0.0f)), glm::vec3(1.0f, 3.0f, 2.0f));
+  glm::vec4 transformed = Lotus::transformBoundingSphere(model, glm::vec4(1.0f, 0.0f, 0.0f, 2.0f));
+
+  // The radius grows with the largest scale
+  EXPECT_FLOAT_EQ(transformed.x, 6.0f);
+  EXPECT_FLOAT_EQ(transformed.w, 6.0f);
+}
+
+TEST(CullingTest, CompactsVisibleInstancesPerDrawBatch)
+{
+  Lotus::Frustum frustum = createFrustum();
+
+  std::vector<Lotus::GPUObjectData> objects =
+  {
+    createObject({ 0.0f, 0.0f, -10.0f }, 1.0f),
+    createObject({ 50.0f, 0.0f, -10.0f }, 1.0f),
+    createObject({ 2.0f, 0.0f, -20.0f }, 1.0f),
+    createObject({ 0.0f, 0.0f, 20.0f }, 1.0f),
+    createObject({ 0.0f, 3.0f, -5.0f }, 1.0f)
+  };
+
+  // Two draw batches, with the objects 3, 0 and 1 in the first and 2 and 4 in the second
+  std::vector<Lotus::GPUInstance> instances = { { 3, 0 }, { 0, 0 }, { 1, 0 }, { 2, 1 }, { 4, 1 } };
+
+  std::vector<Lotus::DrawElementsIndirectCommand> commands(2);
+  commands[0].instanceCount = 3;
+  commands[0].baseInstance = 0;
+  commands[1].instanceCount = 2;
+  commands[1].baseInstance = 3;
+
+  std::vector<uint32_t> objectHandles(instances.size(), 99);
+
+  Lotus::cullInstances(frustum, instances.data(), instances.size(), objects.data(), commands.data(), commands.size(), objectHandles.data());
+
+  EXPECT_EQ(commands[0].instanceCount, 1u);
+  EXPECT_EQ(commands[1].instanceCount, 2u);
+
+  EXPECT_EQ(objectHandles[0], 0u);
+  EXPECT_EQ(objectHandles[3], 2u);
+  EXPECT_EQ(objectHandles[4], 4u);
+
+  // Slots after the visible instances of a batch are not written
+  EXPECT_EQ(objectHandles[1], 99u);
+}
+
+TEST(CullingTest, ProjectsSpheresToTightRectangles)
+{
+  glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1.5f, 0.1f, 100.0f);
+
+  std::vector<glm::vec4> spheres = { { 0.0f, 0.0f, -10.0f, 1.0f }, { 4.0f, -2.0f, -6.0f, 0.5f }, { -3.0f, 5.0f, -20.0f, 3.0f } };
+
+  for (const glm::vec4& sphere : spheres)
+  {
+    glm::vec3 center(sphere.x, sphere.y, sphere.z);
+    glm::vec4 rectangle;
+
+    ASSERT_TRUE(Lotus::projectSphere(center, sphere.w, projection, rectangle));
+
+    // Every point of the surface falls inside the rectangle, and the extreme ones touch its edges
+    glm::vec4 bounds(1.0f, 1.0f, 0.0f, 0.0f);
+    float nearestDepth = 1.0f;
+
+    for (int i = 0; i <= 64; i++)
+    {
+      for (int j = 0; j < 128; j++)
+      {
+        float theta = glm::pi<float>() * i / 64.0f;
+        float phi = 2.0f * glm::pi<float>() * j / 128.0f;
+
+        glm::vec3 point = center + sphere.w * glm::vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+        glm::vec4 clip = projection * glm::vec4(point.x, point.y, point.z, 1.0f);
+        glm::vec3 window = glm::vec3(clip.x, clip.y, clip.z) / clip.w * 0.5f + glm::vec3(0.5f);
+
+        bounds = glm::vec4(std::min(bounds.x, window.x), std::min(bounds.y, window.y), std::max(bounds.z, window.x), std::max(bounds.w, window.y));
+        nearestDepth = std::min(nearestDepth, window.z);
+      }
+    }
+
+    EXPECT_LE(rectangle.x, bounds.x + 1e-5f);
+    EXPECT_LE(rectangle.y, bounds.y + 1e-5f);
+    EXPECT_GE(rectangle.z, bounds.z - 1e-5f);
+    EXPECT_GE(rectangle.w, bounds.w - 1e-5f);
+    EXPECT_NEAR(rectangle.x, bounds.x, 1e-3f);
+    EXPECT_NEAR(rectangle.w, bounds.w, 1e-3f);
+
+    EXPECT_LE(Lotus::computeSphereDepth(center, sphere.w, projection), nearestDepth + 1e-6f);
+  }
+
+  // Spheres crossing the near plane cover an unbounded area
+  glm::vec4 rectangle;
+  EXPECT_FALSE(Lotus::projectSphere(glm::vec3(0.0f, 0.0f, -0.5f), 1.0f, projection, rectangle));
+}
+
+TEST(CullingTest, TestsRectanglesAgainstDepthPyramid)
+{
+  const uint32_t width = 37;
+  const uint32_t height = 23;
+
+  // Far background with a near occluder over the left half of the screen
+  std::vector<float> depths(width * height, 1.0f);
+
+  for (uint32_t y = 0; y < height; y++)
+  {
+    for (uint32_t x = 0; x < width / 2; x++)
+    {
+      depths[y * width + x] = 0.5f;
+    }
+  }
+
+  // The levels halve the sizes rounding down, so they cover odd sizes with three texels
+  std::vector<std::vector<float>> levelsDepths;
+  std::vector<Lotus::DepthPyramidLevel> levels;
+  uint32_t levelWidth = width;
+  uint32_t levelHeight = height;
+
+  while (levelWidth > 1 || levelHeight > 1)
+  {
+    const float* input = levelsDepths.empty() ? depths.data() : levelsDepths.back().data();
+    uint32_t inputWidth = levelWidth;
+    uint32_t inputHeight = levelHeight;
+
+    levelWidth = std::max(levelWidth / 2, 1u);
+    levelHeight = std::max(levelHeight / 2, 1u);
+
+    levelsDepths.emplace_back(levelWidth * levelHeight);
+    Lotus::reduceDepth(input, inputWidth, inputHeight, levelsDepths.back().data(), levelWidth, levelHeight);
+
+    levels.push_back({ nullptr, levelWidth, levelHeight });
+  }
+
+  for (size_t level = 0; level < levels.size(); level++)
+  {
+    levels[level].depths = levelsDepths[level].data();
+  }
+
+  // The texels touching the occluder edge keep the background depth
+  EXPECT_EQ(levels[0].depths[7], 0.5f);
+  EXPECT_EQ(levels[0].depths[8], 1.0f);
+  EXPECT_EQ(levels.back().depths[0], 1.0f);
+
+  uint32_t levelsCount = static_cast<uint32_t>(levels.size());
+
+  EXPECT_TRUE(Lotus::isRectangleOccluded(levels.data(), levelsCount, glm::vec4(0.05f, 0.2f, 0.15f, 0.4f), 0.7f));
+  EXPECT_FALSE(Lotus::isRectangleOccluded(levels.data(), levelsCount, glm::vec4(0.05f, 0.2f, 0.15f, 0.4f), 0.4f));
+  // Large rectangles read coarse levels, where the occluder edge is mixed with the background
+  EXPECT_FALSE(Lotus::isRectangleOccluded(levels.data(), levelsCount, glm::vec4(0.1f, 0.2f, 0.3f, 0.6f), 0.7f));
+  EXPECT_FALSE(Lotus::isRectangleOccluded(levels.data(), levelsCount, glm::vec4(0.4f, 0.2f, 0.6f, 0.6f), 0.7f));
+  EXPECT_FALSE(Lotus::isRectangleOccluded(levels.data(), levelsCount, glm::vec4(0.7f, 0.7f, 0.8f, 0.8f), 0.7f));
+}
+
+TEST(CullingTest, SelectsCoarserLODsWithDistance)
+{
+  // 90 degrees of vertical field of view on 1000 pixels, a unit at distance 500 covers one pixel
+  glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 1000.0f);
+  float lodTarget = Lotus::computeLODTarget(projection, 1000.0f, 1.0f);
+
+  EXPECT_NEAR(lodTarget, 1.0f / 500.0f, 1e-6f);
+
+  // Three levels, the last one is missing
+  glm::vec4 lodErrors = glm::vec4(0.0f, 0.01f, 0.1f, std::numeric_limits<float>::max());
+
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 1.0f, 1.0f, lodTarget), 0u);
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 6.0f, 1.0f, lodTarget), 1u);
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 60.0f, 1.0f, lodTarget), 2u);
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 1e6f, 1.0f, lodTarget), 2u);
+
+  // Scaled objects have scaled errors
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 60.0f, 10.0f, lodTarget), 1u);
+
+  // The camera inside the sphere, and the full detail target
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, -3.0f, 1.0f, lodTarget), 0u);
+  EXPECT_EQ(Lotus::selectMeshLOD(lodErrors, 1e6f, 1.0f, 0.0f), 0u);
+}
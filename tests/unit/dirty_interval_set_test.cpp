@@ -0,0 +1,86 @@
+#include <cstddef>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "util/dirty_interval_set.h"
+
+TEST(DirtyIntervalSetTest, MergesAdjacentAndNearbyRanges)
+{
+  Lotus::DirtyIntervalSet intervals(2);
+
+  intervals.add(0, 4);
+  intervals.add(4, 6);
+  intervals.add(8, 10);
+  intervals.add(20, 21);
+
+  const std::vector<Lotus::DirtyIntervalSet::Interval>& result = intervals.getIntervals();
+
+  ASSERT_EQ(result.size(), 2u);
+  EXPECT_EQ(result[0].first, 0u);
+  EXPECT_EQ(result[0].end, 10u);
+  EXPECT_EQ(result[1].first, 20u);
+  EXPECT_EQ(result[1].end, 21u);
+  EXPECT_EQ(intervals.getDirtySize(), 11u);
+}
+
+TEST(DirtyIntervalSetTest, SortsUnorderedRanges)
+{
+  Lotus::DirtyIntervalSet intervals(0);
+
+  intervals.add(30, 31);
+  intervals.add(10, 12);
+  intervals.add(12, 14);
+  intervals.add(0, 1);
+  intervals.add(11, 13);
+
+  const std::vector<Lotus::DirtyIntervalSet::Interval>& result = intervals.getIntervals();
+
+  ASSERT_EQ(result.size(), 3u);
+  EXPECT_EQ(result[0].first, 0u);
+  EXPECT_EQ(result[1].first, 10u);
+  EXPECT_EQ(result[1].end, 14u);
+  EXPECT_EQ(result[2].first, 30u);
+
+  intervals.clear();
+
+  EXPECT_TRUE(intervals.empty());
+  EXPECT_TRUE(intervals.getIntervals().empty());
+}
+
+TEST(DirtyIntervalSetTest, CoversEveryMarkedElement)
+{
+  std::mt19937 generator(5);
+  std::uniform_int_distribution<size_t> firstDistribution(0, 999);
+  std::uniform_int_distribution<size_t> sizeDistribution(1, 8);
+
+  for (size_t mergeGap : { 0, 1, 16 })
+  {
+    Lotus::DirtyIntervalSet intervals(mergeGap);
+    std::vector<bool> marked(1010, false);
+
+    for (int i = 0; i < 200; i++)
+    {
+      size_t first = firstDistribution(generator);
+      size_t end = first + sizeDistribution(generator);
+
+      intervals.add(first, end);
+      std::fill(marked.begin() + first, marked.begin() + end, true);
+    }
+
+    const std::vector<Lotus::DirtyIntervalSet::Interval>& result = intervals.getIntervals();
+    std::vector<bool> covered(1010, false);
+
+    for (size_t i = 0; i < result.size(); i++)
+    {
+      // Every gap left between intervals is larger than the merge gap
+      if (i > 0) { EXPECT_GT(result[i].first, result[i - 1].end + mergeGap); }
+
+      std::fill(covered.begin() + result[i].first, covered.begin() + result[i].end, true);
+    }
+
+    for (size_t element = 0; element < marked.size(); element++)
+    {
+      if (marked[element]) { EXPECT_TRUE(covered[element]) << "element " << element; }
+    }
+  }
+}
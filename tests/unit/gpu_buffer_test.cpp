@@ -0,0 +1,499 @@
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glad/glad.h>
+#include "render/gpu_buffer.h"
+
+/*
+  The GL entry points are glad function pointers, so the tests replace them with a mock that keeps the
+  buffers in memory and records the fence calls
+*/
+namespace MockGL
+{
+  std::map<GLuint, std::vector<uint8_t>> buffers;
+  std::map<GLenum, GLuint> boundBuffers;
+  GLuint nextBufferID = 1;
+
+  uintptr_t nextFence = 1;
+  std::vector<GLsync> createdFences;
+  std::vector<GLsync> waitedFences;
+  std::vector<GLsync> deletedFences;
+  int timeoutsPerWait = 0;
+  int pendingTimeouts = 0;
+
+  int bufferSubDataCalls = 0;
+  std::vector<std::pair<GLintptr, GLsizeiptr>> bufferSubDataRanges;
+
+  void APIENTRY genBuffers(GLsizei n, GLuint* IDs)
+  {
+    for (GLsizei i = 0; i < n; i++) { IDs[i] = nextBufferID++; }
+  }
+
+  void APIENTRY deleteBuffers(GLsizei n, const GLuint* IDs)
+  {
+    for (GLsizei i = 0; i < n; i++) { buffers.erase(IDs[i]); }
+  }
+
+  void APIENTRY bindBuffer(GLenum target, GLuint ID)
+  {
+    boundBuffers[target] = ID;
+  }
+
+  void APIENTRY bufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags)
+  {
+    EXPECT_TRUE(flags & GL_MAP_PERSISTENT_BIT);
+    EXPECT_TRUE(flags & GL_MAP_COHERENT_BIT);
+
+    buffers[boundBuffers[target]].assign(size, 0);
+  }
+
+  void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+  {
+    buffers[boundBuffers[target]].assign(size, 0);
+  }
+
+  void* APIENTRY mapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+  {
+    return buffers[boundBuffers[target]].data() + offset;
+  }
+
+  void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+  {
+    bufferSubDataCalls++;
+    bufferSubDataRanges.emplace_back(offset, size);
+
+    std::memcpy(buffers[boundBuffers[target]].data() + offset, data, size);
+  }
+
+  void APIENTRY copyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+  {
+    std::memcpy(buffers[boundBuffers[writeTarget]].data() + writeOffset, buffers[boundBuffers[readTarget]].data() + readOffset, size);
+  }
+
+  GLsync APIENTRY fenceSync(GLenum condition, GLbitfield flags)
+  {
+    GLsync fence = reinterpret_cast<GLsync>(nextFence++);
+    createdFences.push_back(fence);
+    pendingTimeouts = timeoutsPerWait;
+
+    return fence;
+  }
+
+  GLenum APIENTRY clientWaitSync(GLsync fence, GLbitfield flags, GLuint64 timeout)
+  {
+    waitedFences.push_back(fence);
+
+    if (pendingTimeouts > 0)
+    {
+      pendingTimeouts--;
+      return GL_TIMEOUT_EXPIRED;
+    }
+
+    return GL_ALREADY_SIGNALED;
+  }
+
+  void APIENTRY deleteSync(GLsync fence)
+  {
+    deletedFences.push_back(fence);
+  }
+
+  void install()
+  {
+    buffers.clear();
+    boundBuffers.clear();
+    createdFences.clear();
+    waitedFences.clear();
+    deletedFences.clear();
+    timeoutsPerWait = 0;
+    pendingTimeouts = 0;
+    bufferSubDataCalls = 0;
+    bufferSubDataRanges.clear();
+
+    glad_glGenBuffers = genBuffers;
+    glad_glDeleteBuffers = deleteBuffers;
+    glad_glBindBuffer = bindBuffer;
+    glad_glBufferData = bufferData;
+    glad_glBufferStorage = bufferStorage;
+    glad_glMapBufferRange = mapBufferRange;
+    glad_glBufferSubData = bufferSubData;
+    glad_glCopyBufferSubData = copyBufferSubData;
+    glad_glFenceSync = fenceSync;
+    glad_glClientWaitSync = clientWaitSync;
+    glad_glDeleteSync = deleteSync;
+  }
+
+  const uint32_t* getRegion(GLuint ID, uint32_t region, size_t regionSize)
+  {
+    return reinterpret_cast<const uint32_t*>(buffers[ID].data()) + region * regionSize;
+  }
+}
+
+using RingBuffer = Lotus::UniformGPUBuffer<uint32_t, Lotus::GPUBufferPolicy::PersistentRing>;
+
+class GPUBufferRingTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    MockGL::install();
+  }
+};
+
+TEST_F(GPUBufferRingTest, RotatesRegions)
+{
+  const size_t regionSize = 8;
+  RingBuffer buffer;
+  buffer.allocate(regionSize);
+
+  ASSERT_EQ(MockGL::buffers[buffer.ID].size(), RingBuffer::RingRegionsCount * regionSize * sizeof(uint32_t));
+
+  for (uint32_t value = 10; value < 14; value++)
+  {
+    buffer.add(&value);
+  }
+
+  // Only the current region is written, without GL uploads
+  EXPECT_EQ(MockGL::bufferSubDataCalls, 0);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, regionSize)[3], 13u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 1, regionSize)[3], 0u);
+
+  for (uint32_t frame = 1; frame <= RingBuffer::RingRegionsCount; frame++)
+  {
+    buffer.nextFrame();
+
+    uint32_t region = frame % RingBuffer::RingRegionsCount;
+
+    // Each region receives the writes it missed before it is used
+    EXPECT_EQ(buffer.getCurrentRegion(), region);
+    EXPECT_EQ(buffer.getRegionOffset(), region * regionSize * sizeof(uint32_t));
+    EXPECT_EQ(MockGL::getRegion(buffer.ID, region, regionSize)[0], 10u);
+    EXPECT_EQ(MockGL::getRegion(buffer.ID, region, regionSize)[3], 13u);
+  }
+}
+
+TEST_F(GPUBufferRingTest, WaitsForRegionFences)
+{
+  RingBuffer buffer;
+  buffer.allocate(4);
+
+  MockGL::timeoutsPerWait = 2;
+
+  // The first regions were never used by the GPU
+  buffer.nextFrame();
+  buffer.nextFrame();
+
+  EXPECT_EQ(MockGL::createdFences.size(), 2u);
+  EXPECT_TRUE(MockGL::waitedFences.empty());
+
+  // Back to the first region, its fence is waited until it signals
+  buffer.nextFrame();
+
+  ASSERT_EQ(MockGL::createdFences.size(), 3u);
+  ASSERT_EQ(MockGL::waitedFences.size(), 3u);
+  EXPECT_EQ(MockGL::waitedFences[0], MockGL::createdFences[0]);
+  EXPECT_EQ(MockGL::waitedFences[2], MockGL::createdFences[0]);
+  ASSERT_EQ(MockGL::deletedFences.size(), 1u);
+  EXPECT_EQ(MockGL::deletedFences[0], MockGL::createdFences[0]);
+
+  MockGL::timeoutsPerWait = 0;
+  buffer.nextFrame();
+
+  ASSERT_EQ(MockGL::waitedFences.size(), 4u);
+  EXPECT_EQ(MockGL::waitedFences[3], MockGL::createdFences[1]);
+}
+
+TEST_F(GPUBufferRingTest, UploadsOnlyTouchedRanges)
+{
+  const size_t regionSize = 8;
+  RingBuffer buffer;
+  buffer.allocate(regionSize);
+
+  for (uint32_t value = 0; value < regionSize; value++)
+  {
+    buffer.add(&value);
+  }
+
+  for (uint32_t frame = 0; frame < RingBuffer::RingRegionsCount; frame++)
+  {
+    buffer.nextFrame();
+  }
+
+  // Changes in the CPU copy outside the unmapped range don't reach the mapped memory
+  uint32_t* data = buffer.map();
+  data[2] = 100;
+  data[5] = 200;
+  buffer.unmap(5, 1);
+
+  uint32_t region = buffer.getCurrentRegion();
+
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, region, regionSize)[5], 200u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, region, regionSize)[2], 2u);
+  EXPECT_EQ(MockGL::bufferSubDataCalls, 0);
+
+  buffer.nextFrame();
+
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, buffer.getCurrentRegion(), regionSize)[5], 200u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, buffer.getCurrentRegion(), regionSize)[2], 2u);
+}
+
+TEST_F(GPUBufferRingTest, ReallocationKeepsData)
+{
+  const size_t regionSize = 2;
+  RingBuffer buffer;
+  buffer.allocate(regionSize);
+
+  for (uint32_t value = 0; value < 5; value++)
+  {
+    buffer.add(&value);
+  }
+
+  ASSERT_EQ(buffer.allocatedSize, 8u);
+
+  // The element added after the reallocation reaches the other regions when they are reused
+  for (uint32_t frame = 0; frame < RingBuffer::RingRegionsCount; frame++)
+  {
+    const uint32_t* data = MockGL::getRegion(buffer.ID, buffer.getCurrentRegion(), buffer.allocatedSize);
+
+    for (uint32_t value = 0; value < 5; value++)
+    {
+      EXPECT_EQ(data[value], value);
+    }
+
+    buffer.nextFrame();
+  }
+}
+
+using ShadowBuffer = Lotus::UniformGPUBuffer<uint32_t, Lotus::GPUBufferPolicy::CPUShadow>;
+
+TEST(GPUBufferShadowTest, UploadsCoalescedDirtyRanges)
+{
+  MockGL::install();
+
+  ShadowBuffer buffer;
+  buffer.allocate(1024);
+  buffer.setDirtyMergeGap(4);
+
+  for (uint32_t value = 0; value < 1024; value++)
+  {
+    buffer.add(&value);
+  }
+
+  buffer.resetUploadCounters();
+  MockGL::bufferSubDataRanges.clear();
+
+  uint32_t* data = buffer.map();
+
+  // Two writes within the gap are uploaded together, the far one alone
+  for (uint32_t index : { 10, 13, 500 })
+  {
+    data[index] = 7;
+    buffer.markDirty(index);
+  }
+
+  buffer.unmap();
+
+  ASSERT_EQ(MockGL::bufferSubDataRanges.size(), 2u);
+  EXPECT_EQ(MockGL::bufferSubDataRanges[0].first, 10 * sizeof(uint32_t));
+  EXPECT_EQ(MockGL::bufferSubDataRanges[0].second, 4 * sizeof(uint32_t));
+  EXPECT_EQ(MockGL::bufferSubDataRanges[1].first, 500 * sizeof(uint32_t));
+  EXPECT_EQ(MockGL::bufferSubDataRanges[1].second, sizeof(uint32_t));
+  EXPECT_EQ(buffer.getUploadedBytes(), 5 * sizeof(uint32_t));
+  EXPECT_EQ(buffer.getUploadsCount(), 2u);
+
+  // Nothing is uploaded when nothing was marked
+  buffer.resetUploadCounters();
+  buffer.map();
+  buffer.unmap();
+
+  EXPECT_EQ(buffer.getUploadedBytes(), 0u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[13], 7u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[14], 14u);
+}
+
+TEST_F(GPUBufferRingTest, CountsUploadedBytes)
+{
+  RingBuffer buffer;
+  buffer.allocate(64);
+  buffer.setDirtyMergeGap(0);
+
+  for (uint32_t value = 0; value < 64; value++)
+  {
+    buffer.add(&value);
+  }
+
+  for (uint32_t frame = 0; frame < RingBuffer::RingRegionsCount; frame++)
+  {
+    buffer.nextFrame();
+  }
+
+  buffer.resetUploadCounters();
+
+  uint32_t* data = buffer.map();
+  data[3] = 1;
+  data[40] = 1;
+  buffer.markDirty(3);
+  buffer.markDirty(40);
+  buffer.unmap();
+
+  EXPECT_EQ(buffer.getUploadedBytes(), 2 * sizeof(uint32_t));
+
+  // The next region catches up with the same two elements
+  buffer.nextFrame();
+
+  EXPECT_EQ(buffer.getUploadedBytes(), 4 * sizeof(uint32_t));
+  EXPECT_EQ(buffer.getUploadsCount(), 4u);
+}
+
+using GeometryBuffer = Lotus::NonUniformGPUBuffer<uint32_t>;
+
+TEST(NonUniformGPUBufferTest, ReusesRemovedRanges)
+{
+  MockGL::install();
+
+  GeometryBuffer buffer;
+  buffer.allocate(16);
+
+  std::vector<uint32_t> values(12);
+
+  for (uint32_t i = 0; i < values.size(); i++) { values[i] = i + 1; }
+
+  uint32_t first = buffer.add(values.data(), 4);
+  uint32_t second = buffer.add(values.data() + 4, 4);
+  uint32_t third = buffer.add(values.data() + 8, 4);
+
+  EXPECT_EQ(first, 0u);
+  EXPECT_EQ(second, 4u);
+  EXPECT_EQ(third, 8u);
+
+  // The removed ranges merge, so a larger range fits where two smaller ones were
+  buffer.remove(first);
+  buffer.remove(second);
+
+  EXPECT_EQ(buffer.getAllocationStatistics().freeBlocksCount, 2u);
+
+  uint32_t merged = buffer.add(values.data(), 8);
+
+  EXPECT_EQ(merged, 0u);
+  EXPECT_EQ(buffer.allocatedSize, 16u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[7], 8u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[8], 9u);
+}
+
+TEST(NonUniformGPUBufferTest, GrowsWhenNoRangeFits)
+{
+  MockGL::install();
+
+  GeometryBuffer buffer;
+  buffer.allocate(8);
+
+  std::vector<uint32_t> values(10, 3);
+
+  buffer.add(values.data(), 6);
+  uint32_t first = buffer.add(values.data(), 10);
+
+  // The free tail of the old buffer is extended by the reallocation
+  EXPECT_EQ(first, 6u);
+  EXPECT_GE(buffer.allocatedSize, 16u);
+  EXPECT_EQ(buffer.filledSize, 16u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[0], 3u);
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[15], 3u);
+
+  Lotus::TLSFAllocator::Statistics statistics = buffer.getAllocationStatistics();
+
+  EXPECT_EQ(statistics.usedSize, 16u);
+  EXPECT_EQ(statistics.capacity, buffer.allocatedSize);
+}
+
+TEST(NonUniformGPUBufferTest, ReservedRangesAreWrittenInSteps)
+{
+  MockGL::install();
+
+  GeometryBuffer buffer;
+  buffer.allocate(16);
+
+  std::vector<uint32_t> values(10);
+
+  for (uint32_t i = 0; i < values.size(); i++) { values[i] = 100 + i; }
+
+  uint32_t first = buffer.add(values.data(), 2);
+  uint32_t reserved = buffer.reserve(8);
+
+  // Reserving uploads nothing, but the range is taken
+  EXPECT_EQ(reserved, 2u);
+  EXPECT_EQ(buffer.filledSize, 10u);
+  EXPECT_EQ(buffer.getUploadedBytes(), 2 * sizeof(uint32_t));
+  EXPECT_EQ(buffer.add(values.data(), 2), 10u);
+
+  // As the renderer uploads a mesh over several frames
+  buffer.write(values.data() + 2, reserved, 5);
+  buffer.write(values.data() + 7, reserved + 5, 3);
+
+  for (uint32_t i = 0; i < 8; i++)
+  {
+    EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[reserved + i], 102 + i);
+  }
+
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[first], 100u);
+
+  buffer.remove(reserved);
+
+  EXPECT_EQ(buffer.getAllocationStatistics().usedSize, 4u);
+}
+
+TEST(NonUniformGPUBufferTest, CompactsWithinBudget)
+{
+  MockGL::install();
+
+  GeometryBuffer buffer;
+  buffer.allocate(64);
+
+  std::vector<uint32_t> ranges[4];
+  uint32_t firsts[4];
+
+  for (uint32_t range = 0; range < 4; range++)
+  {
+    ranges[range].assign(8, range + 1);
+    firsts[range] = buffer.add(ranges[range].data(), ranges[range].size());
+  }
+
+  buffer.remove(firsts[0]);
+  buffer.remove(firsts[2]);
+
+  EXPECT_EQ(buffer.getHolesSize(), 16u);
+
+  // The budget only allows one range per step, the second one overlaps its destination
+  std::vector<GeometryBuffer::Move> moves;
+
+  EXPECT_EQ(buffer.compact(8 * sizeof(uint32_t), moves), 8 * sizeof(uint32_t));
+  ASSERT_EQ(moves.size(), 1u);
+  EXPECT_EQ(moves[0].from, 8u);
+  EXPECT_EQ(moves[0].to, 0u);
+
+  buffer.compact(8 * sizeof(uint32_t), moves);
+
+  ASSERT_EQ(moves.size(), 2u);
+  EXPECT_EQ(moves[1].from, 24u);
+  EXPECT_EQ(moves[1].to, 8u);
+  EXPECT_EQ(buffer.getHolesSize(), 0u);
+  EXPECT_EQ(buffer.filledSize, 16u);
+
+  const uint32_t* data = MockGL::getRegion(buffer.ID, 0, 0);
+
+  for (uint32_t i = 0; i < 16; i++)
+  {
+    EXPECT_EQ(data[i], i < 8 ? 2u : 4u);
+  }
+
+  buffer.shrinkToFit();
+
+  EXPECT_EQ(buffer.allocatedSize, 16u);
+  EXPECT_EQ(MockGL::buffers[buffer.ID].size(), 16 * sizeof(uint32_t));
+  EXPECT_EQ(MockGL::getRegion(buffer.ID, 0, 0)[15], 4u);
+
+  // Removing and adding after the shrink keeps working on the smaller space
+  buffer.remove(0);
+
+  EXPECT_EQ(buffer.add(ranges[0].data(), 8), 0u);
+}
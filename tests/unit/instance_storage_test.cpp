@@ -0,0 +1,111 @@
+#include <cstdint>
+#include <vector>
+#include <gtest/gtest.h>
+#include "render/indirect/instance_storage.h"
+
+TEST(InstanceStorageTest, CreatesAndDestroysInstances)
+{
+  Lotus::InstanceStorage storage;
+
+  Lotus::InstanceID first = storage.create(1, 2, 0, glm::vec3(1.0f, 0.0f, 0.0f));
+  Lotus::InstanceID second = storage.create(3, 4, 1, glm::vec3(2.0f, 0.0f, 0.0f));
+  Lotus::InstanceID third = storage.create(5, 6, 1, glm::vec3(3.0f, 0.0f, 0.0f));
+
+  EXPECT_EQ(storage.size(), 3u);
+  EXPECT_TRUE(storage.destroy(first));
+  EXPECT_FALSE(storage.destroy(first));
+  EXPECT_FALSE(storage.contains(first));
+
+  // The last instance fills the hole, its ID still finds its data
+  EXPECT_EQ(storage.size(), 2u);
+  EXPECT_EQ(storage.getIndex(third), 0u);
+  EXPECT_EQ(storage.getTranslation(third).x, 3.0f);
+  EXPECT_EQ(storage.getMeshHandle(third), Lotus::Handle<Lotus::RenderMesh>(5));
+  EXPECT_EQ(storage.getTranslation(second).x, 2.0f);
+  EXPECT_EQ(storage.getID(storage.getIndex(second)), second);
+
+  // The freed slot is reused with a new generation
+  Lotus::InstanceID fourth = storage.create(7, 8, 0);
+
+  EXPECT_EQ(fourth.get(), first.get());
+  EXPECT_FALSE(storage.contains(first));
+  EXPECT_TRUE(storage.contains(fourth));
+
+  storage.clear();
+
+  EXPECT_EQ(storage.size(), 0u);
+  EXPECT_FALSE(storage.contains(second));
+  EXPECT_FALSE(storage.contains(fourth));
+}
+
+TEST(InstanceStorageTest, TracksDirtyInstancesOnce)
+{
+  Lotus::InstanceStorage storage;
+
+  Lotus::InstanceID first = storage.create(1, 2, 0);
+  Lotus::InstanceID second = storage.create(1, 2, 0);
+
+  EXPECT_TRUE(storage.getDirtyInstances().empty());
+
+  storage.translate(first, glm::vec3(1.0f));
+  storage.scale(first, glm::vec3(2.0f));
+  storage.setMesh(first, 3);
+  storage.setMaterial(second, 2, 0);
+
+  // Setting the same handles doesn't dirty the instance
+  ASSERT_EQ(storage.getDirtyInstances().size(), 1u);
+  EXPECT_EQ(storage.getDirtyInstances()[0], first);
+  EXPECT_EQ(storage.getDirtyFlags()[storage.getIndex(first)], Lotus::InstanceStorage::TransformDirty | Lotus::InstanceStorage::MeshDirty);
+
+  storage.setMaterial(second, 4, 1);
+
+  EXPECT_EQ(storage.getDirtyFlags()[storage.getIndex(second)], Lotus::InstanceStorage::MaterialDirty | Lotus::InstanceStorage::ShaderDirty);
+
+  storage.clearDirty();
+
+  EXPECT_TRUE(storage.getDirtyInstances().empty());
+  EXPECT_EQ(storage.getDirtyFlags()[0], 0);
+  EXPECT_EQ(storage.getDirtyFlags()[1], 0);
+}
+
+TEST(InstanceStorageTest, BulkUpdatesMatchSingleUpdates)
+{
+  Lotus::InstanceStorage bulkStorage;
+  Lotus::InstanceStorage singleStorage;
+  std::vector<Lotus::InstanceID> singleIDs;
+
+  const uint32_t instancesCount = 64;
+
+  for (uint32_t i = 0; i < instancesCount; i++)
+  {
+    glm::vec3 translation(static_cast<float>(i), 0.0f, -1.0f);
+
+    bulkStorage.create(0, 0, 0, translation);
+    singleIDs.push_back(singleStorage.create(0, 0, 0, translation));
+  }
+
+  glm::vec3* translations = bulkStorage.getTranslations();
+  glm::vec3* scales = bulkStorage.getScales();
+
+  for (uint32_t i = 0; i < instancesCount; i++)
+  {
+    translations[i] += glm::vec3(0.0f, 1.0f, 0.0f);
+    scales[i] *= 3.0f;
+  }
+
+  bulkStorage.markTransformsDirty(0, instancesCount);
+
+  for (Lotus::InstanceID instanceID : singleIDs)
+  {
+    singleStorage.translate(instanceID, glm::vec3(0.0f, 1.0f, 0.0f));
+    singleStorage.scale(instanceID, glm::vec3(3.0f));
+  }
+
+  EXPECT_EQ(bulkStorage.getDirtyInstances().size(), instancesCount);
+  EXPECT_EQ(singleStorage.getDirtyInstances().size(), instancesCount);
+
+  for (uint32_t i = 0; i < instancesCount; i++)
+  {
+    EXPECT_EQ(bulkStorage.getModelMatrix(i), singleStorage.getModelMatrix(singleIDs[i]));
+  }
+}
@@ -0,0 +1,191 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "core/job_system.h"
+
+TEST(JobSystemTest, ParallelForRunsEveryElementOnce)
+{
+  Lotus::JobSystem jobSystem(3);
+
+  EXPECT_EQ(jobSystem.getThreadsCount(), 4u);
+
+  for (size_t count : { size_t(0), size_t(1), size_t(7), size_t(1000), size_t(100003) })
+  {
+    std::vector<std::atomic<uint32_t>> visits(count);
+
+    jobSystem.parallelFor(count, 16, [&](size_t first, size_t last)
+    {
+      for (size_t i = first; i < last; i++)
+      {
+        visits[i]++;
+      }
+    });
+
+    for (size_t i = 0; i < count; i++)
+    {
+      ASSERT_EQ(visits[i], 1u) << "Element " << i << " of " << count;
+    }
+  }
+}
+
+TEST(JobSystemTest, RunsSmallLoopsOnTheCallingThread)
+{
+  Lotus::JobSystem jobSystem(2);
+
+  size_t chunks = 0;
+
+  // A single chunk isn't queued, so the counter needs no synchronization
+  jobSystem.parallelFor(100, 1000, [&](size_t first, size_t last)
+  {
+    EXPECT_EQ(first, 0u);
+    EXPECT_EQ(last, 100u);
+    chunks++;
+  });
+
+  EXPECT_EQ(chunks, 1u);
+}
+
+TEST(JobSystemTest, CountersWaitForTheirJobs)
+{
+  Lotus::JobSystem jobSystem(3);
+
+  std::atomic<uint32_t> ranJobs = 0;
+  Lotus::JobCounter counter;
+
+  for (int i = 0; i < 1000; i++)
+  {
+    jobSystem.run([&]() { ranJobs++; }, &counter);
+  }
+
+  jobSystem.wait(counter);
+
+  EXPECT_TRUE(counter.isDone());
+  EXPECT_EQ(ranJobs, 1000u);
+}
+
+TEST(JobSystemTest, DependentJobsRunAfterTheirDependency)
+{
+  Lotus::JobSystem jobSystem(3);
+
+  for (int run = 0; run < 100; run++)
+  {
+    std::atomic<uint32_t> firstStageJobs = 0;
+    std::atomic<uint32_t> secondStageErrors = 0;
+
+    Lotus::JobCounter firstStage;
+    Lotus::JobCounter secondStage;
+
+    for (int i = 0; i < 16; i++)
+    {
+      jobSystem.run([&]() { firstStageJobs++; }, &firstStage);
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+      jobSystem.runAfter(firstStage, [&]() { if (firstStageJobs != 16) { secondStageErrors++; } }, &secondStage);
+    }
+
+    jobSystem.wait(secondStage);
+    jobSystem.wait(firstStage);
+
+    ASSERT_EQ(secondStageErrors, 0u);
+  }
+
+  // A finished dependency queues the job right away
+  Lotus::JobCounter finished;
+  Lotus::JobCounter counter;
+  bool ran = false;
+
+  jobSystem.runAfter(finished, [&]() { ran = true; }, &counter);
+  jobSystem.wait(counter);
+
+  EXPECT_TRUE(ran);
+}
+
+TEST(JobSystemTest, JobsCanWaitForNestedJobs)
+{
+  Lotus::JobSystem jobSystem(2);
+
+  std::vector<std::atomic<uint32_t>> visits(64 * 1024);
+
+  // More outer jobs than threads, every thread ends up waiting inside a job
+  jobSystem.parallelFor(64, 1, [&](size_t firstOuter, size_t lastOuter)
+  {
+    for (size_t outer = firstOuter; outer < lastOuter; outer++)
+    {
+      jobSystem.parallelFor(1024, 64, [&](size_t first, size_t last)
+      {
+        for (size_t i = first; i < last; i++)
+        {
+          visits[outer * 1024 + i]++;
+        }
+      });
+    }
+  });
+
+  for (size_t i = 0; i < visits.size(); i++)
+  {
+    ASSERT_EQ(visits[i], 1u) << "Element " << i;
+  }
+}
+
+TEST(JobSystemTest, RunsJobsWithoutWorkers)
+{
+  Lotus::JobSystem jobSystem(0);
+
+  EXPECT_EQ(jobSystem.getThreadsCount(), 1u);
+
+  uint32_t ranJobs = 0;
+  Lotus::JobCounter counter;
+
+  // Queued jobs run on the waiting thread
+  for (int i = 0; i < 10; i++)
+  {
+    jobSystem.run([&]() { ranJobs++; }, &counter);
+  }
+
+  EXPECT_EQ(ranJobs, 0u);
+
+  jobSystem.wait(counter);
+
+  EXPECT_EQ(ranJobs, 10u);
+}
+
+TEST(JobSystemTest, DetachedJobsFinishWithoutWaits)
+{
+  Lotus::JobSystem jobSystem(0);
+
+  uint32_t ranJobs = 0;
+  Lotus::JobCounter counter;
+
+  // Polled like Mesh::isReady, nothing waits for the counter
+  jobSystem.runDetached([&]() { ranJobs++; }, &counter);
+
+  EXPECT_TRUE(counter.isDone());
+  EXPECT_EQ(ranJobs, 1u);
+}
+
+TEST(JobSystemTest, DetachedJobsRunOnTheWorkers)
+{
+  Lotus::JobSystem jobSystem(2);
+
+  std::atomic<uint32_t> ranJobs = 0;
+  Lotus::JobCounter counter;
+
+  for (int i = 0; i < 10; i++)
+  {
+    jobSystem.runDetached([&]() { ranJobs++; }, &counter);
+  }
+
+  while (!counter.isDone())
+  {
+    std::this_thread::yield();
+  }
+
+  EXPECT_EQ(ranJobs.load(), 10u);
+
+  // The last job may still hold the counter
+  jobSystem.wait(counter);
+}
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+#include <tuple>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include "math/mesh_optimizer.h"
+
+namespace
+{
+  using Triangle = std::array<std::tuple<float, float, float>, 3>;
+
+  // Triangles by position, rotated so the smallest corner is first, which keeps the winding
+  std::vector<Triangle> getTriangles(const std::vector<Lotus::Vertex>& vertices, const std::vector<unsigned int>& indices)
+  {
+    std::vector<Triangle> triangles;
+
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+      Triangle triangle;
+
+      for (int j = 0; j < 3; j++)
+      {
+        const glm::vec3& position = vertices[indices[i + j]].position;
+        triangle[j] = { position.x, position.y, position.z };
+      }
+
+      std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+      triangles.push_back(triangle);
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+
+    return triangles;
+  }
+
+  // Grid of quads in shuffled order, each triangle with its own vertices as some exporters write them
+  void createShuffledGrid(uint32_t size, std::vector<Lotus::Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    std::vector<std::array<glm::vec3, 3>> triangles;
+
+    for (uint32_t y = 0; y < size; y++)
+    {
+      for (uint32_t x = 0; x < size; x++)
+      {
+        glm::vec3 a = glm::vec3(float(x), float(y), 0.0f);
+        glm::vec3 b = glm::vec3(float(x + 1), float(y), 0.0f);
+        glm::vec3 c = glm::vec3(float(x + 1), float(y + 1), 0.0f);
+        glm::vec3 d = glm::vec3(float(x), float(y + 1), 0.0f);
+
+        triangles.push_back({ a, b, c });
+        triangles.push_back({ a, c, d });
+      }
+    }
+
+    std::shuffle(triangles.begin(), triangles.end(), std::mt19937(9));
+
+    for (const auto& triangle : triangles)
+    {
+      for (const glm::vec3& position : triangle)
+      {
+        Lotus::Vertex vertex;
+        vertex.position = position;
+        vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        vertex.uv = glm::vec2(position.x, position.y);
+        vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+        vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+
+        indices.push_back(static_cast<unsigned int>(vertices.size()));
+        vertices.push_back(vertex);
+      }
+    }
+  }
+}
+
+TEST(MeshOptimizerTest, AnalyzesTheVertexCache)
+{
+  // Two triangles sharing an edge, 4 vertices transformed once
+  std::vector<unsigned int> quad = { 0, 1, 2, 0, 2, 3 };
+
+  Lotus::VertexCacheStatistics statistics = Lotus::analyzeVertexCache(quad, 4);
+
+  EXPECT_EQ(statistics.verticesTransformed, 4u);
+  EXPECT_EQ(statistics.verticesCount, 4u);
+  EXPECT_EQ(statistics.trianglesCount, 2u);
+  EXPECT_FLOAT_EQ(statistics.ACMR, 2.0f);
+  EXPECT_FLOAT_EQ(statistics.ATVR, 1.0f);
+
+  // With a cache of 3 vertices the first one is evicted before it is reused
+  std::vector<unsigned int> strip = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+
+  EXPECT_EQ(Lotus::analyzeVertexCache(strip, 6, 3).verticesTransformed, 9u);
+  EXPECT_EQ(Lotus::analyzeVertexCache(strip, 6, 6).verticesTransformed, 6u);
+}
+
+TEST(MeshOptimizerTest, DeduplicatesVertices)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createShuffledGrid(8, vertices, indices);
+
+  std::vector<Triangle> triangles = getTriangles(vertices, indices);
+
+  Lotus::deduplicateVertices(vertices, indices);
+
+  EXPECT_EQ(vertices.size(), 9u * 9u);
+  EXPECT_EQ(getTriangles(vertices, indices), triangles);
+}
+
+TEST(MeshOptimizerTest, OptimizedMeshesHaveTheSameTriangles)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createShuffledGrid(64, vertices, indices);
+
+  std::vector<Triangle> triangles = getTriangles(vertices, indices);
+
+  Lotus::MeshOptimizationReport report;
+  Lotus::optimizeMesh(vertices, indices, &report);
+
+  EXPECT_EQ(getTriangles(vertices, indices), triangles);
+  EXPECT_EQ(vertices.size(), 65u * 65u);
+
+  // Every triangle had its own vertices, a grid in a good order reuses most of them
+  EXPECT_FLOAT_EQ(report.before.ACMR, 3.0f);
+  EXPECT_LT(report.after.ACMR, 1.0f);
+  EXPECT_LT(report.after.ATVR, 1.6f);
+
+  // Vertices are in the order of first use
+  unsigned int nextVertex = 0;
+
+  for (unsigned int index : indices)
+  {
+    ASSERT_LE(index, nextVertex);
+
+    if (index == nextVertex) { nextVertex++; }
+  }
+
+  EXPECT_EQ(nextVertex, vertices.size());
+}
+
+TEST(MeshOptimizerTest, CacheOrderBeatsShuffledOrder)
+{
+  Lotus::Sphere sphere;
+
+  std::vector<unsigned int> indices = sphere.indices;
+
+  // Triangles in random order, the vertices stay in place
+  std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+  std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(unsigned int));
+  std::shuffle(triangles.begin(), triangles.end(), std::mt19937(4));
+  std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(unsigned int));
+
+  float shuffledACMR = Lotus::analyzeVertexCache(indices, sphere.vertices.size()).ACMR;
+
+  std::vector<uint32_t> clusters;
+  Lotus::optimizeVertexCache(indices, sphere.vertices.size(), &clusters);
+
+  EXPECT_EQ(indices.size(), sphere.indices.size());
+  EXPECT_LT(Lotus::analyzeVertexCache(indices, sphere.vertices.size()).ACMR, shuffledACMR * 0.5f);
+
+  ASSERT_FALSE(clusters.empty());
+  EXPECT_EQ(clusters.front(), 0u);
+  EXPECT_TRUE(std::is_sorted(clusters.begin(), clusters.end()));
+
+  // The overdraw ordering moves whole clusters, so the cache efficiency stays close
+  float cacheACMR = Lotus::analyzeVertexCache(indices, sphere.vertices.size()).ACMR;
+
+  Lotus::optimizeOverdraw(indices, sphere.vertices, clusters);
+
+  EXPECT_EQ(indices.size(), sphere.indices.size());
+  EXPECT_LE(Lotus::analyzeVertexCache(indices, sphere.vertices.size()).ACMR, cacheACMR * 1.1f);
+}
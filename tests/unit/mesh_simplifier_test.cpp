@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include "math/bounds.h"
+#include "math/mesh_simplifier.h"
+
+namespace
+{
+  // Grid of size x size quads over the xy plane, the height of each vertex is given by the function
+  void createHeightfield(uint32_t size, const std::function<float(float, float)>& height, std::vector<Lotus::Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    for (uint32_t y = 0; y <= size; y++)
+    {
+      for (uint32_t x = 0; x <= size; x++)
+      {
+        Lotus::Vertex vertex;
+        vertex.position = glm::vec3(float(x), float(y), height(float(x), float(y)));
+        vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+        vertex.uv = glm::vec2(float(x), float(y)) / float(size);
+        vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+        vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+
+        vertices.push_back(vertex);
+      }
+    }
+
+    for (uint32_t y = 0; y < size; y++)
+    {
+      for (uint32_t x = 0; x < size; x++)
+      {
+        unsigned int a = y * (size + 1) + x;
+        unsigned int b = a + 1;
+        unsigned int c = a + size + 2;
+        unsigned int d = a + size + 1;
+
+        indices.insert(indices.end(), { a, b, c, a, c, d });
+      }
+    }
+  }
+
+  float waves(float x, float y)
+  {
+    return 2.0f * std::sin(x * 0.2f) * std::cos(y * 0.15f);
+  }
+
+  glm::vec3 getNormal(const std::vector<Lotus::Vertex>& vertices, const unsigned int* triangle)
+  {
+    const glm::vec3& p0 = vertices[triangle[0]].position;
+
+    return glm::cross(vertices[triangle[1]].position - p0, vertices[triangle[2]].position - p0);
+  }
+
+  // Height of the simplified heightfield under a point, found through the triangle that covers it
+  float sampleHeight(const std::vector<Lotus::Vertex>& vertices, const std::vector<unsigned int>& indices, glm::vec2 point)
+  {
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+      glm::vec3 p0 = vertices[indices[i]].position;
+      glm::vec3 p1 = vertices[indices[i + 1]].position;
+      glm::vec3 p2 = vertices[indices[i + 2]].position;
+
+      glm::vec2 e1 = glm::vec2(p1.x - p0.x, p1.y - p0.y);
+      glm::vec2 e2 = glm::vec2(p2.x - p0.x, p2.y - p0.y);
+      glm::vec2 offset = glm::vec2(point.x - p0.x, point.y - p0.y);
+
+      float determinant = e1.x * e2.y - e1.y * e2.x;
+      float u = (offset.x * e2.y - offset.y * e2.x) / determinant;
+      float v = (e1.x * offset.y - e1.y * offset.x) / determinant;
+
+      if (u >= -1e-5f && v >= -1e-5f && u + v <= 1.0f + 1e-5f)
+      {
+        return p0.z + u * (p1.z - p0.z) + v * (p2.z - p0.z);
+      }
+    }
+
+    return NAN;
+  }
+}
+
+TEST(MeshSimplifierTest, FlatSurfacesSimplifyWithoutError)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createHeightfield(32, [](float, float) { return 0.0f; }, vertices, indices);
+
+  std::vector<unsigned int> simplified;
+  float error = -1.0f;
+
+  Lotus::simplifyMesh(vertices, indices, simplified, 0, 0.0f, &error);
+
+  EXPECT_EQ(error, 0.0f);
+  EXPECT_LT(simplified.size(), indices.size() / 4);
+
+  // The border vertices are locked, so the simplified triangles still cover the whole grid without flips
+  float area = 0.0f;
+
+  for (size_t i = 0; i < simplified.size(); i += 3)
+  {
+    glm::vec3 normal = getNormal(vertices, simplified.data() + i);
+
+    ASSERT_GT(normal.z, 0.0f) << "Triangle " << i / 3;
+    area += normal.z * 0.5f;
+  }
+
+  EXPECT_NEAR(area, 32.0f * 32.0f, 1e-2f);
+}
+
+TEST(MeshSimplifierTest, CurvedSurfacesStayWithinTheErrorBound)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createHeightfield(64, waves, vertices, indices);
+
+  std::vector<unsigned int> simplified;
+  float error = -1.0f;
+
+  // Every triangle has its own plane, so nothing can move without error
+  Lotus::simplifyMesh(vertices, indices, simplified, 0, 0.0f, &error);
+
+  EXPECT_EQ(simplified.size(), indices.size());
+  EXPECT_EQ(error, 0.0f);
+
+  const float targetError = 0.05f;
+
+  Lotus::simplifyMesh(vertices, indices, simplified, indices.size() / 4, targetError, &error);
+
+  EXPECT_LE(error, targetError);
+  EXPECT_GT(error, 0.0f);
+  EXPECT_LE(simplified.size(), indices.size() * 3 / 4);
+
+  float maxDeviation = 0.0f;
+
+  for (const Lotus::Vertex& vertex : vertices)
+  {
+    float height = sampleHeight(vertices, simplified, glm::vec2(vertex.position.x, vertex.position.y));
+
+    ASSERT_FALSE(std::isnan(height)) << "The simplified grid has a hole at " << vertex.position.x << ", " << vertex.position.y;
+    maxDeviation = std::max(maxDeviation, std::abs(height - vertex.position.z));
+  }
+
+  EXPECT_LE(maxDeviation, targetError);
+}
+
+TEST(MeshSimplifierTest, GeneratesAChainOfCoarserLODs)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createHeightfield(128, [](float x, float y) { return waves(x, y) * 0.25f; }, vertices, indices);
+
+  std::vector<unsigned int> fullIndices = indices;
+  std::vector<Lotus::MeshLOD> lods;
+
+  Lotus::generateMeshLODs(vertices, indices, lods);
+
+  ASSERT_GE(lods.size(), 3u);
+  ASSERT_LE(lods.size(), Lotus::MaxMeshLODs);
+
+  // The full mesh is kept in front of the other levels
+  EXPECT_EQ(lods[0].firstIndex, 0u);
+  EXPECT_EQ(lods[0].count, fullIndices.size());
+  EXPECT_EQ(lods[0].error, 0.0f);
+  EXPECT_TRUE(std::equal(fullIndices.begin(), fullIndices.end(), indices.begin()));
+
+  float radius = Lotus::computeMeshBounds(vertices.data(), vertices.size()).sphere.w;
+
+  for (size_t i = 1; i < lods.size(); i++)
+  {
+    EXPECT_EQ(lods[i].firstIndex, lods[i - 1].firstIndex + lods[i - 1].count);
+    EXPECT_EQ(lods[i].count % 3, 0u);
+    EXPECT_LE(lods[i].count, lods[i - 1].count * Lotus::LODMinimumReduction);
+    EXPECT_GE(lods[i].error, lods[i - 1].error);
+    EXPECT_LE(lods[i].error, float(i) * Lotus::LODMaxRelativeError * radius);
+  }
+
+  EXPECT_EQ(lods.back().firstIndex + lods.back().count, indices.size());
+
+  for (unsigned int index : indices)
+  {
+    ASSERT_LT(index, vertices.size());
+  }
+}
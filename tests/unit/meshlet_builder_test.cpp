@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include "math/meshlet_builder.h"
+#include "render/indirect/culling.h"
+
+namespace
+{
+  // Latitude longitude sphere with outward, counter clockwise triangles
+  void createSphere(uint32_t rings, uint32_t segments, std::vector<Lotus::Vertex>& vertices, std::vector<unsigned int>& indices)
+  {
+    const float pi = 3.14159265f;
+
+    for (uint32_t ring = 0; ring <= rings; ring++)
+    {
+      float theta = pi * float(ring) / float(rings);
+
+      for (uint32_t segment = 0; segment <= segments; segment++)
+      {
+        float phi = 2.0f * pi * float(segment) / float(segments);
+
+        Lotus::Vertex vertex;
+        vertex.position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        vertex.normal = vertex.position;
+        vertex.uv = glm::vec2(float(segment) / float(segments), float(ring) / float(rings));
+        vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+        vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+
+        vertices.push_back(vertex);
+      }
+    }
+
+    for (uint32_t ring = 0; ring < rings; ring++)
+    {
+      for (uint32_t segment = 0; segment < segments; segment++)
+      {
+        unsigned int a = ring * (segments + 1) + segment;
+        unsigned int b = a + 1;
+        unsigned int c = a + segments + 2;
+        unsigned int d = a + segments + 1;
+
+        // The triangles touching the poles are degenerate, they are kept to test that they are handled
+        indices.insert(indices.end(), { a, b, c, a, c, d });
+      }
+    }
+  }
+
+  glm::vec3 getNormal(const std::vector<Lotus::Vertex>& vertices, const unsigned int* triangle)
+  {
+    const glm::vec3& p0 = vertices[triangle[0]].position;
+
+    return glm::cross(vertices[triangle[1]].position - p0, vertices[triangle[2]].position - p0);
+  }
+}
+
+TEST(MeshletBuilderTest, MeshletsCoverTheIndicesWithinTheLimits)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createSphere(48, 96, vertices, indices);
+
+  std::vector<Lotus::Meshlet> meshlets;
+  Lotus::buildMeshlets(vertices, indices, meshlets);
+
+  ASSERT_FALSE(meshlets.empty());
+
+  uint32_t nextIndex = 0;
+
+  for (const Lotus::Meshlet& meshlet : meshlets)
+  {
+    ASSERT_EQ(meshlet.firstIndex, nextIndex);
+    ASSERT_GT(meshlet.count, 0u);
+    ASSERT_EQ(meshlet.count % 3, 0u);
+    ASSERT_LE(meshlet.count / 3, Lotus::MeshletMaxTriangles);
+
+    std::vector<unsigned int> meshletVertices(indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.count);
+    std::sort(meshletVertices.begin(), meshletVertices.end());
+    meshletVertices.erase(std::unique(meshletVertices.begin(), meshletVertices.end()), meshletVertices.end());
+
+    ASSERT_LE(meshletVertices.size(), Lotus::MeshletMaxVertices);
+
+    for (unsigned int vertex : meshletVertices)
+    {
+      float distance = glm::length(vertices[vertex].position - glm::vec3(meshlet.boundingSphere));
+
+      ASSERT_LE(distance, meshlet.boundingSphere.w * 1.0001f);
+    }
+
+    nextIndex += meshlet.count;
+  }
+
+  EXPECT_EQ(nextIndex, indices.size());
+
+  // Full meshlets are the common case, the scan only closes one early when a new triangle doesn't fit
+  EXPECT_LE(meshlets.size(), indices.size() / 3 / (Lotus::MeshletMaxTriangles / 4));
+}
+
+TEST(MeshletBuilderTest, BackfacingConesAreConservative)
+{
+  std::vector<Lotus::Vertex> vertices;
+  std::vector<unsigned int> indices;
+  createSphere(64, 128, vertices, indices);
+
+  std::vector<Lotus::Meshlet> meshlets;
+  Lotus::buildMeshlets(vertices, indices, meshlets);
+
+  const glm::vec3 cameras[] = {
+    glm::vec3(0.0f, 0.0f, 3.0f),
+    glm::vec3(10.0f, 4.0f, -2.0f),
+    glm::vec3(0.0f, -1.5f, 0.0f),
+    glm::vec3(0.7f, 0.7f, 0.7f)
+  };
+
+  for (const glm::vec3& camera : cameras)
+  {
+    size_t culled = 0;
+
+    for (const Lotus::Meshlet& meshlet : meshlets)
+    {
+      if (!Lotus::isConeBackfacing(glm::vec3(meshlet.boundingSphere), meshlet.boundingSphere.w, meshlet.cone, camera)) { continue; }
+
+      culled++;
+
+      // A culled meshlet has no triangle facing the camera
+      for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.count; i += 3)
+      {
+        glm::vec3 normal = getNormal(vertices, indices.data() + i);
+
+        ASSERT_LE(glm::dot(camera - vertices[indices[i]].position, normal), 1e-6f) << "Triangle " << i / 3 << " faces the camera";
+      }
+    }
+
+    // Close to half of a sphere faces away from a camera outside of it, less near the surface
+    EXPECT_GT(culled, meshlets.size() / 5) << "Camera at " << camera.x << ", " << camera.y << ", " << camera.z;
+  }
+}
+
+TEST(MeshletBuilderTest, FlatMeshletsHaveATightCone)
+{
+  // Two coplanar triangles facing +z, with a degenerate one between them
+  std::vector<Lotus::Vertex> vertices(4);
+  vertices[0].position = glm::vec3(0.0f, 0.0f, 0.0f);
+  vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+  vertices[2].position = glm::vec3(1.0f, 1.0f, 0.0f);
+  vertices[3].position = glm::vec3(0.0f, 1.0f, 0.0f);
+
+  std::vector<unsigned int> indices = { 0, 1, 2, 0, 0, 2, 0, 2, 3 };
+
+  Lotus::Meshlet meshlet = Lotus::computeMeshletBounds(vertices, indices, 0, static_cast<uint32_t>(indices.size()));
+
+  EXPECT_NEAR(meshlet.cone.z, 1.0f, 1e-6f);
+  EXPECT_NEAR(meshlet.cone.w, 0.0f, 1e-3f);
+  EXPECT_NEAR(meshlet.boundingSphere.w, std::sqrt(0.5f), 1e-6f);
+
+  // Seen from behind the plane it is culled, from the front or from its side it isn't
+  EXPECT_TRUE(Lotus::isConeBackfacing(glm::vec3(meshlet.boundingSphere), meshlet.boundingSphere.w, meshlet.cone, glm::vec3(0.5f, 0.5f, -5.0f)));
+  EXPECT_FALSE(Lotus::isConeBackfacing(glm::vec3(meshlet.boundingSphere), meshlet.boundingSphere.w, meshlet.cone, glm::vec3(0.5f, 0.5f, 5.0f)));
+  EXPECT_FALSE(Lotus::isConeBackfacing(glm::vec3(meshlet.boundingSphere), meshlet.boundingSphere.w, meshlet.cone, glm::vec3(5.0f, 0.5f, -0.1f)));
+}
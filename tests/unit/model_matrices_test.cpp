@@ -0,0 +1,154 @@
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include <glm/gtx/quaternion.hpp>
+#include "math/model_matrices.h"
+
+namespace
+{
+  struct Transforms
+  {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::fquat> rotations;
+    std::vector<glm::vec3> scales;
+  };
+
+  // Counts that aren't multiples of the SIMD widths exercise the scalar tail
+  Transforms createTransforms(uint32_t count)
+  {
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    Transforms transforms;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+      transforms.translations.push_back(glm::vec3(distribution(generator), distribution(generator), distribution(generator)) * 50.0f);
+      transforms.rotations.push_back(glm::normalize(glm::fquat(distribution(generator), distribution(generator), distribution(generator), distribution(generator))));
+      transforms.scales.push_back(glm::vec3(distribution(generator) + 2.0f, distribution(generator) + 2.0f, distribution(generator) + 2.0f));
+    }
+
+    return transforms;
+  }
+
+  glm::mat4 referenceModelMatrix(const glm::vec3& translation, const glm::fquat& rotation, const glm::vec3& scale)
+  {
+    return glm::translate(glm::mat4(1.0f), translation) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+  }
+
+  void expectMatricesNear(const glm::mat4& actual, const glm::mat4& expected)
+  {
+    for (int c = 0; c < 4; c++)
+    {
+      for (int r = 0; r < 4; r++)
+      {
+        EXPECT_NEAR(actual[c][r], expected[c][r], 1e-4f) << "column " << c << ", row " << r;
+      }
+    }
+  }
+}
+
+TEST(ModelMatricesTest, ComposesLikeGLM)
+{
+  Transforms transforms = createTransforms(1);
+
+  expectMatricesNear(
+      Lotus::composeModelMatrix(transforms.translations[0], transforms.rotations[0], transforms.scales[0]),
+      referenceModelMatrix(transforms.translations[0], transforms.rotations[0], transforms.scales[0]));
+
+  expectMatricesNear(
+      Lotus::composeModelMatrix(glm::vec3(0.0f), glm::fquat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f)),
+      glm::mat4(1.0f));
+}
+
+TEST(ModelMatricesTest, BatchedMatchesReference)
+{
+  const uint32_t count = 103;
+  Transforms transforms = createTransforms(count);
+
+  std::vector<glm::mat4> matrices(count);
+  Lotus::composeModelMatrices(transforms.translations.data(), transforms.rotations.data(), transforms.scales.data(), matrices.data(), count);
+
+  for (uint32_t i = 0; i < count; i++)
+  {
+    expectMatricesNear(matrices[i], referenceModelMatrix(transforms.translations[i], transforms.rotations[i], transforms.scales[i]));
+  }
+}
+
+TEST(ModelMatricesTest, ScatteredMatchesReference)
+{
+  const uint32_t count = 101;
+  Transforms transforms = createTransforms(count);
+
+  std::vector<uint32_t> indices;
+
+  for (uint32_t i = count; i-- > 0;)
+  {
+    if (i % 3 != 1) { indices.push_back(i); }
+  }
+
+  std::vector<glm::mat4> matrices(indices.size());
+  Lotus::composeModelMatrices(transforms.translations.data(), transforms.rotations.data(), transforms.scales.data(), indices.data(), matrices.data(), indices.size());
+
+  for (size_t i = 0; i < indices.size(); i++)
+  {
+    uint32_t index = indices[i];
+    expectMatricesNear(matrices[i], referenceModelMatrix(transforms.translations[index], transforms.rotations[index], transforms.scales[index]));
+  }
+}
+
+TEST(ModelMatricesTest, NormalMatrixMatchesTheInverseTranspose)
+{
+  Transforms transforms = createTransforms(17);
+
+  // A mirroring scale has a negative determinant
+  transforms.scales[0].y = -transforms.scales[0].y;
+
+  std::mt19937 generator(5);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+  for (uint32_t i = 0; i < transforms.scales.size(); i++)
+  {
+    glm::mat4 model = Lotus::composeModelMatrix(transforms.translations[i], transforms.rotations[i], transforms.scales[i]);
+    glm::mat3 normalMatrix = Lotus::computeNormalMatrix(model);
+    glm::mat3 reference = glm::transpose(glm::inverse(glm::mat3(model)));
+
+    // The shaders normalize the normals, so only the directions have to match
+    glm::vec3 normal = glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)));
+    glm::vec3 actual = glm::normalize(normalMatrix * normal);
+    glm::vec3 expected = glm::normalize(reference * normal);
+
+    EXPECT_NEAR(actual.x, expected.x, 1e-4f) << "transform " << i;
+    EXPECT_NEAR(actual.y, expected.y, 1e-4f) << "transform " << i;
+    EXPECT_NEAR(actual.z, expected.z, 1e-4f) << "transform " << i;
+  }
+}
+
+TEST(ModelMatricesTest, WritesTheObjectModelAsStd140Columns)
+{
+  glm::mat4 model = Lotus::composeModelMatrix(glm::vec3(1.0f, 2.0f, 3.0f), glm::fquat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(2.0f, 4.0f, 8.0f));
+
+  Lotus::GPUObjectData object;
+  object.boundingSphere = glm::vec4(1.0f);
+  Lotus::writeObjectModel(model, object);
+
+  expectMatricesNear(object.model, model);
+
+  // The cofactors of a diagonal matrix are the products of the other two scales
+  EXPECT_FLOAT_EQ(object.normalMatrix[0].x, 32.0f);
+  EXPECT_FLOAT_EQ(object.normalMatrix[1].y, 16.0f);
+  EXPECT_FLOAT_EQ(object.normalMatrix[2].z, 8.0f);
+
+  for (int c = 0; c < 3; c++)
+  {
+    EXPECT_EQ(object.normalMatrix[c].w, 0.0f);
+  }
+
+  EXPECT_EQ(offsetof(Lotus::GPUObjectData, normalMatrix), 64u);
+  EXPECT_EQ(offsetof(Lotus::GPUObjectData, materialHandle), 112u);
+  EXPECT_EQ(offsetof(Lotus::GPUObjectData, boundingSphere), 128u);
+  EXPECT_EQ(object.boundingSphere, glm::vec4(1.0f));
+}
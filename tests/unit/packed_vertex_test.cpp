@@ -0,0 +1,107 @@
+#include <cmath>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <glm/glm.hpp>
+#include "math/packed_vertex.h"
+
+namespace
+{
+  glm::vec3 randomDirection(std::mt19937& generator)
+  {
+    std::normal_distribution<float> distribution;
+
+    return glm::normalize(glm::vec3(distribution(generator), distribution(generator), distribution(generator)));
+  }
+}
+
+TEST(PackedVertexTest, OctahedralEncodingRoundTrips)
+{
+  std::mt19937 generator(3);
+
+  std::vector<glm::vec3> directions =
+  {
+    { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+    { 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+  };
+
+  for (int i = 0; i < 10000; i++)
+  {
+    directions.push_back(randomDirection(generator));
+  }
+
+  for (const glm::vec3& direction : directions)
+  {
+    glm::vec2 encoded = Lotus::encodeOctahedral(direction);
+
+    ASSERT_LE(std::abs(encoded.x), 1.0f);
+    ASSERT_LE(std::abs(encoded.y), 1.0f);
+    ASSERT_GT(glm::dot(Lotus::decodeOctahedral(encoded), direction), 0.99999f);
+  }
+}
+
+TEST(PackedVertexTest, PackedVerticesKeepTheirAttributes)
+{
+  std::mt19937 generator(11);
+  std::uniform_real_distribution<float> position(-50.0f, 150.0f);
+  std::uniform_real_distribution<float> uv(-2.0f, 2.0f);
+
+  std::vector<Lotus::Vertex> vertices(5000);
+
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    Lotus::Vertex& vertex = vertices[i];
+
+    vertex.position = glm::vec3(position(generator), position(generator) * 0.1f, position(generator));
+    vertex.normal = randomDirection(generator);
+    vertex.tangent = glm::normalize(glm::cross(vertex.normal, randomDirection(generator)));
+    vertex.uv = glm::vec2(uv(generator), uv(generator));
+
+    // Half of the vertices have mirrored UVs
+    vertex.bitangent = glm::cross(vertex.normal, vertex.tangent) * (i % 2 == 0 ? 1.0f : -1.0f);
+  }
+
+  Lotus::MeshBounds bounds = Lotus::computeMeshBounds(vertices.data(), vertices.size());
+  glm::vec3 extent = bounds.maximum - bounds.minimum;
+
+  std::vector<Lotus::PackedVertex> packedVertices(vertices.size());
+  Lotus::packVertices(vertices.data(), vertices.size(), bounds, packedVertices.data());
+
+  EXPECT_EQ(sizeof(Lotus::PackedVertex), 20u);
+
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    const Lotus::Vertex& vertex = vertices[i];
+    Lotus::Vertex unpacked = Lotus::unpackVertex(packedVertices[i], bounds);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+      // Half a quantization step, and the float error of the decoding
+      ASSERT_NEAR(unpacked.position[axis], vertex.position[axis], extent[axis] / 65535.0f * 0.5f + 1e-4f) << "Vertex " << i;
+    }
+
+    ASSERT_GT(glm::dot(unpacked.normal, vertex.normal), 0.99999f) << "Vertex " << i;
+    ASSERT_GT(glm::dot(unpacked.tangent, vertex.tangent), 0.99999f) << "Vertex " << i;
+    ASSERT_GT(glm::dot(unpacked.bitangent, vertex.bitangent), 0.9999f) << "Vertex " << i;
+
+    // Half floats keep 11 bits of mantissa, tiny values may be flushed to zero
+    ASSERT_NEAR(unpacked.uv.x, vertex.uv.x, std::abs(vertex.uv.x) / 1024.0f + 1e-4f) << "Vertex " << i;
+    ASSERT_NEAR(unpacked.uv.y, vertex.uv.y, std::abs(vertex.uv.y) / 1024.0f + 1e-4f) << "Vertex " << i;
+  }
+}
+
+TEST(PackedVertexTest, FlatMeshesKeepTheirFlatAxis)
+{
+  Lotus::Plane plane;
+
+  Lotus::MeshBounds bounds = Lotus::computeMeshBounds(plane.vertices.data(), plane.vertices.size());
+
+  for (const Lotus::Vertex& vertex : plane.vertices)
+  {
+    Lotus::Vertex unpacked = Lotus::unpackVertex(Lotus::packVertex(vertex, bounds), bounds);
+
+    EXPECT_EQ(unpacked.position, vertex.position);
+    EXPECT_EQ(unpacked.uv, vertex.uv);
+    EXPECT_GT(glm::dot(unpacked.normal, vertex.normal), 0.99999f);
+  }
+}
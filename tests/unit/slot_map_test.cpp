@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+#include <gtest/gtest.h>
+#include "util/slot_map.h"
+
+TEST(SlotMapTest, InsertsAndFinds)
+{
+  Lotus::SlotMap<int> slotMap;
+
+  Lotus::Handle<int> first = slotMap.insert(10);
+  Lotus::Handle<int> second = slotMap.insert(20);
+
+  EXPECT_EQ(slotMap.size(), 2u);
+  EXPECT_TRUE(slotMap.contains(first));
+  EXPECT_TRUE(slotMap.contains(second));
+  EXPECT_EQ(slotMap[first], 10);
+  EXPECT_EQ(slotMap[second], 20);
+  EXPECT_FALSE(slotMap.contains(Lotus::Handle<int>(7)));
+}
+
+TEST(SlotMapTest, DetectsStaleHandles)
+{
+  Lotus::SlotMap<int> slotMap;
+
+  Lotus::Handle<int> first = slotMap.insert(10);
+  Lotus::Handle<int> second = slotMap.insert(20);
+
+  EXPECT_TRUE(slotMap.erase(first));
+  EXPECT_FALSE(slotMap.erase(first));
+  EXPECT_FALSE(slotMap.contains(first));
+  EXPECT_EQ(slotMap.find(first), nullptr);
+
+  // The slot is reused with a new generation, so the old handle doesn't alias the new element
+  Lotus::Handle<int> third = slotMap.insert(30);
+
+  EXPECT_EQ(third.get(), first.get());
+  EXPECT_NE(third.getGeneration(), first.getGeneration());
+  EXPECT_FALSE(slotMap.contains(first));
+  EXPECT_EQ(slotMap[third], 30);
+  EXPECT_EQ(slotMap[second], 20);
+
+  slotMap.clear();
+
+  EXPECT_TRUE(slotMap.empty());
+  EXPECT_FALSE(slotMap.contains(second));
+  EXPECT_FALSE(slotMap.contains(third));
+}
+
+TEST(SlotMapTest, KeepsElementsDense)
+{
+  Lotus::SlotMap<uint32_t> slotMap;
+  std::unordered_map<uint32_t, Lotus::Handle<uint32_t>> handles;
+
+  std::mt19937 generator(5);
+  uint32_t nextValue = 0;
+
+  for (int step = 0; step < 20000; step++)
+  {
+    if (handles.empty() || generator() % 3 != 0)
+    {
+      handles[nextValue] = slotMap.insert(nextValue);
+      nextValue++;
+    }
+    else
+    {
+      auto it = handles.begin();
+      std::advance(it, generator() % std::min<size_t>(handles.size(), 16));
+
+      EXPECT_TRUE(slotMap.erase(it->second));
+      handles.erase(it);
+    }
+  }
+
+  ASSERT_EQ(slotMap.size(), handles.size());
+
+  for (const auto& [value, handle] : handles)
+  {
+    ASSERT_TRUE(slotMap.contains(handle));
+    EXPECT_EQ(slotMap[handle], value);
+  }
+
+  // Dense iteration visits every element once, and the dense positions map back to the handles
+  size_t denseIndex = 0;
+
+  for (uint32_t value : slotMap)
+  {
+    ASSERT_EQ(handles.count(value), 1u);
+    EXPECT_TRUE(slotMap.getHandle(denseIndex) == handles[value]);
+    denseIndex++;
+  }
+
+  EXPECT_EQ(denseIndex, handles.size());
+  EXPECT_LE(slotMap.getSlotsCount(), static_cast<size_t>(nextValue));
+}
@@ -0,0 +1,92 @@
+#include <cstdint>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "math/radix_sort.h"
+#include "render/indirect/sort_key.h"
+
+TEST(SortKeyLayoutTest, PacksAndExtractsFields)
+{
+  Lotus::SortKeyLayout layout;
+  layout.shaderBits = 6;
+  layout.meshBits = 20;
+  layout.materialBits = 22;
+  layout.depthBits = 16;
+
+  ASSERT_TRUE(layout.isValid());
+
+  uint64_t key = layout.pack(37, 123456, 3000000, 65535);
+
+  EXPECT_EQ(layout.getShader(key), 37u);
+  EXPECT_EQ(layout.getMesh(key), 123456u);
+  EXPECT_EQ(layout.getMaterial(key), 3000000u);
+  EXPECT_EQ(layout.getDepthBucket(key), 65535u);
+}
+
+TEST(SortKeyLayoutTest, OrdersByShaderThenMeshThenMaterialThenDepth)
+{
+  Lotus::SortKeyLayout layout;
+  layout.materialBits = 16;
+  layout.depthBits = 8;
+
+  EXPECT_LT(layout.pack(0, 900, 900, 200), layout.pack(1, 0, 0, 0));
+  EXPECT_LT(layout.pack(1, 2, 900, 200), layout.pack(1, 3, 0, 0));
+  EXPECT_LT(layout.pack(1, 3, 4, 200), layout.pack(1, 3, 5, 0));
+  EXPECT_LT(layout.pack(1, 3, 5, 7), layout.pack(1, 3, 5, 8));
+}
+
+TEST(SortKeyLayoutTest, IgnoresEmptyFields)
+{
+  Lotus::SortKeyLayout layout;
+
+  EXPECT_EQ(layout.pack(2, 5, 100, 100), layout.pack(2, 5, 0, 0));
+  EXPECT_EQ(layout.getMaterial(layout.pack(2, 5, 100, 100)), 0u);
+}
+
+TEST(RadixSortTest, MatchesStableSort)
+{
+  struct Element
+  {
+    uint64_t key;
+    uint32_t order;
+  };
+
+  std::mt19937_64 generator(5);
+
+  for (uint32_t keyBits : { 4u, 13u, 32u, 64u })
+  {
+    uint64_t mask = keyBits == 64 ? ~uint64_t(0) : (uint64_t(1) << keyBits) - 1;
+
+    std::vector<Element> elements(5000);
+
+    for (uint32_t i = 0; i < elements.size(); i++)
+    {
+      elements[i] = { generator() & mask, i };
+    }
+
+    std::vector<Element> expected = elements;
+    std::stable_sort(expected.begin(), expected.end(), [](const Element& a, const Element& b) { return a.key < b.key; });
+
+    std::vector<Element> scratch;
+    Lotus::radixSort(elements, scratch, [](const Element& element) { return element.key; }, keyBits);
+
+    ASSERT_EQ(elements.size(), expected.size());
+
+    for (size_t i = 0; i < elements.size(); i++)
+    {
+      EXPECT_EQ(elements[i].key, expected[i].key);
+      EXPECT_EQ(elements[i].order, expected[i].order);
+    }
+  }
+}
+
+TEST(RadixSortTest, SkipsConstantKeys)
+{
+  std::vector<uint32_t> values = { 7, 7, 7, 7 };
+  std::vector<uint32_t> scratch;
+
+  Lotus::radixSort(values, scratch, [](uint32_t value) { return value; }, 32);
+
+  EXPECT_EQ(values, std::vector<uint32_t>({ 7, 7, 7, 7 }));
+}
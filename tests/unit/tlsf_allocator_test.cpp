@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include "util/tlsf_allocator.h"
+
+using Lotus::TLSFAllocator;
+
+TEST(TLSFAllocatorTest, BinsRoundSizes)
+{
+  for (uint32_t size = 1; size < (1u << 20); size += 1 + size / 7)
+  {
+    uint32_t upperBin = TLSFAllocator::sizeToBinRoundUp(size);
+    uint32_t lowerBin = TLSFAllocator::sizeToBinRoundDown(size);
+
+    // Any block stored in the rounded up bin fits the size, and a block is never stored in a bin larger than itself
+    EXPECT_GE(TLSFAllocator::binToSize(upperBin), size);
+    EXPECT_LE(TLSFAllocator::binToSize(lowerBin), size);
+    EXPECT_LE(upperBin - lowerBin, 1u);
+  }
+}
+
+TEST(TLSFAllocatorTest, MergesFreedNeighbors)
+{
+  TLSFAllocator allocator(1000);
+
+  TLSFAllocator::Allocation a = allocator.allocate(100);
+  TLSFAllocator::Allocation b = allocator.allocate(200);
+  TLSFAllocator::Allocation c = allocator.allocate(300);
+
+  ASSERT_TRUE(a.valid() && b.valid() && c.valid());
+  EXPECT_EQ(a.offset, 0u);
+  EXPECT_EQ(b.offset, 100u);
+  EXPECT_EQ(c.offset, 300u);
+
+  allocator.free(a);
+  allocator.free(c);
+
+  TLSFAllocator::Statistics statistics = allocator.getStatistics();
+
+  EXPECT_EQ(statistics.usedSize, 200u);
+  EXPECT_EQ(statistics.freeBlocksCount, 2u);
+  EXPECT_EQ(statistics.largestFreeBlock, 700u);
+  EXPECT_GT(statistics.getFragmentation(), 0.0f);
+
+  // Freeing the middle range joins the whole space again
+  allocator.free(b);
+
+  statistics = allocator.getStatistics();
+
+  EXPECT_EQ(statistics.freeBlocksCount, 1u);
+  EXPECT_EQ(statistics.largestFreeBlock, 1000u);
+  EXPECT_EQ(statistics.allocationsCount, 0u);
+  EXPECT_EQ(statistics.getFragmentation(), 0.0f);
+
+  EXPECT_EQ(allocator.allocate(1000).offset, 0u);
+}
+
+TEST(TLSFAllocatorTest, GrowsAtTheEnd)
+{
+  TLSFAllocator allocator(64);
+
+  TLSFAllocator::Allocation first = allocator.allocate(48);
+
+  EXPECT_FALSE(allocator.allocate(32).valid());
+
+  allocator.grow(128);
+
+  // The free tail of the old space is merged with the added space
+  TLSFAllocator::Allocation second = allocator.allocate(32);
+
+  ASSERT_TRUE(second.valid());
+  EXPECT_EQ(second.offset, 48u);
+  EXPECT_EQ(allocator.getStatistics().freeBlocksCount, 1u);
+
+  allocator.free(first);
+  allocator.free(second);
+
+  EXPECT_EQ(allocator.getStatistics().largestFreeBlock, 128u);
+}
+
+TEST(TLSFAllocatorTest, SlidesAllocationsIntoHoles)
+{
+  TLSFAllocator allocator(100);
+
+  TLSFAllocator::Allocation a = allocator.allocate(10);
+  TLSFAllocator::Allocation b = allocator.allocate(20);
+  TLSFAllocator::Allocation c = allocator.allocate(30);
+
+  allocator.free(a);
+
+  // The first allocation has no free block before it
+  EXPECT_EQ(allocator.slideDown(b.node), 0u);
+  EXPECT_EQ(allocator.slideDown(b.node), 0u);
+  EXPECT_EQ(allocator.slideDown(c.node), 20u);
+  EXPECT_EQ(allocator.getAllocationOffset(c.node), 20u);
+
+  // The holes ended merged with the free tail
+  TLSFAllocator::Statistics statistics = allocator.getStatistics();
+
+  EXPECT_EQ(statistics.freeBlocksCount, 1u);
+  EXPECT_EQ(statistics.largestFreeBlock, 50u);
+
+  EXPECT_EQ(allocator.shrink(0), 50u);
+  EXPECT_EQ(allocator.getStatistics().freeBlocksCount, 0u);
+  EXPECT_FALSE(allocator.allocate(1).valid());
+
+  allocator.free(c);
+
+  // Only free space is removed from the end
+  EXPECT_EQ(allocator.shrink(40), 40u);
+  EXPECT_EQ(allocator.getStatistics().largestFreeBlock, 20u);
+}
+
+TEST(TLSFAllocatorTest, FuzzAgainstOccupancyMap)
+{
+  const uint32_t capacity = 1 << 14;
+
+  std::mt19937 generator(11);
+  std::uniform_int_distribution<uint32_t> sizeDistribution(1, 300);
+  std::uniform_int_distribution<int> actionDistribution(0, 9);
+
+  TLSFAllocator allocator(capacity);
+  std::vector<TLSFAllocator::Allocation> allocations;
+  std::vector<uint32_t> sizes;
+  std::vector<bool> occupied(capacity, false);
+  uint32_t usedSize = 0;
+
+  for (int step = 0; step < 20000; step++)
+  {
+    if (actionDistribution(generator) < 6 || allocations.empty())
+    {
+      uint32_t size = sizeDistribution(generator);
+      TLSFAllocator::Allocation allocation = allocator.allocate(size);
+
+      if (!allocation.valid()) { continue; }
+
+      ASSERT_LE(allocation.offset + size, capacity);
+
+      for (uint32_t i = allocation.offset; i < allocation.offset + size; i++)
+      {
+        ASSERT_FALSE(occupied[i]) << "Allocation overlaps at " << i;
+        occupied[i] = true;
+      }
+
+      allocations.push_back(allocation);
+      sizes.push_back(size);
+      usedSize += size;
+    }
+    else
+    {
+      size_t index = std::uniform_int_distribution<size_t>(0, allocations.size() - 1)(generator);
+
+      for (uint32_t i = allocations[index].offset; i < allocations[index].offset + sizes[index]; i++)
+      {
+        occupied[i] = false;
+      }
+
+      allocator.free(allocations[index]);
+      usedSize -= sizes[index];
+
+      allocations[index] = allocations.back();
+      allocations.pop_back();
+      sizes[index] = sizes.back();
+      sizes.pop_back();
+    }
+
+    if (step % 500 == 0)
+    {
+      // Free blocks are always merged, so they match the runs of free elements
+      uint32_t freeRuns = 0;
+      uint32_t largestRun = 0;
+      uint32_t run = 0;
+
+      for (uint32_t i = 0; i <= capacity; i++)
+      {
+        if (i < capacity && !occupied[i])
+        {
+          run++;
+        }
+        else if (run > 0)
+        {
+          freeRuns++;
+          largestRun = std::max(largestRun, run);
+          run = 0;
+        }
+      }
+
+      TLSFAllocator::Statistics statistics = allocator.getStatistics();
+
+      ASSERT_EQ(statistics.usedSize, usedSize);
+      ASSERT_EQ(statistics.allocationsCount, allocations.size());
+      ASSERT_EQ(statistics.freeBlocksCount, freeRuns);
+      ASSERT_EQ(statistics.largestFreeBlock, largestRun);
+    }
+  }
+
+  for (const TLSFAllocator::Allocation& allocation : allocations)
+  {
+    allocator.free(allocation);
+  }
+
+  EXPECT_EQ(allocator.getStatistics().largestFreeBlock, capacity);
+}
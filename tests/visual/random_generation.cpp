@@ -118,11 +118,13 @@ int main()
 
   Lotus::Renderer renderer;
 	renderer.startUp();
+	renderer.setOcclusionCulling(true);
 
 	renderer.setAmbientLight(glm::vec3(0.1, 0.1, 0.1));
 	createDirectionalLight(renderer);
 
-  ventMesh = meshManager.loadMesh(Lotus::assetPath("models/air_conditioner/AirConditioner.obj").string());
+  // The vents appear once the mesh is loaded and uploaded, the window opens without waiting for it
+  ventMesh = meshManager.loadMeshAsync(Lotus::assetPath("models/air_conditioner/AirConditioner.obj").string());
 
 	for (int i = 0; i < objectsCount; i++)
 	{
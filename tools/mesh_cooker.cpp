@@ -0,0 +1,125 @@
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <assimp/Importer.hpp>
+
+#include "core/job_system.h"
+#include "math/mesh_optimizer.h"
+#include "render/indirect/cooked_mesh.h"
+#include "render/indirect/mesh_manager.h"
+
+/*
+  Cooks every mesh file given in the command line, directories are searched recursively. Each cooked file is
+  written next to its source with the .lmesh extension, the files that are already up to date are skipped
+*/
+
+void printUsage()
+{
+  std::cout << "Usage: mesh_cooker [--flip-uvs] [--force] [--stats] <file or directory>...\n"
+            << "  --flip-uvs  Flip the texture coordinates, as the flipUVs argument of MeshManager::loadMesh\n"
+            << "  --force     Cook the meshes even if their cooked file is up to date\n"
+            << "  --stats     Print the vertex cache statistics of the meshes before and after their optimization\n";
+}
+
+void printStatistics(const char* name, const Lotus::VertexCacheStatistics& statistics)
+{
+  std::cout << "  " << name << ": ACMR " << statistics.ACMR << ", ATVR " << statistics.ATVR
+            << ", " << statistics.verticesCount << " vertices, " << statistics.trianglesCount << " triangles\n";
+}
+
+bool isMeshFile(const std::filesystem::path& path, const Assimp::Importer& importer)
+{
+  std::string extension = path.extension().string();
+
+  return !extension.empty() && importer.IsExtensionSupported(extension);
+}
+
+int main(int argc, char** argv)
+{
+  bool flipUVs = false;
+  bool force = false;
+  bool statistics = false;
+  std::vector<std::filesystem::path> inputs;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (std::strcmp(argv[i], "--flip-uvs") == 0) { flipUVs = true; }
+    else if (std::strcmp(argv[i], "--force") == 0) { force = true; }
+    else if (std::strcmp(argv[i], "--stats") == 0) { statistics = true; }
+    else if (std::strcmp(argv[i], "--help") == 0)
+    {
+      printUsage();
+      return EXIT_SUCCESS;
+    }
+    else { inputs.emplace_back(argv[i]); }
+  }
+
+  if (inputs.empty())
+  {
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  Assimp::Importer importer;
+  std::vector<std::filesystem::path> meshPaths;
+
+  for (const std::filesystem::path& input : inputs)
+  {
+    if (std::filesystem::is_directory(input))
+    {
+      for (const auto& entry : std::filesystem::recursive_directory_iterator(input))
+      {
+        if (entry.is_regular_file() && isMeshFile(entry.path(), importer)) { meshPaths.push_back(entry.path()); }
+      }
+    }
+    else if (std::filesystem::is_regular_file(input))
+    {
+      meshPaths.push_back(input);
+    }
+    else
+    {
+      std::cerr << "Skipped " << input.string() << ", it doesn't exist\n";
+    }
+  }
+
+  // Every mesh has its own importer, so they are cooked on all the threads
+  std::vector<char> cooked(meshPaths.size(), 0);
+  // Only filled for the meshes imported in this run, the up to date ones aren't imported again
+  std::vector<Lotus::MeshOptimizationReport> reports(meshPaths.size());
+
+  Lotus::JobSystem::getInstance().parallelFor(meshPaths.size(), 1, [&](size_t first, size_t last)
+  {
+    for (size_t i = first; i < last; i++)
+    {
+      cooked[i] = Lotus::MeshManager::cookMesh(meshPaths[i], flipUVs, force, &reports[i]);
+    }
+  });
+
+  size_t failedCount = 0;
+
+  for (size_t i = 0; i < meshPaths.size(); i++)
+  {
+    if (cooked[i])
+    {
+      std::cout << "Cooked " << meshPaths[i].string() << " -> " << Lotus::getCookedMeshPath(meshPaths[i]).string() << "\n";
+
+      if (statistics && reports[i].after.trianglesCount > 0)
+      {
+        printStatistics("Imported", reports[i].before);
+        printStatistics("Optimized", reports[i].after);
+      }
+    }
+    else
+    {
+      std::cerr << "Failed " << meshPaths[i].string() << "\n";
+      failedCount++;
+    }
+  }
+
+  std::cout << meshPaths.size() - failedCount << " of " << meshPaths.size() << " meshes cooked\n";
+
+  return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}